@@ -109,35 +109,32 @@ int bytewise_copy(csalt_store *store, void *_)
 		progress = csalt_progress(csalt_store_size(first));
 
 	/*
-	 * We want blocking behaviour for this application, which
-	 * is achieved via a simple spin-looop.
+	 * We want blocking behaviour for this application.
 	 *
 	 * The ceasoning library is non-blocking by default, which
 	 * allows the construction of composite types that can implement
-	 * algorithms generically.
+	 * algorithms generically. csalt_store_transfer is a function
+	 * accepting any two stores and attempting a non-blocking transfer
+	 * between them, returning the total amount copied so far.
+	 *
+	 * csalt_store_transfer_wait builds blocking behaviour on top of
+	 * it: whenever a read or write makes no progress, it waits in
+	 * poll() on the file descriptor behind the store, instead of
+	 * spinning. The last argument is a timeout in milliseconds, with
+	 * -1 meaning no timeout.
+	 *
+	 * It returns the total amount copied, or -1 if there is an
+	 * error, so we only need one generic error check which works
+	 * across all stores, without having to worry about EAGAIN or
+	 * EWOULDBLOCK.
 	 */
-	while (!csalt_progress_complete(&progress))
-		/*
-		 * Non-blocking file descriptor types will return 0
-		 * when there's no data to read, and -1 when the file
-		 * descriptor is unavailable for reading/writing. That includes
-		 * types representing network sockets, etc.
-		 *
-		 * This allows us to do one generic error check which works
-		 * across all stores, without having to worry about
-		 * EAGAIN or EWOULDBLOCK.
-		 *
-		 * csalt_store_transfer is a function accepting any two stores
-		 * and attempting a non-blocking transfer between them. It
-		 * returns the total amount copied across all calls, or -1 if
-		 * there is an error.
-		 */
-		if (csalt_store_transfer(
-			&progress,
-			(csalt_static_store*)first,
-			(csalt_static_store*)second
-		) < 0)
-			return -1;
+	if (csalt_store_transfer_wait(
+		&progress,
+		(csalt_static_store*)first,
+		(csalt_static_store*)second,
+		-1
+	) < 0)
+		return -1;
 	return 0;
 }
 
@@ -0,0 +1,212 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_KV_BASE_H
+#define CSALT_KV_BASE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <csalt/platform/init.h>
+
+#include <csalt/stores.h>
+
+/**
+ * \file
+ * \brief This file defines the interface for key/value stores,
+ * which map keys of any length to values of any length.
+ *
+ * Values are handed out as stores rather than copied out, so
+ * they can be read, written in place, or passed straight to
+ * csalt_store_transfer(). Since a value may only stay where it is
+ * until the key/value store is next modified, the value store is
+ * only passed to a block, in the same way as csalt_store_split().
+ *
+ * Key/value stores are also static stores, so they can be
+ * returned from resources: csalt_store_read() and
+ * csalt_store_write() return -1, and csalt_store_split() passes
+ * the key/value store itself to the block.
+ */
+
+/**
+ * \brief Any struct whos first member is a pointer to
+ * a csalt_kv_interface can be passed with a basic cast to the
+ * virtual functions taking csalt_kv.
+ */
+typedef const struct csalt_kv_interface * const csalt_kv;
+
+/**
+ * \brief Function type for finding a value, and passing it to a
+ * block as a store.
+ */
+typedef int csalt_kv_get_fn(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \brief Function type for setting the value for a key, reading
+ * it from a store.
+ */
+typedef int csalt_kv_put_fn(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+);
+
+/**
+ * \brief Function type for removing a key and its value.
+ */
+typedef int csalt_kv_remove_fn(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size
+);
+
+/**
+ * \brief Type for a logic block called for each key and value by
+ * csalt_kv_iterate().
+ *
+ * Returning non-zero stops the iteration.
+ */
+typedef int csalt_kv_block_fn(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+);
+
+/**
+ * \brief Function type for calling a block on every key and value.
+ */
+typedef int csalt_kv_iterate_fn(
+	csalt_kv *kv,
+	csalt_kv_block_fn *block,
+	void *param
+);
+
+struct csalt_kv_interface {
+	struct csalt_static_store_interface parent;
+	csalt_kv_get_fn *get;
+	csalt_kv_put_fn *put;
+	csalt_kv_remove_fn *remove;
+	csalt_kv_iterate_fn *iterate;
+};
+
+/**
+ * \brief Finds the value for key, and passes it to block as a
+ * store.
+ *
+ * The value store is only valid inside the block, and the block
+ * must not modify kv.
+ *
+ * \returns The return value of block, or -1 if the key isn't
+ * 	present.
+ */
+int csalt_kv_get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \brief Sets the value for key to value_size bytes read from
+ * value, replacing any existing value.
+ *
+ * \returns 0 on success, or -1 on failure, in which case kv is
+ * 	left unchanged.
+ */
+int csalt_kv_put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+);
+
+/**
+ * \brief Removes key and its value.
+ *
+ * \returns 0 if the key was removed, or -1 if it wasn't present.
+ */
+int csalt_kv_remove(csalt_kv *kv, const void *key, ssize_t key_size);
+
+/**
+ * \brief Calls block on every key and value, in no particular
+ * order, until block returns non-zero.
+ *
+ * The block must not modify kv.
+ *
+ * \returns The first non-zero return value of block, or 0.
+ */
+int csalt_kv_iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param);
+
+/**
+ * \brief Implements csalt_store_read() for key/value stores by
+ * returning -1.
+ */
+ssize_t csalt_kv_read(csalt_static_store *store, void *buffer, ssize_t size);
+
+/**
+ * \brief Implements csalt_store_write() for key/value stores by
+ * returning -1.
+ */
+ssize_t csalt_kv_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+);
+
+/**
+ * \brief Implements csalt_store_split() for key/value stores by
+ * passing the key/value store itself to block.
+ */
+int csalt_kv_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \brief Reads value_size bytes from value into memory, for
+ * implementing csalt_kv_put().
+ *
+ * \returns 0 on success, or -1 if value couldn't supply
+ * 	value_size bytes.
+ */
+int csalt_kv_read_value(
+	csalt_static_store *value,
+	void *buffer,
+	ssize_t value_size
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_KV_BASE_H
@@ -0,0 +1,198 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_KV_BLOOM_H
+#define CSALT_KV_BLOOM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief This file defines a blocked Bloom filter, and a key/value
+ * decorator which uses one to skip lookups of missing keys.
+ */
+
+/**
+ * \brief The size of each block of a csalt_bloom, in bytes.
+ */
+#define CSALT_BLOOM_BLOCK_SIZE 32
+
+/**
+ * \brief The size of the header at the start of a saved
+ * 	csalt_bloom, in bytes.
+ */
+#define CSALT_BLOOM_HEADER_SIZE 32
+
+/**
+ * \brief A probabilistic set of keys, which can answer that a key
+ * 	is definitely missing, or may be present.
+ *
+ * The filter is split into blocks of 256 bits, each made of eight
+ * 32-bit words. A key sets one bit in each word of a single block,
+ * so every lookup touches one cache line, and the eight words can
+ * be tested with a single vector operation. At 10 bits per key,
+ * about 1% of missing keys are reported as present.
+ *
+ * The filter is stored as one allocation: a header, followed by
+ * the blocks. csalt_bloom_save() writes it to a store as it is, and
+ * csalt_bloom_view() uses a saved filter already in memory, such
+ * as a mapped file or a heap store, without copying it. Saved
+ * filters use the machine's byte order.
+ *
+ * Keys can't be removed from the filter.
+ */
+struct csalt_bloom {
+	char *image;
+	uint32_t *blocks;
+	uint64_t block_count;
+	uint64_t seed;
+	bool owned;
+};
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Allocates an empty filter.
+ *
+ * \param bloom The filter to initialize
+ * \param keys The number of keys expected
+ * \param bits_per_key The number of bits to use for each key
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_bloom_init(struct csalt_bloom *bloom, ssize_t keys, ssize_t bits_per_key);
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Uses a saved filter in memory, without copying it.
+ *
+ * The memory must stay valid, and 4-byte aligned, for as long as
+ * the filter is used. Adding keys modifies the memory.
+ *
+ * \returns 0 on success, or -1 if data doesn't hold a saved
+ * 	filter.
+ */
+int csalt_bloom_view(struct csalt_bloom *bloom, void *data, ssize_t size);
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Reads a saved filter from the start of store into a new
+ * 	allocation.
+ *
+ * \returns 0 on success, or -1 on failure.
+ */
+int csalt_bloom_load(struct csalt_bloom *bloom, csalt_static_store *store);
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Frees the filter, if it was allocated by
+ * 	csalt_bloom_init() or csalt_bloom_load().
+ */
+void csalt_bloom_deinit(struct csalt_bloom *bloom);
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Writes the filter to the start of store, in the form read
+ * 	by csalt_bloom_view() and csalt_bloom_load().
+ *
+ * \returns 0 on success, or -1 on failure, including when store
+ * 	stops accepting data before the whole filter is written.
+ */
+int csalt_bloom_save(const struct csalt_bloom *bloom, csalt_static_store *store);
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Returns the size of the saved filter, in bytes.
+ */
+ssize_t csalt_bloom_size(const struct csalt_bloom *bloom);
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Adds key to the filter.
+ */
+void csalt_bloom_add(struct csalt_bloom *bloom, const void *key, ssize_t key_size);
+
+/**
+ * \public \memberof csalt_bloom
+ * \brief Returns false if key was never added to the filter, or
+ * 	true if it may have been.
+ */
+bool csalt_bloom_contains(
+	const struct csalt_bloom *bloom,
+	const void *key,
+	ssize_t key_size
+);
+
+/**
+ * \brief Decorates a key/value store with a csalt_bloom, so gets
+ * 	of missing keys usually don't reach the decorated store.
+ *
+ * csalt_kv_get() returns -1 straight away for keys the filter
+ * says are missing. csalt_kv_put() adds the key to the filter once
+ * the decorated store has accepted it. csalt_kv_remove() and
+ * csalt_kv_iterate() are passed to the decorated store; removed
+ * keys stay in the filter.
+ *
+ * The filter must already hold every key in the decorated store,
+ * either because it was saved alongside it, or by calling
+ * csalt_kv_bloom_fill().
+ */
+struct csalt_kv_bloom {
+	const struct csalt_kv_interface *vtable;
+	csalt_kv *decorated;
+	struct csalt_bloom *filter;
+
+	/**
+	 * \brief The number of gets answered by the filter alone.
+	 */
+	size_t skipped;
+};
+
+/**
+ * \public \memberof csalt_kv_bloom
+ * \brief Constructs a new csalt_kv_bloom.
+ *
+ * \param decorated The key/value store to decorate
+ * \param filter An initialized filter, which must outlive the
+ * 	decorator
+ *
+ * \returns The new decorator
+ */
+struct csalt_kv_bloom csalt_kv_bloom(csalt_kv *decorated, struct csalt_bloom *filter);
+
+/**
+ * \public \memberof csalt_kv_bloom
+ * \brief Adds every key in the decorated store to the filter.
+ *
+ * \returns 0 on success, or the non-zero return value of
+ * 	csalt_kv_iterate().
+ */
+int csalt_kv_bloom_fill(struct csalt_kv_bloom *kv);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_KV_BLOOM_H
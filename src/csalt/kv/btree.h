@@ -0,0 +1,185 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_KV_BTREE_H
+#define CSALT_KV_BTREE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <stdint.h>
+
+#include <csalt/resource/base.h>
+#include <csalt/util.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_kv_btree
+ */
+
+/**
+ * \brief The largest key_size + value_size a single entry can
+ * 	have.
+ *
+ * This keeps at least four entries on every page, so splitting a
+ * page always leaves halves which fit.
+ */
+#define CSALT_KV_BTREE_MAX_ENTRY ((DEFAULT_PAGESIZE - 16) / 4 - 6)
+
+/**
+ * \brief The key/value store returned by csalt_resource_kv_btree.
+ */
+struct csalt_store_kv_btree {
+	const struct csalt_kv_interface *vtable;
+	csalt_store *file;
+	uint32_t root;
+	uint32_t page_count;
+	uint64_t count;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a B+tree kept in a dynamic store, such as a
+ * 	csalt_resource_file, ordering its keys by memcmp().
+ *
+ * The tree is made of DEFAULT_PAGESIZE nodes, aligned to
+ * DEFAULT_PAGESIZE in the store, so a lookup reads one page per
+ * level of the tree. Each node stores the prefix its keys share
+ * once, followed by the rest of each key, and separators in
+ * internal nodes are cut down to the shortest key which still
+ * separates their children, so more entries fit per page and the
+ * tree stays shallow.
+ *
+ * Leaves are linked in key order, so csalt_kv_iterate() and
+ * csalt_store_kv_btree_range() visit keys in order, reading leaf
+ * pages one after another.
+ *
+ * Values are passed to blocks as memory stores holding a copy of
+ * the value; writing to them doesn't change the tree.
+ *
+ * Pages are updated in place, and removals don't merge pages, so
+ * a tree which is mostly emptied keeps its size. The tree is not
+ * thread-safe.
+ *
+ * csalt_resource_init() initializes the given resource, and
+ * creates an empty tree if its store is empty.
+ * csalt_resource_deinit() deinitializes it again.
+ */
+struct csalt_resource_kv_btree {
+	const struct csalt_static_resource_interface *vtable;
+	csalt_resource *file;
+	struct csalt_store_kv_btree store;
+};
+
+/**
+ * \public \memberof csalt_resource_kv_btree
+ * \brief Constructs a new csalt_resource_kv_btree.
+ *
+ * \param file A resource returning a dynamic store to keep the
+ * 	tree in, usually a csalt_resource_file opened for reading and
+ * 	writing
+ *
+ * \returns The new B+tree resource
+ */
+struct csalt_resource_kv_btree csalt_resource_kv_btree(csalt_resource *file);
+
+csalt_static_store *csalt_resource_kv_btree_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_kv_btree_deinit(csalt_resource *resource);
+
+/**
+ * \brief Function type for supplying sorted entries to
+ * 	csalt_store_kv_btree_load().
+ *
+ * Implementations point key and value at the next entry, which
+ * must stay valid until the next call.
+ *
+ * \returns 1 if an entry was returned, 0 at the end of the input,
+ * 	or -1 on error.
+ */
+typedef int csalt_kv_btree_next_fn(
+	const void **key,
+	ssize_t *key_size,
+	const void **value,
+	ssize_t *value_size,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_kv_btree
+ * \brief Builds the tree from entries in ascending key order.
+ *
+ * Rather than inserting entries one at a time, this fills each
+ * leaf page in turn, then builds each level of internal nodes
+ * above them, writing every page once.
+ *
+ * \param store An empty tree
+ * \param next Called for each entry in turn
+ * \param param Passed to next
+ *
+ * \returns 0 on success, or -1 if the tree wasn't empty, the keys
+ * 	weren't in strictly ascending order, an entry was too large,
+ * 	or next or writing to the store failed. On failure, the tree
+ * 	is left empty.
+ */
+int csalt_store_kv_btree_load(
+	struct csalt_store_kv_btree *store,
+	csalt_kv_btree_next_fn *next,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_kv_btree
+ * \brief Calls block for each key from begin, up to but not
+ * 	including end, in ascending order, until block returns
+ * 	non-zero.
+ *
+ * \param begin The lowest key to visit, or NULL to start at the
+ * 	first key
+ * \param end The key to stop at, or NULL to carry on to the last
+ * 	key
+ *
+ * \returns The first non-zero return value of block, 0 if block
+ * 	was called for every key in the range, or -1 if reading a page
+ * 	failed.
+ */
+int csalt_store_kv_btree_range(
+	struct csalt_store_kv_btree *store,
+	const void *begin,
+	ssize_t begin_size,
+	const void *end,
+	ssize_t end_size,
+	csalt_kv_block_fn *block,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_kv_btree
+ * \brief Returns the number of keys in the tree.
+ */
+ssize_t csalt_store_kv_btree_count(const struct csalt_store_kv_btree *store);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_KV_BTREE_H
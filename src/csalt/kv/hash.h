@@ -0,0 +1,126 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_KV_HASH_H
+#define CSALT_KV_HASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <csalt/resource/heap.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_kv_hash
+ */
+
+/*
+ * A single slot in a hash table. This should not be considered
+ * part of the public API.
+ */
+struct csalt_kv_hash_slot;
+
+/*
+ * One table of slots, and the heap it lives in. This should not
+ * be considered part of the public API.
+ */
+struct csalt_kv_hash_table {
+	struct csalt_resource_heap heap;
+	struct csalt_kv_hash_slot *slots;
+	size_t capacity;
+	size_t count;
+};
+
+/**
+ * \brief The key/value store returned by csalt_resource_kv_hash.
+ *
+ * While the table is growing, entries live in either table, and
+ * are moved from the old table a few at a time by each
+ * csalt_kv_put() and csalt_kv_remove().
+ */
+struct csalt_store_kv_hash {
+	const struct csalt_kv_interface *vtable;
+	struct csalt_kv_hash_table table;
+	struct csalt_kv_hash_table old;
+	size_t cursor;
+	uint64_t seed;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents an in-memory hash table, mapping keys to
+ * 	values.
+ *
+ * The table uses open addressing with Robin Hood probing, so
+ * lookups stay short even when the table is nearly full. Slot
+ * tables are allocated with csalt_resource_heap, and keys and
+ * values are stored together in a single allocation per entry.
+ *
+ * When the table passes seven eighths full, a table of twice the
+ * size is allocated, and entries are migrated incrementally, so no
+ * single csalt_kv_put() pays for rehashing the whole table.
+ *
+ * csalt_resource_init() returns a csalt_kv, cast to
+ * csalt_static_store. csalt_resource_deinit() frees every entry.
+ */
+struct csalt_resource_kv_hash {
+	const struct csalt_static_resource_interface *vtable;
+	ssize_t capacity;
+	struct csalt_store_kv_hash store;
+};
+
+/**
+ * \public \memberof csalt_resource_kv_hash
+ * \brief Constructs a new csalt_resource_kv_hash.
+ *
+ * \param capacity The number of entries to allocate space for
+ * 	initially. The table grows as needed.
+ *
+ * \returns The new hash table resource
+ */
+struct csalt_resource_kv_hash csalt_resource_kv_hash(ssize_t capacity);
+
+csalt_static_store *csalt_resource_kv_hash_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_kv_hash_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_kv_hash
+ * \brief Returns the number of keys in the table.
+ */
+ssize_t csalt_store_kv_hash_count(const struct csalt_store_kv_hash *store);
+
+/**
+ * \public \memberof csalt_store_kv_hash
+ * \brief Returns true if entries are still being migrated from
+ * 	a smaller table.
+ */
+bool csalt_store_kv_hash_rehashing(const struct csalt_store_kv_hash *store);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_KV_HASH_H
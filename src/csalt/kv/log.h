@@ -0,0 +1,175 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_KV_LOG_H
+#define CSALT_KV_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hash.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <csalt/platform/threads.h>
+#include <csalt/resource/file.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_kv_log
+ */
+
+/**
+ * \brief The default size a segment grows to before a new one is
+ * 	started.
+ */
+#define CSALT_KV_LOG_SEGMENT_SIZE (64l * 1024 * 1024)
+
+/*
+ * A single log file and its bookkeeping. This should not be
+ * considered part of the public API.
+ */
+struct csalt_kv_log_segment;
+
+/**
+ * \brief The key/value store returned by csalt_resource_kv_log.
+ *
+ * Every function on this store is thread-safe, and
+ * csalt_store_kv_log_compact() may run on another thread, for
+ * example as a job on a csalt_resource_executor, while keys are
+ * read and written.
+ */
+struct csalt_store_kv_log {
+	const struct csalt_kv_interface *vtable;
+	const char *directory;
+	ssize_t segment_size;
+	struct csalt_resource_kv_hash index;
+	struct csalt_kv_log_segment **segments;
+	size_t segment_count;
+	size_t segment_capacity;
+	struct csalt_kv_log_segment *active;
+	uint64_t next_id;
+	uint64_t next_sequence;
+	bool compacting;
+	csalt_mutex lock;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a persistent key/value store, kept as a log
+ * 	of records in a directory.
+ *
+ * Every csalt_kv_put() and csalt_kv_remove() appends a record to
+ * the active segment file, so writes are sequential no matter
+ * which key they touch. An in-memory index, a
+ * csalt_resource_kv_hash, maps each key to the segment, offset and
+ * length of its newest record. csalt_kv_get() passes a split of
+ * the segment's csalt_resource_file store to the block, so values
+ * are read straight from the file. Value stores must only be read
+ * from.
+ *
+ * When the active segment passes the segment size, it's closed and
+ * a hint file is written beside it, listing each record's key and
+ * position without the values. On csalt_resource_init(), segments
+ * with a hint file are indexed from it instead of being read in
+ * full. A segment without one is scanned, stopping at the first
+ * record with a bad checksum, which is cut off as a torn write.
+ *
+ * Overwritten and removed records stay in the log until
+ * csalt_store_kv_log_compact() copies the live records out of
+ * every closed segment and deletes them.
+ *
+ * csalt_resource_init() creates the directory if needed.
+ * csalt_resource_deinit() writes a hint file for the active
+ * segment, so the next start doesn't need to scan anything. It
+ * must not be called while a compaction is running.
+ */
+struct csalt_resource_kv_log {
+	const struct csalt_static_resource_interface *vtable;
+	const char *directory;
+	ssize_t segment_size;
+	struct csalt_store_kv_log store;
+};
+
+/**
+ * \public \memberof csalt_resource_kv_log
+ * \brief Constructs a new csalt_resource_kv_log.
+ *
+ * \param directory The directory to keep the log in
+ * \param segment_size The size a segment grows to before a new one
+ * 	is started. If zero or less, CSALT_KV_LOG_SEGMENT_SIZE is
+ * 	used.
+ *
+ * \returns The new log resource
+ */
+struct csalt_resource_kv_log csalt_resource_kv_log(
+	const char *directory,
+	ssize_t segment_size
+);
+
+csalt_static_store *csalt_resource_kv_log_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_kv_log_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_kv_log
+ * \brief Flushes the active segment to disk.
+ *
+ * Records are written with pwrite() and left to the kernel to
+ * flush, so the most recent writes can be lost on power failure
+ * until this is called.
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_store_kv_log_sync(struct csalt_store_kv_log *store);
+
+/**
+ * \public \memberof csalt_store_kv_log
+ * \brief Returns the number of bytes in the log taken up by
+ * 	overwritten and removed records.
+ */
+ssize_t csalt_store_kv_log_dead(struct csalt_store_kv_log *store);
+
+/**
+ * \public \memberof csalt_store_kv_log
+ * \brief Rewrites every closed segment, keeping only live
+ * 	records, and deletes the old segments.
+ *
+ * Records are copied without holding the store's lock, so reads
+ * and writes carry on while the compaction runs. The lock is only
+ * taken briefly per record, and once at the end to switch the
+ * index over to the new segments.
+ *
+ * The old segments are only deleted once a single rename has
+ * recorded that they're no longer needed, so if the process stops
+ * part way through, the next csalt_resource_init() finds the same
+ * keys and values either way.
+ *
+ * \returns The number of bytes reclaimed, or -1 on failure or if
+ * 	another compaction is already running.
+ */
+ssize_t csalt_store_kv_log_compact(struct csalt_store_kv_log *store);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_KV_LOG_H
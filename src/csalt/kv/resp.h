@@ -0,0 +1,265 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_KV_RESP_H
+#define CSALT_KV_RESP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <csalt/resource/base.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_kv_resp
+ */
+
+/**
+ * \brief The types of reply in RESP2 and RESP3.
+ */
+enum csalt_resp_type {
+	CSALT_RESP_SIMPLE,
+	CSALT_RESP_ERROR,
+	CSALT_RESP_INTEGER,
+	CSALT_RESP_BULK,
+	CSALT_RESP_ARRAY,
+	CSALT_RESP_NULL,
+	CSALT_RESP_BOOLEAN,
+	CSALT_RESP_DOUBLE,
+	CSALT_RESP_BIG_NUMBER,
+	CSALT_RESP_BULK_ERROR,
+	CSALT_RESP_VERBATIM,
+	CSALT_RESP_MAP,
+	CSALT_RESP_SET,
+};
+
+/**
+ * \brief A parsed reply.
+ *
+ * String data isn't copied: data points into the connection's read
+ * buffer, and is only valid until the block the reply was passed to
+ * returns. It isn't nul-terminated.
+ */
+struct csalt_resp_reply {
+	enum csalt_resp_type type;
+
+	/**
+	 * \brief The text of simple strings, errors, bulk strings,
+	 * 	doubles, big numbers and verbatim strings, including the
+	 * 	verbatim string's format prefix.
+	 */
+	const char *data;
+	ssize_t size;
+
+	/**
+	 * \brief The value of integers and booleans.
+	 */
+	long long integer;
+
+	/**
+	 * \brief The elements of arrays, sets and maps. Maps have
+	 * 	their keys and values alternating, so count is twice the
+	 * 	number of pairs.
+	 */
+	const struct csalt_resp_reply *elements;
+	ssize_t count;
+};
+
+/**
+ * \brief Type for a logic block receiving a reply.
+ */
+typedef int csalt_resp_reply_fn(
+	const struct csalt_resp_reply *reply,
+	void *param
+);
+
+/**
+ * \brief The key/value store returned by csalt_resource_kv_resp.
+ *
+ * The store isn't thread-safe.
+ */
+struct csalt_store_kv_resp {
+	const struct csalt_kv_interface *vtable;
+	csalt_static_store *connection;
+	ssize_t buffer_size;
+	char *read_buffer;
+	ssize_t read_size;
+	ssize_t read_begin;
+	ssize_t read_end;
+	char *write_buffer;
+	ssize_t write_size;
+	ssize_t write_length;
+	ssize_t pending;
+	struct csalt_resp_reply *elements;
+	ssize_t element_size;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a key/value store on a Redis-compatible server,
+ * 	spoken to over RESP.
+ *
+ * The decorated resource is the connection, usually a
+ * csalt_resource_network_client or a Unix domain socket client.
+ *
+ * csalt_kv_get(), csalt_kv_put() and csalt_kv_remove() send GET,
+ * SET and DEL, and wait for their reply. csalt_kv_get() passes the
+ * value to the block as a memory store over the read buffer, so
+ * bulk strings are never copied out of it. csalt_kv_iterate() uses
+ * SCAN, and fetches each batch of keys' values with pipelined GETs;
+ * like SCAN itself, it may visit a key more than once.
+ *
+ * To avoid waiting a round trip for each command, commands can be
+ * queued with csalt_store_kv_resp_queue() and friends, which only
+ * write to the write buffer, and their replies read back in order
+ * with csalt_store_kv_resp_reply(). The write buffer is sent when
+ * it fills, when csalt_store_kv_resp_flush() is called, and before
+ * waiting for a reply.
+ *
+ * Replies arrive in the order commands were sent, so the csalt_kv
+ * functions can't be mixed with queued commands: while any queued
+ * command's reply is still unread, they return -1 without sending
+ * anything. Read every outstanding reply first.
+ *
+ * Bulk strings longer than 512 MiB, and aggregates with more than
+ * INT32_MAX elements, are treated as invalid replies.
+ *
+ * Both RESP2 and RESP3 replies are understood, so RESP3 can be
+ * switched on by queueing HELLO 3. RESP3 push messages aren't
+ * replies to any command, and are skipped.
+ *
+ * csalt_resource_deinit() discards any outstanding replies, then
+ * deinitializes the connection.
+ */
+struct csalt_resource_kv_resp {
+	const struct csalt_static_resource_interface *vtable;
+	csalt_static_resource *connection;
+	ssize_t buffer_size;
+	struct csalt_store_kv_resp store;
+};
+
+/**
+ * \public \memberof csalt_resource_kv_resp
+ * \brief Constructs a new csalt_resource_kv_resp.
+ *
+ * \param connection The resource to connect to the server with
+ * \param buffer_size The starting size of the read and write
+ * 	buffers, or zero or less for 4096 bytes. The buffers grow to
+ * 	fit the largest reply and the largest command.
+ *
+ * \returns The new RESP resource
+ */
+struct csalt_resource_kv_resp csalt_resource_kv_resp(
+	csalt_static_resource *connection,
+	ssize_t buffer_size
+);
+
+csalt_static_store *csalt_resource_kv_resp_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_kv_resp_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_kv_resp
+ * \brief Queues a command without waiting for its reply.
+ *
+ * \param count The number of arguments, including the command name
+ * \param arguments The arguments
+ * \param sizes The size of each argument
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_store_kv_resp_queue(
+	struct csalt_store_kv_resp *store,
+	ssize_t count,
+	const void *const *arguments,
+	const ssize_t *sizes
+);
+
+/**
+ * \public \memberof csalt_store_kv_resp
+ * \brief Queues a GET for key without waiting for its reply.
+ */
+int csalt_store_kv_resp_queue_get(
+	struct csalt_store_kv_resp *store,
+	const void *key,
+	ssize_t key_size
+);
+
+/**
+ * \public \memberof csalt_store_kv_resp
+ * \brief Queues a SET of key to value without waiting for its
+ * 	reply.
+ */
+int csalt_store_kv_resp_queue_set(
+	struct csalt_store_kv_resp *store,
+	const void *key,
+	ssize_t key_size,
+	const void *value,
+	ssize_t value_size
+);
+
+/**
+ * \public \memberof csalt_store_kv_resp
+ * \brief Queues a DEL of key without waiting for its reply.
+ */
+int csalt_store_kv_resp_queue_del(
+	struct csalt_store_kv_resp *store,
+	const void *key,
+	ssize_t key_size
+);
+
+/**
+ * \public \memberof csalt_store_kv_resp
+ * \brief Sends every queued command.
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_store_kv_resp_flush(struct csalt_store_kv_resp *store);
+
+/**
+ * \public \memberof csalt_store_kv_resp
+ * \brief Waits for the reply to the oldest command whose reply
+ * 	hasn't been read, and passes it to block.
+ *
+ * \returns The return value of block, or -1 if there are no
+ * 	commands waiting for replies, or the connection failed or sent
+ * 	something which isn't RESP. After a connection error, the
+ * 	store can't be used again.
+ */
+int csalt_store_kv_resp_reply(
+	struct csalt_store_kv_resp *store,
+	csalt_resp_reply_fn *block,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_kv_resp
+ * \brief Returns the number of commands queued or sent whose
+ * 	replies haven't been read yet.
+ */
+ssize_t csalt_store_kv_resp_pending(const struct csalt_store_kv_resp *store);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_KV_RESP_H
@@ -0,0 +1,30 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_KVS_H
+#define CSALT_KVS_H
+
+#include <csalt/platform/init.h>
+#include "kv/base.h"
+#include "kv/hash.h"
+#include "kv/log.h"
+#include "kv/btree.h"
+#include "kv/resp.h"
+#include "kv/bloom.h"
+
+#endif // CSALT_KVS_H
@@ -0,0 +1,183 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_CACHE_H
+#define CSALT_RESOURCE_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <stddef.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_cache
+ */
+
+/*
+ * The bookkeeping for one cached block. This should not be
+ * considered part of the public API.
+ */
+struct csalt_cache_frame;
+
+/**
+ * \brief The store returned by csalt_resource_cache.
+ *
+ * csalt_store_read() is served from cached blocks, loading any
+ * missing blocks from the decorated store first.
+ *
+ * csalt_store_write() writes through to the decorated store, and
+ * drops any cached blocks it overlaps, so the next read loads them
+ * again.
+ *
+ * csalt_store_split() passes a view of the same cache to the
+ * block, so reads through the split share the cached blocks.
+ *
+ * csalt_store_size() is passed to the decorated store.
+ * csalt_store_resize() is passed to the decorated store, then
+ * drops every cached block.
+ *
+ * The cache is not thread-safe. Decorate it with
+ * csalt_resource_mutex if it's shared between threads.
+ */
+struct csalt_store_cache {
+	const struct csalt_dynamic_store_interface *vtable;
+	csalt_store *decorated;
+	ssize_t block_size;
+	ssize_t block_count;
+	char *blocks;
+	struct csalt_cache_frame *frames;
+	ssize_t *buckets;
+	size_t bucket_mask;
+	ssize_t hand;
+	ssize_t tail;
+
+	/**
+	 * \brief The number of block lookups served from the cache.
+	 */
+	size_t hits;
+
+	/**
+	 * \brief The number of block lookups which had to load the
+	 * 	block from the decorated store.
+	 */
+	size_t misses;
+
+	/**
+	 * \brief The number of cached blocks dropped to make room for
+	 * 	another block.
+	 */
+	size_t evictions;
+};
+
+/**
+ * \brief A range of a csalt_store_cache, passed to the block by
+ * 	csalt_store_split().
+ */
+struct csalt_store_cache_view {
+	const struct csalt_static_store_interface *vtable;
+	struct csalt_store_cache *cache;
+	ssize_t begin;
+	ssize_t end;
+};
+
+/**
+ * \extends csalt_resource
+ * \brief Decorates a resource with a bounded cache of fixed-size
+ * 	blocks, for putting in front of slow stores such as files or
+ * 	network-backed stores.
+ *
+ * The cache holds up to block_count blocks in one allocation.
+ * When it's full, a block is chosen for eviction with the CLOCK
+ * algorithm: every cached block has a reference bit, which is set
+ * when the block is read. A hand sweeps over the blocks, clearing
+ * reference bits, and evicts the first block it finds with its bit
+ * already clear. Blocks which are read often keep their bit set,
+ * and stay cached, without any per-read list maintenance.
+ *
+ * csalt_resource_init() initializes the decorated resource and
+ * allocates the blocks. If either fails, NULL is returned.
+ */
+struct csalt_resource_cache {
+	const struct csalt_dynamic_resource_interface *vtable;
+	csalt_resource *resource;
+	ssize_t block_size;
+	ssize_t block_count;
+	struct csalt_store_cache store;
+};
+
+/**
+ * \public \memberof csalt_resource_cache
+ * \brief Constructs a new csalt_resource_cache.
+ *
+ * \param resource The resource to cache
+ * \param block_size The size of each cached block, in bytes
+ * \param block_count The largest number of blocks to cache
+ *
+ * \returns The new cache resource
+ */
+struct csalt_resource_cache csalt_resource_cache(
+	csalt_resource *resource,
+	ssize_t block_size,
+	ssize_t block_count
+);
+
+csalt_store *csalt_resource_cache_init(csalt_resource *resource);
+void csalt_resource_cache_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_cache
+ * \brief Drops every cached block.
+ *
+ * Use this when the decorated store has been changed other than
+ * through the cache.
+ */
+void csalt_store_cache_invalidate(struct csalt_store_cache *cache);
+
+ssize_t csalt_store_cache_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t amount
+);
+
+ssize_t csalt_store_cache_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t amount
+);
+
+int csalt_store_cache_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+ssize_t csalt_store_cache_size(csalt_store *store);
+
+ssize_t csalt_store_cache_resize(csalt_store *store, ssize_t new_size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_CACHE_H
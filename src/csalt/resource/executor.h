@@ -0,0 +1,222 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_EXECUTOR_H
+#define CSALT_RESOURCE_EXECUTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include <csalt/platform/threads.h>
+#include <csalt/store/parallel.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_executor
+ */
+
+/*
+ * A single worker thread and its queue. This should not be
+ * considered part of the public API.
+ */
+struct csalt_executor_worker;
+
+/**
+ * \brief The store returned by csalt_resource_executor.
+ *
+ * Jobs are submitted to the executor with
+ * csalt_store_executor_submit(). csalt_store_read() and
+ * csalt_store_write() are not applicable and return -1;
+ * csalt_store_split() passes the executor itself to the block.
+ *
+ * Stores which run their work as a batch of tasks, such as
+ * csalt_store_tee, can run it on the executor through its parallel
+ * member.
+ */
+struct csalt_store_executor {
+	const struct csalt_static_store_interface *vtable;
+	struct csalt_executor_worker *workers;
+	ssize_t worker_count;
+	ssize_t queue_size;
+	csalt_mutex lock;
+	csalt_cond work;
+	csalt_cond done;
+	atomic_size_t next;
+	atomic_size_t pending;
+	atomic_size_t active;
+	atomic_bool stopping;
+
+	/**
+	 * \brief Runs a batch of tasks on the workers. The last task
+	 * 	is run from the calling thread while the others run, as
+	 * 	are any which don't fit in the queues.
+	 */
+	struct csalt_store_parallel parallel;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a fixed pool of worker threads, for running
+ * 	resource blocks asynchronously.
+ *
+ * Each worker owns a double-ended queue of jobs. Workers take
+ * their own most recently queued job first, and when their own
+ * queue is empty, steal the oldest job from another worker's
+ * queue. Jobs submitted from inside a running job are queued on
+ * the current worker, so fork/join style work stays on the same
+ * core where possible.
+ *
+ * csalt_resource_init() starts the threads. csalt_resource_deinit()
+ * waits for every submitted job to finish, then joins the threads.
+ */
+struct csalt_resource_executor {
+	const struct csalt_static_resource_interface *vtable;
+	ssize_t threads;
+	ssize_t queue_size;
+	struct csalt_store_executor store;
+};
+
+/**
+ * \brief A job to run on a csalt_resource_executor, and the
+ * 	handle for its result.
+ *
+ * Jobs are owned by the caller, and must stay valid until
+ * csalt_executor_job_wait() returns or csalt_executor_job_done()
+ * returns true.
+ *
+ * \sa csalt_executor_job()
+ * \sa csalt_executor_job_fn()
+ */
+struct csalt_executor_job {
+	csalt_resource *resource;
+	csalt_store_block_fn *block;
+	int (*function)(void *param);
+	void *param;
+
+	/**
+	 * \brief The return value of the job, once it has finished.
+	 */
+	int result;
+
+	atomic_int state;
+	struct csalt_store_executor *executor;
+};
+
+/**
+ * \public \memberof csalt_resource_executor
+ * \brief Constructs a new csalt_resource_executor.
+ *
+ * \param threads The number of worker threads to start. If zero
+ * 	or less, one thread per online processor is started.
+ * \param queue_size The number of jobs each worker can hold
+ * 	in its queue.
+ *
+ * \returns The new executor resource
+ */
+struct csalt_resource_executor csalt_resource_executor(
+	ssize_t threads,
+	ssize_t queue_size
+);
+
+csalt_static_store *csalt_resource_executor_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_executor_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_executor_job
+ * \brief Constructs a job which calls csalt_resource_use() with
+ * 	the given arguments.
+ *
+ * The result of the job is the return value of
+ * csalt_resource_use().
+ */
+struct csalt_executor_job csalt_executor_job(
+	csalt_resource *resource,
+	csalt_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_executor_job
+ * \brief Constructs a job which calls function with param.
+ *
+ * The result of the job is the return value of function.
+ */
+struct csalt_executor_job csalt_executor_job_fn(
+	int (*function)(void *param),
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_executor
+ * \brief Queues a job to be run by one of the executor's workers.
+ *
+ * This function does not block: if every worker's queue is full,
+ * it returns -1 immediately.
+ *
+ * \param executor The executor to run the job on
+ * \param job The job to run
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_store_executor_submit(
+	struct csalt_store_executor *executor,
+	struct csalt_executor_job *job
+);
+
+/**
+ * \public \memberof csalt_store_executor
+ * \brief Blocks until every job submitted so far has finished.
+ *
+ * This must not be called from inside a job, since the calling
+ * job would be waiting on itself.
+ */
+void csalt_store_executor_wait(struct csalt_store_executor *executor);
+
+/**
+ * \public \memberof csalt_executor_job
+ * \brief Returns true if the job has finished, false otherwise.
+ */
+bool csalt_executor_job_done(const struct csalt_executor_job *job);
+
+/**
+ * \public \memberof csalt_executor_job
+ * \brief Blocks until the job has finished, then returns its
+ * 	result.
+ *
+ * When called from inside another job on the same executor,
+ * the calling worker runs other queued jobs while it waits,
+ * instead of blocking.
+ *
+ * \returns The result of the job, or -1 if the job was never
+ * 	submitted.
+ */
+int csalt_executor_job_wait(struct csalt_executor_job *job);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_EXECUTOR_H
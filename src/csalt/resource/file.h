@@ -123,6 +123,23 @@ struct csalt_resource_file csalt_resource_file_new(
  */
 struct csalt_resource_file csalt_resource_file_open(const char *path, int flags);
 
+/**
+ * \public \memberof csalt_resource_file
+ * \brief Constructor for a file resource around a file descriptor
+ * 	which is already open, such as one received from another
+ * 	process with csalt_store_network_unix_receive_fd().
+ *
+ * The resource takes ownership of the file descriptor:
+ * csalt_resource_deinit() closes it, after which the resource
+ * can't be initialized again. The descriptor's flags are left as
+ * they are.
+ *
+ * \param fd The open file descriptor
+ *
+ * \returns The new file resource
+ */
+struct csalt_resource_file csalt_resource_file_descriptor(int fd);
+
 csalt_store *csalt_resource_file_init(csalt_resource *resource);
 void csalt_resource_file_deinit(csalt_resource *resource);
 ssize_t csalt_store_file_read(
@@ -142,6 +159,7 @@ int csalt_store_file_split(
 	csalt_static_store_block_fn *block,
 	void *param
 );
+int csalt_store_file_fd(csalt_static_store *store);
 ssize_t csalt_store_file_size(csalt_store *store);
 ssize_t csalt_store_file_resize(csalt_store *store, ssize_t new_size);
 
@@ -86,6 +86,7 @@ int csalt_store_lazy_split(
 	csalt_static_store_block_fn *block,
 	void *param
 );
+int csalt_store_lazy_fd(csalt_static_store *store);
 ssize_t csalt_store_lazy_size(csalt_store *store);
 ssize_t csalt_store_lazy_resize(csalt_store *store, ssize_t new_size);
 
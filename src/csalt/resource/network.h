@@ -29,8 +29,16 @@ extern "C" {
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <stdbool.h>
 
 #include "network/client.h"
+#include "network/server.h"
+#include "network/server_pool.h"
+#include "network/client_pool.h"
+#include "network/buffered.h"
+#include "network/udp.h"
+#include "network/zerocopy.h"
+#include "network/unix.h"
 
 /**
  * \file
@@ -60,6 +68,8 @@ extern "C" {
  *
  * \returns The return value of callback on success, otherwise
  * 	an error code from getaddrinfo.
+ *
+ * \sa csalt_resource_network_dns_cache_enable()
  */
 int csalt_resource_network_getaddrinfo(
 	const char *node,
@@ -69,6 +79,72 @@ int csalt_resource_network_getaddrinfo(
 	void *param
 );
 
+/**
+ * \brief Options for the resolver cache used by
+ * 	csalt_resource_network_getaddrinfo().
+ *
+ * \sa csalt_resource_network_dns_cache_enable()
+ */
+struct csalt_network_dns_cache_options {
+	/**
+	 * \brief How long, in milliseconds, to keep a successful
+	 * 	result.
+	 */
+	int ttl;
+
+	/**
+	 * \brief How long, in milliseconds, to keep a failed result,
+	 * 	such as an unknown host. Temporary failures are never
+	 * 	cached.
+	 */
+	int negative_ttl;
+
+	/**
+	 * \brief If true, uncached names are resolved on a
+	 * 	background thread, and
+	 * 	csalt_resource_network_getaddrinfo() returns EAI_AGAIN
+	 * 	until the result is ready, instead of blocking.
+	 */
+	bool background;
+
+	/**
+	 * \brief The most names to keep at once, or 0 for no limit.
+	 * 	Once it's reached, the oldest name is dropped to make
+	 * 	room for a new one.
+	 */
+	size_t max_entries;
+};
+
+/**
+ * \brief Enables a process-wide cache of
+ * 	csalt_resource_network_getaddrinfo() results.
+ *
+ * The cache is disabled by default. While it is enabled, results
+ * are kept for the configured time and shared between threads, and
+ * concurrent lookups of the same name wait for a single call to
+ * getaddrinfo(), rather than each making their own.
+ *
+ * getaddrinfo() doesn't report the DNS record's own TTL, so the
+ * same TTL is used for every result. Expired results are dropped
+ * whenever a new name is added, whether or not they're looked up
+ * again.
+ *
+ * Enabling the cache while it is already enabled changes the
+ * options for new results.
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_resource_network_dns_cache_enable(
+	const struct csalt_network_dns_cache_options *options
+);
+
+/**
+ * \brief Disables the cache, and releases every cached result.
+ *
+ * Waits for any background lookups to finish first.
+ */
+void csalt_resource_network_dns_cache_disable(void);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
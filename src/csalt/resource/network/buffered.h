@@ -0,0 +1,174 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_NETWORK_BUFFERED_H
+#define CSALT_RESOURCE_NETWORK_BUFFERED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
+
+#include <stdbool.h>
+
+#include "client.h"
+
+/**
+ * \file
+ * \copydoc csalt_resource_network_buffered
+ */
+
+/**
+ * \brief Socket options set by csalt_resource_network_buffered.
+ *
+ * Both options only apply to TCP sockets, and are ignored for
+ * other sockets.
+ */
+struct csalt_network_buffered_options {
+	/**
+	 * \brief Sets TCP_NODELAY, so each flush is sent immediately
+	 * 	instead of waiting to be combined with later data. Since
+	 * 	small writes are already combined by the buffer, this is
+	 * 	usually what you want.
+	 */
+	bool nodelay;
+
+	/**
+	 * \brief Sets TCP_CORK while the resource is in use, so the
+	 * 	kernel only sends full packets, and pushes out the
+	 * 	remainder on each flush.
+	 */
+	bool cork;
+};
+
+/**
+ * \extends csalt_store_network_client
+ * \brief The store returned by csalt_resource_network_buffered.
+ *
+ * csalt_store_read() returns data left over from a previous read
+ * if there is any. Otherwise, it fills the read buffer with a
+ * single read from the socket, and returns what was asked for from
+ * it. Reads at least as large as the read buffer go straight to
+ * the socket. Any buffered writes are flushed before reading from
+ * the socket, so a request can't be left waiting in the buffer
+ * while its response is being read.
+ *
+ * csalt_store_write() copies the data into the write buffer if it
+ * fits. Otherwise, the buffered data and the new data are sent
+ * together with a single writev() call, and what's left of the new
+ * data is buffered. As with the socket itself, the return value may
+ * be less than the size for non-blocking sockets.
+ *
+ * csalt_store_split() passes the store itself.
+ */
+struct csalt_store_network_buffered {
+	struct csalt_store_network_client parent;
+	bool cork;
+
+	char *read_buffer;
+	ssize_t read_size;
+	ssize_t read_begin;
+	ssize_t read_end;
+
+	char *write_buffer;
+	ssize_t write_size;
+	ssize_t write_length;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Decorates a network socket resource with user-space read
+ * 	and write buffers.
+ *
+ * The decorated resource must return a store compatible with
+ * csalt_store_network_client, such as csalt_resource_network_client
+ * or csalt_resource_network_pooled_client.
+ *
+ * csalt_resource_deinit() flushes any buffered writes, waiting for
+ * the socket to become writable if necessary, before deinitializing
+ * the decorated resource.
+ */
+struct csalt_resource_network_buffered {
+	const struct csalt_static_resource_interface *vtable;
+	csalt_static_resource *resource;
+	ssize_t read_size;
+	ssize_t write_size;
+	struct csalt_network_buffered_options options;
+
+	struct csalt_store_network_buffered result;
+};
+
+/**
+ * \public \memberof csalt_resource_network_buffered
+ * \brief Constructs a new csalt_resource_network_buffered.
+ *
+ * \param resource The socket resource to decorate
+ * \param read_size The size of the read buffer
+ * \param write_size The size of the write buffer; buffered writes
+ * 	are sent when it fills up
+ * \param options The socket options to set
+ *
+ * \returns The new resource
+ */
+struct csalt_resource_network_buffered csalt_resource_network_buffered(
+	csalt_static_resource *resource,
+	ssize_t read_size,
+	ssize_t write_size,
+	struct csalt_network_buffered_options options
+);
+csalt_static_store *csalt_resource_network_buffered_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_buffered_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_buffered
+ * \brief Sends any buffered writes.
+ *
+ * \returns The number of bytes still buffered, which may be
+ * 	non-zero for non-blocking sockets, or -1 on error.
+ */
+ssize_t csalt_store_network_buffered_flush(
+	struct csalt_store_network_buffered *store
+);
+
+ssize_t csalt_store_network_buffered_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+);
+ssize_t csalt_store_network_buffered_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+);
+int csalt_store_network_buffered_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_NETWORK_BUFFERED_H
@@ -23,29 +23,80 @@
 extern "C" {
 #endif
 
-#include "csalt/resources.h"
-#include "csalt/stores.h"
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <stdbool.h>
 
 /**
  * \file
  * \copydoc csalt_resource_network_client
  */
 
+/**
+ * \brief Options controlling how a csalt_resource_network_client
+ * 	connects.
+ *
+ * \sa csalt_network_client_options()
+ */
+struct csalt_network_client_options {
+	/**
+	 * \brief How long to wait, in milliseconds, for a connection
+	 * 	attempt before starting the next one in parallel.
+	 */
+	int attempt_delay;
+
+	/**
+	 * \brief The longest time, in milliseconds, to spend
+	 * 	connecting to all addresses, or -1 for no limit beyond the
+	 * 	system's own.
+	 */
+	int timeout;
+
+	/**
+	 * \brief Whether to request TCP Fast Open, where the kernel
+	 * 	supports it.
+	 *
+	 * With Fast Open, the handshake is completed on the first
+	 * write, so connection errors may be reported then instead.
+	 */
+	bool fast_open;
+};
+
+/**
+ * \public \memberof csalt_network_client_options
+ * \brief Returns the default options: a 250 millisecond attempt
+ * 	delay, no timeout, and no TCP Fast Open.
+ */
+struct csalt_network_client_options csalt_network_client_options(void);
+
 /**
  * \extends csalt_static_resource
  * \brief Represents a `connect()`ed network socket.
  *
  * This represents the client side of a network program.
+ *
+ * Connections are attempted without blocking, racing the addresses
+ * returned by getaddrinfo against each other: the addresses are
+ * ordered to alternate between address families, and each attempt
+ * is given csalt_network_client_options::attempt_delay to connect
+ * before the next one is started alongside it. The first
+ * connection established is kept, and the rest are closed. An
+ * attempt that fails immediately starts the next one straight
+ * away. Only addresses of the same socket type and protocol as the
+ * first address getaddrinfo returns are tried.
+ *
+ * The resulting socket is in blocking mode.
  */
 struct csalt_resource_network_client {
 	const struct csalt_static_resource_interface *vtable;
 	const char *node;
 	const char *service;
 	const struct addrinfo *hints;
+	struct csalt_network_client_options options;
 
 	struct csalt_store_network_client {
 		const struct csalt_static_store_interface *vtable;
@@ -63,7 +114,8 @@ struct csalt_resource_network_client {
  * 	a port number or one of the human-readable service names
  * 	in the system's "services" file, e.g. /etc/services
  * \param hints An addrinfo struct, used to narrow down the
- * 	types of addresses to query
+ * 	types of addresses to query. If NULL, a TCP connection over
+ * 	any family is made.
  *
  * \returns The new csalt_resource_network_client resource
  */
@@ -72,6 +124,20 @@ struct csalt_resource_network_client csalt_resource_network_client(
 	const char *service,
 	const struct addrinfo *hints
 );
+
+/**
+ * \memberof csalt_resource_network_client
+ * \brief Constructs a new csalt_resource_network_client with the
+ * 	given connection options.
+ *
+ * \sa csalt_resource_network_client()
+ */
+struct csalt_resource_network_client csalt_resource_network_client_options(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	struct csalt_network_client_options options
+);
 csalt_static_store *csalt_resource_network_client_init(
 	csalt_static_resource *resource
 );
@@ -142,6 +208,7 @@ int csalt_store_network_client_split(
 	csalt_static_store_block_fn *block,
 	void *param
 );
+int csalt_store_network_client_fd(csalt_static_store *store);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,210 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_NETWORK_CLIENT_POOL_H
+#define CSALT_RESOURCE_NETWORK_CLIENT_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
+
+#include <stdbool.h>
+
+#include <csalt/platform/threads.h>
+
+#include "client.h"
+
+/**
+ * \file
+ * \copydoc csalt_resource_network_client_pool
+ */
+
+/*
+ * The idle connections for one (node, service, hints) key. This
+ * should not be considered part of the public API.
+ */
+struct csalt_network_client_pool_key;
+
+/**
+ * \brief The store returned by csalt_resource_network_client_pool,
+ * 	to be passed to csalt_resource_network_pooled_client().
+ *
+ * csalt_store_read() and csalt_store_write() are not applicable
+ * and return -1; csalt_store_split() passes the pool itself to the
+ * block.
+ */
+struct csalt_store_network_client_pool {
+	const struct csalt_static_store_interface *vtable;
+	ssize_t max_per_key;
+	int idle_timeout;
+	csalt_mutex lock;
+	struct csalt_network_client_pool_key *keys;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Keeps connected sockets open between uses, so they can be
+ * 	reused by later csalt_resource_network_pooled_client%s to
+ * 	the same address.
+ *
+ * Connections are grouped by the node, service and hints they were
+ * opened with. Each group is limited to max_per_key connections,
+ * counting both idle connections and those in use.
+ *
+ * Idle connections are closed when they have been idle for longer
+ * than idle_timeout, or when the peer has closed them or sent
+ * unexpected data, which is checked before each reuse.
+ *
+ * csalt_resource_deinit() closes every idle connection. Every
+ * pooled client must have been deinitialized first.
+ */
+struct csalt_resource_network_client_pool {
+	const struct csalt_static_resource_interface *vtable;
+	ssize_t max_per_key;
+	int idle_timeout;
+
+	struct csalt_store_network_client_pool result;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief A csalt_resource_network_client which takes its connection
+ * 	from a pool, and returns it to the pool when deinitialized.
+ *
+ * csalt_resource_init() reuses an idle connection from the pool
+ * if a healthy one is available, and otherwise connects using
+ * client, as long as the pool's limit allows it. If neither is
+ * possible, initialization fails without waiting.
+ *
+ * The store passed to the block is compatible with
+ * csalt_store_network_client. If the block leaves the connection in
+ * an unknown state - for example, after an error part-way through
+ * a request - it should call
+ * csalt_store_network_pooled_client_discard() so the connection is
+ * closed instead of reused.
+ */
+struct csalt_resource_network_pooled_client {
+	const struct csalt_static_resource_interface *vtable;
+	struct csalt_store_network_client_pool *pool;
+	struct csalt_resource_network_client client;
+	struct csalt_network_client_pool_key *key;
+
+	struct csalt_store_network_pooled_client {
+		struct csalt_store_network_client parent;
+		bool discard;
+	} result;
+};
+
+/**
+ * \public \memberof csalt_resource_network_client_pool
+ * \brief Constructs a new csalt_resource_network_client_pool.
+ *
+ * \param max_per_key The maximum number of connections to each
+ * 	address, in use or idle
+ * \param idle_timeout The longest time, in milliseconds, to keep an
+ * 	idle connection
+ *
+ * \returns The new pool resource
+ */
+struct csalt_resource_network_client_pool csalt_resource_network_client_pool(
+	ssize_t max_per_key,
+	int idle_timeout
+);
+csalt_static_store *csalt_resource_network_client_pool_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_client_pool_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_client_pool
+ * \brief Closes every idle connection which has passed the idle
+ * 	timeout.
+ *
+ * Expired connections are also closed as they're found by
+ * csalt_resource_network_pooled_client; this function is for
+ * releasing them without waiting for that.
+ *
+ * \returns The number of connections closed.
+ */
+ssize_t csalt_store_network_client_pool_prune(
+	struct csalt_store_network_client_pool *pool
+);
+
+ssize_t csalt_store_network_client_pool_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+);
+ssize_t csalt_store_network_client_pool_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+);
+int csalt_store_network_client_pool_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_resource_network_pooled_client
+ * \brief Constructs a new csalt_resource_network_pooled_client.
+ *
+ * The parameters are the same as csalt_resource_network_client(),
+ * and are used both to find a matching connection in the pool and
+ * to open a new one. The connection options can be changed through
+ * the client member before initialization.
+ *
+ * \param pool The pool to take connections from
+ * \param node The node to connect to
+ * \param service The service to connect to
+ * \param hints An addrinfo struct, used to narrow down the
+ * 	types of addresses to connect to
+ *
+ * \returns The new pooled client resource
+ */
+struct csalt_resource_network_pooled_client csalt_resource_network_pooled_client(
+	struct csalt_store_network_client_pool *pool,
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+);
+csalt_static_store *csalt_resource_network_pooled_client_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_pooled_client_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_pooled_client
+ * \brief Marks the connection to be closed when the pooled client
+ * 	is deinitialized, instead of being returned to the pool.
+ */
+void csalt_store_network_pooled_client_discard(
+	struct csalt_store_network_pooled_client *client
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_NETWORK_CLIENT_POOL_H
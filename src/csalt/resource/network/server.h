@@ -0,0 +1,241 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_NETWORK_SERVER_H
+#define CSALT_RESOURCE_NETWORK_SERVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <stdbool.h>
+
+#include "client.h"
+
+/**
+ * \file
+ * \copydoc csalt_resource_network_server
+ */
+
+/**
+ * \brief The maximum number of events handled by one call to
+ * 	csalt_store_network_server_poll().
+ */
+#ifndef CSALT_NETWORK_SERVER_EVENTS
+#define CSALT_NETWORK_SERVER_EVENTS 64
+#endif
+
+/**
+ * \brief How long, in milliseconds, a server stops accepting
+ * 	connections after running out of file descriptors, unless a
+ * 	connection is closed first.
+ */
+#ifndef CSALT_NETWORK_SERVER_ACCEPT_BACKOFF
+#define CSALT_NETWORK_SERVER_ACCEPT_BACKOFF 100
+#endif
+
+/**
+ * \extends csalt_store_network_client
+ * \brief A connection accepted by a csalt_resource_network_server.
+ *
+ * This can be used anywhere a csalt_store_network_client can. The
+ * socket is non-blocking, so csalt_store_read() returns -1 with
+ * errno set to EAGAIN once there is no more data available.
+ *
+ * The data member is initialized to NULL when the connection is
+ * accepted, and is otherwise left alone, for the block to keep
+ * per-connection state in.
+ */
+struct csalt_store_network_server_client {
+	struct csalt_store_network_client parent;
+	void *data;
+
+	struct csalt_store_network_server_client *previous;
+	struct csalt_store_network_server_client *next;
+};
+
+/**
+ * \brief The store returned by csalt_resource_network_server.
+ *
+ * csalt_store_read() and csalt_store_write() are not applicable
+ * and return -1; csalt_store_split() passes the server itself to
+ * the block. Connections are handled with
+ * csalt_store_network_server_poll().
+ *
+ * If accepting a connection fails because the process or system
+ * is out of file descriptors, the connection is left waiting, and
+ * the listening socket is taken out of the epoll set until a
+ * connection closes or CSALT_NETWORK_SERVER_ACCEPT_BACKOFF
+ * milliseconds pass, rather than waking every poll for a
+ * connection which can't be accepted.
+ */
+struct csalt_store_network_server {
+	const struct csalt_static_store_interface *vtable;
+	int fd;
+	int epoll_fd;
+	ssize_t client_count;
+	struct csalt_store_network_server_client *clients;
+
+	/*
+	 * When to start accepting connections again, on the
+	 * CLOCK_MONOTONIC clock in milliseconds, or 0 while accepting.
+	 * This should not be considered part of the public API.
+	 */
+	long long accept_resume;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a listening network socket, and the
+ * 	connections accepted from it.
+ *
+ * This represents the server side of a network program. Clients
+ * are multiplexed with epoll, so a single thread can serve many
+ * thousands of connections, as long as the block doesn't wait
+ * on any of them.
+ *
+ * csalt_resource_deinit() closes the listening socket and every
+ * connection still open.
+ *
+ * If reuse_port is set before initialization, the socket is
+ * opened with SO_REUSEPORT, so several servers can listen on the
+ * same address and have the kernel balance connections between
+ * them.
+ *
+ * \sa csalt_resource_network_server_pool
+ */
+struct csalt_resource_network_server {
+	const struct csalt_static_resource_interface *vtable;
+	const char *node;
+	const char *service;
+	const struct addrinfo *hints;
+	int backlog;
+	bool reuse_port;
+
+	struct csalt_store_network_server result;
+};
+
+/**
+ * \public \memberof csalt_resource_network_server
+ * \brief Constructs a new csalt_resource_network_server.
+ *
+ * \param node The address to listen on, or NULL to listen on
+ * 	every address
+ * \param service The port or service name to listen on
+ * \param hints An addrinfo struct, used to narrow down the
+ * 	types of addresses to listen on. If NULL, a passive TCP
+ * 	socket of any family is used.
+ *
+ * \returns The new csalt_resource_network_server resource
+ */
+struct csalt_resource_network_server csalt_resource_network_server(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+);
+csalt_static_store *csalt_resource_network_server_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_server_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_server
+ * \brief Sets up a server store around a socket which is already
+ * 	listening, for listening sockets created by other means.
+ *
+ * The store takes ownership of the socket, which should be
+ * non-blocking, and closes it on failure.
+ *
+ * \param store The store to set up
+ * \param fd The listening socket
+ *
+ * \returns The store, or NULL on failure
+ *
+ * \sa csalt_resource_network_unix_server
+ */
+csalt_static_store *csalt_store_network_server_open(
+	struct csalt_store_network_server *store,
+	int fd
+);
+
+/**
+ * \public \memberof csalt_store_network_server
+ * \brief Closes every connection and the listening socket of a
+ * 	store set up with csalt_store_network_server_open().
+ */
+void csalt_store_network_server_close(struct csalt_store_network_server *store);
+
+/**
+ * \public \memberof csalt_store_network_server
+ * \brief Waits for activity on the server, accepts any new
+ * 	connections, and calls block for each connection with data
+ * 	to read.
+ *
+ * block receives the connection as a
+ * csalt_store_network_server_client. It is also called when the
+ * peer closes the connection, in which case csalt_store_read()
+ * returns 0. If block returns a positive value, the connection is
+ * kept open, and block is called again next time it has data;
+ * otherwise, the connection is closed.
+ *
+ * \param server The server to poll
+ * \param timeout The maximum time to wait in milliseconds, or -1
+ * 	to wait indefinitely. While accepting is paused, the wait
+ * 	ends early once it's time to accept again.
+ * \param block The function to call for each readable connection
+ * \param param An additional parameter to pass to block
+ *
+ * \returns The number of events handled, 0 on timeout, or -1 on
+ * 	error.
+ */
+int csalt_store_network_server_poll(
+	struct csalt_store_network_server *server,
+	int timeout,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+ssize_t csalt_store_network_server_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+);
+ssize_t csalt_store_network_server_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+);
+int csalt_store_network_server_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_NETWORK_SERVER_H
@@ -0,0 +1,183 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_NETWORK_SERVER_POOL_H
+#define CSALT_RESOURCE_NETWORK_SERVER_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+
+#include "server.h"
+
+/**
+ * \file
+ * \copydoc csalt_resource_network_server_pool
+ */
+
+/**
+ * \brief The longest time, in milliseconds, a worker takes to
+ * 	notice csalt_store_network_server_pool_stop().
+ */
+#ifndef CSALT_NETWORK_SERVER_POOL_INTERVAL
+#define CSALT_NETWORK_SERVER_POOL_INTERVAL 100
+#endif
+
+/*
+ * A single worker thread and its server. This should not be
+ * considered part of the public API.
+ */
+struct csalt_network_server_worker;
+
+/**
+ * \brief The store returned by csalt_resource_network_server_pool.
+ *
+ * csalt_store_read() and csalt_store_write() are not applicable
+ * and return -1; csalt_store_split() passes the pool itself to the
+ * block. Connections are handled with
+ * csalt_store_network_server_pool_run().
+ *
+ * node and service hold the numeric address and port every worker
+ * is listening on, which is useful when binding to port 0.
+ */
+struct csalt_store_network_server_pool {
+	const struct csalt_static_store_interface *vtable;
+	struct csalt_network_server_worker *workers;
+	ssize_t worker_count;
+	atomic_bool stopping;
+
+	struct addrinfo hints;
+	char node[INET6_ADDRSTRLEN];
+	char service[sizeof("65535")];
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a group of csalt_resource_network_server%s
+ * 	listening on the same address, each served by its own thread.
+ *
+ * Every server is opened with SO_REUSEPORT, so the kernel
+ * balances new connections between them, and each thread accepts
+ * and multiplexes its own connections with its own epoll set.
+ * Blocks written for csalt_store_network_server_poll() can be used
+ * unchanged, but may be called from several threads at once.
+ *
+ * The first server is bound to the requested address, and the rest
+ * are bound to the address it received, so port 0 can be used.
+ *
+ * If pin is set, worker i is restricted to running on CPU i modulo
+ * the number of online CPUs.
+ */
+struct csalt_resource_network_server_pool {
+	const struct csalt_static_resource_interface *vtable;
+	const char *node;
+	const char *service;
+	const struct addrinfo *hints;
+	ssize_t threads;
+	bool pin;
+
+	struct csalt_store_network_server_pool result;
+};
+
+/**
+ * \public \memberof csalt_resource_network_server_pool
+ * \brief Constructs a new csalt_resource_network_server_pool.
+ *
+ * \param node The address to listen on, or NULL to listen on
+ * 	every address
+ * \param service The port or service name to listen on
+ * \param hints An addrinfo struct, used to narrow down the
+ * 	types of addresses to listen on. If NULL, a passive TCP
+ * 	socket of any family is used.
+ * \param threads The number of servers and threads. If zero or
+ * 	less, one per online processor is used.
+ * \param pin Whether to pin each thread to a CPU
+ *
+ * \returns The new csalt_resource_network_server_pool resource
+ */
+struct csalt_resource_network_server_pool csalt_resource_network_server_pool(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	ssize_t threads,
+	bool pin
+);
+csalt_static_store *csalt_resource_network_server_pool_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_server_pool_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_server_pool
+ * \brief Starts the worker threads, and blocks until they have
+ * 	been stopped with csalt_store_network_server_pool_stop().
+ *
+ * Each worker calls csalt_store_network_server_poll() on its own
+ * server with block and param in a loop.
+ *
+ * \returns 0 on success, -1 if the threads couldn't be started or
+ * 	a worker stopped because of an error.
+ */
+int csalt_store_network_server_pool_run(
+	struct csalt_store_network_server_pool *pool,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_network_server_pool
+ * \brief Asks the workers started by
+ * 	csalt_store_network_server_pool_run() to stop.
+ *
+ * This can be called from a block or from any other thread. It
+ * does not wait for the workers to stop.
+ */
+void csalt_store_network_server_pool_stop(
+	struct csalt_store_network_server_pool *pool
+);
+
+ssize_t csalt_store_network_server_pool_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+);
+ssize_t csalt_store_network_server_pool_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+);
+int csalt_store_network_server_pool_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_NETWORK_SERVER_POOL_H
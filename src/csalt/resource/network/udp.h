@@ -0,0 +1,299 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_NETWORK_UDP_H
+#define CSALT_RESOURCE_NETWORK_UDP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <stdbool.h>
+
+#include "client.h"
+
+/**
+ * \file
+ * \copydoc csalt_resource_network_udp
+ */
+
+/**
+ * \brief The most datagrams moved by a single call to
+ * 	csalt_store_network_udp_send() or
+ * 	csalt_store_network_udp_receive().
+ */
+#define CSALT_NETWORK_UDP_BATCH 256
+
+/**
+ * \brief Socket options set by csalt_resource_network_udp.
+ *
+ * Offloads the kernel doesn't support are left disabled, and
+ * the resource falls back to sending and receiving single
+ * datagrams.
+ */
+struct csalt_network_udp_options {
+	/**
+	 * \brief If greater than zero, sets UDP_SEGMENT on the socket,
+	 * 	so every write larger than this is split into datagrams of
+	 * 	this size by the kernel or the network card.
+	 */
+	int segment_size;
+
+	/**
+	 * \brief Sets UDP_GRO on the socket, allowing the kernel to
+	 * 	combine consecutive datagrams from the same sender into a
+	 * 	single receive.
+	 *
+	 * csalt_store_network_udp_receive() reports the size of the
+	 * combined datagrams in csalt_network_datagram::segment_size.
+	 * Plain reads from the store don't, so only enable this when
+	 * receiving with csalt_store_network_udp_receive().
+	 */
+	bool gro;
+
+	/**
+	 * \brief If greater than zero, sets SO_RCVBUF, so bursts of
+	 * 	datagrams aren't dropped while the reader catches up.
+	 */
+	int receive_buffer_size;
+};
+
+/**
+ * \brief A single datagram to send or receive in a batch.
+ */
+struct csalt_network_datagram {
+	/**
+	 * \brief The datagram's contents, or the memory to receive it
+	 * 	into.
+	 */
+	void *buffer;
+
+	/**
+	 * \brief The size of the datagram to send, or of the buffer to
+	 * 	receive into.
+	 */
+	ssize_t size;
+
+	/**
+	 * \brief The amount sent or received, set by the batch call.
+	 */
+	ssize_t length;
+
+	/**
+	 * \brief The address to send to, or the address received
+	 * 	from. Leave address_length as 0 to send to a connected
+	 * 	socket's peer.
+	 */
+	struct sockaddr_storage address;
+	socklen_t address_length;
+
+	/**
+	 * \brief The size of each datagram in buffer, set on receive.
+	 *
+	 * This is the same as length unless UDP_GRO combined several
+	 * datagrams, in which case every datagram but the last is
+	 * this size.
+	 */
+	int segment_size;
+};
+
+/**
+ * \extends csalt_store_network_client
+ * \brief The store returned by csalt_resource_network_udp.
+ *
+ * csalt_store_read() and csalt_store_write() receive and send a
+ * single datagram, as with the socket itself. Writing requires a
+ * connected socket.
+ *
+ * csalt_store_split() passes the store itself.
+ */
+struct csalt_store_network_udp {
+	struct csalt_store_network_client parent;
+
+	/**
+	 * \brief The UDP_SEGMENT size in effect, or 0 if segmentation
+	 * 	offload isn't enabled.
+	 */
+	int segment_size;
+
+	/**
+	 * \brief Whether UDP_GRO is enabled.
+	 */
+	bool gro;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a UDP socket, either connected to a peer or
+ * 	bound to a local address.
+ *
+ * The addresses returned by getaddrinfo are tried in order, and
+ * the first which can be connected or bound is used. The socket
+ * is in blocking mode: pass MSG_DONTWAIT to the batch functions
+ * for non-blocking calls.
+ *
+ * For high datagram rates, use csalt_store_network_udp_receive()
+ * and csalt_store_network_udp_send(), which move up to
+ * CSALT_NETWORK_UDP_BATCH datagrams per system call, and
+ * csalt_store_network_udp_send_segments(), which hands a whole
+ * buffer of equally sized datagrams to the kernel at once.
+ *
+ * \sa csalt_resource_network_udp_connected()
+ * \sa csalt_resource_network_udp_bound()
+ */
+struct csalt_resource_network_udp {
+	const struct csalt_static_resource_interface *vtable;
+	const char *node;
+	const char *service;
+	const struct addrinfo *hints;
+	bool bind;
+	struct csalt_network_udp_options options;
+	struct csalt_store_network_udp result;
+};
+
+/**
+ * \public \memberof csalt_resource_network_udp
+ * \brief Constructs a UDP socket connected to the given address.
+ *
+ * \param node The node to connect to
+ * \param service The service to connect to
+ * \param hints Hints for getaddrinfo, or NULL for any datagram
+ * 	socket
+ * \param options Socket options to set
+ *
+ * \returns The new resource
+ */
+struct csalt_resource_network_udp csalt_resource_network_udp_connected(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	struct csalt_network_udp_options options
+);
+
+/**
+ * \public \memberof csalt_resource_network_udp
+ * \brief Constructs a UDP socket bound to the given address.
+ *
+ * \param node The node to bind to, or NULL for the wildcard
+ * 	address
+ * \param service The service to bind to, or "0" for any free port
+ * \param hints Hints for getaddrinfo, or NULL for any passive
+ * 	datagram socket
+ * \param options Socket options to set
+ *
+ * \returns The new resource
+ */
+struct csalt_resource_network_udp csalt_resource_network_udp_bound(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	struct csalt_network_udp_options options
+);
+
+csalt_static_store *csalt_resource_network_udp_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_udp_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_udp
+ * \brief Receives up to count datagrams with a single recvmmsg()
+ * 	call.
+ *
+ * Fills in the length, address and segment size of each datagram
+ * received. A datagram larger than its buffer is truncated.
+ *
+ * \param store The socket to receive from
+ * \param datagrams The datagrams to receive into
+ * \param count The number of datagrams, of which at most
+ * 	CSALT_NETWORK_UDP_BATCH are used
+ * \param flags Flags for recvmmsg(). MSG_WAITFORONE blocks for the
+ * 	first datagram, then returns whatever else has arrived.
+ *
+ * \returns The number of datagrams received, or -1 on error.
+ */
+ssize_t csalt_store_network_udp_receive(
+	struct csalt_store_network_udp *store,
+	struct csalt_network_datagram *datagrams,
+	ssize_t count,
+	int flags
+);
+
+/**
+ * \public \memberof csalt_store_network_udp
+ * \brief Sends up to count datagrams with a single sendmmsg()
+ * 	call.
+ *
+ * Sets the length of each datagram sent.
+ *
+ * \param store The socket to send from
+ * \param datagrams The datagrams to send
+ * \param count The number of datagrams, of which at most
+ * 	CSALT_NETWORK_UDP_BATCH are used
+ * \param flags Flags for sendmmsg()
+ *
+ * \returns The number of datagrams sent, or -1 on error.
+ */
+ssize_t csalt_store_network_udp_send(
+	struct csalt_store_network_udp *store,
+	struct csalt_network_datagram *datagrams,
+	ssize_t count,
+	int flags
+);
+
+/**
+ * \public \memberof csalt_store_network_udp
+ * \brief Sends a buffer as a run of datagrams of segment_size
+ * 	bytes each, the last of which may be shorter.
+ *
+ * Where the kernel supports UDP_SEGMENT, each run of up to 64
+ * datagrams is sent with a single system call, and split up by
+ * the kernel or the network card. Otherwise, the datagrams are sent
+ * in batches with sendmmsg().
+ *
+ * \param store The socket to send from
+ * \param buffer The data to send
+ * \param size The size of buffer
+ * \param segment_size The size of each datagram
+ * \param address The address to send to, or NULL for a connected
+ * 	socket's peer
+ * \param address_length The length of address
+ *
+ * \returns The number of bytes sent, or -1 if nothing could be
+ * 	sent.
+ */
+ssize_t csalt_store_network_udp_send_segments(
+	struct csalt_store_network_udp *store,
+	const void *buffer,
+	ssize_t size,
+	int segment_size,
+	const struct sockaddr *address,
+	socklen_t address_length
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_NETWORK_UDP_H
@@ -0,0 +1,184 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_NETWORK_UNIX_H
+#define CSALT_RESOURCE_NETWORK_UNIX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
+
+#include <sys/types.h>
+
+#include "client.h"
+#include "server.h"
+
+/**
+ * \file
+ * \brief Unix domain socket resources, for communicating with
+ * 	other processes on the same machine without going through
+ * 	the TCP stack.
+ *
+ * Socket names are file system paths, or names in Linux's
+ * abstract namespace when they start with '@'. Abstract names
+ * don't appear in the file system, and disappear once the
+ * listening socket is closed.
+ *
+ * Besides data, Unix domain sockets can pass open file
+ * descriptors between processes, with
+ * csalt_store_network_unix_send_fd() and
+ * csalt_store_network_unix_receive_fd(). A file store can be
+ * handed over by sending csalt_store_fd(), and opened on the other
+ * side with csalt_resource_file_descriptor(), instead of copying
+ * its contents through the socket.
+ */
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a Unix domain socket connected to a listening
+ * 	socket.
+ *
+ * The store is a csalt_store_network_client, so it can be used
+ * anywhere a TCP connection can. The socket is in blocking mode.
+ */
+struct csalt_resource_network_unix_client {
+	const struct csalt_static_resource_interface *vtable;
+	const char *path;
+	int type;
+
+	struct csalt_store_network_client result;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Represents a listening Unix domain socket, and the
+ * 	connections accepted from it.
+ *
+ * The store is a csalt_store_network_server, and connections are
+ * handled with csalt_store_network_server_poll() in the same way
+ * as for TCP.
+ *
+ * A socket bound to a file system path creates a socket file,
+ * which is removed by csalt_resource_deinit(). If the file is
+ * already there, for example after a crash, initialization fails
+ * rather than taking over another server's name.
+ */
+struct csalt_resource_network_unix_server {
+	const struct csalt_static_resource_interface *vtable;
+	const char *path;
+	int type;
+	int backlog;
+
+	struct csalt_store_network_server result;
+};
+
+/**
+ * \public \memberof csalt_resource_network_unix_client
+ * \brief Constructs a new csalt_resource_network_unix_client.
+ *
+ * \param path The name of the socket to connect to
+ * \param type SOCK_STREAM for a byte stream, or SOCK_SEQPACKET to
+ * 	keep message boundaries
+ *
+ * \returns The new resource
+ */
+struct csalt_resource_network_unix_client csalt_resource_network_unix_client(
+	const char *path,
+	int type
+);
+csalt_static_store *csalt_resource_network_unix_client_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_unix_client_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_resource_network_unix_server
+ * \brief Constructs a new csalt_resource_network_unix_server.
+ *
+ * \param path The name to listen on
+ * \param type SOCK_STREAM for a byte stream, or SOCK_SEQPACKET to
+ * 	keep message boundaries
+ *
+ * \returns The new resource
+ */
+struct csalt_resource_network_unix_server csalt_resource_network_unix_server(
+	const char *path,
+	int type
+);
+csalt_static_store *csalt_resource_network_unix_server_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_unix_server_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_client
+ * \brief Sends data along with an open file descriptor over a
+ * 	Unix domain socket.
+ *
+ * The receiver gets its own copy of the file descriptor, and the
+ * sender's copy is left open.
+ *
+ * \param network The socket to send on
+ * \param buffer The data to send with the file descriptor, which
+ * 	must be at least one byte
+ * \param size The amount of data to send
+ * \param fd The file descriptor to send
+ *
+ * \returns The amount of data sent, or -1 on error.
+ */
+ssize_t csalt_store_network_unix_send_fd(
+	const struct csalt_store_network_client *network,
+	const void *buffer,
+	ssize_t size,
+	int fd
+);
+
+/**
+ * \public \memberof csalt_store_network_client
+ * \brief Receives data, and a file descriptor if one was sent
+ * 	with it, from a Unix domain socket.
+ *
+ * The received file descriptor is opened with close-on-exec set.
+ *
+ * Only one descriptor can be received at a time. If the data came
+ * with more than one, every descriptor is closed, and -1 is
+ * returned with errno set to EMSGSIZE; the data is still consumed.
+ *
+ * \param network The socket to receive from
+ * \param buffer The memory to receive data into
+ * \param size The size of buffer
+ * \param fd Set to the file descriptor received, or -1 if the data
+ * 	didn't come with one
+ *
+ * \returns The amount of data received, or -1 on error.
+ */
+ssize_t csalt_store_network_unix_receive_fd(
+	const struct csalt_store_network_client *network,
+	void *buffer,
+	ssize_t size,
+	int *fd
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_NETWORK_UNIX_H
@@ -0,0 +1,239 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_NETWORK_ZEROCOPY_H
+#define CSALT_RESOURCE_NETWORK_ZEROCOPY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "csalt/resource/base.h"
+#include "csalt/store/base.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client.h"
+
+/**
+ * \file
+ * \copydoc csalt_resource_network_zerocopy
+ */
+
+/**
+ * \brief The number of out-of-order completion ranges a
+ * 	csalt_store_network_zerocopy can hold on to while waiting for
+ * 	earlier sends to complete.
+ */
+#define CSALT_NETWORK_ZEROCOPY_RANGES 32
+
+/**
+ * \brief The longest time csalt_resource_deinit() waits for
+ * 	zero-copy sends to complete, in milliseconds, before closing
+ * 	the socket anyway.
+ */
+#define CSALT_NETWORK_ZEROCOPY_DEINIT_TIMEOUT 5000
+
+/**
+ * \extends csalt_store_network_client
+ * \brief The store returned by csalt_resource_network_zerocopy.
+ *
+ * csalt_store_write() sends writes of at least the threshold size
+ * with MSG_ZEROCOPY, and smaller writes as usual. Since callers of
+ * csalt_store_write() expect to reuse the buffer as soon as it
+ * returns, it waits for a zero-copy send to complete first, and
+ * returns -1 if it can't tell that it has. To overlap sends with
+ * other work, use csalt_store_network_zerocopy_send(), which
+ * returns straight away, and csalt_store_network_zerocopy_wait()
+ * before reusing the buffer.
+ *
+ * csalt_store_read() reads from the socket as usual.
+ *
+ * csalt_store_split() passes the store itself.
+ */
+struct csalt_store_network_zerocopy {
+	struct csalt_store_network_client parent;
+	ssize_t threshold;
+
+	/**
+	 * \brief Whether the socket accepted SO_ZEROCOPY. If not,
+	 * 	every write is copied as usual.
+	 */
+	bool enabled;
+
+	/**
+	 * \brief Set when the kernel reports that it copied the data
+	 * 	for a zero-copy send anyway, as it does for loopback and
+	 * 	for devices without scatter-gather support. If this is
+	 * 	set, zero-copy sends are only adding overhead.
+	 */
+	bool copied;
+
+	/**
+	 * \brief Set if more completions arrived out of order than
+	 * 	could be held on to. The sends they covered can then never
+	 * 	be seen to complete, so waiting for them fails instead.
+	 */
+	bool lost;
+
+	uint64_t sent;
+	uint64_t completed;
+
+	// Completions which arrived before an earlier send completed,
+	// merged where they touch, so one range is held per gap
+	struct {
+		uint64_t begin;
+		uint64_t end;
+	} ranges[CSALT_NETWORK_ZEROCOPY_RANGES];
+	int range_count;
+};
+
+/**
+ * \extends csalt_static_resource
+ * \brief Decorates a network socket resource so that large writes
+ * 	are sent without copying them into the kernel.
+ *
+ * With MSG_ZEROCOPY, the kernel sends straight from the caller's
+ * memory, which must then be left untouched until the kernel
+ * reports that the send has completed. Each zero-copy send is
+ * given an ID, and completions are read from the socket's error
+ * queue by csalt_store_network_zerocopy_done() and
+ * csalt_store_network_zerocopy_wait().
+ *
+ * Pinning the memory has a cost of its own, so zero-copy is only
+ * worth it for writes of around 10KB or more.
+ *
+ * The decorated resource must return a store compatible with
+ * csalt_store_network_client, such as csalt_resource_network_client.
+ *
+ * csalt_resource_deinit() waits for every zero-copy send to
+ * complete before deinitializing the decorated resource, for up to
+ * CSALT_NETWORK_ZEROCOPY_DEINIT_TIMEOUT milliseconds. If they still
+ * haven't completed, or their completions were lost, the socket is
+ * closed anyway.
+ */
+struct csalt_resource_network_zerocopy {
+	const struct csalt_static_resource_interface *vtable;
+	csalt_static_resource *resource;
+	ssize_t threshold;
+
+	struct csalt_store_network_zerocopy result;
+};
+
+/**
+ * \public \memberof csalt_resource_network_zerocopy
+ * \brief Constructs a new csalt_resource_network_zerocopy.
+ *
+ * \param resource The socket resource to decorate
+ * \param threshold The smallest write to send with MSG_ZEROCOPY
+ *
+ * \returns The new resource
+ */
+struct csalt_resource_network_zerocopy csalt_resource_network_zerocopy(
+	csalt_static_resource *resource,
+	ssize_t threshold
+);
+csalt_static_store *csalt_resource_network_zerocopy_init(
+	csalt_static_resource *resource
+);
+void csalt_resource_network_zerocopy_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_network_zerocopy
+ * \brief Sends data, without copying it if it's at least the
+ * 	threshold size.
+ *
+ * \param store The store to send on
+ * \param buffer The data to send
+ * \param size The amount of data to send
+ * \param id Set to the ID to pass to
+ * 	csalt_store_network_zerocopy_done() or
+ * 	csalt_store_network_zerocopy_wait() before buffer can be
+ * 	reused. Sends which were copied are given an ID which is
+ * 	already done. May be NULL.
+ *
+ * \returns The amount sent, or -1 on error.
+ */
+ssize_t csalt_store_network_zerocopy_send(
+	struct csalt_store_network_zerocopy *store,
+	const void *buffer,
+	ssize_t size,
+	uint64_t *id
+);
+
+/**
+ * \public \memberof csalt_store_network_zerocopy
+ * \brief Returns the ID of the most recent zero-copy send, which
+ * 	is done once every earlier send is done.
+ */
+uint64_t csalt_store_network_zerocopy_last(
+	const struct csalt_store_network_zerocopy *store
+);
+
+/**
+ * \public \memberof csalt_store_network_zerocopy
+ * \brief Reads any completions waiting on the socket, then
+ * 	returns whether the send with the given ID, and every send
+ * 	before it, has completed.
+ */
+bool csalt_store_network_zerocopy_done(
+	struct csalt_store_network_zerocopy *store,
+	uint64_t id
+);
+
+/**
+ * \public \memberof csalt_store_network_zerocopy
+ * \brief Waits for the send with the given ID, and every send
+ * 	before it, to complete.
+ *
+ * \param store The store the data was sent on
+ * \param id The ID returned by csalt_store_network_zerocopy_send()
+ * \param timeout The longest time to wait, in milliseconds, or -1
+ * 	to wait indefinitely
+ *
+ * \returns 0 once the send has completed, or -1 on timeout or
+ * 	error, or if completions were lost (see
+ * 	csalt_store_network_zerocopy::lost).
+ */
+int csalt_store_network_zerocopy_wait(
+	struct csalt_store_network_zerocopy *store,
+	uint64_t id,
+	int timeout
+);
+
+/**
+ * \public \memberof csalt_store_network_zerocopy
+ * \brief Returns the number of zero-copy sends which haven't
+ * 	completed yet, as of the last time completions were read.
+ */
+ssize_t csalt_store_network_zerocopy_pending(
+	const struct csalt_store_network_zerocopy *store
+);
+
+ssize_t csalt_store_network_zerocopy_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_NETWORK_ZEROCOPY_H
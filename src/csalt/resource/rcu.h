@@ -0,0 +1,211 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_RCU_H
+#define CSALT_RESOURCE_RCU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+#include "heap.h"
+
+#include <stdatomic.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_rcu
+ */
+
+/**
+ * \brief The number of readers which may be reading a single
+ * 	csalt_store_rcu at the same time.
+ *
+ * This sets the size of csalt_store_rcu, so it's fixed when the
+ * library is built.
+ */
+#define CSALT_STORE_RCU_READERS 32
+
+/*
+ * A single published snapshot. This should not be considered
+ * part of the public API.
+ */
+struct csalt_store_rcu_version;
+
+/*
+ * A reader's announced epoch, padded to its own cache line.
+ * This should not be considered part of the public API.
+ */
+struct csalt_store_rcu_reader {
+	_Alignas(64) atomic_size_t epoch;
+};
+
+/**
+ * \brief A read-mostly store, where readers never block and
+ * 	writers publish whole new versions atomically.
+ *
+ * The store holds a pointer to the current version, which is
+ * backed by a csalt_resource_heap. Every operation is performed
+ * against whichever version is current when the operation
+ * begins.
+ *
+ * - csalt_store_read(), csalt_store_split() and csalt_store_size()
+ *   operate on the current version. Inside a csalt_store_split()
+ *   block, the version passed will stay valid until the block
+ *   returns, even if newer versions are published in the
+ *   meantime.
+ * - csalt_store_write() and csalt_store_resize() copy the current
+ *   version, perform the operation on the copy, then publish it.
+ *   To perform more than one modification per copy, use
+ *   csalt_store_rcu_update().
+ *
+ * Replaced versions are reclaimed once every reader which could
+ * have seen them has finished, using epoch-based reclamation.
+ *
+ * Reads never wait on a lock; if every one of the
+ * CSALT_STORE_RCU_READERS reader slots is in use, the operation
+ * returns -1 immediately, in the same way a failed trylock does for
+ * csalt_store_mutex.
+ */
+struct csalt_store_rcu {
+	const struct csalt_dynamic_store_interface *vtable;
+	_Atomic(struct csalt_store_rcu_version *) current;
+	_Atomic(struct csalt_store_rcu_version *) retired;
+	atomic_size_t epoch;
+	struct csalt_store_rcu_reader readers[CSALT_STORE_RCU_READERS];
+};
+
+/**
+ * \extends csalt_resource
+ * \brief Represents a request for a csalt_store_rcu.
+ *
+ * csalt_resource_init() allocates the first version with the
+ * given size. csalt_resource_deinit() frees every version,
+ * current or retired; no reader may still be using the store
+ * when it is called.
+ */
+struct csalt_resource_rcu {
+	const struct csalt_dynamic_resource_interface *vtable;
+	ssize_t size;
+	struct csalt_store_rcu store;
+};
+
+/**
+ * \public \memberof csalt_resource_rcu
+ * \brief Constructs a new csalt_resource_rcu.
+ *
+ * \param initial_size The size of the first version.
+ *
+ * \returns The constructed resource
+ */
+struct csalt_resource_rcu csalt_resource_rcu(ssize_t initial_size);
+
+csalt_store *csalt_resource_rcu_init(csalt_resource *resource);
+void csalt_resource_rcu_deinit(csalt_resource *resource);
+
+ssize_t csalt_store_rcu_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t amount
+);
+ssize_t csalt_store_rcu_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t amount
+);
+int csalt_store_rcu_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+ssize_t csalt_store_rcu_size(csalt_store *store);
+ssize_t csalt_store_rcu_resize(csalt_store *store, ssize_t new_size);
+
+/**
+ * \public \memberof csalt_store_rcu
+ * \brief Copies the current version, passes the copy to block
+ * 	and publishes the copy if block succeeds.
+ *
+ * The copy is a heap store and may be written to, resized or
+ * decorated as normal inside block.
+ *
+ * If block returns a negative value, the copy is discarded. If
+ * another writer published a version after the copy was made,
+ * the copy is also discarded and -1 is returned, so that
+ * concurrent writers never overwrite each other's changes; the
+ * caller may simply try again.
+ *
+ * \param store The store to update
+ * \param block The function to build the new version
+ * \param param An additional parameter to pass to block
+ *
+ * \returns The return value of block on success, or -1 if the
+ * 	copy could not be made or published.
+ */
+int csalt_store_rcu_update(
+	struct csalt_store_rcu *store,
+	csalt_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_rcu
+ * \brief Allocates a new, uninitialized version, passes it to
+ * 	block and publishes it if block succeeds.
+ *
+ * Unlike csalt_store_rcu_update(), the current version is not
+ * copied, and the new version replaces whichever version is
+ * current when block returns.
+ *
+ * \param store The store to publish to
+ * \param size The size of the new version
+ * \param block The function to fill the new version
+ * \param param An additional parameter to pass to block
+ *
+ * \returns The return value of block on success, or -1 if the
+ * 	new version could not be allocated.
+ */
+int csalt_store_rcu_publish(
+	struct csalt_store_rcu *store,
+	ssize_t size,
+	csalt_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \public \memberof csalt_store_rcu
+ * \brief Frees any retired versions which no reader can still
+ * 	be using.
+ *
+ * This is called automatically after every publish, but may be
+ * called again to reclaim versions which were still in use at
+ * the time.
+ *
+ * \returns The number of retired versions still waiting to be
+ * 	freed.
+ */
+ssize_t csalt_store_rcu_reclaim(struct csalt_store_rcu *store);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_RCU_H
@@ -0,0 +1,253 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_RESOURCE_TIERED_H
+#define CSALT_RESOURCE_TIERED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <csalt/platform/threads.h>
+#include <csalt/util.h>
+
+/**
+ * \file
+ * \copydoc csalt_resource_tiered
+ */
+
+/*
+ * An access count for a block which isn't in any cached tier.
+ * This should not be considered part of the public API.
+ */
+struct csalt_tier_ghost {
+	ssize_t block;
+	ssize_t count;
+};
+
+/**
+ * \brief One tier of a csalt_resource_tiered.
+ *
+ * \sa csalt_tier()
+ */
+struct csalt_tier {
+	csalt_resource *resource;
+	ssize_t capacity;
+
+	/**
+	 * \brief The number of block reads served by this tier.
+	 */
+	size_t hits;
+
+	/**
+	 * \brief The number of blocks promoted into this tier.
+	 */
+	size_t promotions;
+
+	/**
+	 * \brief The number of blocks demoted out of this tier.
+	 */
+	size_t demotions;
+
+	csalt_store *store;
+	ssize_t *blocks;
+	ssize_t *counts;
+	bool *referenced;
+	ssize_t *next;
+	ssize_t *buckets;
+	size_t bucket_mask;
+	ssize_t free_slot;
+	ssize_t hand;
+};
+
+/**
+ * \brief The store returned by csalt_resource_tiered.
+ *
+ * csalt_store_read() reads each block from the fastest tier
+ * holding it, promoting it a tier once it's been read often
+ * enough. Finding the tier holding a block doesn't touch the
+ * tiers' stores.
+ *
+ * csalt_store_write() writes through to the last tier, and to the
+ * cached copy of each block it overlaps.
+ *
+ * csalt_store_split() passes a view of the same tiers to the
+ * block.
+ *
+ * csalt_store_size() is passed to the last tier.
+ * csalt_store_resize() is passed to the last tier, then drops
+ * every cached block.
+ *
+ * Every operation holds a mutex, so the store can be shared
+ * between threads, including a thread running
+ * csalt_store_tiered_demote().
+ */
+struct csalt_store_tiered {
+	const struct csalt_dynamic_store_interface *vtable;
+	struct csalt_tier *tiers;
+	ssize_t tier_count;
+	ssize_t block_size;
+	ssize_t promote_after;
+	char *scratch;
+	struct csalt_tier_ghost *ghosts;
+	ssize_t ghost_count;
+	csalt_mutex lock;
+};
+
+/**
+ * \brief A range of a csalt_store_tiered, passed to the block by
+ * 	csalt_store_split().
+ */
+struct csalt_store_tiered_view {
+	const struct csalt_static_store_interface *vtable;
+	struct csalt_store_tiered *tiered;
+	ssize_t begin;
+	ssize_t end;
+};
+
+/**
+ * \extends csalt_resource
+ * \brief Manages a hierarchy of stores, from fastest to slowest,
+ * 	keeping the most used blocks in the fastest tiers.
+ *
+ * The last tier holds all of the data, at its real offsets. Every
+ * other tier holds copies of up to capacity blocks, in slots of
+ * block_size bytes, and each block is cached in at most one tier.
+ *
+ * A block is promoted one tier up after it's been read
+ * promote_after times in its current tier. When a tier is full,
+ * the block to make room is chosen with the CLOCK algorithm, and
+ * demoted one tier down, swapping places with a block being
+ * promoted from there. Blocks demoted out of the slowest cached
+ * tier are only dropped, since the last tier already has them.
+ *
+ * csalt_store_tiered_demote() sweeps every cached tier, demoting
+ * blocks which haven't been read since the last sweep. It can be
+ * run on a csalt_resource_executor with
+ * csalt_store_tiered_demote_job().
+ *
+ * csalt_resource_init() initializes every tier's resource and
+ * allocates the bookkeeping. If any of them fail, NULL is
+ * returned. A cached tier's capacity is reduced if its store is
+ * too small to hold that many blocks.
+ */
+struct csalt_resource_tiered {
+	const struct csalt_dynamic_resource_interface *vtable;
+	struct csalt_tier *tiers;
+	ssize_t tier_count;
+	ssize_t block_size;
+	ssize_t promote_after;
+	struct csalt_store_tiered store;
+};
+
+/**
+ * \public \memberof csalt_tier
+ * \brief Constructs a tier for a csalt_resource_tiered.
+ *
+ * \param resource The resource for this tier
+ * \param capacity The largest number of blocks this tier caches.
+ * 	This is ignored for the last tier.
+ */
+struct csalt_tier csalt_tier(csalt_resource *resource, ssize_t capacity);
+
+/**
+ * \public \memberof csalt_resource_tiered
+ * \brief Constructs a new csalt_resource_tiered.
+ *
+ * For statically allocated arrays, csalt_resource_tiered()
+ * provides a convenience macro for calling this function.
+ *
+ * \param begin The fastest tier
+ * \param end One past the slowest tier, which holds all the data
+ * \param block_size The size of each block moved between tiers
+ * \param promote_after The number of reads of a block before
+ * 	it's promoted
+ *
+ * \returns The new tiered resource
+ */
+struct csalt_resource_tiered csalt_resource_tiered_bounds(
+	struct csalt_tier *begin,
+	struct csalt_tier *end,
+	ssize_t block_size,
+	ssize_t promote_after
+);
+
+#define csalt_resource_tiered(tiers, block_size, promote_after) \
+	csalt_resource_tiered_bounds( \
+		(tiers), \
+		csalt_arrend(tiers), \
+		(block_size), \
+		(promote_after))
+
+csalt_store *csalt_resource_tiered_init(csalt_resource *resource);
+void csalt_resource_tiered_deinit(csalt_resource *resource);
+
+/**
+ * \public \memberof csalt_store_tiered
+ * \brief Demotes every cached block which hasn't been read since
+ * 	the last call, and halves the read counts of the rest.
+ *
+ * \returns The number of blocks demoted, or -1 on error.
+ */
+ssize_t csalt_store_tiered_demote(struct csalt_store_tiered *store);
+
+/**
+ * \public \memberof csalt_store_tiered
+ * \brief Calls csalt_store_tiered_demote() on the store passed as
+ * 	param.
+ *
+ * This has the signature expected by csalt_executor_job_fn().
+ *
+ * \returns 0 on success, -1 on error.
+ */
+int csalt_store_tiered_demote_job(void *param);
+
+ssize_t csalt_store_tiered_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t amount
+);
+
+ssize_t csalt_store_tiered_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t amount
+);
+
+int csalt_store_tiered_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+ssize_t csalt_store_tiered_size(csalt_store *store);
+
+ssize_t csalt_store_tiered_resize(csalt_store *store, ssize_t new_size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_RESOURCE_TIERED_H
@@ -29,6 +29,10 @@
 #include "resource/lazy.h"
 #include "resource/logger.h"
 #include "resource/mutex.h"
+#include "resource/rcu.h"
+#include "resource/cache.h"
+#include "resource/tiered.h"
+#include "resource/executor.h"
 #include "resource/network.h"
 #include "resource/file.h"
 
@@ -0,0 +1,157 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_STORES_ATOMIC_H
+#define CSALT_STORES_ATOMIC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+#include <stdbool.h>
+
+/**
+ * \file
+ * \copydoc csalt_store_atomic
+ */
+
+/**
+ * \brief A store for a single 1, 2, 4, 8 or 16 byte value in
+ * 	memory, which is accessed with atomic operations instead of a
+ * 	lock.
+ *
+ * The value must be aligned to its size. Every operation returns
+ * an error if the size isn't supported or the value is misaligned.
+ *
+ * csalt_store_read() and csalt_store_write() atomically load or
+ * store the whole value. Since a value can't be read or written
+ * partially, they return -1 if size is smaller than the value,
+ * and otherwise only transfer the value's size.
+ *
+ * csalt_store_split() passes the store itself, as long as the
+ * range covers the whole value, and returns -1 otherwise.
+ *
+ * Values are passed to and returned from the other operations
+ * through pointers to objects of the same size as the store's
+ * value. 16-byte values may be implemented with a lock by the
+ * compiler's atomic library, if the processor has no suitable
+ * instruction.
+ *
+ * \sa csalt_store_atomic()
+ * \sa csalt_store_atomic_bounds()
+ */
+struct csalt_store_atomic {
+	const struct csalt_static_store_interface *vtable;
+	void *begin;
+	ssize_t size;
+};
+
+/**
+ * \public \memberof csalt_store_atomic
+ * \brief Constructs a new csalt_store_atomic.
+ *
+ * \param begin The address of the value
+ * \param size The size of the value
+ *
+ * \returns The new store
+ */
+struct csalt_store_atomic csalt_store_atomic_bounds(void *begin, ssize_t size);
+
+/**
+ * \brief Convenience macro for constructing a csalt_store_atomic
+ * 	for an object.
+ */
+#define csalt_store_atomic(obj) \
+	csalt_store_atomic_bounds(&(obj), sizeof(obj))
+
+ssize_t csalt_store_atomic_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size);
+ssize_t csalt_store_atomic_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size);
+int csalt_store_atomic_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param);
+
+/**
+ * \public \memberof csalt_store_atomic
+ * \brief Atomically adds to the value, treating it as an unsigned
+ * 	integer which wraps on overflow.
+ *
+ * \param store The store to modify
+ * \param operand A pointer to the amount to add
+ * \param previous If not NULL, receives the value before the
+ * 	addition
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_store_atomic_fetch_add(
+	struct csalt_store_atomic *store,
+	const void *operand,
+	void *previous
+);
+
+/**
+ * \public \memberof csalt_store_atomic
+ * \brief Atomically replaces the value.
+ *
+ * \param store The store to modify
+ * \param desired A pointer to the new value
+ * \param previous If not NULL, receives the value that was
+ * 	replaced
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_store_atomic_exchange(
+	struct csalt_store_atomic *store,
+	const void *desired,
+	void *previous
+);
+
+/**
+ * \public \memberof csalt_store_atomic
+ * \brief Atomically replaces the value with desired, if it is
+ * 	equal to expected.
+ *
+ * \param store The store to modify
+ * \param expected A pointer to the value expected. If the
+ * 	comparison fails, it receives the current value.
+ * \param desired A pointer to the new value
+ *
+ * \returns 1 if the value was replaced, 0 if the comparison
+ * 	failed, or -1 on error.
+ */
+int csalt_store_atomic_compare_exchange(
+	struct csalt_store_atomic *store,
+	void *expected,
+	const void *desired
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_STORES_ATOMIC_H
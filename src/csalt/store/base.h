@@ -118,10 +118,22 @@ typedef ssize_t csalt_store_resize_fn(
 	ssize_t new_size
 );
 
+/**
+ * \brief Returns a file descriptor which can be passed to poll()
+ * to wait for the store to become readable or writable, or -1 if
+ * there isn't one.
+ */
+typedef int csalt_store_fd_fn(csalt_static_store *store);
+
+/**
+ * The fd member may be left NULL by stores which aren't backed by
+ * a file descriptor.
+ */
 struct csalt_static_store_interface {
 	csalt_store_read_fn *read;
 	csalt_store_write_fn *write;
 	csalt_store_split_fn *split;
+	csalt_store_fd_fn *fd;
 };
 
 struct csalt_dynamic_store_interface {
@@ -179,6 +191,16 @@ int csalt_store_split(
 	void *data
 );
 
+/**
+ * \brief Returns a file descriptor to poll() on while waiting for
+ * the store to become readable or writable, or -1 if the store
+ * isn't backed by a file descriptor.
+ *
+ * Decorators return the file descriptor of the store they
+ * decorate.
+ */
+int csalt_store_fd(csalt_static_store *store);
+
 /**
  * \brief Returns the current size of the given store.
  */
@@ -247,6 +269,42 @@ ssize_t csalt_store_transfer(
 	csalt_static_store *to
 );
 
+/**
+ * \brief Transfers data from one store into another, blocking
+ * until the transfer is complete.
+ *
+ * Unlike calling csalt_store_transfer() in a loop, this waits in
+ * poll() whenever a read or write fails with EAGAIN or EWOULDBLOCK,
+ * using the file descriptor from csalt_store_fd(), so no CPU is used
+ * while waiting on a non-blocking file or socket. Stores without a
+ * file descriptor are retried straight away.
+ *
+ * A read of zero bytes is the end of the source, and a write of
+ * zero bytes means the destination is full; either ends the
+ * transfer early.
+ *
+ * Before each read, the destination is polled until it can accept
+ * data. Data which has been read is always written before
+ * returning, even once the timeout has expired, since it can't be
+ * returned to the source.
+ *
+ * \param progress The progress of the transfer
+ * \param from The store to read from
+ * \param to The store to write to
+ * \param timeout The longest time to wait, in milliseconds, or -1
+ * 	to wait indefinitely
+ *
+ * \returns The total amount transferred, which is less than
+ * 	progress->total if the source ended, the destination filled
+ * 	up or the timeout expired, or -1 on error.
+ */
+ssize_t csalt_store_transfer_wait(
+	struct csalt_progress *progress,
+	csalt_static_store *from,
+	csalt_static_store *to,
+	int timeout
+);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
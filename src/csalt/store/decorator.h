@@ -56,6 +56,7 @@ int csalt_store_decorator_split(
 	ssize_t,
 	csalt_static_store_block_fn *,
 	void *);
+int csalt_store_decorator_fd(csalt_static_store *);
 ssize_t csalt_store_decorator_size(csalt_store *);
 ssize_t csalt_store_decorator_resize(csalt_store *, ssize_t);
 
@@ -29,6 +29,38 @@ extern "C" {
 #include "base.h"
 #include "pair.h"
 
+#include <csalt/platform/threads.h>
+
+/*
+ * A dirty byte range. This should not be considered part of
+ * the public API.
+ */
+struct csalt_fallback_range {
+	ssize_t begin;
+	ssize_t end;
+};
+
+struct csalt_static_store_fallback;
+
+/**
+ * \brief Tracks the ranges written to a fallback's primary store
+ * 	which haven't yet been written back to its secondary store.
+ *
+ * Overlapping and adjacent ranges are coalesced as they're
+ * marked, so the ranges stay sorted and disjoint.
+ *
+ * \sa csalt_store_fallback_writeback()
+ */
+struct csalt_fallback_dirty {
+	csalt_mutex lock;
+	struct csalt_fallback_range *ranges;
+	ssize_t count;
+	ssize_t capacity;
+	ssize_t dirty_bytes;
+	ssize_t watermark;
+	struct csalt_static_store_fallback *fallback;
+};
+
 /**
  * \brief Implements a fallback mechanism for read operations.
  *
@@ -55,10 +87,17 @@ extern "C" {
  * csalt_store_size() implements the same logic as for csalt_store_pair.
  *
  * csalt_store_resize() implements the same logic as for csalt_store_pair.
+ *
+ * By default, nothing is written back to later stores until
+ * csalt_store_fallback_flush() is called. In write-back mode,
+ * enabled by csalt_store_fallback_writeback(), the ranges written
+ * are tracked instead, and only those are written back.
  */
 struct csalt_store_fallback {
 	const struct csalt_dynamic_store_interface *vtable;
 	struct csalt_store_pair pair;
+	struct csalt_fallback_dirty *dirty;
+	ssize_t offset;
 };
 
 /**
@@ -70,6 +109,8 @@ struct csalt_store_fallback {
 struct csalt_static_store_fallback {
 	const struct csalt_static_store_interface *vtable;
 	struct csalt_static_store_pair pair;
+	struct csalt_fallback_dirty *dirty;
+	ssize_t offset;
 };
 
 /**
@@ -158,6 +199,82 @@ ssize_t csalt_store_fallback_flush(
 	struct csalt_static_store_fallback *store,
 	ssize_t amount);
 
+/**
+ * \public \memberof csalt_fallback_dirty
+ * \brief Initializes an empty set of dirty ranges.
+ *
+ * \param dirty The dirty ranges to initialize
+ * \param watermark The largest number of dirty bytes allowed.
+ * 	A write which takes the fallback past this writes every
+ * 	dirty range back before returning. If zero or less, writes
+ * 	never flush.
+ *
+ * \returns 0 on success, -1 on failure.
+ */
+int csalt_fallback_dirty_init(
+	struct csalt_fallback_dirty *dirty,
+	ssize_t watermark);
+
+/**
+ * \public \memberof csalt_fallback_dirty
+ * \brief Frees the dirty ranges, without writing them back.
+ */
+void csalt_fallback_dirty_deinit(struct csalt_fallback_dirty *dirty);
+
+/**
+ * \public \memberof csalt_static_store_fallback
+ * \brief Switches a fallback to write-back mode.
+ *
+ * Writes to the fallback, including writes through the stores
+ * passed to csalt_store_split() blocks, mark the ranges written
+ * as dirty in the given set. csalt_store_fallback_flush_dirty()
+ * writes only those ranges back to the secondary store.
+ *
+ * Writing back may run on another thread, such as with
+ * csalt_store_fallback_flush_job(), while the fallback is being
+ * written. Ranges are taken out of the set before they're copied,
+ * so a range written during a flush is marked dirty again.
+ *
+ * \param store The csalt_static_store_fallback or
+ * 	csalt_store_fallback to apply this to.
+ * \param dirty An initialized set of dirty ranges, which must
+ * 	outlive the fallback. Each set tracks one fallback, which
+ * 	mustn't be moved while it's in write-back mode.
+ */
+void csalt_store_fallback_writeback(
+	struct csalt_static_store_fallback *store,
+	struct csalt_fallback_dirty *dirty);
+
+/**
+ * \public \memberof csalt_static_store_fallback
+ * \brief Writes every dirty range back to the secondary store.
+ *
+ * \returns The number of bytes written back, or -1 on error.
+ * 	Ranges which couldn't be written back stay dirty.
+ */
+ssize_t csalt_store_fallback_flush_dirty(
+	struct csalt_static_store_fallback *store);
+
+/**
+ * \public \memberof csalt_static_store_fallback
+ * \brief Calls csalt_store_fallback_flush_dirty() on the fallback
+ * 	passed as param.
+ *
+ * This has the signature expected by csalt_executor_job_fn(), for
+ * writing back on a csalt_resource_executor.
+ *
+ * \returns 0 on success, -1 on error.
+ */
+int csalt_store_fallback_flush_job(void *param);
+
+/**
+ * \public \memberof csalt_static_store_fallback
+ * \brief Returns the number of bytes waiting to be written back,
+ * 	or 0 if the fallback isn't in write-back mode.
+ */
+ssize_t csalt_store_fallback_dirty(
+	struct csalt_static_store_fallback *store);
+
 /**
  * \public \memberof csalt_store_fallback
  * \brief Initializes an array of csalt_store_fallback's
@@ -0,0 +1,246 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_STORES_LIST_H
+#define CSALT_STORES_LIST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+#include "pair.h"
+
+#include <csalt/util.h>
+
+/**
+ * \file
+ * \copydoc csalt_store_list
+ */
+
+/**
+ * \brief A list of stores backed by an array, which behaves the
+ * 	same way as a list of csalt_store_pair%s constructed with
+ * 	csalt_store_pair_list().
+ *
+ * Unlike a pair list, finding a store by index doesn't walk the
+ * list, and splitting the list builds a single array of split
+ * stores instead of a new pair per store.
+ *
+ * csalt_store_read() reads from each store in turn, and returns the
+ * result of the first store which doesn't return zero.
+ *
+ * csalt_store_write() writes to every store in order, stopping at
+ * the first error. If every write succeeds, it returns the lowest
+ * amount written, allowing for repeated attempts without data loss.
+ *
+ * csalt_store_size() returns the smallest size reported by the
+ * stores, and csalt_store_resize() resizes every store, returning
+ * the smallest new size.
+ *
+ * csalt_store_split() passes a csalt_static_store_list of the
+ * stores, each split by the requested amount.
+ *
+ * Entries in the array may be null pointers, in which case they
+ * are skipped. A list with no stores reads and writes zero bytes,
+ * and fails to resize.
+ *
+ * \sa csalt_store_list_bounds()
+ * \sa csalt_store_list_from_pairs_bounds()
+ */
+struct csalt_store_list {
+	const struct csalt_dynamic_store_interface *vtable;
+	csalt_store **begin;
+	csalt_store **end;
+};
+
+struct csalt_static_store_list {
+	const struct csalt_static_store_interface *vtable;
+	csalt_static_store **begin;
+	csalt_static_store **end;
+};
+
+/**
+ * \public \memberof csalt_store_list
+ * \brief Constructs a list over an array of stores.
+ *
+ * The array is not copied, and must outlive the list.
+ *
+ * \param begin The beginning of the array of stores
+ * \param end The end of the array of stores
+ *
+ * \returns The new list
+ *
+ * \sa csalt_store_list()
+ */
+struct csalt_store_list csalt_store_list_bounds(
+	csalt_store **begin,
+	csalt_store **end
+);
+
+/**
+ * \brief Convenience macro for constructing a list from an array
+ * 	with a size known at compile-time.
+ *
+ * \sa csalt_store_list_bounds()
+ */
+#define csalt_store_list(store_array) \
+	csalt_store_list_bounds((store_array), csalt_arrend(store_array))
+
+/**
+ * \public \memberof csalt_store_list
+ * \brief Constructs a static list over an array of static stores.
+ */
+struct csalt_static_store_list csalt_static_store_list_bounds(
+	csalt_static_store **begin,
+	csalt_static_store **end
+);
+
+/**
+ * \brief Convenience macro for constructing a static list from an
+ * 	array with a size known at compile-time.
+ *
+ * \sa csalt_static_store_list_bounds()
+ */
+#define csalt_static_store_list(store_array) \
+	csalt_static_store_list_bounds((store_array), csalt_arrend(store_array))
+
+/**
+ * \public \memberof csalt_store_list
+ * \brief Constructs a list with the same stores as a list of pairs
+ * 	constructed by csalt_store_pair_list().
+ *
+ * The `first` member of each pair is copied to the output array,
+ * and the list is constructed over the copied part of the array.
+ *
+ * If the output array is smaller than the list of pairs, the array
+ * is untouched and an empty list is returned.
+ *
+ * \param pairs The first pair in the list
+ * \param out_begin The beginning of the output array
+ * \param out_end The end of the output array
+ *
+ * \returns The new list
+ *
+ * \sa csalt_store_list_from_pairs()
+ */
+struct csalt_store_list csalt_store_list_from_pairs_bounds(
+	const struct csalt_store_pair *pairs,
+	csalt_store **out_begin,
+	csalt_store **out_end
+);
+
+/**
+ * \brief Convenience macro for csalt_store_list_from_pairs_bounds(),
+ * 	given an output array with a size known at compile-time.
+ *
+ * \code
+ * 	struct csalt_store_pair pairs[csalt_arrlength(stores)] = { 0 };
+ * 	csalt_store_pair_list(stores, pairs);
+ *
+ * 	csalt_store *copy[csalt_arrlength(pairs)];
+ * 	struct csalt_store_list list = csalt_store_list_from_pairs(pairs, copy);
+ * \endcode
+ *
+ * \sa csalt_store_list_from_pairs_bounds()
+ */
+#define csalt_store_list_from_pairs(pairs, out_array) \
+	csalt_store_list_from_pairs_bounds( \
+		(pairs), \
+		(out_array), \
+		csalt_arrend(out_array) \
+	)
+
+ssize_t csalt_store_list_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size);
+ssize_t csalt_store_list_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size);
+int csalt_store_list_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param);
+ssize_t csalt_store_list_size(csalt_store *store);
+ssize_t csalt_store_list_resize(csalt_store *store, ssize_t new_size);
+
+/**
+ * \public \memberof csalt_store_list
+ * \brief Returns the number of entries in the list.
+ */
+ssize_t csalt_store_list_length(const struct csalt_store_list *list);
+
+/**
+ * \public \memberof csalt_store_list
+ * \brief Returns the store at an index of the list, or a null
+ * 	pointer if the index is out of range.
+ */
+csalt_store *csalt_store_list_get(
+	const struct csalt_store_list *list,
+	ssize_t index
+);
+
+/**
+ * \public \memberof csalt_store_list
+ * \brief Splits each store in the list using different bounds per
+ * 	store.
+ *
+ * This behaves the same way as
+ * csalt_store_pair_list_multisplit_bounds(): the first split
+ * defines how to split the first store, the second split the second
+ * store, and so on. If there are fewer splits than stores, the
+ * remaining stores are passed as-is; extra splits are ignored.
+ *
+ * The split stores are collected into a single array, which is
+ * passed to `block` as a csalt_static_store_list.
+ *
+ * \sa csalt_store_list_multisplit()
+ */
+int csalt_store_list_multisplit_bounds(
+	const struct csalt_static_store_list *list,
+	const struct csalt_store_multisplit_split *begin,
+	const struct csalt_store_multisplit_split *end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+/**
+ * \brief Convenience macro for csalt_store_list_multisplit_bounds().
+ *
+ * Takes a static array as the second argument, instead of separate
+ * begin/end pointers.
+ *
+ * \sa csalt_store_list_multisplit_bounds()
+ */
+#define csalt_store_list_multisplit(list, multisplit_split_arr, block, param) \
+	csalt_store_list_multisplit_bounds( \
+		list, \
+		multisplit_split_arr, \
+		csalt_arrend(multisplit_split_arr), \
+		block, \
+		param)
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_STORES_LIST_H
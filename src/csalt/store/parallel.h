@@ -0,0 +1,90 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_STORES_PARALLEL_H
+#define CSALT_STORES_PARALLEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+
+/**
+ * \file
+ * \copydoc csalt_store_parallel
+ */
+
+/**
+ * \brief A task run by a csalt_store_parallel, returning 0 on
+ * 	success or -1 on failure.
+ */
+typedef int csalt_store_task_fn(void *param);
+
+/**
+ * \brief Runs a batch of independent tasks concurrently, for stores
+ * 	which divide their work between other stores, such as
+ * 	csalt_store_tee and csalt_store_striped.
+ *
+ * Stores only need to know how to hand a batch over; where it runs
+ * is up to whoever provides the csalt_store_parallel. For example,
+ * csalt_store_executor has one which runs the batch on its
+ * workers.
+ *
+ * run calls task once for each of count parameters, which are laid
+ * out size bytes apart starting at params, and returns once every
+ * call has finished. Every task is run, even if an earlier one
+ * fails.
+ *
+ * \sa csalt_store_parallel_run()
+ */
+struct csalt_store_parallel {
+	int (*run)(
+		struct csalt_store_parallel *parallel,
+		csalt_store_task_fn *task,
+		void *params,
+		ssize_t size,
+		ssize_t count);
+};
+
+/**
+ * \public \memberof csalt_store_parallel
+ * \brief Runs a batch of tasks on parallel, or one after another
+ * 	from the calling thread if parallel is NULL.
+ *
+ * \param parallel Where to run the tasks, or NULL
+ * \param task The function to call for each parameter
+ * \param params The first parameter
+ * \param size The distance in bytes between parameters
+ * \param count The number of parameters
+ *
+ * \returns 0 if every task succeeded, or -1 if any of them failed.
+ */
+int csalt_store_parallel_run(
+	struct csalt_store_parallel *parallel,
+	csalt_store_task_fn *task,
+	void *params,
+	ssize_t size,
+	ssize_t count
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_STORES_PARALLEL_H
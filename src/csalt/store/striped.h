@@ -0,0 +1,152 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_STORES_STRIPED_H
+#define CSALT_STORES_STRIPED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+#include "parallel.h"
+
+#include <csalt/util.h>
+
+/**
+ * \file
+ * \copydoc csalt_store_striped
+ */
+
+/**
+ * \brief Spreads one logical store across several devices in
+ * 	fixed-size stripes, in the style of RAID-0.
+ *
+ * The logical store is divided into stripes of `stripe_unit` bytes,
+ * which are placed on each device in turn: the first stripe on the
+ * first device, the second stripe on the second device, and so on,
+ * returning to the first device after the last.
+ *
+ * csalt_store_read() and csalt_store_write() split each device
+ * with csalt_store_split() for every stripe in the range, and
+ * transfer the stripe to or from its place in the buffer. If a
+ * csalt_store_parallel is given and the range covers more than one
+ * device, the devices are transferred concurrently on it, one task
+ * per device; otherwise they are transferred one after another. If any
+ * device fails, the whole transfer returns -1. Otherwise, the
+ * return value is the length of the range transferred without a
+ * gap, so a device which runs out of space ends the transfer at its
+ * first missing byte.
+ *
+ * csalt_store_split() splits each device to the part of it which
+ * holds the requested range, and passes a csalt_static_store_striped
+ * over the split devices.
+ *
+ * csalt_store_size() returns the length of the logical store before
+ * the first byte any device is missing. csalt_store_resize() resizes
+ * each device to hold its share of the new size, then returns the
+ * new logical size.
+ *
+ * A stripe unit of less than one byte is an error; a striped store
+ * with no devices reads and writes zero bytes.
+ *
+ * \sa csalt_store_striped_bounds()
+ */
+struct csalt_store_striped {
+	const struct csalt_dynamic_store_interface *vtable;
+	csalt_store **begin;
+	csalt_store **end;
+	ssize_t stripe_unit;
+	struct csalt_store_parallel *parallel;
+
+	/*
+	 * Where the start of this store lies in the stripe pattern,
+	 * once split. This should not be considered part of the public
+	 * API.
+	 */
+	ssize_t origin;
+};
+
+struct csalt_static_store_striped {
+	const struct csalt_static_store_interface *vtable;
+	csalt_static_store **begin;
+	csalt_static_store **end;
+	ssize_t stripe_unit;
+	struct csalt_store_parallel *parallel;
+	ssize_t origin;
+};
+
+/**
+ * \public \memberof csalt_store_striped
+ * \brief Constructs a striped store over an array of devices.
+ *
+ * The array is not copied, and must outlive the store.
+ *
+ * \param begin The beginning of the array of devices
+ * \param end The end of the array of devices
+ * \param stripe_unit The number of contiguous bytes placed on
+ * 	each device before moving to the next
+ * \param parallel Where to transfer the devices concurrently, such
+ * 	as a csalt_store_executor's parallel member, or NULL to
+ * 	transfer them from the calling thread.
+ *
+ * \returns The new striped store
+ */
+struct csalt_store_striped csalt_store_striped_bounds(
+	csalt_store **begin,
+	csalt_store **end,
+	ssize_t stripe_unit,
+	struct csalt_store_parallel *parallel
+);
+
+/**
+ * \brief Convenience macro for constructing a striped store from an
+ * 	array of devices with a size known at compile-time.
+ *
+ * \sa csalt_store_striped_bounds()
+ */
+#define csalt_store_striped(devices, stripe_unit, parallel) \
+	csalt_store_striped_bounds( \
+		(devices), \
+		csalt_arrend(devices), \
+		(stripe_unit), \
+		(parallel) \
+	)
+
+ssize_t csalt_store_striped_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size);
+ssize_t csalt_store_striped_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size);
+int csalt_store_striped_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param);
+ssize_t csalt_store_striped_size(csalt_store *store);
+ssize_t csalt_store_striped_resize(csalt_store *store, ssize_t new_size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_STORES_STRIPED_H
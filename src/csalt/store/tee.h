@@ -0,0 +1,134 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSALT_STORES_TEE_H
+#define CSALT_STORES_TEE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "base.h"
+#include "parallel.h"
+
+#include <csalt/util.h>
+
+/**
+ * \file
+ * \copydoc csalt_store_tee
+ */
+
+/**
+ * \brief Fans writes out to a list of sinks, tracking how far each
+ * 	sink has got separately.
+ *
+ * Writes are treated as one stream, and each sink's position in it
+ * is tracked separately. csalt_store_write() returns how much of
+ * the buffer the slowest sink accepted, and like any other store,
+ * expects the rest to be passed again at the start of the next
+ * write; splitting the tee at the amount written to continue, as
+ * csalt_store_transfer() does, works the same way. If a sink writes
+ * partially - for example, a non-blocking socket - or returns an
+ * error, the sinks which got further keep their progress, and are
+ * only sent the part of the next buffer they haven't accepted yet,
+ * split to where they stopped.
+ *
+ * If a csalt_store_parallel is given, the sinks are written
+ * concurrently on it; otherwise they are written one after
+ * another.
+ *
+ * csalt_store_read() reads from the first sink.
+ *
+ * csalt_store_split() splits every sink, and passes a tee of the
+ * split sinks which shares this tee's progress.
+ *
+ * \sa csalt_store_tee()
+ * \sa csalt_store_tee_bounds()
+ */
+struct csalt_store_tee {
+	const struct csalt_static_store_interface *vtable;
+	csalt_static_store **begin;
+	csalt_static_store **end;
+	struct csalt_progress *progress;
+	struct csalt_store_parallel *parallel;
+};
+
+/**
+ * \public \memberof csalt_store_tee
+ * \brief Constructs a tee over an array of sinks.
+ *
+ * \param begin The beginning of the array of sinks
+ * \param end The end of the array of sinks
+ * \param progress An array with one csalt_progress per sink, used
+ * 	to track each sink's position in the stream. It is reset by
+ * 	this function.
+ * \param parallel Where to write the sinks concurrently, such as
+ * 	a csalt_store_executor's parallel member, or NULL to write
+ * 	them from the calling thread.
+ *
+ * \returns The new tee
+ */
+struct csalt_store_tee csalt_store_tee_bounds(
+	csalt_static_store **begin,
+	csalt_static_store **end,
+	struct csalt_progress *progress,
+	struct csalt_store_parallel *parallel
+);
+
+/**
+ * \brief Convenience macro for constructing a tee from an array of
+ * 	sinks with a size known at compile-time.
+ *
+ * \sa csalt_store_tee_bounds()
+ */
+#define csalt_store_tee(sinks, progress, parallel) \
+	csalt_store_tee_bounds( \
+		(sinks), \
+		csalt_arrend(sinks), \
+		(progress), \
+		(parallel) \
+	)
+
+ssize_t csalt_store_tee_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size);
+ssize_t csalt_store_tee_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size);
+int csalt_store_tee_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param);
+
+/**
+ * \public \memberof csalt_store_tee
+ * \brief Returns the position of the slowest sink in the stream,
+ * 	which is the number of bytes every sink has accepted since
+ * 	the tee was constructed.
+ */
+ssize_t csalt_store_tee_position(const struct csalt_store_tee *tee);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CSALT_STORES_TEE_H
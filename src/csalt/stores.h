@@ -30,5 +30,10 @@
 #include "store/array.h"
 #include "store/mutex.h"
 #include "store/rwlock.h"
+#include "store/tee.h"
+#include "store/atomic.h"
+#include "store/list.h"
+#include "store/striped.h"
+#include "store/parallel.h"
 
 #endif // CSALT_STORES_H
@@ -21,6 +21,9 @@
 
 #include <csalt/platform/init.h>
 
+#include <stddef.h>
+#include <stdint.h>
+
 /**
  * \file
  * This file provides macros for common tasks
@@ -96,6 +99,15 @@ void *csalt_lfind(
 	int (*comp)(const void *, const void *)
 );
 
+/**
+ * \brief Hashes size bytes of data into a 64 bit value.
+ *
+ * The hash is fast and well distributed, for use in hash tables,
+ * but isn't cryptographically secure. Varying the seed per table
+ * makes collisions harder to arrange from outside.
+ */
+uint64_t csalt_hash(const void *data, size_t size, uint64_t seed);
+
 #ifdef PAGESIZE
 /**
  * DEFAULT_PAGESIZE represents the size of a page if
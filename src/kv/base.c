@@ -0,0 +1,109 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/kv/base.h"
+
+// virtual call functions
+
+int csalt_kv_get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	return (*kv)->get(kv, key, key_size, block, param);
+}
+
+int csalt_kv_put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+)
+{
+	return (*kv)->put(kv, key, key_size, value, value_size);
+}
+
+int csalt_kv_remove(csalt_kv *kv, const void *key, ssize_t key_size)
+{
+	return (*kv)->remove(kv, key, key_size);
+}
+
+int csalt_kv_iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param)
+{
+	return (*kv)->iterate(kv, block, param);
+}
+
+ssize_t csalt_kv_read(csalt_static_store *store, void *buffer, ssize_t size)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+ssize_t csalt_kv_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+int csalt_kv_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
+
+int csalt_kv_read_value(
+	csalt_static_store *value,
+	void *buffer,
+	ssize_t value_size
+)
+{
+	struct csalt_store_memory destination = csalt_store_memory_bounds(
+		buffer,
+		(char *)buffer + value_size);
+	struct csalt_progress progress = csalt_progress(value_size);
+
+	while (!csalt_progress_complete(&progress)) {
+		const ssize_t before = progress.amount_completed;
+		const ssize_t after = csalt_store_transfer(
+			&progress,
+			value,
+			(csalt_static_store *)&destination);
+		if (after <= before)
+			return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/kv/bloom.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "csalt/util.h"
+
+typedef struct csalt_bloom bloom_t;
+typedef struct csalt_kv_bloom kv_bloom_t;
+
+#define WORDS (CSALT_BLOOM_BLOCK_SIZE / sizeof(uint32_t))
+
+static const char magic[8] = "csbloom1";
+
+struct header {
+	char magic[8];
+	uint64_t block_count;
+	uint64_t seed;
+	uint64_t reserved;
+};
+
+_Static_assert(sizeof(struct header) == CSALT_BLOOM_HEADER_SIZE, "Bloom header size");
+
+// Odd multipliers which spread a key's hash over each word of its
+// block, as used by split block Bloom filters
+static const uint32_t salts[WORDS] = {
+	0x47b6137bu,
+	0x44974d91u,
+	0x8824ad5bu,
+	0xa2b7289du,
+	0x705495c7u,
+	0x2df1424bu,
+	0x9efc4947u,
+	0x5c6bfb31u,
+};
+
+static void attach(bloom_t *bloom, char *image, bool owned)
+{
+	const struct header *const header = (const struct header *)image;
+	bloom->image = image;
+	bloom->blocks = (uint32_t *)(image + CSALT_BLOOM_HEADER_SIZE);
+	bloom->block_count = header->block_count;
+	bloom->seed = header->seed;
+	bloom->owned = owned;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+int csalt_bloom_init(bloom_t *bloom, ssize_t keys, ssize_t bits_per_key)
+{
+	if (keys < 1)
+		keys = 1;
+	if (bits_per_key < 1)
+		return -1;
+
+	const uint64_t bits = (uint64_t)keys * (uint64_t)bits_per_key;
+	const uint64_t block_bits = CSALT_BLOOM_BLOCK_SIZE * 8;
+	const uint64_t block_count = (bits + block_bits - 1) / block_bits;
+	if (block_count > (SSIZE_MAX - CSALT_BLOOM_HEADER_SIZE) / CSALT_BLOOM_BLOCK_SIZE)
+		return -1;
+
+	const size_t size = CSALT_BLOOM_HEADER_SIZE + block_count * CSALT_BLOOM_BLOCK_SIZE;
+	char *const image = aligned_alloc(CSALT_BLOOM_BLOCK_SIZE, size);
+	if (!image)
+		return -1;
+	memset(image, 0, size);
+
+	struct header *const header = (struct header *)image;
+	memcpy(header->magic, magic, sizeof(magic));
+	header->block_count = block_count;
+	header->seed = (uint64_t)(uintptr_t)bloom ^ now_ns();
+	attach(bloom, image, true);
+	return 0;
+}
+
+int csalt_bloom_view(bloom_t *bloom, void *data, ssize_t size)
+{
+	const struct header *const header = data;
+	if (
+		size < CSALT_BLOOM_HEADER_SIZE
+		|| (uintptr_t)data % sizeof(uint32_t)
+		|| memcmp(header->magic, magic, sizeof(magic))
+		|| !header->block_count
+		|| header->block_count > (uint64_t)(size - CSALT_BLOOM_HEADER_SIZE) / CSALT_BLOOM_BLOCK_SIZE
+	)
+		return -1;
+
+	attach(bloom, data, false);
+	return 0;
+}
+
+int csalt_bloom_load(bloom_t *bloom, csalt_static_store *store)
+{
+	struct header header;
+	if (csalt_kv_read_value(store, &header, sizeof(header)))
+		return -1;
+	if (
+		memcmp(header.magic, magic, sizeof(magic))
+		|| !header.block_count
+		|| header.block_count > (SSIZE_MAX - CSALT_BLOOM_HEADER_SIZE) / CSALT_BLOOM_BLOCK_SIZE
+	)
+		return -1;
+
+	const ssize_t size = CSALT_BLOOM_HEADER_SIZE
+		+ (ssize_t)header.block_count * CSALT_BLOOM_BLOCK_SIZE;
+	char *const image = aligned_alloc(CSALT_BLOOM_BLOCK_SIZE, (size_t)size);
+	if (!image)
+		return -1;
+
+	if (csalt_kv_read_value(store, image, size) || csalt_bloom_view(bloom, image, size)) {
+		free(image);
+		return -1;
+	}
+	bloom->owned = true;
+	return 0;
+}
+
+void csalt_bloom_deinit(bloom_t *bloom)
+{
+	if (bloom->owned)
+		free(bloom->image);
+	bloom->image = NULL;
+	bloom->blocks = NULL;
+	bloom->owned = false;
+}
+
+ssize_t csalt_bloom_size(const bloom_t *bloom)
+{
+	return CSALT_BLOOM_HEADER_SIZE + (ssize_t)bloom->block_count * CSALT_BLOOM_BLOCK_SIZE;
+}
+
+int csalt_bloom_save(const bloom_t *bloom, csalt_static_store *store)
+{
+	const ssize_t size = csalt_bloom_size(bloom);
+	struct csalt_store_memory image = csalt_store_memory_bounds(
+		bloom->image,
+		bloom->image + size);
+	struct csalt_progress progress = csalt_progress(size);
+
+	while (!csalt_progress_complete(&progress)) {
+		const ssize_t before = progress.amount_completed;
+		if (csalt_store_transfer(&progress, (csalt_static_store *)&image, store) <= before)
+			return -1;
+	}
+	return 0;
+}
+
+// Finds the block for a key. The top half of the hash picks the
+// block, and the bottom half picks a bit in each of its words.
+static uint32_t *locate(const bloom_t *bloom, const void *key, ssize_t key_size, uint32_t *bits)
+{
+	const uint64_t hash = csalt_hash(key, (size_t)key_size, bloom->seed);
+	const uint64_t block = ((hash >> 32) * bloom->block_count) >> 32;
+	*bits = (uint32_t)hash;
+	return bloom->blocks + block * WORDS;
+}
+
+void csalt_bloom_add(bloom_t *bloom, const void *key, ssize_t key_size)
+{
+	uint32_t bits;
+	uint32_t *const block = locate(bloom, key, key_size, &bits);
+	for (size_t i = 0; i < WORDS; i++)
+		block[i] |= 1u << ((bits * salts[i]) >> 27);
+}
+
+bool csalt_bloom_contains(const bloom_t *bloom, const void *key, ssize_t key_size)
+{
+	uint32_t bits;
+	const uint32_t *const block = locate(bloom, key, key_size, &bits);
+
+	// Every word is tested without branching, so the loop can be
+	// vectorized
+	uint32_t missing = 0;
+	for (size_t i = 0; i < WORDS; i++)
+		missing |= ~block[i] & (1u << ((bits * salts[i]) >> 27));
+	return !missing;
+}
+
+// Key/value decorator
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	kv_bloom_t *const bloom = (kv_bloom_t *)kv;
+	if (!csalt_bloom_contains(bloom->filter, key, key_size)) {
+		bloom->skipped++;
+		return -1;
+	}
+	return csalt_kv_get(bloom->decorated, key, key_size, block, param);
+}
+
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+)
+{
+	kv_bloom_t *const bloom = (kv_bloom_t *)kv;
+	if (csalt_kv_put(bloom->decorated, key, key_size, value, value_size))
+		return -1;
+	csalt_bloom_add(bloom->filter, key, key_size);
+	return 0;
+}
+
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size)
+{
+	kv_bloom_t *const bloom = (kv_bloom_t *)kv;
+	return csalt_kv_remove(bloom->decorated, key, key_size);
+}
+
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param)
+{
+	kv_bloom_t *const bloom = (kv_bloom_t *)kv;
+	return csalt_kv_iterate(bloom->decorated, block, param);
+}
+
+static const struct csalt_kv_interface kv_impl = {
+	{
+		csalt_kv_read,
+		csalt_kv_write,
+		csalt_kv_split,
+		NULL,
+	},
+	get,
+	put,
+	remove_key,
+	iterate,
+};
+
+struct csalt_kv_bloom csalt_kv_bloom(csalt_kv *decorated, bloom_t *filter)
+{
+	return (kv_bloom_t) {
+		.vtable = &kv_impl,
+		.decorated = decorated,
+		.filter = filter,
+		.skipped = 0,
+	};
+}
+
+static int receive_key(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	(void)value;
+	csalt_bloom_add(param, key, key_size);
+	return 0;
+}
+
+int csalt_kv_bloom_fill(kv_bloom_t *kv)
+{
+	return csalt_kv_iterate(kv->decorated, receive_key, kv->filter);
+}
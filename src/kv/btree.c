@@ -0,0 +1,1143 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/kv/btree.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct csalt_resource_kv_btree resource_t;
+typedef struct csalt_store_kv_btree store_t;
+
+#define PAGE DEFAULT_PAGESIZE
+#define MAGIC 0x6565727462746c73ull
+
+// Size of a cell's own fields, besides its key suffix and value
+#define LEAF_CELL 4
+#define INTERNAL_CELL 6
+
+// On-disk structures are in host byte order
+struct meta {
+	uint64_t magic;
+	uint32_t page_size;
+	uint32_t root;
+	uint32_t page_count;
+	uint32_t reserved;
+	uint64_t count;
+};
+
+// A page is this header, the shared key prefix, then the cells.
+// Leaf cells are a uint16_t suffix size, a uint16_t value size, the
+// suffix and the value. Internal cells are a uint16_t suffix size,
+// a uint32_t child page and the suffix; the child holds keys at
+// least as large as the cell's key, and first holds keys smaller
+// than every cell's key.
+struct header {
+	uint8_t leaf;
+	uint8_t reserved;
+	uint16_t count;
+	uint16_t prefix_size;
+	uint16_t reserved2;
+	uint32_t next;
+	uint32_t first;
+};
+
+// A decoded page. Full keys and values are copied into the arena,
+// and entries refer to them by offset.
+struct entry {
+	size_t key_offset;
+	size_t key_size;
+	size_t value_offset;
+	size_t value_size;
+	uint32_t child;
+};
+
+struct node {
+	uint32_t page;
+	bool leaf;
+	uint32_t next;
+	uint32_t first;
+	struct entry *entries;
+	size_t count;
+	size_t capacity;
+	char *arena;
+	size_t arena_size;
+	size_t arena_capacity;
+};
+
+// Keys moved up into a parent after a split
+struct promotion {
+	char *key;
+	size_t key_size;
+	uint32_t page;
+};
+
+struct promotions {
+	struct promotion *items;
+	size_t count;
+};
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+);
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size);
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param);
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_kv_btree_init,
+	csalt_resource_kv_btree_deinit,
+};
+
+static const struct csalt_kv_interface kv_impl = {
+	{
+		csalt_kv_read,
+		csalt_kv_write,
+		csalt_kv_split,
+		NULL,
+	},
+	get,
+	put,
+	remove_key,
+	iterate,
+};
+
+struct csalt_resource_kv_btree csalt_resource_kv_btree(csalt_resource *file)
+{
+	return (resource_t) {
+		.vtable = &impl,
+		.file = file,
+		.store = {
+			.vtable = &kv_impl,
+		},
+	};
+}
+
+// Key comparison
+
+static int compare(const void *a, size_t a_size, const void *b, size_t b_size)
+{
+	const int result = memcmp(a, b, csalt_min(a_size, b_size));
+	if (result)
+		return result;
+	return (a_size > b_size) - (a_size < b_size);
+}
+
+static size_t common_prefix(const char *a, size_t a_size, const char *b, size_t b_size)
+{
+	const size_t limit = csalt_min(a_size, b_size);
+	size_t size = 0;
+	while (size < limit && a[size] == b[size])
+		size++;
+	return size;
+}
+
+// Page I/O
+
+struct page_params {
+	void *buffer;
+	ssize_t size;
+};
+
+static int receive_page_read(csalt_static_store *store, void *param)
+{
+	struct page_params *const params = param;
+	return csalt_kv_read_value(store, params->buffer, params->size);
+}
+
+static int receive_page_write(csalt_static_store *store, void *param)
+{
+	struct page_params *const params = param;
+	struct csalt_store_memory source = csalt_store_memory_bounds(
+		params->buffer,
+		(char *)params->buffer + params->size);
+	struct csalt_progress progress = csalt_progress(params->size);
+
+	while (!csalt_progress_complete(&progress)) {
+		const ssize_t before = progress.amount_completed;
+		if (csalt_store_transfer(&progress, (csalt_static_store *)&source, store) <= before)
+			return -1;
+	}
+	return 0;
+}
+
+static int page_read(store_t *tree, uint32_t page, void *buffer)
+{
+	if (page >= tree->page_count)
+		return -1;
+
+	struct page_params params = { buffer, PAGE };
+	return csalt_store_split(
+		(csalt_static_store *)tree->file,
+		(ssize_t)page * PAGE,
+		(ssize_t)(page + 1) * PAGE,
+		receive_page_read,
+		&params);
+}
+
+static int page_write(store_t *tree, uint32_t page, const void *buffer)
+{
+	struct page_params params = { (void *)buffer, PAGE };
+	return csalt_store_split(
+		(csalt_static_store *)tree->file,
+		(ssize_t)page * PAGE,
+		(ssize_t)(page + 1) * PAGE,
+		receive_page_write,
+		&params);
+}
+
+static int pages_reserve(store_t *tree, uint32_t count)
+{
+	const ssize_t size = (ssize_t)(tree->page_count + count) * PAGE;
+	return csalt_store_resize(tree->file, size) == size? 0: -1;
+}
+
+static uint32_t page_allocate(store_t *tree)
+{
+	if (pages_reserve(tree, 1))
+		return 0;
+	return tree->page_count++;
+}
+
+static int meta_write(store_t *tree)
+{
+	char buffer[PAGE] = { 0 };
+	const struct meta meta = {
+		MAGIC,
+		PAGE,
+		tree->root,
+		tree->page_count,
+		0,
+		tree->count,
+	};
+	memcpy(buffer, &meta, sizeof(meta));
+	return page_write(tree, 0, buffer);
+}
+
+// Nodes
+
+static void node_free(struct node *node)
+{
+	free(node->entries);
+	free(node->arena);
+	*node = (struct node) { 0 };
+}
+
+static char *node_key(const struct node *node, size_t index)
+{
+	return node->arena + node->entries[index].key_offset;
+}
+
+static int arena_append(struct node *node, const void *data, size_t size, size_t *offset)
+{
+	if (node->arena_size + size > node->arena_capacity) {
+		const size_t capacity = csalt_max(
+			node->arena_capacity * 2,
+			node->arena_size + size);
+		char *const arena = realloc(node->arena, csalt_max(capacity, 1));
+		if (!arena)
+			return -1;
+		node->arena = arena;
+		node->arena_capacity = capacity;
+	}
+
+	*offset = node->arena_size;
+	if (size)
+		memcpy(node->arena + node->arena_size, data, size);
+	node->arena_size += size;
+	return 0;
+}
+
+// Inserts an entry at index, with the key made from prefix and
+// suffix
+static int node_insert(
+	struct node *node,
+	size_t index,
+	const void *prefix,
+	size_t prefix_size,
+	const void *suffix,
+	size_t suffix_size,
+	const void *value,
+	size_t value_size,
+	uint32_t child
+)
+{
+	if (node->count == node->capacity) {
+		const size_t capacity = csalt_max(node->capacity * 2, 16);
+		struct entry *const entries = realloc(
+			node->entries,
+			capacity * sizeof(*entries));
+		if (!entries)
+			return -1;
+		node->entries = entries;
+		node->capacity = capacity;
+	}
+
+	struct entry entry = {
+		.value_size = value_size,
+		.key_size = prefix_size + suffix_size,
+		.child = child,
+	};
+	size_t ignored;
+	if (
+		arena_append(node, prefix, prefix_size, &entry.key_offset)
+		|| arena_append(node, suffix, suffix_size, &ignored)
+		|| arena_append(node, value, value_size, &entry.value_offset)
+	)
+		return -1;
+
+	memmove(
+		node->entries + index + 1,
+		node->entries + index,
+		(node->count - index) * sizeof(*node->entries));
+	node->entries[index] = entry;
+	node->count++;
+	return 0;
+}
+
+static void node_erase(struct node *node, size_t index)
+{
+	memmove(
+		node->entries + index,
+		node->entries + index + 1,
+		(node->count - index - 1) * sizeof(*node->entries));
+	node->count--;
+}
+
+static int node_read(store_t *tree, uint32_t page, struct node *node)
+{
+	char buffer[PAGE];
+	*node = (struct node) { .page = page };
+	if (!page || page_read(tree, page, buffer))
+		return -1;
+
+	struct header header;
+	memcpy(&header, buffer, sizeof(header));
+	node->leaf = header.leaf;
+	node->next = header.next;
+	node->first = header.first;
+
+	const char *const prefix = buffer + sizeof(header);
+	size_t offset = sizeof(header) + header.prefix_size;
+	const size_t cell = node->leaf? LEAF_CELL: INTERNAL_CELL;
+	if (offset > PAGE)
+		return -1;
+
+	for (size_t i = 0; i < header.count; i++) {
+		uint16_t suffix_size = 0;
+		uint16_t value_size = 0;
+		uint32_t child = 0;
+		if (offset + cell > PAGE)
+			break;
+
+		memcpy(&suffix_size, buffer + offset, sizeof(suffix_size));
+		if (node->leaf)
+			memcpy(&value_size, buffer + offset + 2, sizeof(value_size));
+		else
+			memcpy(&child, buffer + offset + 2, sizeof(child));
+		offset += cell;
+
+		if (offset + suffix_size + value_size > PAGE)
+			break;
+
+		if (node_insert(
+			node,
+			node->count,
+			prefix,
+			header.prefix_size,
+			buffer + offset,
+			suffix_size,
+			buffer + offset + suffix_size,
+			value_size,
+			child
+		))
+			break;
+		offset += (size_t)suffix_size + value_size;
+	}
+
+	if (node->count != header.count) {
+		node_free(node);
+		return -1;
+	}
+	return 0;
+}
+
+static size_t cell_size(const struct node *node, size_t index)
+{
+	const struct entry *const entry = &node->entries[index];
+	return (node->leaf? LEAF_CELL: INTERNAL_CELL)
+		+ entry->key_size
+		+ entry->value_size;
+}
+
+// Keys are sorted, so the prefix shared by a range of them is the
+// prefix shared by the first and last
+static size_t range_prefix(const struct node *node, size_t begin, size_t end)
+{
+	if (end - begin < 2)
+		return end - begin? node->entries[begin].key_size: 0;
+	return common_prefix(
+		node_key(node, begin),
+		node->entries[begin].key_size,
+		node_key(node, end - 1),
+		node->entries[end - 1].key_size);
+}
+
+static size_t range_size(const struct node *node, size_t begin, size_t end)
+{
+	const size_t prefix = range_prefix(node, begin, end);
+	size_t size = sizeof(struct header) + prefix;
+	for (size_t i = begin; i < end; i++)
+		size += cell_size(node, i) - prefix;
+	return size;
+}
+
+static void encode(
+	const struct node *node,
+	size_t begin,
+	size_t end,
+	uint32_t next,
+	uint32_t first,
+	char *buffer
+)
+{
+	const size_t prefix = range_prefix(node, begin, end);
+	const struct header header = {
+		.leaf = node->leaf,
+		.count = (uint16_t)(end - begin),
+		.prefix_size = (uint16_t)prefix,
+		.next = next,
+		.first = first,
+	};
+
+	memset(buffer, 0, PAGE);
+	memcpy(buffer, &header, sizeof(header));
+	if (begin < end)
+		memcpy(buffer + sizeof(header), node_key(node, begin), prefix);
+
+	size_t offset = sizeof(header) + prefix;
+	for (size_t i = begin; i < end; i++) {
+		const struct entry *const entry = &node->entries[i];
+		const uint16_t suffix_size = (uint16_t)(entry->key_size - prefix);
+		memcpy(buffer + offset, &suffix_size, sizeof(suffix_size));
+		if (node->leaf) {
+			const uint16_t value_size = (uint16_t)entry->value_size;
+			memcpy(buffer + offset + 2, &value_size, sizeof(value_size));
+		} else {
+			memcpy(buffer + offset + 2, &entry->child, sizeof(entry->child));
+		}
+		offset += node->leaf? LEAF_CELL: INTERNAL_CELL;
+
+		memcpy(buffer + offset, node_key(node, i) + prefix, suffix_size);
+		offset += suffix_size;
+		memcpy(buffer + offset, node->arena + entry->value_offset, entry->value_size);
+		offset += entry->value_size;
+	}
+}
+
+static int promote(
+	struct promotions *promotions,
+	const char *key,
+	size_t key_size,
+	uint32_t page
+)
+{
+	struct promotion *const items = realloc(
+		promotions->items,
+		(promotions->count + 1) * sizeof(*items));
+	if (!items)
+		return -1;
+	promotions->items = items;
+
+	char *const copy = malloc(csalt_max(key_size, 1));
+	if (!copy)
+		return -1;
+	memcpy(copy, key, key_size);
+
+	items[promotions->count++] = (struct promotion) { copy, key_size, page };
+	return 0;
+}
+
+static void promotions_free(struct promotions *promotions)
+{
+	for (size_t i = 0; i < promotions->count; i++)
+		free(promotions->items[i].key);
+	free(promotions->items);
+	*promotions = (struct promotions) { 0 };
+}
+
+// Finds where to split a node which doesn't fit in a page.
+// Halves are tried first; if a shared prefix was holding a large
+// node together, the node is packed greedily into as many pages as
+// it needs. In internal nodes, the first entry of every chunk but
+// the first is promoted rather than stored, so counting it as
+// stored only overestimates.
+static size_t *split_points(const struct node *node, size_t *chunks)
+{
+	size_t *const points = malloc((node->count + 1) * sizeof(*points));
+	if (!points)
+		return NULL;
+
+	size_t total = 0;
+	for (size_t i = 0; i < node->count; i++)
+		total += cell_size(node, i);
+
+	size_t half = 0;
+	size_t middle = 0;
+	while (middle < node->count - 1 && half < total / 2)
+		half += cell_size(node, middle++);
+	middle = csalt_max(middle, 1);
+
+	if (
+		range_size(node, 0, middle) <= PAGE
+		&& range_size(node, middle, node->count) <= PAGE
+	) {
+		points[0] = 0;
+		points[1] = middle;
+		points[2] = node->count;
+		*chunks = 2;
+		return points;
+	}
+
+	*chunks = 0;
+	points[0] = 0;
+	for (size_t begin = 0; begin < node->count;) {
+		size_t end = begin + 1;
+		while (end < node->count && range_size(node, begin, end + 1) <= PAGE)
+			end++;
+		points[++*chunks] = end;
+		begin = end;
+	}
+	return points;
+}
+
+// Writes a node back to its page, splitting it across new pages if
+// it's outgrown it, and adds the new pages to promotions
+static int node_write(store_t *tree, const struct node *node, struct promotions *promotions)
+{
+	char buffer[PAGE];
+	if (range_size(node, 0, node->count) <= PAGE) {
+		encode(node, 0, node->count, node->next, node->first, buffer);
+		return page_write(tree, node->page, buffer);
+	}
+
+	size_t chunks = 0;
+	size_t *const points = split_points(node, &chunks);
+	if (!points)
+		return -1;
+
+	// Reserve every page up front, so nothing is written unless
+	// the whole split can be
+	const uint32_t first_page = tree->page_count;
+	int result = pages_reserve(tree, (uint32_t)(chunks - 1));
+	if (!result)
+		tree->page_count += (uint32_t)(chunks - 1);
+
+	for (size_t i = 1; !result && i < chunks; i++) {
+		const size_t begin = points[i];
+		const uint32_t page = first_page + (uint32_t)(i - 1);
+
+		if (node->leaf) {
+			// The shortest key above the left chunk's last key
+			// which isn't above the right chunk's first key
+			const size_t shared = common_prefix(
+				node_key(node, begin - 1),
+				node->entries[begin - 1].key_size,
+				node_key(node, begin),
+				node->entries[begin].key_size);
+			result = promote(
+				promotions,
+				node_key(node, begin),
+				csalt_min(shared + 1, node->entries[begin].key_size),
+				page);
+		} else {
+			result = promote(
+				promotions,
+				node_key(node, begin),
+				node->entries[begin].key_size,
+				page);
+		}
+	}
+
+	for (size_t i = 0; !result && i < chunks; i++) {
+		const uint32_t page = i? first_page + (uint32_t)(i - 1): node->page;
+		size_t begin = points[i];
+		uint32_t first = node->first;
+		uint32_t next = node->next;
+
+		if (node->leaf && i + 1 < chunks)
+			next = first_page + (uint32_t)i;
+		if (!node->leaf && i)
+			first = node->entries[begin++].child;
+
+		encode(node, begin, points[i + 1], next, first, buffer);
+		result = page_write(tree, page, buffer);
+	}
+
+	free(points);
+	return result;
+}
+
+// Searching
+
+// The first entry whose key isn't less than key
+static size_t lower_bound(const struct node *node, const void *key, size_t key_size)
+{
+	size_t low = 0;
+	size_t high = node->count;
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (compare(node_key(node, middle), node->entries[middle].key_size, key, key_size) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+// The first entry whose key is greater than key
+static size_t upper_bound(const struct node *node, const void *key, size_t key_size)
+{
+	size_t low = 0;
+	size_t high = node->count;
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (compare(node_key(node, middle), node->entries[middle].key_size, key, key_size) <= 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+static uint32_t child_for(const struct node *node, const void *key, size_t key_size)
+{
+	const size_t index = upper_bound(node, key, key_size);
+	return index? node->entries[index - 1].child: node->first;
+}
+
+// Reads the leaf which would hold key, or the first leaf if key is
+// NULL
+static int find_leaf(
+	store_t *tree,
+	const void *key,
+	size_t key_size,
+	struct node *node
+)
+{
+	uint32_t page = tree->root;
+	for (;;) {
+		if (node_read(tree, page, node))
+			return -1;
+		if (node->leaf)
+			return 0;
+
+		page = key? child_for(node, key, key_size): node->first;
+		node_free(node);
+	}
+}
+
+static bool entry_fits(ssize_t key_size, ssize_t value_size)
+{
+	return key_size >= 0
+		&& value_size >= 0
+		&& key_size + value_size <= CSALT_KV_BTREE_MAX_ENTRY;
+}
+
+// Key/value operations
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	store_t *const tree = (store_t *)kv;
+	if (!tree->root || key_size < 0)
+		return -1;
+
+	struct node node;
+	if (find_leaf(tree, key, (size_t)key_size, &node))
+		return -1;
+
+	int result = -1;
+	const size_t index = lower_bound(&node, key, (size_t)key_size);
+	if (
+		index < node.count
+		&& !compare(node_key(&node, index), node.entries[index].key_size, key, (size_t)key_size)
+	) {
+		char *const value = node.arena + node.entries[index].value_offset;
+		struct csalt_store_memory memory = csalt_store_memory_bounds(
+			value,
+			value + node.entries[index].value_size);
+		result = block((csalt_static_store *)&memory, param);
+	}
+
+	node_free(&node);
+	return result;
+}
+
+static int insert(
+	store_t *tree,
+	uint32_t page,
+	const void *key,
+	size_t key_size,
+	const void *value,
+	size_t value_size,
+	struct promotions *promotions
+)
+{
+	struct node node;
+	if (node_read(tree, page, &node))
+		return -1;
+
+	int result = 0;
+	bool added = false;
+	if (node.leaf) {
+		const size_t index = lower_bound(&node, key, key_size);
+		const bool exists = index < node.count
+			&& !compare(node_key(&node, index), node.entries[index].key_size, key, key_size);
+		if (exists)
+			node_erase(&node, index);
+		added = !exists;
+
+		result = node_insert(&node, index, NULL, 0, key, key_size, value, value_size, 0);
+	} else {
+		const size_t index = upper_bound(&node, key, key_size);
+		const uint32_t child = index? node.entries[index - 1].child: node.first;
+
+		struct promotions children = { 0 };
+		result = insert(tree, child, key, key_size, value, value_size, &children);
+		for (size_t i = 0; !result && i < children.count; i++)
+			result = node_insert(
+				&node,
+				index + i,
+				NULL,
+				0,
+				children.items[i].key,
+				children.items[i].key_size,
+				NULL,
+				0,
+				children.items[i].page);
+		promotions_free(&children);
+	}
+
+	if (!result)
+		result = node_write(tree, &node, promotions);
+
+	// Only counted once the leaf holding it has been written
+	if (!result && added)
+		tree->count++;
+	node_free(&node);
+	return result;
+}
+
+// Adds levels above the root until the root fits in one page
+static int grow(store_t *tree, struct promotions *promotions)
+{
+	int result = 0;
+	while (!result && promotions->count) {
+		struct node root = {
+			.page = page_allocate(tree),
+			.first = tree->root,
+		};
+		result = root.page? 0: -1;
+		for (size_t i = 0; !result && i < promotions->count; i++)
+			result = node_insert(
+				&root,
+				i,
+				NULL,
+				0,
+				promotions->items[i].key,
+				promotions->items[i].key_size,
+				NULL,
+				0,
+				promotions->items[i].page);
+
+		struct promotions above = { 0 };
+		if (!result)
+			result = node_write(tree, &root, &above);
+		if (!result)
+			tree->root = root.page;
+
+		node_free(&root);
+		promotions_free(promotions);
+		*promotions = above;
+	}
+	return result;
+}
+
+static int create_root(store_t *tree)
+{
+	char buffer[PAGE];
+	const struct node empty = { .leaf = true };
+	const uint32_t page = page_allocate(tree);
+	if (!page)
+		return -1;
+
+	encode(&empty, 0, 0, 0, 0, buffer);
+	if (page_write(tree, page, buffer))
+		return -1;
+	tree->root = page;
+	return 0;
+}
+
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+)
+{
+	store_t *const tree = (store_t *)kv;
+	if (!entry_fits(key_size, value_size))
+		return -1;
+
+	char buffer[CSALT_KV_BTREE_MAX_ENTRY];
+	if (csalt_kv_read_value(value, buffer, value_size))
+		return -1;
+
+	if (!tree->root && create_root(tree))
+		return -1;
+
+	struct promotions promotions = { 0 };
+	int result = insert(
+		tree,
+		tree->root,
+		key,
+		(size_t)key_size,
+		buffer,
+		(size_t)value_size,
+		&promotions);
+	if (!result)
+		result = grow(tree, &promotions);
+	promotions_free(&promotions);
+
+	if (!result)
+		result = meta_write(tree);
+	return result;
+}
+
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size)
+{
+	store_t *const tree = (store_t *)kv;
+	if (!tree->root || key_size < 0)
+		return -1;
+
+	struct node node;
+	if (find_leaf(tree, key, (size_t)key_size, &node))
+		return -1;
+
+	int result = -1;
+	const size_t index = lower_bound(&node, key, (size_t)key_size);
+	if (
+		index < node.count
+		&& !compare(node_key(&node, index), node.entries[index].key_size, key, (size_t)key_size)
+	) {
+		// Removing a key never makes a page bigger, so this can't
+		// split
+		node_erase(&node, index);
+		result = node_write(tree, &node, NULL);
+		if (!result) {
+			tree->count--;
+			result = meta_write(tree);
+		}
+	}
+
+	node_free(&node);
+	return result;
+}
+
+int csalt_store_kv_btree_range(
+	store_t *tree,
+	const void *begin,
+	ssize_t begin_size,
+	const void *end,
+	ssize_t end_size,
+	csalt_kv_block_fn *block,
+	void *param
+)
+{
+	if (!tree->root)
+		return 0;
+
+	struct node node;
+	if (find_leaf(tree, begin, (size_t)begin_size, &node))
+		return -1;
+
+	int result = 0;
+	size_t index = begin? lower_bound(&node, begin, (size_t)begin_size): 0;
+	for (;;) {
+		for (; !result && index < node.count; index++) {
+			const struct entry *const entry = &node.entries[index];
+			if (end && compare(node_key(&node, index), entry->key_size, end, (size_t)end_size) >= 0) {
+				node_free(&node);
+				return 0;
+			}
+
+			char *const value = node.arena + entry->value_offset;
+			struct csalt_store_memory memory = csalt_store_memory_bounds(
+				value,
+				value + entry->value_size);
+			result = block(
+				node_key(&node, index),
+				(ssize_t)entry->key_size,
+				(csalt_static_store *)&memory,
+				param);
+		}
+
+		const uint32_t next = node.next;
+		node_free(&node);
+		if (result || !next)
+			return result;
+		if (node_read(tree, next, &node))
+			return -1;
+		index = 0;
+	}
+}
+
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param)
+{
+	return csalt_store_kv_btree_range((store_t *)kv, NULL, 0, NULL, 0, block, param);
+}
+
+// Bulk loading
+
+// Starts a new node on a freshly allocated page, writing out the
+// full one. Separators for the new page are added to level.
+static int load_flush(
+	store_t *tree,
+	struct node *node,
+	struct promotions *level,
+	const char *key,
+	size_t key_size,
+	size_t separator_size
+)
+{
+	char buffer[PAGE];
+	const uint32_t page = page_allocate(tree);
+	if (!page)
+		return -1;
+
+	encode(node, 0, node->count, node->leaf? page: 0, node->first, buffer);
+	if (page_write(tree, node->page, buffer))
+		return -1;
+
+	const bool leaf = node->leaf;
+	node_free(node);
+	*node = (struct node) { .page = page, .leaf = leaf };
+	return promote(level, key, separator_size? separator_size: key_size, page);
+}
+
+static int load_leaves(
+	store_t *tree,
+	csalt_kv_btree_next_fn *next,
+	void *param,
+	struct promotions *level
+)
+{
+	struct node node = { .page = page_allocate(tree), .leaf = true };
+	int result = node.page? 0: -1;
+	tree->root = node.page;
+
+	for (;;) {
+		const void *key = NULL;
+		const void *value = NULL;
+		ssize_t key_size = 0;
+		ssize_t value_size = 0;
+		const int more = result? 0: next(&key, &key_size, &value, &value_size, param);
+		if (more <= 0) {
+			result = result || more;
+			break;
+		}
+
+		const size_t last = node.count - 1;
+		if (
+			!entry_fits(key_size, value_size)
+			|| (node.count && compare(node_key(&node, last), node.entries[last].key_size, key, (size_t)key_size) >= 0)
+		) {
+			result = -1;
+			break;
+		}
+
+		result = node_insert(&node, node.count, NULL, 0, key, (size_t)key_size, value, (size_t)value_size, 0);
+		if (!result && range_size(&node, 0, node.count) > PAGE) {
+			// Move the new entry to the start of a new leaf
+			node_erase(&node, node.count - 1);
+			const size_t shared = common_prefix(
+				node_key(&node, node.count - 1),
+				node.entries[node.count - 1].key_size,
+				key,
+				(size_t)key_size);
+			result = load_flush(tree, &node, level, key, (size_t)key_size, csalt_min(shared + 1, (size_t)key_size))
+				|| node_insert(&node, 0, NULL, 0, key, (size_t)key_size, value, (size_t)value_size, 0);
+		}
+		tree->count++;
+	}
+
+	char buffer[PAGE];
+	if (!result) {
+		encode(&node, 0, node.count, 0, 0, buffer);
+		result = page_write(tree, node.page, buffer);
+	}
+	node_free(&node);
+	return result;
+}
+
+// Builds one level of internal nodes over the pages in below. The
+// first page of the level below is the current root.
+static int load_level(
+	store_t *tree,
+	struct promotions *below,
+	struct promotions *level
+)
+{
+	struct node node = { .page = page_allocate(tree), .first = tree->root };
+	int result = node.page? 0: -1;
+	tree->root = node.page;
+
+	for (size_t i = 0; !result && i < below->count; i++) {
+		const struct promotion *const item = &below->items[i];
+		result = node_insert(&node, node.count, NULL, 0, item->key, item->key_size, NULL, 0, item->page);
+		if (!result && range_size(&node, 0, node.count) > PAGE) {
+			// The separator moves up, and its page becomes the
+			// first child of a new node
+			node_erase(&node, node.count - 1);
+			result = load_flush(tree, &node, level, item->key, item->key_size, 0);
+			node.first = item->page;
+		}
+	}
+
+	char buffer[PAGE];
+	if (!result) {
+		encode(&node, 0, node.count, 0, node.first, buffer);
+		result = page_write(tree, node.page, buffer);
+	}
+	node_free(&node);
+	return result;
+}
+
+static int reset(store_t *tree)
+{
+	tree->root = 0;
+	tree->count = 0;
+	tree->page_count = 1;
+	if (csalt_store_resize(tree->file, PAGE) != PAGE)
+		return -1;
+	return meta_write(tree);
+}
+
+int csalt_store_kv_btree_load(
+	store_t *tree,
+	csalt_kv_btree_next_fn *next,
+	void *param
+)
+{
+	if (tree->count || reset(tree))
+		return -1;
+
+	struct promotions level = { 0 };
+	int result = load_leaves(tree, next, param, &level);
+
+	while (!result && level.count) {
+		struct promotions above = { 0 };
+		result = load_level(tree, &level, &above);
+		promotions_free(&level);
+		level = above;
+	}
+	promotions_free(&level);
+
+	if (!result)
+		result = meta_write(tree);
+	if (result)
+		reset(tree);
+	return result;
+}
+
+// Resource functions
+
+csalt_static_store *csalt_resource_kv_btree_init(
+	csalt_static_resource *resource
+)
+{
+	resource_t *const btree = (resource_t *)resource;
+	store_t *const tree = &btree->store;
+
+	tree->file = csalt_resource_init(btree->file);
+	if (!tree->file)
+		return NULL;
+
+	tree->root = 0;
+	tree->count = 0;
+	tree->page_count = 1;
+
+	const ssize_t size = csalt_store_size(tree->file);
+	if (!size) {
+		if (reset(tree)) {
+			csalt_resource_deinit(btree->file);
+			return NULL;
+		}
+		return (csalt_static_store *)tree;
+	}
+
+	char buffer[PAGE];
+	struct meta meta = { 0 };
+	tree->page_count = (uint32_t)(size / PAGE);
+	if (!page_read(tree, 0, buffer))
+		memcpy(&meta, buffer, sizeof(meta));
+
+	if (
+		meta.magic != MAGIC
+		|| meta.page_size != PAGE
+		|| meta.page_count > tree->page_count
+		|| meta.root >= meta.page_count
+	) {
+		csalt_resource_deinit(btree->file);
+		return NULL;
+	}
+
+	tree->root = meta.root;
+	tree->page_count = meta.page_count;
+	tree->count = meta.count;
+	return (csalt_static_store *)tree;
+}
+
+void csalt_resource_kv_btree_deinit(csalt_resource *resource)
+{
+	resource_t *const btree = (resource_t *)resource;
+	csalt_resource_deinit(btree->file);
+}
+
+ssize_t csalt_store_kv_btree_count(const store_t *tree)
+{
+	return (ssize_t)tree->count;
+}
@@ -0,0 +1,437 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/kv/hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "csalt/util.h"
+
+typedef struct csalt_resource_kv_hash resource_t;
+typedef struct csalt_store_kv_hash store_t;
+typedef struct csalt_kv_hash_table table_t;
+typedef struct csalt_kv_hash_slot slot_t;
+
+#define MINIMUM_CAPACITY 8
+
+// The number of old slots moved by each modification while
+// rehashing. Any value above one finishes the migration before
+// the new table can fill up.
+#define MIGRATE_STEP 8
+
+struct entry {
+	ssize_t key_size;
+	ssize_t value_size;
+	char data[];
+};
+
+struct csalt_kv_hash_slot {
+	uint64_t hash;
+	struct entry *entry;
+};
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+);
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size);
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param);
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_kv_hash_init,
+	csalt_resource_kv_hash_deinit,
+};
+
+static const struct csalt_kv_interface kv_impl = {
+	{
+		csalt_kv_read,
+		csalt_kv_write,
+		csalt_kv_split,
+		NULL,
+	},
+	get,
+	put,
+	remove_key,
+	iterate,
+};
+
+struct csalt_resource_kv_hash csalt_resource_kv_hash(ssize_t capacity)
+{
+	return (resource_t) {
+		.vtable = &impl,
+		.capacity = capacity,
+		.store = {
+			.vtable = &kv_impl,
+		},
+	};
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// Table operations
+
+static int table_init(table_t *table, size_t capacity)
+{
+	table->heap = csalt_resource_heap((ssize_t)(capacity * sizeof(slot_t)));
+	if (!csalt_resource_init(csalt_resource(&table->heap)))
+		return -1;
+
+	table->slots = (slot_t *)table->heap.store.begin;
+	memset(table->slots, 0, capacity * sizeof(slot_t));
+	table->capacity = capacity;
+	table->count = 0;
+	return 0;
+}
+
+static void table_deinit(table_t *table)
+{
+	for (size_t i = 0; i < table->capacity; i++)
+		free(table->slots[i].entry);
+	csalt_resource_deinit(csalt_resource(&table->heap));
+	*table = (table_t) { 0 };
+}
+
+static size_t distance(const table_t *table, size_t index)
+{
+	const size_t mask = table->capacity - 1;
+	return (index - (size_t)table->slots[index].hash) & mask;
+}
+
+static bool entry_matches(
+	const slot_t *slot,
+	uint64_t hash,
+	const void *key,
+	ssize_t key_size
+)
+{
+	return slot->hash == hash
+		&& slot->entry->key_size == key_size
+		&& !memcmp(slot->entry->data, key, (size_t)key_size);
+}
+
+static slot_t *table_find(
+	table_t *table,
+	uint64_t hash,
+	const void *key,
+	ssize_t key_size
+)
+{
+	if (!table->count)
+		return NULL;
+
+	const size_t mask = table->capacity - 1;
+	size_t index = (size_t)hash & mask;
+
+	// Robin Hood ordering means the search can stop as soon as it
+	// reaches an entry closer to its home slot than the key would be
+	for (size_t probe = 0; table->slots[index].entry; probe++) {
+		if (distance(table, index) < probe)
+			return NULL;
+		if (entry_matches(&table->slots[index], hash, key, key_size))
+			return &table->slots[index];
+		index = (index + 1) & mask;
+	}
+	return NULL;
+}
+
+static void table_insert(table_t *table, slot_t slot)
+{
+	const size_t mask = table->capacity - 1;
+	size_t index = (size_t)slot.hash & mask;
+
+	for (size_t probe = 0; table->slots[index].entry; probe++) {
+		const size_t existing = distance(table, index);
+		if (existing < probe) {
+			const slot_t displaced = table->slots[index];
+			table->slots[index] = slot;
+			slot = displaced;
+			probe = existing;
+		}
+		index = (index + 1) & mask;
+	}
+
+	table->slots[index] = slot;
+	table->count++;
+}
+
+static void table_erase(table_t *table, slot_t *slot)
+{
+	const size_t mask = table->capacity - 1;
+	size_t index = (size_t)(slot - table->slots);
+	size_t next = (index + 1) & mask;
+
+	// Backward shift deletion: pull every following displaced entry
+	// one slot closer to home, so no tombstones are needed
+	while (table->slots[next].entry && distance(table, next)) {
+		table->slots[index] = table->slots[next];
+		index = next;
+		next = (next + 1) & mask;
+	}
+
+	table->slots[index] = (slot_t) { 0 };
+	table->count--;
+}
+
+static bool table_full(const table_t *table)
+{
+	return table->count + 1 > table->capacity - table->capacity / 8;
+}
+
+// Incremental rehashing
+
+static void migrate(store_t *store, size_t steps)
+{
+	table_t *const old = &store->old;
+	if (!old->slots)
+		return;
+
+	const size_t mask = old->capacity - 1;
+	while (steps-- && old->count) {
+		while (!old->slots[store->cursor].entry)
+			store->cursor = (store->cursor + 1) & mask;
+
+		// Erasing may shift the next entry into the cursor's slot,
+		// so the cursor only moves on when the slot is empty
+		const slot_t slot = old->slots[store->cursor];
+		table_erase(old, &old->slots[store->cursor]);
+		table_insert(&store->table, slot);
+	}
+
+	if (!old->count) {
+		table_deinit(old);
+		store->cursor = 0;
+	}
+}
+
+static int grow(store_t *store)
+{
+	if (store->old.slots)
+		migrate(store, SIZE_MAX);
+
+	table_t larger;
+	if (table_init(&larger, store->table.capacity * 2))
+		return -1;
+
+	store->old = store->table;
+	store->table = larger;
+	store->cursor = 0;
+	return 0;
+}
+
+static uint64_t hash_key(const store_t *store, const void *key, ssize_t key_size)
+{
+	// Zero marks an empty slot's hash, so it's never used for a key
+	const uint64_t hash = csalt_hash(key, (size_t)key_size, store->seed);
+	return hash? hash: 1;
+}
+
+static slot_t *find(store_t *store, uint64_t hash, const void *key, ssize_t key_size)
+{
+	slot_t *const slot = table_find(&store->table, hash, key, key_size);
+	if (slot || !store->old.slots)
+		return slot;
+	return table_find(&store->old, hash, key, key_size);
+}
+
+// Key/value operations
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	store_t *const store = (store_t *)kv;
+	const slot_t *const slot = find(
+		store,
+		hash_key(store, key, key_size),
+		key,
+		key_size);
+	if (!slot)
+		return -1;
+
+	struct entry *const entry = slot->entry;
+	char *const value = entry->data + entry->key_size;
+	struct csalt_store_memory memory = csalt_store_memory_bounds(
+		value,
+		value + entry->value_size);
+	return block((csalt_static_store *)&memory, param);
+}
+
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+)
+{
+	store_t *const store = (store_t *)kv;
+	if (key_size < 0 || value_size < 0)
+		return -1;
+
+	struct entry *const entry = malloc(
+		sizeof(*entry) + (size_t)key_size + (size_t)value_size);
+	if (!entry)
+		return -1;
+
+	entry->key_size = key_size;
+	entry->value_size = value_size;
+	memcpy(entry->data, key, (size_t)key_size);
+	if (csalt_kv_read_value(value, entry->data + key_size, value_size)) {
+		free(entry);
+		return -1;
+	}
+
+	const uint64_t hash = hash_key(store, key, key_size);
+	slot_t *const existing = find(store, hash, key, key_size);
+	if (existing) {
+		free(existing->entry);
+		existing->entry = entry;
+		migrate(store, MIGRATE_STEP);
+		return 0;
+	}
+
+	// If a larger table can't be allocated, keep filling this one
+	// until it's completely full
+	if (
+		table_full(&store->table)
+		&& grow(store)
+		&& store->table.count + 1 >= store->table.capacity
+	) {
+		free(entry);
+		return -1;
+	}
+
+	table_insert(&store->table, (slot_t) { hash, entry });
+	migrate(store, MIGRATE_STEP);
+	return 0;
+}
+
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size)
+{
+	store_t *const store = (store_t *)kv;
+	const uint64_t hash = hash_key(store, key, key_size);
+
+	table_t *table = &store->table;
+	slot_t *slot = table_find(table, hash, key, key_size);
+	if (!slot && store->old.slots) {
+		table = &store->old;
+		slot = table_find(table, hash, key, key_size);
+	}
+	if (!slot)
+		return -1;
+
+	free(slot->entry);
+	table_erase(table, slot);
+	migrate(store, MIGRATE_STEP);
+	return 0;
+}
+
+static int iterate_table(table_t *table, csalt_kv_block_fn *block, void *param)
+{
+	for (size_t i = 0; i < table->capacity; i++) {
+		struct entry *const entry = table->slots[i].entry;
+		if (!entry)
+			continue;
+
+		char *const value = entry->data + entry->key_size;
+		struct csalt_store_memory memory = csalt_store_memory_bounds(
+			value,
+			value + entry->value_size);
+		const int result = block(
+			entry->data,
+			entry->key_size,
+			(csalt_static_store *)&memory,
+			param);
+		if (result)
+			return result;
+	}
+	return 0;
+}
+
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param)
+{
+	store_t *const store = (store_t *)kv;
+	const int result = iterate_table(&store->table, block, param);
+	if (result || !store->old.slots)
+		return result;
+	return iterate_table(&store->old, block, param);
+}
+
+// Resource functions
+
+csalt_static_store *csalt_resource_kv_hash_init(
+	csalt_static_resource *resource
+)
+{
+	resource_t *const hash = (resource_t *)resource;
+	store_t *const store = &hash->store;
+
+	// Round up so the table stays under the load limit with
+	// capacity entries in it
+	const size_t wanted = hash->capacity > 0? (size_t)hash->capacity: 0;
+	size_t capacity = MINIMUM_CAPACITY;
+	while (capacity - capacity / 8 < wanted)
+		capacity *= 2;
+
+	if (table_init(&store->table, capacity))
+		return NULL;
+
+	store->old = (table_t) { 0 };
+	store->cursor = 0;
+	store->seed = (uint64_t)(uintptr_t)store ^ now_ns();
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_kv_hash_deinit(csalt_resource *resource)
+{
+	resource_t *const hash = (resource_t *)resource;
+	if (hash->store.old.slots)
+		table_deinit(&hash->store.old);
+	table_deinit(&hash->store.table);
+}
+
+ssize_t csalt_store_kv_hash_count(const store_t *store)
+{
+	return (ssize_t)(store->table.count + store->old.count);
+}
+
+bool csalt_store_kv_hash_rehashing(const store_t *store)
+{
+	return store->old.slots != NULL;
+}
@@ -0,0 +1,1259 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/kv/log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "csalt/util.h"
+
+typedef struct csalt_resource_kv_log resource_t;
+typedef struct csalt_store_kv_log store_t;
+typedef struct csalt_kv_log_segment segment_t;
+
+enum {
+	RECORD_TOMBSTONE = 1,
+};
+
+// On-disk records and hints are in host byte order
+struct record {
+	uint64_t sequence;
+	uint32_t key_size;
+	uint32_t value_size;
+	uint32_t flags;
+	uint32_t checksum;
+};
+
+struct hint {
+	uint64_t sequence;
+	uint64_t offset;
+	uint32_t key_size;
+	uint32_t value_size;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+// What the index stores for each key
+struct location {
+	segment_t *segment;
+	ssize_t offset;
+	ssize_t size;
+	uint64_t sequence;
+};
+
+struct csalt_kv_log_segment {
+	uint64_t id;
+	struct csalt_resource_file file;
+	ssize_t size;
+	ssize_t dead;
+
+	// Hint entries for the records written so far, kept until
+	// the segment is closed and its hint file written
+	char *hints;
+	size_t hints_size;
+	size_t hints_capacity;
+	bool hints_valid;
+
+	char path[];
+};
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+);
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size);
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param);
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_kv_log_init,
+	csalt_resource_kv_log_deinit,
+};
+
+static const struct csalt_kv_interface kv_impl = {
+	{
+		csalt_kv_read,
+		csalt_kv_write,
+		csalt_kv_split,
+		NULL,
+	},
+	get,
+	put,
+	remove_key,
+	iterate,
+};
+
+struct csalt_resource_kv_log csalt_resource_kv_log(
+	const char *directory,
+	ssize_t segment_size
+)
+{
+	return (resource_t) {
+		.vtable = &impl,
+		.directory = directory,
+		.segment_size = segment_size,
+		.store = {
+			.vtable = &kv_impl,
+		},
+	};
+}
+
+// File helpers
+
+static void file_path(
+	char *path,
+	const store_t *store,
+	uint64_t id,
+	const char *suffix
+)
+{
+	snprintf(path, PATH_MAX, "%s/%016llx%s",
+		store->directory,
+		(unsigned long long)id,
+		suffix);
+}
+
+static bool parse_name(const char *name, const char *suffix, uint64_t *id)
+{
+	if (strlen(name) != 16 + strlen(suffix) || name[0] == '-' || name[0] == '+')
+		return false;
+
+	char *end = NULL;
+	*id = strtoull(name, &end, 16);
+	return end == name + 16 && !strcmp(end, suffix);
+}
+
+static int write_at(int fd, const void *buffer, size_t size, off_t offset)
+{
+	for (size_t written = 0; written < size;) {
+		const ssize_t result = pwrite(
+			fd,
+			(const char *)buffer + written,
+			size - written,
+			offset + (off_t)written);
+		if (result < 0 && errno != EINTR)
+			return -1;
+		if (result > 0)
+			written += (size_t)result;
+	}
+	return 0;
+}
+
+static int sync_directory(const store_t *store)
+{
+	const int fd = open(store->directory, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return -1;
+	const int result = fsync(fd);
+	close(fd);
+	return result;
+}
+
+// Reads a whole file into memory
+static char *read_file(const char *path, ssize_t *size)
+{
+	struct csalt_resource_file file = csalt_resource_file_open(path, O_RDONLY);
+	csalt_store *const store = csalt_resource_init(csalt_resource(&file));
+	if (!store)
+		return NULL;
+
+	*size = csalt_store_size(store);
+	char *buffer = *size >= 0? malloc((size_t)*size + 1): NULL;
+	if (buffer && csalt_kv_read_value((csalt_static_store *)store, buffer, *size)) {
+		free(buffer);
+		buffer = NULL;
+	}
+
+	csalt_resource_deinit(csalt_resource(&file));
+	return buffer;
+}
+
+// Writes a whole file by writing a temporary file and renaming it
+// over the old one, so readers see all of it or none of it
+static int replace_file(const char *path, const void *buffer, size_t size)
+{
+	char temporary[PATH_MAX];
+	snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+	struct csalt_resource_file file = csalt_resource_file(
+		temporary,
+		O_WRONLY | O_TRUNC,
+		0644);
+	csalt_store *const store = csalt_resource_init(csalt_resource(&file));
+	if (!store)
+		return -1;
+
+	const int fd = csalt_store_fd((csalt_static_store *)store);
+	const int result = write_at(fd, buffer, size, 0) || fdatasync(fd);
+	csalt_resource_deinit(csalt_resource(&file));
+
+	if (result || rename(temporary, path)) {
+		unlink(temporary);
+		return -1;
+	}
+	return 0;
+}
+
+// Segments with an id below the floor have been replaced by a
+// compaction, and are deleted when they're found
+static uint64_t read_floor(const store_t *store)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/floor", store->directory);
+
+	ssize_t size = 0;
+	char *const buffer = read_file(path, &size);
+	uint64_t floor = 0;
+	if (buffer && size == sizeof(floor))
+		memcpy(&floor, buffer, sizeof(floor));
+	free(buffer);
+	return floor;
+}
+
+static int write_floor(const store_t *store, uint64_t floor)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/floor", store->directory);
+	if (replace_file(path, &floor, sizeof(floor)))
+		return -1;
+
+	// The rename has happened, so the compaction can't be undone
+	// even if it isn't on disk yet
+	sync_directory(store);
+	return 0;
+}
+
+// Segment functions
+
+static segment_t *segment_open(
+	const store_t *store,
+	uint64_t id,
+	const char *suffix,
+	bool create
+)
+{
+	segment_t *const segment = calloc(1, sizeof(*segment) + PATH_MAX);
+	if (!segment)
+		return NULL;
+
+	segment->id = id;
+	segment->hints_valid = true;
+	file_path(segment->path, store, id, suffix);
+	segment->file = create?
+		csalt_resource_file_new(segment->path, O_RDWR, 0644):
+		csalt_resource_file_open(segment->path, O_RDWR);
+
+	csalt_store *const file = csalt_resource_init(csalt_resource(&segment->file));
+	if (!file) {
+		free(segment);
+		return NULL;
+	}
+
+	segment->size = csalt_store_size(file);
+	return segment;
+}
+
+static void segment_close(segment_t *segment)
+{
+	csalt_resource_deinit(csalt_resource(&segment->file));
+	free(segment->hints);
+	free(segment);
+}
+
+static void segment_delete(const store_t *store, segment_t *segment)
+{
+	char path[PATH_MAX];
+	file_path(path, store, segment->id, ".hint");
+	unlink(path);
+	unlink(segment->path);
+	segment_close(segment);
+}
+
+static csalt_static_store *segment_store(segment_t *segment)
+{
+	return (csalt_static_store *)&segment->file.store;
+}
+
+static int segment_fd(segment_t *segment)
+{
+	return csalt_store_fd(segment_store(segment));
+}
+
+struct read_params {
+	void *buffer;
+	ssize_t size;
+};
+
+static int receive_read(csalt_static_store *store, void *param)
+{
+	struct read_params *const params = param;
+	return csalt_kv_read_value(store, params->buffer, params->size);
+}
+
+static int segment_read(
+	segment_t *segment,
+	void *buffer,
+	ssize_t size,
+	ssize_t offset
+)
+{
+	if (offset + size > segment->size)
+		return -1;
+
+	struct read_params params = { buffer, size };
+	return csalt_store_split(
+		segment_store(segment),
+		offset,
+		offset + size,
+		receive_read,
+		&params);
+}
+
+static int segment_append(segment_t *segment, const void *buffer, ssize_t size)
+{
+	if (write_at(segment_fd(segment), buffer, (size_t)size, segment->size))
+		return -1;
+
+	segment->size += size;
+	segment->file.store.end = segment->size;
+	return 0;
+}
+
+static void segment_hint(
+	segment_t *segment,
+	const struct record *record,
+	ssize_t offset,
+	const void *key
+)
+{
+	if (!segment->hints_valid)
+		return;
+
+	const struct hint hint = {
+		record->sequence,
+		(uint64_t)offset,
+		record->key_size,
+		record->value_size,
+		record->flags,
+		0,
+	};
+	const size_t size = sizeof(hint) + record->key_size;
+
+	if (segment->hints_size + size > segment->hints_capacity) {
+		const size_t capacity = csalt_max(
+			segment->hints_capacity * 2,
+			segment->hints_size + size);
+		char *const hints = realloc(segment->hints, capacity);
+
+		// Without hints, the segment is scanned on the next start
+		if (!hints) {
+			segment->hints_valid = false;
+			return;
+		}
+		segment->hints = hints;
+		segment->hints_capacity = capacity;
+	}
+
+	memcpy(segment->hints + segment->hints_size, &hint, sizeof(hint));
+	memcpy(segment->hints + segment->hints_size + sizeof(hint), key, record->key_size);
+	segment->hints_size += size;
+}
+
+static void segment_write_hints(const store_t *store, segment_t *segment)
+{
+	char path[PATH_MAX];
+	file_path(path, store, segment->id, ".hint");
+	if (segment->hints_valid)
+		replace_file(path, segment->hints, segment->hints_size);
+
+	free(segment->hints);
+	segment->hints = NULL;
+	segment->hints_size = 0;
+	segment->hints_capacity = 0;
+	segment->hints_valid = false;
+}
+
+static int reserve_segments(store_t *store, size_t count)
+{
+	if (store->segment_count + count <= store->segment_capacity)
+		return 0;
+
+	const size_t capacity = csalt_max(
+		store->segment_capacity * 2,
+		store->segment_count + count);
+	segment_t **const segments = realloc(
+		store->segments,
+		capacity * sizeof(*segments));
+	if (!segments)
+		return -1;
+
+	store->segments = segments;
+	store->segment_capacity = capacity;
+	return 0;
+}
+
+static int add_segment(store_t *store, segment_t *segment)
+{
+	if (reserve_segments(store, 1))
+		return -1;
+	store->segments[store->segment_count++] = segment;
+	return 0;
+}
+
+// Records
+
+static uint32_t checksum(const char *record, ssize_t size)
+{
+	struct record header;
+	memcpy(&header, record, sizeof(header));
+	header.checksum = 0;
+
+	const uint64_t hash = csalt_hash(&header, sizeof(header), 0);
+	return (uint32_t)csalt_hash(
+		record + sizeof(header),
+		(size_t)size - sizeof(header),
+		hash);
+}
+
+static ssize_t record_size(const struct record *record)
+{
+	return (ssize_t)(sizeof(*record) + record->key_size + record->value_size);
+}
+
+// Index functions
+
+static csalt_kv *store_index(store_t *store)
+{
+	return (csalt_kv *)&store->index.store;
+}
+
+static int receive_location(csalt_static_store *store, void *param)
+{
+	return csalt_kv_read_value(store, param, sizeof(struct location));
+}
+
+static int index_find(
+	store_t *store,
+	const void *key,
+	ssize_t key_size,
+	struct location *location
+)
+{
+	return csalt_kv_get(
+		store_index(store),
+		key,
+		key_size,
+		receive_location,
+		location);
+}
+
+static int index_set(
+	store_t *store,
+	const void *key,
+	ssize_t key_size,
+	struct location location
+)
+{
+	struct csalt_store_memory value = csalt_store_memory(location);
+	return csalt_kv_put(
+		store_index(store),
+		key,
+		key_size,
+		(csalt_static_store *)&value,
+		sizeof(location));
+}
+
+static bool removed_after(
+	csalt_kv *tombstones,
+	const void *key,
+	ssize_t key_size,
+	uint64_t sequence
+)
+{
+	uint64_t removed = 0;
+	struct read_params params = { &removed, sizeof(removed) };
+	return !csalt_kv_get(tombstones, key, key_size, receive_read, &params)
+		&& removed > sequence;
+}
+
+// Applies a record to the index, whether freshly written or found
+// on start-up. tombstones holds the newest removal of each key seen
+// while starting up, since segments aren't read in order; it's NULL
+// otherwise.
+static int apply(
+	store_t *store,
+	csalt_kv *tombstones,
+	const struct record *record,
+	struct location location,
+	const void *key
+)
+{
+	const ssize_t key_size = record->key_size;
+
+	if (tombstones && removed_after(tombstones, key, key_size, location.sequence)) {
+		location.segment->dead += location.size;
+		return 0;
+	}
+
+	struct location previous;
+	if (!index_find(store, key, key_size, &previous)) {
+		if (previous.sequence >= location.sequence) {
+			location.segment->dead += location.size;
+			return 0;
+		}
+		previous.segment->dead += previous.size;
+	}
+
+	if (!(record->flags & RECORD_TOMBSTONE))
+		return index_set(store, key, key_size, location);
+
+	location.segment->dead += location.size;
+	csalt_kv_remove(store_index(store), key, key_size);
+	if (!tombstones)
+		return 0;
+
+	struct csalt_store_memory sequence = csalt_store_memory(location.sequence);
+	return csalt_kv_put(
+		tombstones,
+		key,
+		key_size,
+		(csalt_static_store *)&sequence,
+		sizeof(location.sequence));
+}
+
+static int rotate(store_t *store)
+{
+	segment_t *const segment = segment_open(store, store->next_id, ".log", true);
+	if (!segment)
+		return -1;
+
+	if (add_segment(store, segment)) {
+		segment_delete(store, segment);
+		return -1;
+	}
+
+	store->next_id++;
+	segment_t *const previous = store->active;
+	store->active = segment;
+
+	// The hint file mustn't describe records which aren't on disk
+	if (!fdatasync(segment_fd(previous)))
+		segment_write_hints(store, previous);
+	return 0;
+}
+
+// Appends a record to the active segment and indexes it. The record
+// buffer must have space for the header, followed by the key and
+// value.
+static int append(
+	store_t *store,
+	char *buffer,
+	ssize_t key_size,
+	ssize_t value_size,
+	uint32_t flags
+)
+{
+	if (store->active->size >= store->segment_size && rotate(store))
+		return -1;
+
+	struct record record = {
+		store->next_sequence,
+		(uint32_t)key_size,
+		(uint32_t)value_size,
+		flags,
+		0,
+	};
+	memcpy(buffer, &record, sizeof(record));
+	const ssize_t size = record_size(&record);
+	record.checksum = checksum(buffer, size);
+	memcpy(buffer, &record, sizeof(record));
+
+	segment_t *const segment = store->active;
+	const ssize_t offset = segment->size;
+	if (segment_append(segment, buffer, size))
+		return -1;
+
+	store->next_sequence++;
+	const char *const key = buffer + sizeof(record);
+	segment_hint(segment, &record, offset, key);
+
+	const struct location location = {
+		segment,
+		offset,
+		size,
+		record.sequence,
+	};
+	return apply(store, NULL, &record, location, key);
+}
+
+// Key/value operations
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	store_t *const store = (store_t *)kv;
+	csalt_mutex_lock(&store->lock);
+
+	struct location location;
+	int result = -1;
+	if (!index_find(store, key, key_size, &location))
+		result = csalt_store_split(
+			segment_store(location.segment),
+			location.offset + (ssize_t)sizeof(struct record) + key_size,
+			location.offset + location.size,
+			block,
+			param);
+
+	csalt_mutex_unlock(&store->lock);
+	return result;
+}
+
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+)
+{
+	store_t *const store = (store_t *)kv;
+	if (
+		key_size < 0 || key_size > UINT32_MAX
+		|| value_size < 0 || value_size > UINT32_MAX
+	)
+		return -1;
+
+	char *const buffer = malloc(
+		sizeof(struct record) + (size_t)key_size + (size_t)value_size);
+	if (!buffer)
+		return -1;
+
+	char *const key_copy = buffer + sizeof(struct record);
+	memcpy(key_copy, key, (size_t)key_size);
+
+	// Read the value before taking the lock, since value might be
+	// slow, such as a socket
+	if (csalt_kv_read_value(value, key_copy + key_size, value_size)) {
+		free(buffer);
+		return -1;
+	}
+
+	csalt_mutex_lock(&store->lock);
+	const int result = append(store, buffer, key_size, value_size, 0);
+	csalt_mutex_unlock(&store->lock);
+
+	free(buffer);
+	return result;
+}
+
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size)
+{
+	store_t *const store = (store_t *)kv;
+	if (key_size < 0 || key_size > UINT32_MAX)
+		return -1;
+
+	char *const buffer = malloc(sizeof(struct record) + (size_t)key_size);
+	if (!buffer)
+		return -1;
+	memcpy(buffer + sizeof(struct record), key, (size_t)key_size);
+
+	csalt_mutex_lock(&store->lock);
+	struct location location;
+	int result = index_find(store, key, key_size, &location);
+	if (!result)
+		result = append(store, buffer, key_size, 0, RECORD_TOMBSTONE);
+	csalt_mutex_unlock(&store->lock);
+
+	free(buffer);
+	return result;
+}
+
+struct iterate_params {
+	store_t *store;
+	csalt_kv_block_fn *block;
+	void *param;
+	const void *key;
+	ssize_t key_size;
+};
+
+static int iterate_value(csalt_static_store *value, void *param)
+{
+	struct iterate_params *const params = param;
+	return params->block(params->key, params->key_size, value, params->param);
+}
+
+static int iterate_entry(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	struct iterate_params *const params = param;
+	struct location location;
+	if (csalt_kv_read_value(value, &location, sizeof(location)))
+		return -1;
+
+	params->key = key;
+	params->key_size = key_size;
+	return csalt_store_split(
+		segment_store(location.segment),
+		location.offset + (ssize_t)sizeof(struct record) + key_size,
+		location.offset + location.size,
+		iterate_value,
+		params);
+}
+
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param)
+{
+	store_t *const store = (store_t *)kv;
+	struct iterate_params params = {
+		.store = store,
+		.block = block,
+		.param = param,
+	};
+
+	csalt_mutex_lock(&store->lock);
+	const int result = csalt_kv_iterate(store_index(store), iterate_entry, &params);
+	csalt_mutex_unlock(&store->lock);
+	return result;
+}
+
+// Start-up
+
+static int load_hints(store_t *store, csalt_kv *tombstones, segment_t *segment)
+{
+	char path[PATH_MAX];
+	file_path(path, store, segment->id, ".hint");
+
+	ssize_t size = 0;
+	char *const hints = read_file(path, &size);
+	if (!hints)
+		return -1;
+
+	// Check the whole file before applying any of it, so a bad
+	// hint file can fall back to a scan without applying records
+	// twice
+	bool valid = true;
+	for (ssize_t offset = 0; valid && offset < size;) {
+		struct hint hint;
+		valid = offset + (ssize_t)sizeof(hint) <= size;
+		if (!valid)
+			break;
+
+		memcpy(&hint, hints + offset, sizeof(hint));
+		const ssize_t end = (ssize_t)(hint.offset + sizeof(struct record))
+			+ hint.key_size + hint.value_size;
+		offset += (ssize_t)sizeof(hint) + hint.key_size;
+		valid = offset <= size && end <= segment->size;
+	}
+
+	int result = valid? 0: -1;
+	for (ssize_t offset = 0; !result && offset < size;) {
+		struct hint hint;
+		memcpy(&hint, hints + offset, sizeof(hint));
+		const char *const key = hints + offset + sizeof(hint);
+
+		const struct record record = {
+			hint.sequence,
+			hint.key_size,
+			hint.value_size,
+			hint.flags,
+			0,
+		};
+		const struct location location = {
+			segment,
+			(ssize_t)hint.offset,
+			record_size(&record),
+			hint.sequence,
+		};
+		result = apply(store, tombstones, &record, location, key);
+		store->next_sequence = csalt_max(store->next_sequence, hint.sequence + 1);
+		offset += (ssize_t)sizeof(hint) + hint.key_size;
+	}
+
+	free(hints);
+	return result;
+}
+
+static int scan(store_t *store, csalt_kv *tombstones, segment_t *segment)
+{
+	char *buffer = NULL;
+	ssize_t capacity = 0;
+	ssize_t offset = 0;
+	int result = 0;
+
+	while (!result) {
+		struct record record;
+		if (
+			segment->size - offset < (ssize_t)sizeof(record)
+			|| segment_read(segment, &record, sizeof(record), offset)
+		)
+			break;
+
+		// The sizes may be from a torn write, so they're checked
+		// against the segment before anything is allocated for them
+		const ssize_t size = record_size(&record);
+		if (size > segment->size - offset)
+			break;
+
+		if (size > capacity) {
+			char *const larger = realloc(buffer, (size_t)size);
+			if (!larger) {
+				result = -1;
+				break;
+			}
+			buffer = larger;
+			capacity = size;
+		}
+
+		if (
+			segment_read(segment, buffer, size, offset)
+			|| checksum(buffer, size) != record.checksum
+		)
+			break;
+
+		const char *const key = buffer + sizeof(record);
+		segment_hint(segment, &record, offset, key);
+		const struct location location = {
+			segment,
+			offset,
+			size,
+			record.sequence,
+		};
+		result = apply(store, tombstones, &record, location, key);
+		store->next_sequence = csalt_max(store->next_sequence, record.sequence + 1);
+		offset += size;
+	}
+	free(buffer);
+
+	// Anything after the last good record was a torn write
+	if (!result && offset < segment->size) {
+		csalt_store_resize((csalt_store *)segment_store(segment), offset);
+		segment->size = offset;
+	}
+
+	if (!result)
+		segment_write_hints(store, segment);
+	return result;
+}
+
+static int open_segments(store_t *store, uint64_t floor)
+{
+	DIR *const directory = opendir(store->directory);
+	if (!directory)
+		return -1;
+
+	int result = 0;
+	for (struct dirent *entry; !result && (entry = readdir(directory));) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s", store->directory, entry->d_name);
+
+		uint64_t id = 0;
+		const bool log = parse_name(entry->d_name, ".log", &id);
+		if (
+			parse_name(entry->d_name, ".merge", &id)
+			|| parse_name(entry->d_name, ".hint.tmp", &id)
+			|| (!log && parse_name(entry->d_name, ".hint", &id) && id < floor)
+			|| (log && id < floor)
+		) {
+			unlink(path);
+			continue;
+		}
+		if (!log)
+			continue;
+
+		segment_t *const segment = segment_open(store, id, ".log", false);
+		result = segment? add_segment(store, segment): -1;
+		if (segment && result)
+			segment_close(segment);
+		store->next_id = csalt_max(store->next_id, id + 1);
+	}
+
+	closedir(directory);
+	return result;
+}
+
+static int recover(store_t *store)
+{
+	const uint64_t floor = read_floor(store);
+	store->next_id = floor;
+	if (open_segments(store, floor))
+		return -1;
+
+	struct csalt_resource_kv_hash tombstones = csalt_resource_kv_hash(0);
+	csalt_kv *const removed = (csalt_kv *)csalt_resource_init(csalt_resource(&tombstones));
+	if (!removed)
+		return -1;
+
+	int result = 0;
+	for (size_t i = 0; !result && i < store->segment_count; i++) {
+		segment_t *const segment = store->segments[i];
+		if (load_hints(store, removed, segment))
+			result = scan(store, removed, segment);
+	}
+
+	csalt_resource_deinit(csalt_resource(&tombstones));
+	return result;
+}
+
+// Resource functions
+
+static void destroy(store_t *store)
+{
+	for (size_t i = 0; i < store->segment_count; i++)
+		segment_close(store->segments[i]);
+	free(store->segments);
+	store->segments = NULL;
+	store->segment_count = 0;
+	store->segment_capacity = 0;
+	store->active = NULL;
+
+	csalt_resource_deinit(csalt_resource(&store->index));
+	csalt_mutex_deinit(&store->lock);
+}
+
+csalt_static_store *csalt_resource_kv_log_init(
+	csalt_static_resource *resource
+)
+{
+	resource_t *const log = (resource_t *)resource;
+	store_t *const store = &log->store;
+
+	if (mkdir(log->directory, 0755) && errno != EEXIST)
+		return NULL;
+
+	store->directory = log->directory;
+	store->segment_size = log->segment_size > 0?
+		log->segment_size:
+		CSALT_KV_LOG_SEGMENT_SIZE;
+	store->segments = NULL;
+	store->segment_count = 0;
+	store->segment_capacity = 0;
+	store->active = NULL;
+	store->next_id = 0;
+	store->next_sequence = 1;
+	store->compacting = false;
+
+	store->index = csalt_resource_kv_hash(0);
+	if (!csalt_resource_init(csalt_resource(&store->index)))
+		return NULL;
+	csalt_mutex_init(&store->lock, NULL);
+
+	// Start-up always begins a new segment, rather than appending
+	// to one which may have been cut short
+	if (recover(store)) {
+		destroy(store);
+		return NULL;
+	}
+
+	store->active = segment_open(store, store->next_id, ".log", true);
+	if (!store->active || add_segment(store, store->active)) {
+		if (store->active)
+			segment_delete(store, store->active);
+		destroy(store);
+		return NULL;
+	}
+	store->next_id++;
+
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_kv_log_deinit(csalt_resource *resource)
+{
+	resource_t *const log = (resource_t *)resource;
+	store_t *const store = &log->store;
+	segment_t *const active = store->active;
+
+	if (!active->size)
+		unlink(active->path);
+	else if (!fdatasync(segment_fd(active)))
+		segment_write_hints(store, active);
+
+	destroy(store);
+}
+
+int csalt_store_kv_log_sync(store_t *store)
+{
+	csalt_mutex_lock(&store->lock);
+	const int result = fdatasync(segment_fd(store->active));
+	csalt_mutex_unlock(&store->lock);
+	return result;
+}
+
+ssize_t csalt_store_kv_log_dead(store_t *store)
+{
+	csalt_mutex_lock(&store->lock);
+	ssize_t dead = 0;
+	for (size_t i = 0; i < store->segment_count; i++)
+		dead += store->segments[i]->dead;
+	csalt_mutex_unlock(&store->lock);
+	return dead;
+}
+
+// Compaction
+
+struct compaction {
+	store_t *store;
+	uint64_t floor;
+	segment_t **inputs;
+	size_t input_count;
+	segment_t **outputs;
+	size_t output_count;
+	char *buffer;
+	ssize_t capacity;
+};
+
+static bool is_live(
+	struct compaction *compaction,
+	segment_t *segment,
+	ssize_t offset,
+	const void *key,
+	ssize_t key_size
+)
+{
+	store_t *const store = compaction->store;
+	struct location location;
+
+	csalt_mutex_lock(&store->lock);
+	const bool live = !index_find(store, key, key_size, &location)
+		&& location.segment == segment
+		&& location.offset == offset;
+	csalt_mutex_unlock(&store->lock);
+	return live;
+}
+
+static segment_t *output_for(struct compaction *compaction)
+{
+	store_t *const store = compaction->store;
+	if (compaction->output_count) {
+		segment_t *const last = compaction->outputs[compaction->output_count - 1];
+		if (last->size < store->segment_size)
+			return last;
+	}
+
+	segment_t **const outputs = realloc(
+		compaction->outputs,
+		(compaction->output_count + 1) * sizeof(*outputs));
+	if (!outputs)
+		return NULL;
+	compaction->outputs = outputs;
+
+	csalt_mutex_lock(&store->lock);
+	const uint64_t id = store->next_id++;
+	csalt_mutex_unlock(&store->lock);
+
+	segment_t *const segment = segment_open(store, id, ".merge", true);
+	if (segment)
+		outputs[compaction->output_count++] = segment;
+	return segment;
+}
+
+static int copy_live(struct compaction *compaction, segment_t *input)
+{
+	for (ssize_t offset = 0; offset < input->size;) {
+		struct record record;
+		if (segment_read(input, &record, sizeof(record), offset))
+			return -1;
+
+		const ssize_t size = record_size(&record);
+		if (size > compaction->capacity) {
+			char *const larger = realloc(compaction->buffer, (size_t)size);
+			if (!larger)
+				return -1;
+			compaction->buffer = larger;
+			compaction->capacity = size;
+		}
+
+		// Tombstones are never live, since every record they
+		// could hide is in a segment being compacted too
+		char *const key = compaction->buffer + sizeof(record);
+		if (
+			!(record.flags & RECORD_TOMBSTONE)
+			&& !segment_read(input, key, record.key_size, offset + (ssize_t)sizeof(record))
+			&& is_live(compaction, input, offset, key, record.key_size)
+		) {
+			segment_t *const output = output_for(compaction);
+			if (
+				!output
+				|| segment_read(input, compaction->buffer, size, offset)
+			)
+				return -1;
+
+			const ssize_t destination = output->size;
+			if (segment_append(output, compaction->buffer, size))
+				return -1;
+			segment_hint(output, &record, destination, key);
+		}
+		offset += size;
+	}
+	return 0;
+}
+
+// Makes the output segments permanent. Until the floor is written,
+// a restart sees both the inputs and the outputs, and the sequence
+// numbers pick the same record from either.
+static int publish(struct compaction *compaction)
+{
+	const store_t *const store = compaction->store;
+	for (size_t i = 0; i < compaction->output_count; i++) {
+		segment_t *const output = compaction->outputs[i];
+		char path[PATH_MAX];
+		file_path(path, store, output->id, ".log");
+
+		char hint[PATH_MAX];
+		file_path(hint, store, output->id, ".hint");
+		if (
+			fdatasync(segment_fd(output))
+			|| (output->hints_valid && replace_file(hint, output->hints, output->hints_size))
+			|| rename(output->path, path)
+		)
+			return -1;
+		strcpy(output->path, path);
+	}
+
+	return sync_directory(store) || write_floor(store, compaction->floor);
+}
+
+static void switch_index(struct compaction *compaction)
+{
+	store_t *const store = compaction->store;
+
+	for (size_t i = 0; i < compaction->output_count; i++) {
+		segment_t *const output = compaction->outputs[i];
+		for (size_t offset = 0; offset < output->hints_size;) {
+			struct hint hint;
+			memcpy(&hint, output->hints + offset, sizeof(hint));
+			const char *const key = output->hints + offset + sizeof(hint);
+			const ssize_t size = (ssize_t)sizeof(struct record)
+				+ hint.key_size + hint.value_size;
+
+			// Keys written since the copy stay where they are
+			struct location location;
+			if (
+				!index_find(store, key, hint.key_size, &location)
+				&& location.sequence == hint.sequence
+				&& location.segment->id < compaction->floor
+			) {
+				location.segment = output;
+				location.offset = (ssize_t)hint.offset;
+				index_set(store, key, hint.key_size, location);
+			} else {
+				output->dead += size;
+			}
+			offset += sizeof(hint) + hint.key_size;
+		}
+
+		free(output->hints);
+		output->hints = NULL;
+		output->hints_size = 0;
+		output->hints_capacity = 0;
+		output->hints_valid = false;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < store->segment_count; i++)
+		if (store->segments[i]->id >= compaction->floor)
+			store->segments[kept++] = store->segments[i];
+	store->segment_count = kept;
+
+	for (size_t i = 0; i < compaction->output_count; i++)
+		store->segments[store->segment_count++] = compaction->outputs[i];
+}
+
+ssize_t csalt_store_kv_log_compact(store_t *store)
+{
+	struct compaction compaction = {
+		.store = store,
+	};
+
+	csalt_mutex_lock(&store->lock);
+	const bool busy = store->compacting;
+	store->compacting = true;
+	compaction.floor = store->active->id;
+
+	compaction.inputs = busy? NULL: malloc(store->segment_count * sizeof(segment_t *));
+	for (size_t i = 0; compaction.inputs && i < store->segment_count; i++)
+		if (store->segments[i]->id < compaction.floor)
+			compaction.inputs[compaction.input_count++] = store->segments[i];
+	csalt_mutex_unlock(&store->lock);
+
+	if (busy)
+		return -1;
+
+	int result = compaction.inputs? 0: -1;
+	for (size_t i = 0; !result && i < compaction.input_count; i++)
+		result = copy_live(&compaction, compaction.inputs[i]);
+	free(compaction.buffer);
+
+	// Space in the segment list is reserved up front, since
+	// nothing can fail once the floor has been written
+	if (!result) {
+		csalt_mutex_lock(&store->lock);
+		result = reserve_segments(store, compaction.output_count);
+		csalt_mutex_unlock(&store->lock);
+	}
+	if (!result)
+		result = publish(&compaction);
+
+	ssize_t reclaimed = -1;
+	if (!result) {
+		reclaimed = 0;
+		for (size_t i = 0; i < compaction.input_count; i++)
+			reclaimed += compaction.inputs[i]->size;
+		for (size_t i = 0; i < compaction.output_count; i++)
+			reclaimed -= compaction.outputs[i]->size;
+	}
+
+	csalt_mutex_lock(&store->lock);
+	if (!result)
+		switch_index(&compaction);
+	store->compacting = false;
+	csalt_mutex_unlock(&store->lock);
+
+	segment_t **const removed = result? compaction.outputs: compaction.inputs;
+	const size_t removed_count = result? compaction.output_count: compaction.input_count;
+	for (size_t i = 0; i < removed_count; i++)
+		segment_delete(store, removed[i]);
+
+	free(compaction.inputs);
+	free(compaction.outputs);
+	return reclaimed;
+}
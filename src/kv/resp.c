@@ -0,0 +1,813 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/kv/resp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+
+typedef struct csalt_resource_kv_resp resource_t;
+typedef struct csalt_store_kv_resp store_t;
+typedef struct csalt_resp_reply reply_t;
+
+// Deeper replies than this are treated as invalid, so a hostile
+// server can't exhaust the stack
+#define MAX_DEPTH 64
+
+// Longer strings and larger aggregates than these are treated as
+// invalid, so a hostile server can't overflow a length or make the
+// read buffer grow without limit. The string limit is Redis's own.
+#define MAX_BULK ((long long)512 * 1024 * 1024)
+#define MAX_AGGREGATE ((long long)INT32_MAX)
+#define MAX_READ_BUFFER ((ssize_t)MAX_BULK * 2)
+
+#define SCAN_COUNT "100"
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+);
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size);
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param);
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_kv_resp_init,
+	csalt_resource_kv_resp_deinit,
+};
+
+static const struct csalt_kv_interface kv_impl = {
+	{
+		csalt_kv_read,
+		csalt_kv_write,
+		csalt_kv_split,
+		NULL,
+	},
+	get,
+	put,
+	remove_key,
+	iterate,
+};
+
+struct csalt_resource_kv_resp csalt_resource_kv_resp(
+	csalt_static_resource *connection,
+	ssize_t buffer_size
+)
+{
+	return (resource_t) {
+		.vtable = &impl,
+		.connection = connection,
+		.buffer_size = buffer_size,
+		.store = {
+			.vtable = &kv_impl,
+		},
+	};
+}
+
+// Writing commands
+
+static int write_all(store_t *store, const char *buffer, ssize_t size)
+{
+	while (size > 0) {
+		const ssize_t written = csalt_store_write(store->connection, buffer, size);
+		if (written <= 0)
+			return -1;
+		buffer += written;
+		size -= written;
+	}
+	return 0;
+}
+
+int csalt_store_kv_resp_flush(store_t *store)
+{
+	const ssize_t length = store->write_length;
+	store->write_length = 0;
+	return write_all(store, store->write_buffer, length);
+}
+
+// Makes space for a whole command in the write buffer, so a
+// command is never sent in part
+static int reserve(store_t *store, ssize_t size)
+{
+	if (store->write_length + size <= store->write_size)
+		return 0;
+	if (store->write_length && csalt_store_kv_resp_flush(store))
+		return -1;
+	if (size <= store->write_size)
+		return 0;
+
+	char *const buffer = realloc(store->write_buffer, (size_t)size);
+	if (!buffer)
+		return -1;
+	store->write_buffer = buffer;
+	store->write_size = size;
+	return 0;
+}
+
+static ssize_t digits(ssize_t value)
+{
+	ssize_t count = 1;
+	for (; value >= 10; value /= 10)
+		count++;
+	return count;
+}
+
+// The size of a length header, such as "$12\r\n"
+static ssize_t header_size(ssize_t value)
+{
+	return 1 + digits(value) + 2;
+}
+
+static ssize_t argument_size(ssize_t size)
+{
+	return header_size(size) + size + 2;
+}
+
+static void append(store_t *store, const void *data, ssize_t size)
+{
+	memcpy(store->write_buffer + store->write_length, data, (size_t)size);
+	store->write_length += size;
+}
+
+static void append_header(store_t *store, char type, ssize_t value)
+{
+	// snprintf writes a nul after the header, which the reserved
+	// space may not have room for
+	char header[32];
+	const int length = snprintf(header, sizeof(header), "%c%zd\r\n", type, value);
+	append(store, header, length);
+}
+
+static void append_argument(store_t *store, const void *data, ssize_t size)
+{
+	append_header(store, '$', size);
+	append(store, data, size);
+	append(store, "\r\n", 2);
+}
+
+int csalt_store_kv_resp_queue(
+	store_t *store,
+	ssize_t count,
+	const void *const *arguments,
+	const ssize_t *sizes
+)
+{
+	ssize_t size = header_size(count);
+	for (ssize_t i = 0; i < count; i++) {
+		if (sizes[i] < 0)
+			return -1;
+		size += argument_size(sizes[i]);
+	}
+	if (count < 1 || reserve(store, size))
+		return -1;
+
+	append_header(store, '*', count);
+	for (ssize_t i = 0; i < count; i++)
+		append_argument(store, arguments[i], sizes[i]);
+	store->pending++;
+	return 0;
+}
+
+int csalt_store_kv_resp_queue_get(store_t *store, const void *key, ssize_t key_size)
+{
+	const void *const arguments[] = { "GET", key };
+	const ssize_t sizes[] = { 3, key_size };
+	return csalt_store_kv_resp_queue(store, 2, arguments, sizes);
+}
+
+int csalt_store_kv_resp_queue_set(
+	store_t *store,
+	const void *key,
+	ssize_t key_size,
+	const void *value,
+	ssize_t value_size
+)
+{
+	const void *const arguments[] = { "SET", key, value };
+	const ssize_t sizes[] = { 3, key_size, value_size };
+	return csalt_store_kv_resp_queue(store, 3, arguments, sizes);
+}
+
+int csalt_store_kv_resp_queue_del(store_t *store, const void *key, ssize_t key_size)
+{
+	const void *const arguments[] = { "DEL", key };
+	const ssize_t sizes[] = { 3, key_size };
+	return csalt_store_kv_resp_queue(store, 2, arguments, sizes);
+}
+
+// Parsing replies. Replies are first measured, to find out whether
+// the whole reply has arrived and how many elements it has, then
+// built into the elements array in place.
+
+// The length of the line at data, without its CRLF, or -1 if the
+// CRLF hasn't arrived yet
+static ssize_t line_length(const char *data, ssize_t size)
+{
+	const char *const end = data + size;
+	for (const char *cr = data; cr < end; cr++) {
+		cr = memchr(cr, '\r', (size_t)(end - cr));
+		if (!cr || cr + 1 == end)
+			return -1;
+		if (cr[1] == '\n')
+			return cr - data;
+	}
+	return -1;
+}
+
+static int parse_integer(const char *text, ssize_t length, long long *value)
+{
+	const bool negative = length && text[0] == '-';
+	ssize_t i = negative;
+	if (i == length || length > 20)
+		return -1;
+
+	long long result = 0;
+	for (; i < length; i++) {
+		if (text[i] < '0' || text[i] > '9')
+			return -1;
+		const int digit = text[i] - '0';
+		if (result > (LLONG_MAX - digit) / 10)
+			return -1;
+		result = result * 10 + digit;
+	}
+	*value = negative? -result: result;
+	return 0;
+}
+
+static bool is_aggregate(char type)
+{
+	return type == '*' || type == '~' || type == '%' || type == '>' || type == '|';
+}
+
+// Returns the length of the reply at data, 0 if it hasn't all
+// arrived, or -1 if it isn't valid
+static ssize_t measure(const char *data, ssize_t size, ssize_t *elements, int depth)
+{
+	if (depth > MAX_DEPTH)
+		return -1;
+
+	const ssize_t line = size? line_length(data + 1, size - 1): -1;
+	if (line < 0)
+		return 0;
+	const ssize_t header = 1 + line + 2;
+	++*elements;
+
+	long long count = 0;
+	switch (data[0]) {
+	case '+': case '-': case ':': case '_': case '#': case ',': case '(':
+		return header;
+
+	case '$': case '!': case '=':
+		if (parse_integer(data + 1, line, &count))
+			return -1;
+		if (count < 0)
+			return data[0] == '$' && count == -1? header: -1;
+		if (count > MAX_BULK)
+			return -1;
+		if (size < header + count + 2)
+			return 0;
+		if (data[header + count] != '\r' || data[header + count + 1] != '\n')
+			return -1;
+		return header + (ssize_t)count + 2;
+
+	default:
+		if (!is_aggregate(data[0]) || parse_integer(data + 1, line, &count))
+			return -1;
+		if (count < 0)
+			return data[0] == '*' && count == -1? header: -1;
+		if (count > MAX_AGGREGATE)
+			return -1;
+		if (data[0] == '%' || data[0] == '|')
+			count *= 2;
+	}
+
+	ssize_t offset = header;
+	for (long long i = 0; i < count; i++) {
+		const ssize_t length = measure(data + offset, size - offset, elements, depth + 1);
+		if (length <= 0)
+			return length;
+		offset += length;
+	}
+
+	// Attributes describe the reply which follows them
+	if (data[0] == '|') {
+		const ssize_t length = measure(data + offset, size - offset, elements, depth + 1);
+		if (length <= 0)
+			return length;
+		offset += length;
+	}
+	return offset;
+}
+
+// Builds a reply which has already been measured, returning its
+// length, or -1 if it isn't valid
+static ssize_t build(
+	store_t *store,
+	const char *data,
+	ssize_t size,
+	reply_t *reply,
+	ssize_t *next
+)
+{
+	const ssize_t line = line_length(data + 1, size - 1);
+	const ssize_t header = 1 + line + 2;
+	*reply = (reply_t) {
+		.data = data + 1,
+		.size = line,
+	};
+
+	long long count = 0;
+	switch (data[0]) {
+	case '+':
+		reply->type = CSALT_RESP_SIMPLE;
+		return header;
+	case '-':
+		reply->type = CSALT_RESP_ERROR;
+		return header;
+	case ',':
+		reply->type = CSALT_RESP_DOUBLE;
+		return header;
+	case '(':
+		reply->type = CSALT_RESP_BIG_NUMBER;
+		return header;
+	case '_':
+		reply->type = CSALT_RESP_NULL;
+		return header;
+	case ':':
+		reply->type = CSALT_RESP_INTEGER;
+		return parse_integer(data + 1, line, &reply->integer)? -1: header;
+	case '#':
+		reply->type = CSALT_RESP_BOOLEAN;
+		reply->integer = data[1] == 't';
+		return line == 1 && (data[1] == 't' || data[1] == 'f')? header: -1;
+
+	case '$': case '!': case '=':
+		parse_integer(data + 1, line, &count);
+		reply->type = data[0] == '$'? CSALT_RESP_BULK:
+			data[0] == '!'? CSALT_RESP_BULK_ERROR:
+			CSALT_RESP_VERBATIM;
+		if (count < 0) {
+			*reply = (reply_t) { .type = CSALT_RESP_NULL };
+			return header;
+		}
+		reply->data = data + header;
+		reply->size = (ssize_t)count;
+		return header + (ssize_t)count + 2;
+	}
+
+	parse_integer(data + 1, line, &count);
+	if (data[0] == '*' && count < 0) {
+		*reply = (reply_t) { .type = CSALT_RESP_NULL };
+		return header;
+	}
+
+	if (data[0] == '%' || data[0] == '|')
+		count *= 2;
+
+	reply_t *const elements = store->elements + *next;
+	*next += (ssize_t)count;
+
+	ssize_t offset = header;
+	for (long long i = 0; i < count; i++) {
+		const ssize_t length = build(store, data + offset, size - offset, &elements[i], next);
+		if (length < 0)
+			return -1;
+		offset += length;
+	}
+
+	if (data[0] == '|') {
+		const ssize_t length = build(store, data + offset, size - offset, reply, next);
+		return length < 0? -1: offset + length;
+	}
+
+	*reply = (reply_t) {
+		.type = data[0] == '*'? CSALT_RESP_ARRAY:
+			data[0] == '~'? CSALT_RESP_SET:
+			CSALT_RESP_MAP,
+		.elements = elements,
+		.count = (ssize_t)count,
+	};
+	return offset;
+}
+
+// Reads more of the reply, making room in the read buffer first
+static int fill(store_t *store)
+{
+	if (store->read_begin == store->read_end) {
+		store->read_begin = 0;
+		store->read_end = 0;
+	}
+
+	if (store->read_end == store->read_size) {
+		if (store->read_begin) {
+			memmove(
+				store->read_buffer,
+				store->read_buffer + store->read_begin,
+				(size_t)(store->read_end - store->read_begin));
+			store->read_end -= store->read_begin;
+			store->read_begin = 0;
+		} else {
+			if (store->read_size > MAX_READ_BUFFER / 2)
+				return -1;
+			char *const buffer = realloc(store->read_buffer, (size_t)store->read_size * 2);
+			if (!buffer)
+				return -1;
+			store->read_buffer = buffer;
+			store->read_size *= 2;
+		}
+	}
+
+	const ssize_t amount = csalt_store_read(
+		store->connection,
+		store->read_buffer + store->read_end,
+		store->read_size - store->read_end);
+	if (amount <= 0)
+		return -1;
+	store->read_end += amount;
+	return 0;
+}
+
+static int reserve_elements(store_t *store, ssize_t count)
+{
+	if (count <= store->element_size)
+		return 0;
+
+	reply_t *const elements = realloc(store->elements, (size_t)count * sizeof(*elements));
+	if (!elements)
+		return -1;
+	store->elements = elements;
+	store->element_size = count;
+	return 0;
+}
+
+int csalt_store_kv_resp_reply(
+	store_t *store,
+	csalt_resp_reply_fn *block,
+	void *param
+)
+{
+	if (!store->pending || (store->write_length && csalt_store_kv_resp_flush(store)))
+		return -1;
+
+	for (;;) {
+		const char *const data = store->read_buffer + store->read_begin;
+		const ssize_t available = store->read_end - store->read_begin;
+
+		ssize_t elements = 0;
+		const ssize_t length = measure(data, available, &elements, 0);
+		if (length < 0)
+			return -1;
+		if (!length) {
+			if (fill(store))
+				return -1;
+			continue;
+		}
+
+		// Push messages don't answer any command
+		store->read_begin += length;
+		if (data[0] == '>')
+			continue;
+
+		ssize_t next = 1;
+		if (
+			reserve_elements(store, elements)
+			|| build(store, data, length, &store->elements[0], &next) < 0
+		)
+			return -1;
+
+		// The read buffer isn't touched again until the next
+		// reply, so data stays valid while the block runs
+		store->pending--;
+		return block(&store->elements[0], param);
+	}
+}
+
+ssize_t csalt_store_kv_resp_pending(const store_t *store)
+{
+	return store->pending;
+}
+
+// Key/value operations
+
+static bool reply_is(const reply_t *reply, const char *text)
+{
+	const ssize_t size = (ssize_t)strlen(text);
+	return reply->type == CSALT_RESP_SIMPLE
+		&& reply->size == size
+		&& !memcmp(reply->data, text, (size_t)size);
+}
+
+static bool is_string(const reply_t *reply)
+{
+	return reply->type == CSALT_RESP_BULK
+		|| reply->type == CSALT_RESP_SIMPLE
+		|| reply->type == CSALT_RESP_VERBATIM;
+}
+
+struct get_params {
+	csalt_static_store_block_fn *block;
+	void *param;
+};
+
+static int receive_get(const reply_t *reply, void *param)
+{
+	struct get_params *const params = param;
+	if (!is_string(reply))
+		return -1;
+
+	struct csalt_store_memory value = csalt_store_memory_bounds(
+		(char *)reply->data,
+		(char *)reply->data + reply->size);
+	return params->block((csalt_static_store *)&value, params->param);
+}
+
+static int get(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	store_t *const store = (store_t *)kv;
+	struct get_params params = { block, param };
+	if (store->pending || csalt_store_kv_resp_queue_get(store, key, key_size))
+		return -1;
+	return csalt_store_kv_resp_reply(store, receive_get, &params);
+}
+
+static int receive_ok(const reply_t *reply, void *param)
+{
+	(void)param;
+	return reply_is(reply, "OK")? 0: -1;
+}
+
+static int put(
+	csalt_kv *kv,
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	ssize_t value_size
+)
+{
+	store_t *const store = (store_t *)kv;
+	if (store->pending || key_size < 0 || value_size < 0)
+		return -1;
+
+	const ssize_t size = header_size(3)
+		+ argument_size(3)
+		+ argument_size(key_size)
+		+ argument_size(value_size);
+	if (reserve(store, size))
+		return -1;
+
+	// The value is read straight into the write buffer. If it
+	// can't be read, the command is taken back out again.
+	const ssize_t length = store->write_length;
+	append_header(store, '*', 3);
+	append_argument(store, "SET", 3);
+	append_argument(store, key, key_size);
+	append_header(store, '$', value_size);
+	if (csalt_kv_read_value(value, store->write_buffer + store->write_length, value_size)) {
+		store->write_length = length;
+		return -1;
+	}
+	store->write_length += value_size;
+	append(store, "\r\n", 2);
+	store->pending++;
+
+	return csalt_store_kv_resp_reply(store, receive_ok, NULL);
+}
+
+static int receive_removed(const reply_t *reply, void *param)
+{
+	(void)param;
+	return reply->type == CSALT_RESP_INTEGER && reply->integer > 0? 0: -1;
+}
+
+static int remove_key(csalt_kv *kv, const void *key, ssize_t key_size)
+{
+	store_t *const store = (store_t *)kv;
+	if (store->pending || csalt_store_kv_resp_queue_del(store, key, key_size))
+		return -1;
+	return csalt_store_kv_resp_reply(store, receive_removed, NULL);
+}
+
+// Iteration
+
+struct scan_batch {
+	char cursor[32];
+	ssize_t cursor_size;
+	char *keys;
+	ssize_t *offsets;
+	ssize_t count;
+};
+
+static int receive_scan(const reply_t *reply, void *param)
+{
+	struct scan_batch *const batch = param;
+	if (
+		reply->type != CSALT_RESP_ARRAY
+		|| reply->count != 2
+		|| !is_string(&reply->elements[0])
+		|| reply->elements[0].size >= (ssize_t)sizeof(batch->cursor)
+		|| reply->elements[1].type != CSALT_RESP_ARRAY
+	)
+		return -1;
+
+	const reply_t *const keys = reply->elements[1].elements;
+	const ssize_t count = reply->elements[1].count;
+	ssize_t total = 0;
+	for (ssize_t i = 0; i < count; i++) {
+		if (!is_string(&keys[i]))
+			return -1;
+		total += keys[i].size;
+	}
+
+	// The keys are copied, since the read buffer is reused for the
+	// values
+	batch->keys = malloc((size_t)total + 1);
+	batch->offsets = malloc((size_t)(count + 1) * sizeof(*batch->offsets));
+	if (!batch->keys || !batch->offsets)
+		return -1;
+
+	batch->offsets[0] = 0;
+	for (ssize_t i = 0; i < count; i++) {
+		memcpy(batch->keys + batch->offsets[i], keys[i].data, (size_t)keys[i].size);
+		batch->offsets[i + 1] = batch->offsets[i] + keys[i].size;
+	}
+	batch->count = count;
+
+	memcpy(batch->cursor, reply->elements[0].data, (size_t)reply->elements[0].size);
+	batch->cursor_size = reply->elements[0].size;
+	return 0;
+}
+
+struct iterate_params {
+	csalt_kv_block_fn *block;
+	void *param;
+	const char *key;
+	ssize_t key_size;
+};
+
+static int receive_iterate(const reply_t *reply, void *param)
+{
+	struct iterate_params *const params = param;
+
+	// The key was removed after the scan found it
+	if (reply->type == CSALT_RESP_NULL)
+		return 0;
+	if (!is_string(reply))
+		return -1;
+
+	struct csalt_store_memory value = csalt_store_memory_bounds(
+		(char *)reply->data,
+		(char *)reply->data + reply->size);
+	return params->block(
+		params->key,
+		params->key_size,
+		(csalt_static_store *)&value,
+		params->param);
+}
+
+static int receive_ignore(const reply_t *reply, void *param)
+{
+	(void)reply;
+	(void)param;
+	return 0;
+}
+
+// Fetches the values for a batch of keys with pipelined GETs
+static int iterate_batch(store_t *store, struct scan_batch *batch, csalt_kv_block_fn *block, void *param)
+{
+	ssize_t queued = 0;
+	int result = 0;
+	for (; !result && queued < batch->count; queued++)
+		result = csalt_store_kv_resp_queue_get(
+			store,
+			batch->keys + batch->offsets[queued],
+			batch->offsets[queued + 1] - batch->offsets[queued]);
+
+	// Every reply is read, even after the block asks to stop, so
+	// the next command gets its own reply
+	for (ssize_t i = 0; i < queued; i++) {
+		struct iterate_params params = {
+			block,
+			param,
+			batch->keys + batch->offsets[i],
+			batch->offsets[i + 1] - batch->offsets[i],
+		};
+		const int received = csalt_store_kv_resp_reply(
+			store,
+			result? receive_ignore: receive_iterate,
+			&params);
+		if (!result)
+			result = received;
+	}
+	return result;
+}
+
+static int iterate(csalt_kv *kv, csalt_kv_block_fn *block, void *param)
+{
+	store_t *const store = (store_t *)kv;
+	char cursor[32] = "0";
+	ssize_t cursor_size = 1;
+	if (store->pending)
+		return -1;
+
+	int result = 0;
+	do {
+		const void *const arguments[] = { "SCAN", cursor, "COUNT", SCAN_COUNT };
+		const ssize_t sizes[] = { 4, cursor_size, 5, sizeof(SCAN_COUNT) - 1 };
+		struct scan_batch batch = { .count = 0 };
+
+		result = csalt_store_kv_resp_queue(store, 4, arguments, sizes);
+		if (!result)
+			result = csalt_store_kv_resp_reply(store, receive_scan, &batch);
+		if (!result)
+			result = iterate_batch(store, &batch, block, param);
+
+		memcpy(cursor, batch.cursor, (size_t)batch.cursor_size);
+		cursor_size = batch.cursor_size;
+		free(batch.keys);
+		free(batch.offsets);
+	} while (!result && !(cursor_size == 1 && cursor[0] == '0'));
+
+	return result;
+}
+
+// Resource functions
+
+csalt_static_store *csalt_resource_kv_resp_init(
+	csalt_static_resource *resource
+)
+{
+	resource_t *const resp = (resource_t *)resource;
+	store_t *const store = &resp->store;
+	const ssize_t size = resp->buffer_size > 0? resp->buffer_size: 4096;
+
+	store->connection = csalt_static_resource_init(resp->connection);
+	if (!store->connection)
+		return NULL;
+
+	store->buffer_size = size;
+	store->read_buffer = malloc((size_t)size);
+	store->write_buffer = malloc((size_t)size);
+	store->elements = NULL;
+	store->element_size = 0;
+	store->read_size = size;
+	store->write_size = size;
+	store->read_begin = 0;
+	store->read_end = 0;
+	store->write_length = 0;
+	store->pending = 0;
+
+	if (!store->read_buffer || !store->write_buffer) {
+		free(store->read_buffer);
+		free(store->write_buffer);
+		csalt_resource_deinit((csalt_resource *)resp->connection);
+		return NULL;
+	}
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_kv_resp_deinit(csalt_resource *resource)
+{
+	resource_t *const resp = (resource_t *)resource;
+	store_t *const store = &resp->store;
+
+	free(store->read_buffer);
+	free(store->write_buffer);
+	free(store->elements);
+	store->read_buffer = NULL;
+	store->write_buffer = NULL;
+	store->elements = NULL;
+	csalt_resource_deinit((csalt_resource *)resp->connection);
+}
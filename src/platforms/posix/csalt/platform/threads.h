@@ -9,10 +9,150 @@
 extern "C" {
 #endif
 
+#ifdef CSALT_FUTEX
+
+/*
+ * Linux futex-based locks. Each lock is a single 32-bit word, and
+ * the uncontended lock and unlock paths are a single atomic
+ * operation; the kernel is only entered when a thread has to wait.
+ *
+ * The functions return 0 on success and EBUSY when a try-lock
+ * fails, like their pthread equivalents.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+typedef struct csalt_mutex {
+	_Atomic uint32_t state;
+} csalt_mutex;
+
+/*
+ * Mutex parameters aren't supported by the futex implementation;
+ * this type exists so the same code compiles either way.
+ */
+typedef int csalt_mutex_params;
+
+typedef struct csalt_rwlock {
+	_Atomic uint32_t state;
+} csalt_rwlock;
+
+typedef struct csalt_cond {
+	_Atomic uint32_t sequence;
+} csalt_cond;
+
+void csalt_futex_mutex_lock_slow(csalt_mutex *mutex, uint32_t state);
+void csalt_futex_wake(_Atomic uint32_t *address, int count);
+int csalt_futex_rwlock_rdlock(csalt_rwlock *rwlock);
+int csalt_futex_rwlock_wrlock(csalt_rwlock *rwlock);
+int csalt_futex_rwlock_tryrdlock(csalt_rwlock *rwlock);
+int csalt_futex_rwlock_trywrlock(csalt_rwlock *rwlock);
+int csalt_futex_rwlock_unlock(csalt_rwlock *rwlock);
+int csalt_futex_cond_wait(csalt_cond *cond, csalt_mutex *mutex);
+int csalt_futex_cond_wake(csalt_cond *cond, int count);
+
+// 0: unlocked, 1: locked, 2: locked with (possible) waiters
+static inline int csalt_futex_mutex_init(
+	csalt_mutex *mutex,
+	const csalt_mutex_params *params
+)
+{
+	(void)params;
+	atomic_init(&mutex->state, 0);
+	return 0;
+}
+
+static inline int csalt_futex_mutex_trylock(csalt_mutex *mutex)
+{
+	uint32_t expected = 0;
+	if (atomic_compare_exchange_strong(&mutex->state, &expected, 1))
+		return 0;
+	return EBUSY;
+}
+
+static inline int csalt_futex_mutex_lock(csalt_mutex *mutex)
+{
+	uint32_t expected = 0;
+	if (!atomic_compare_exchange_strong(&mutex->state, &expected, 1))
+		csalt_futex_mutex_lock_slow(mutex, expected);
+	return 0;
+}
+
+static inline int csalt_futex_mutex_unlock(csalt_mutex *mutex)
+{
+	if (atomic_exchange(&mutex->state, 0) == 2)
+		csalt_futex_wake(&mutex->state, 1);
+	return 0;
+}
+
+static inline int csalt_futex_rwlock_init(
+	csalt_rwlock *rwlock,
+	const void *params
+)
+{
+	(void)params;
+	atomic_init(&rwlock->state, 0);
+	return 0;
+}
+
+static inline int csalt_futex_mutex_deinit(csalt_mutex *mutex)
+{
+	(void)mutex;
+	return 0;
+}
+
+static inline int csalt_futex_rwlock_deinit(csalt_rwlock *rwlock)
+{
+	(void)rwlock;
+	return 0;
+}
+
+static inline int csalt_futex_cond_init(csalt_cond *cond)
+{
+	atomic_init(&cond->sequence, 0);
+	return 0;
+}
+
+static inline int csalt_futex_cond_deinit(csalt_cond *cond)
+{
+	(void)cond;
+	return 0;
+}
+
+#define CSALT_MUTEX_INITIALIZER { 0 }
+#define CSALT_COND_INITIALIZER { 0 }
+
+#define csalt_mutex_init(...) csalt_futex_mutex_init(__VA_ARGS__)
+#define csalt_mutex_lock(mutex) csalt_futex_mutex_lock(mutex)
+#define csalt_mutex_trylock(mutex) csalt_futex_mutex_trylock(mutex)
+#define csalt_mutex_unlock(mutex) csalt_futex_mutex_unlock(mutex)
+#define csalt_mutex_deinit(mutex) csalt_futex_mutex_deinit(mutex)
+
+#define csalt_rwlock_init(...) csalt_futex_rwlock_init(__VA_ARGS__)
+#define csalt_rwlock_rdlock(rwlock) csalt_futex_rwlock_rdlock(rwlock)
+#define csalt_rwlock_wrlock(rwlock) csalt_futex_rwlock_wrlock(rwlock)
+#define csalt_rwlock_tryrdlock(rwlock) csalt_futex_rwlock_tryrdlock(rwlock)
+#define csalt_rwlock_trywrlock(rwlock) csalt_futex_rwlock_trywrlock(rwlock)
+#define csalt_rwlock_unlock(rwlock) csalt_futex_rwlock_unlock(rwlock)
+#define csalt_rwlock_deinit(rwlock) csalt_futex_rwlock_deinit(rwlock)
+
+#define csalt_cond_init(cond) csalt_futex_cond_init(cond)
+#define csalt_cond_wait(cond, mutex) csalt_futex_cond_wait(cond, mutex)
+#define csalt_cond_signal(cond) csalt_futex_cond_wake(cond, 1)
+#define csalt_cond_broadcast(cond) csalt_futex_cond_wake(cond, INT_MAX)
+#define csalt_cond_deinit(cond) csalt_futex_cond_deinit(cond)
+
+#else // CSALT_FUTEX
+
 typedef pthread_mutex_t csalt_mutex;
 typedef pthread_mutexattr_t csalt_mutex_params;
 
 // should standardize this
+#define CSALT_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define CSALT_COND_INITIALIZER PTHREAD_COND_INITIALIZER
+
 #define csalt_mutex_init(...) pthread_mutex_init(__VA_ARGS__)
 #define csalt_mutex_lock(mutex) pthread_mutex_lock(mutex)
 #define csalt_mutex_trylock(mutex) pthread_mutex_trylock(mutex)
@@ -29,6 +169,23 @@ typedef pthread_rwlock_t csalt_rwlock;
 #define csalt_rwlock_unlock(rwlock) pthread_rwlock_unlock(rwlock)
 #define csalt_rwlock_deinit(rwlock) pthread_rwlock_destroy(rwlock)
 
+typedef pthread_cond_t csalt_cond;
+
+#define csalt_cond_init(cond) pthread_cond_init(cond, NULL)
+#define csalt_cond_wait(cond, mutex) pthread_cond_wait(cond, mutex)
+#define csalt_cond_signal(cond) pthread_cond_signal(cond)
+#define csalt_cond_broadcast(cond) pthread_cond_broadcast(cond)
+#define csalt_cond_deinit(cond) pthread_cond_destroy(cond)
+
+#endif // CSALT_FUTEX
+
+typedef pthread_t csalt_thread;
+
+#define csalt_thread_create(thread, fn, param) \
+	pthread_create(thread, NULL, fn, param)
+#define csalt_thread_join(thread) pthread_join(thread, NULL)
+#define csalt_thread_detach(thread) pthread_detach(thread)
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
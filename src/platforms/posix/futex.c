@@ -0,0 +1,155 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// syscall() and SYS_futex aren't exposed by _XOPEN_SOURCE alone
+#define _GNU_SOURCE
+
+#include "csalt/platform/threads.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static void futex_wait(_Atomic uint32_t *address, uint32_t expected)
+{
+	// Returns early with EAGAIN if the value has already changed,
+	// or EINTR on a signal; callers re-check their condition either
+	// way
+	syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void csalt_futex_wake(_Atomic uint32_t *address, int count)
+{
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+void csalt_futex_mutex_lock_slow(csalt_mutex *mutex, uint32_t state)
+{
+	// Mark the mutex as contended before sleeping, so the holder
+	// knows to wake us when it unlocks
+	if (state != 2)
+		state = atomic_exchange(&mutex->state, 2);
+	while (state != 0) {
+		futex_wait(&mutex->state, 2);
+		state = atomic_exchange(&mutex->state, 2);
+	}
+}
+
+/*
+ * The rwlock state holds the reader count in the low bits, plus a
+ * bit for a held write lock and a bit for sleeping waiters of
+ * either kind. Waiters are all woken together when the lock becomes
+ * free, and race to take it again.
+ */
+#define RWLOCK_WRITER ((uint32_t)1 << 31)
+#define RWLOCK_WAITING ((uint32_t)1 << 30)
+#define RWLOCK_READERS (RWLOCK_WAITING - 1)
+
+int csalt_futex_rwlock_tryrdlock(csalt_rwlock *rwlock)
+{
+	uint32_t state = atomic_load(&rwlock->state);
+	while (!(state & RWLOCK_WRITER)) {
+		if ((state & RWLOCK_READERS) == RWLOCK_READERS)
+			return EAGAIN;
+		if (atomic_compare_exchange_weak(&rwlock->state, &state, state + 1))
+			return 0;
+	}
+	return EBUSY;
+}
+
+int csalt_futex_rwlock_trywrlock(csalt_rwlock *rwlock)
+{
+	uint32_t state = atomic_load(&rwlock->state);
+	while (!(state & ~RWLOCK_WAITING)) {
+		if (atomic_compare_exchange_weak(
+			&rwlock->state,
+			&state,
+			state | RWLOCK_WRITER
+		))
+			return 0;
+	}
+	return EBUSY;
+}
+
+static void rwlock_sleep(csalt_rwlock *rwlock, uint32_t held_mask)
+{
+	uint32_t state = atomic_load(&rwlock->state);
+	if (!(state & held_mask))
+		return;
+	if (!(state & RWLOCK_WAITING)) {
+		if (!atomic_compare_exchange_strong(
+			&rwlock->state,
+			&state,
+			state | RWLOCK_WAITING
+		))
+			return;
+		state |= RWLOCK_WAITING;
+	}
+	futex_wait(&rwlock->state, state);
+}
+
+int csalt_futex_rwlock_rdlock(csalt_rwlock *rwlock)
+{
+	int result;
+	while ((result = csalt_futex_rwlock_tryrdlock(rwlock)) == EBUSY)
+		rwlock_sleep(rwlock, RWLOCK_WRITER);
+	return result;
+}
+
+int csalt_futex_rwlock_wrlock(csalt_rwlock *rwlock)
+{
+	while (csalt_futex_rwlock_trywrlock(rwlock))
+		rwlock_sleep(rwlock, ~RWLOCK_WAITING);
+	return 0;
+}
+
+int csalt_futex_rwlock_unlock(csalt_rwlock *rwlock)
+{
+	uint32_t state = atomic_load(&rwlock->state);
+	uint32_t next;
+	do {
+		if (state & RWLOCK_WRITER)
+			next = 0;
+		else if ((state & RWLOCK_READERS) == 1)
+			next = 0;
+		else
+			next = state - 1;
+	} while (!atomic_compare_exchange_weak(&rwlock->state, &state, next));
+
+	if ((state & RWLOCK_WAITING) && !next)
+		csalt_futex_wake(&rwlock->state, INT_MAX);
+	return 0;
+}
+
+int csalt_futex_cond_wait(csalt_cond *cond, csalt_mutex *mutex)
+{
+	// Any signal after this load changes the sequence, so the wait
+	// below returns immediately instead of missing it
+	const uint32_t sequence = atomic_load(&cond->sequence);
+	csalt_futex_mutex_unlock(mutex);
+	futex_wait(&cond->sequence, sequence);
+	csalt_futex_mutex_lock(mutex);
+	return 0;
+}
+
+int csalt_futex_cond_wake(csalt_cond *cond, int count)
+{
+	atomic_fetch_add(&cond->sequence, 1);
+	csalt_futex_wake(&cond->sequence, count);
+	return 0;
+}
@@ -0,0 +1,451 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/resource/cache.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct csalt_resource_cache resource_t;
+typedef struct csalt_store_cache cache_t;
+typedef struct csalt_store_cache_view view_t;
+typedef struct csalt_cache_frame frame_t;
+
+struct csalt_cache_frame {
+	ssize_t block;
+	ssize_t length;
+	ssize_t next;
+	bool referenced;
+};
+
+static ssize_t view_read(csalt_static_store *store, void *buffer, ssize_t amount);
+static ssize_t view_write(csalt_static_store *store, const void *buffer, ssize_t amount);
+static int view_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+static const struct csalt_dynamic_resource_interface impl = {
+	csalt_resource_cache_init,
+	csalt_resource_cache_deinit,
+};
+
+static const struct csalt_dynamic_store_interface store_impl = {
+	{
+		csalt_store_cache_read,
+		csalt_store_cache_write,
+		csalt_store_cache_split,
+		NULL,
+	},
+	csalt_store_cache_size,
+	csalt_store_cache_resize,
+};
+
+static const struct csalt_static_store_interface view_impl = {
+	view_read,
+	view_write,
+	view_split,
+	NULL,
+};
+
+struct csalt_resource_cache csalt_resource_cache(
+	csalt_resource *resource,
+	ssize_t block_size,
+	ssize_t block_count
+)
+{
+	return (resource_t) {
+		.vtable = &impl,
+		.resource = resource,
+		.block_size = block_size,
+		.block_count = block_count,
+		.store = {
+			.vtable = &store_impl,
+		},
+	};
+}
+
+static view_t whole(cache_t *cache)
+{
+	return (view_t) {
+		&view_impl,
+		cache,
+		0,
+		SSIZE_MAX,
+	};
+}
+
+// Block lookup. Cached blocks are found through a chained hash
+// table, with the chains threaded through the frames.
+
+static size_t bucket(const cache_t *cache, ssize_t block)
+{
+	return (size_t)(((uint64_t)block * 0x9e3779b97f4a7c15u) >> 32) & cache->bucket_mask;
+}
+
+static ssize_t lookup(const cache_t *cache, ssize_t block)
+{
+	ssize_t index = cache->buckets[bucket(cache, block)];
+	while (index >= 0 && cache->frames[index].block != block)
+		index = cache->frames[index].next;
+	return index;
+}
+
+static void drop(cache_t *cache, ssize_t index)
+{
+	frame_t *const frame = &cache->frames[index];
+	ssize_t *link = &cache->buckets[bucket(cache, frame->block)];
+	while (*link != index)
+		link = &cache->frames[*link].next;
+	*link = frame->next;
+
+	if (cache->tail == frame->block)
+		cache->tail = -1;
+	frame->block = -1;
+	frame->referenced = false;
+}
+
+// Chooses the frame to load the next block into
+static ssize_t victim(cache_t *cache)
+{
+	for (;;) {
+		const ssize_t index = cache->hand;
+		frame_t *const frame = &cache->frames[index];
+		cache->hand = (index + 1) % cache->block_count;
+
+		if (frame->block < 0)
+			return index;
+		if (frame->referenced) {
+			frame->referenced = false;
+			continue;
+		}
+
+		drop(cache, index);
+		cache->evictions++;
+		return index;
+	}
+}
+
+struct load_params {
+	char *buffer;
+	ssize_t size;
+	ssize_t result;
+};
+
+static int receive_load(csalt_static_store *store, void *param)
+{
+	struct load_params *const params = param;
+	params->result = csalt_store_read(store, params->buffer, params->size);
+	return params->result < 0? -1: 0;
+}
+
+static ssize_t load(cache_t *cache, ssize_t block)
+{
+	const ssize_t index = victim(cache);
+	char *const buffer = cache->blocks + index * cache->block_size;
+	const ssize_t begin = block * cache->block_size;
+
+	// Reads don't advance through a store, so each short read is
+	// followed by a split from where it stopped
+	ssize_t length = 0;
+	while (length < cache->block_size) {
+		struct load_params params = {
+			buffer + length,
+			cache->block_size - length,
+			-1,
+		};
+		if (csalt_store_split(
+			(csalt_static_store *)cache->decorated,
+			begin + length,
+			begin + cache->block_size,
+			receive_load,
+			&params
+		))
+			return -1;
+		if (!params.result)
+			break;
+		length += params.result;
+	}
+
+	frame_t *const frame = &cache->frames[index];
+	const size_t slot = bucket(cache, block);
+	frame->block = block;
+	frame->length = length;
+	frame->next = cache->buckets[slot];
+	cache->buckets[slot] = index;
+
+	// A short block is the end of the store, and goes stale if the
+	// store grows
+	if (length < cache->block_size) {
+		if (cache->tail >= 0)
+			drop(cache, lookup(cache, cache->tail));
+		cache->tail = block;
+	}
+	return index;
+}
+
+static ssize_t find(cache_t *cache, ssize_t block)
+{
+	const ssize_t index = lookup(cache, block);
+	if (index >= 0) {
+		cache->hits++;
+		return index;
+	}
+	cache->misses++;
+	return load(cache, block);
+}
+
+void csalt_store_cache_invalidate(cache_t *cache)
+{
+	for (ssize_t i = 0; i < cache->block_count; i++) {
+		cache->frames[i].block = -1;
+		cache->frames[i].referenced = false;
+	}
+	for (size_t i = 0; i <= cache->bucket_mask; i++)
+		cache->buckets[i] = -1;
+	cache->hand = 0;
+	cache->tail = -1;
+}
+
+// Drops the blocks a write to [begin, end) overlaps
+static void invalidate_range(cache_t *cache, ssize_t begin, ssize_t end)
+{
+	const ssize_t first = begin / cache->block_size;
+	const ssize_t last = (end - 1) / cache->block_size;
+
+	if (cache->tail >= 0 && cache->tail < first)
+		drop(cache, lookup(cache, cache->tail));
+
+	// Large writes are cheaper to handle by checking each frame
+	// than each block
+	if (last - first >= cache->block_count) {
+		for (ssize_t i = 0; i < cache->block_count; i++) {
+			const ssize_t block = cache->frames[i].block;
+			if (block >= first && block <= last)
+				drop(cache, i);
+		}
+		return;
+	}
+
+	for (ssize_t block = first; block <= last; block++) {
+		const ssize_t index = lookup(cache, block);
+		if (index >= 0)
+			drop(cache, index);
+	}
+}
+
+// Views
+
+static ssize_t view_read(csalt_static_store *store, void *buffer, ssize_t amount)
+{
+	view_t *const view = (view_t *)store;
+	cache_t *const cache = view->cache;
+	if (amount > view->end - view->begin)
+		amount = view->end - view->begin;
+
+	ssize_t done = 0;
+	while (done < amount) {
+		const ssize_t offset = view->begin + done;
+		const ssize_t within = offset % cache->block_size;
+		const ssize_t index = find(cache, offset / cache->block_size);
+		if (index < 0)
+			return done? done: -1;
+
+		frame_t *const frame = &cache->frames[index];
+		frame->referenced = true;
+
+		ssize_t size = frame->length - within;
+		if (size <= 0)
+			break;
+		if (size > amount - done)
+			size = amount - done;
+
+		memcpy(
+			(char *)buffer + done,
+			cache->blocks + index * cache->block_size + within,
+			(size_t)size);
+		done += size;
+
+		if (frame->length < cache->block_size)
+			break;
+	}
+	return done;
+}
+
+struct write_params {
+	const void *buffer;
+	ssize_t amount;
+	ssize_t result;
+};
+
+static int receive_write(csalt_static_store *store, void *param)
+{
+	struct write_params *const params = param;
+	params->result = csalt_store_write(store, params->buffer, params->amount);
+	return params->result < 0? -1: 0;
+}
+
+static ssize_t view_write(csalt_static_store *store, const void *buffer, ssize_t amount)
+{
+	view_t *const view = (view_t *)store;
+	cache_t *const cache = view->cache;
+	if (amount > view->end - view->begin)
+		amount = view->end - view->begin;
+	if (amount <= 0)
+		return 0;
+
+	struct write_params params = { buffer, amount, -1 };
+	const int result = csalt_store_split(
+		(csalt_static_store *)cache->decorated,
+		view->begin,
+		view->begin + amount,
+		receive_write,
+		&params);
+
+	// Even a failed write may have changed part of the range
+	invalidate_range(cache, view->begin, view->begin + amount);
+	return result? -1: params.result;
+}
+
+static int view_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	view_t *const view = (view_t *)store;
+	if (begin < 0 || end < begin)
+		return -1;
+
+	view_t split = *view;
+	split.begin = begin < view->end - view->begin?
+		view->begin + begin:
+		view->end;
+	split.end = end < view->end - view->begin?
+		view->begin + end:
+		view->end;
+	return block((csalt_static_store *)&split, param);
+}
+
+// The cache itself behaves as a view of the whole decorated store
+
+ssize_t csalt_store_cache_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t amount
+)
+{
+	view_t view = whole((cache_t *)store);
+	return view_read((csalt_static_store *)&view, buffer, amount);
+}
+
+ssize_t csalt_store_cache_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t amount
+)
+{
+	view_t view = whole((cache_t *)store);
+	return view_write((csalt_static_store *)&view, buffer, amount);
+}
+
+int csalt_store_cache_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	view_t view = whole((cache_t *)store);
+	return view_split((csalt_static_store *)&view, begin, end, block, param);
+}
+
+ssize_t csalt_store_cache_size(csalt_store *store)
+{
+	cache_t *const cache = (cache_t *)store;
+	return csalt_store_size(cache->decorated);
+}
+
+ssize_t csalt_store_cache_resize(csalt_store *store, ssize_t new_size)
+{
+	cache_t *const cache = (cache_t *)store;
+	const ssize_t result = csalt_store_resize(cache->decorated, new_size);
+	csalt_store_cache_invalidate(cache);
+	return result;
+}
+
+// Resource functions
+
+csalt_store *csalt_resource_cache_init(csalt_resource *resource)
+{
+	resource_t *const resource_cache = (resource_t *)resource;
+	cache_t *const cache = &resource_cache->store;
+	const ssize_t block_size = resource_cache->block_size;
+	const ssize_t block_count = resource_cache->block_count;
+
+	if (block_size < 1 || block_count < 1)
+		return NULL;
+
+	// Two buckets per frame keeps the chains short
+	size_t buckets = 1;
+	while (buckets < (size_t)block_count * 2)
+		buckets *= 2;
+
+	cache->decorated = csalt_resource_init(resource_cache->resource);
+	if (!cache->decorated)
+		return NULL;
+
+	cache->block_size = block_size;
+	cache->block_count = block_count;
+	cache->blocks = malloc((size_t)block_size * (size_t)block_count);
+	cache->frames = malloc((size_t)block_count * sizeof(*cache->frames));
+	cache->buckets = malloc(buckets * sizeof(*cache->buckets));
+	cache->bucket_mask = buckets - 1;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+
+	if (!cache->blocks || !cache->frames || !cache->buckets) {
+		csalt_resource_cache_deinit(resource);
+		return NULL;
+	}
+
+	csalt_store_cache_invalidate(cache);
+	return (csalt_store *)cache;
+}
+
+void csalt_resource_cache_deinit(csalt_resource *resource)
+{
+	resource_t *const resource_cache = (resource_t *)resource;
+	cache_t *const cache = &resource_cache->store;
+
+	free(cache->blocks);
+	free(cache->frames);
+	free(cache->buckets);
+	cache->blocks = NULL;
+	cache->frames = NULL;
+	cache->buckets = NULL;
+	csalt_resource_deinit(resource_cache->resource);
+}
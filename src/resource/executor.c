@@ -0,0 +1,432 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/resource/executor.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <sched.h>
+
+typedef struct csalt_resource_executor executor_t;
+typedef struct csalt_store_executor store_t;
+typedef struct csalt_executor_worker worker_t;
+typedef struct csalt_executor_job job_t;
+
+enum {
+	JOB_CREATED,
+	JOB_QUEUED,
+	JOB_DONE,
+};
+
+struct csalt_executor_worker {
+	csalt_mutex lock;
+	job_t **jobs;
+	size_t top;
+	size_t bottom;
+	csalt_thread thread;
+	store_t *executor;
+};
+
+static _Thread_local worker_t *current_worker = NULL;
+
+static int run_parallel(
+	struct csalt_store_parallel *parallel,
+	csalt_store_task_fn *task,
+	void *params,
+	ssize_t size,
+	ssize_t count);
+
+static ssize_t store_read(csalt_static_store *store, void *buffer, ssize_t size)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+static ssize_t store_write(csalt_static_store *store, const void *buffer, ssize_t size)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+static int store_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_executor_init,
+	csalt_resource_executor_deinit,
+};
+
+static const struct csalt_static_store_interface store_impl = {
+	store_read,
+	store_write,
+	store_split,
+	NULL,
+};
+
+struct csalt_resource_executor csalt_resource_executor(
+	ssize_t threads,
+	ssize_t queue_size
+)
+{
+	return (executor_t) {
+		.vtable = &impl,
+		.threads = threads,
+		.queue_size = queue_size,
+		.store = {
+			.vtable = &store_impl,
+			.parallel = { run_parallel },
+		},
+	};
+}
+
+struct csalt_executor_job csalt_executor_job(
+	csalt_resource *resource,
+	csalt_store_block_fn *block,
+	void *param
+)
+{
+	return (job_t) {
+		.resource = resource,
+		.block = block,
+		.param = param,
+		.result = -1,
+	};
+}
+
+struct csalt_executor_job csalt_executor_job_fn(
+	int (*function)(void *param),
+	void *param
+)
+{
+	return (job_t) {
+		.function = function,
+		.param = param,
+		.result = -1,
+	};
+}
+
+// Queue operations. The owning worker pushes and pops at the
+// bottom; other workers steal from the top.
+
+static bool push(worker_t *worker, job_t *job)
+{
+	const size_t capacity = (size_t)worker->executor->queue_size;
+	csalt_mutex_lock(&worker->lock);
+	const bool full = worker->bottom - worker->top == capacity;
+	if (!full)
+		worker->jobs[worker->bottom++ % capacity] = job;
+	csalt_mutex_unlock(&worker->lock);
+	return !full;
+}
+
+static job_t *pop(worker_t *worker)
+{
+	const size_t capacity = (size_t)worker->executor->queue_size;
+	job_t *job = NULL;
+	csalt_mutex_lock(&worker->lock);
+	if (worker->bottom != worker->top)
+		job = worker->jobs[--worker->bottom % capacity];
+	csalt_mutex_unlock(&worker->lock);
+	return job;
+}
+
+static job_t *steal(worker_t *worker)
+{
+	const size_t capacity = (size_t)worker->executor->queue_size;
+	job_t *job = NULL;
+	csalt_mutex_lock(&worker->lock);
+	if (worker->bottom != worker->top)
+		job = worker->jobs[worker->top++ % capacity];
+	csalt_mutex_unlock(&worker->lock);
+	return job;
+}
+
+static job_t *take(store_t *executor, worker_t *self)
+{
+	const size_t count = (size_t)executor->worker_count;
+	const size_t first = self? (size_t)(self - executor->workers): 0;
+
+	job_t *job = self? pop(self): NULL;
+	for (size_t i = 1; !job && i <= count; i++)
+		job = steal(&executor->workers[(first + i) % count]);
+
+	if (job)
+		atomic_fetch_sub(&executor->pending, 1);
+	return job;
+}
+
+static void finished(store_t *executor)
+{
+	csalt_mutex_lock(&executor->lock);
+	atomic_fetch_sub(&executor->active, 1);
+	csalt_cond_broadcast(&executor->done);
+	csalt_mutex_unlock(&executor->lock);
+}
+
+static void run(job_t *job)
+{
+	store_t *const executor = job->executor;
+	if (job->function)
+		job->result = job->function(job->param);
+	else
+		job->result = csalt_resource_use(
+			job->resource,
+			job->block,
+			job->param);
+
+	// The job may be freed by its owner as soon as it's marked
+	// done, so it mustn't be touched after this point
+	atomic_store(&job->state, JOB_DONE);
+	finished(executor);
+}
+
+static void *worker_main(void *param)
+{
+	worker_t *const worker = param;
+	store_t *const executor = worker->executor;
+	current_worker = worker;
+
+	for (;;) {
+		job_t *const job = take(executor, worker);
+		if (job) {
+			run(job);
+			continue;
+		}
+
+		csalt_mutex_lock(&executor->lock);
+		while (
+			!atomic_load(&executor->pending) &&
+			!atomic_load(&executor->stopping)
+		)
+			csalt_cond_wait(&executor->work, &executor->lock);
+		const bool stop = atomic_load(&executor->stopping)
+			&& !atomic_load(&executor->pending);
+		csalt_mutex_unlock(&executor->lock);
+
+		if (stop)
+			break;
+	}
+	return NULL;
+}
+
+static void destroy(store_t *executor, ssize_t started)
+{
+	csalt_mutex_lock(&executor->lock);
+	atomic_store(&executor->stopping, true);
+	csalt_cond_broadcast(&executor->work);
+	csalt_mutex_unlock(&executor->lock);
+
+	for (ssize_t i = 0; i < started; i++)
+		csalt_thread_join(executor->workers[i].thread);
+
+	for (ssize_t i = 0; i < executor->worker_count; i++) {
+		free(executor->workers[i].jobs);
+		csalt_mutex_deinit(&executor->workers[i].lock);
+	}
+
+	free(executor->workers);
+	executor->workers = NULL;
+	csalt_cond_deinit(&executor->done);
+	csalt_cond_deinit(&executor->work);
+	csalt_mutex_deinit(&executor->lock);
+}
+
+csalt_static_store *csalt_resource_executor_init(
+	csalt_static_resource *resource
+)
+{
+	executor_t *const executor = (executor_t *)resource;
+	store_t *const store = &executor->store;
+
+	if (executor->queue_size < 1)
+		return NULL;
+
+	ssize_t threads = executor->threads;
+	if (threads < 1)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+
+	store->workers = calloc((size_t)threads, sizeof(*store->workers));
+	if (!store->workers)
+		return NULL;
+
+	store->worker_count = threads;
+	store->queue_size = executor->queue_size;
+	atomic_init(&store->next, 0);
+	atomic_init(&store->pending, 0);
+	atomic_init(&store->active, 0);
+	atomic_init(&store->stopping, false);
+	csalt_mutex_init(&store->lock, NULL);
+	csalt_cond_init(&store->work);
+	csalt_cond_init(&store->done);
+
+	bool allocated = true;
+	for (ssize_t i = 0; i < threads; i++) {
+		worker_t *const worker = &store->workers[i];
+		csalt_mutex_init(&worker->lock, NULL);
+		worker->executor = store;
+		worker->jobs = calloc(
+			(size_t)executor->queue_size,
+			sizeof(*worker->jobs));
+		allocated = allocated && worker->jobs;
+	}
+
+	if (!allocated) {
+		destroy(store, 0);
+		return NULL;
+	}
+
+	for (ssize_t i = 0; i < threads; i++) {
+		worker_t *const worker = &store->workers[i];
+		if (csalt_thread_create(&worker->thread, worker_main, worker)) {
+			destroy(store, i);
+			return NULL;
+		}
+	}
+
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_executor_deinit(csalt_resource *resource)
+{
+	executor_t *const executor = (executor_t *)resource;
+	csalt_store_executor_wait(&executor->store);
+	destroy(&executor->store, executor->store.worker_count);
+}
+
+int csalt_store_executor_submit(store_t *executor, job_t *job)
+{
+	if (atomic_load(&executor->stopping))
+		return -1;
+
+	job->executor = executor;
+	atomic_store(&job->state, JOB_QUEUED);
+	atomic_fetch_add(&executor->active, 1);
+	atomic_fetch_add(&executor->pending, 1);
+
+	const size_t count = (size_t)executor->worker_count;
+	const bool nested = current_worker
+		&& current_worker->executor == executor;
+	const size_t first = nested?
+		(size_t)(current_worker - executor->workers):
+		atomic_fetch_add(&executor->next, 1) % count;
+
+	for (size_t i = 0; i < count; i++) {
+		if (push(&executor->workers[(first + i) % count], job)) {
+			csalt_mutex_lock(&executor->lock);
+			csalt_cond_signal(&executor->work);
+			csalt_mutex_unlock(&executor->lock);
+			return 0;
+		}
+	}
+
+	atomic_fetch_sub(&executor->pending, 1);
+	atomic_store(&job->state, JOB_CREATED);
+	finished(executor);
+	return -1;
+}
+
+void csalt_store_executor_wait(store_t *executor)
+{
+	csalt_mutex_lock(&executor->lock);
+	while (atomic_load(&executor->active))
+		csalt_cond_wait(&executor->done, &executor->lock);
+	csalt_mutex_unlock(&executor->lock);
+}
+
+bool csalt_executor_job_done(const job_t *job)
+{
+	return atomic_load(&job->state) == JOB_DONE;
+}
+
+int csalt_executor_job_wait(job_t *job)
+{
+	if (atomic_load(&job->state) == JOB_CREATED)
+		return -1;
+
+	store_t *const executor = job->executor;
+
+	if (current_worker && current_worker->executor == executor) {
+		while (!csalt_executor_job_done(job)) {
+			job_t *const other = take(executor, current_worker);
+			if (other)
+				run(other);
+			else
+				sched_yield();
+		}
+		return job->result;
+	}
+
+	csalt_mutex_lock(&executor->lock);
+	while (!csalt_executor_job_done(job))
+		csalt_cond_wait(&executor->done, &executor->lock);
+	csalt_mutex_unlock(&executor->lock);
+	return job->result;
+}
+
+static int run_parallel(
+	struct csalt_store_parallel *parallel,
+	csalt_store_task_fn *task,
+	void *params,
+	ssize_t size,
+	ssize_t count
+)
+{
+	store_t *const executor = (store_t *)
+		((char *)parallel - offsetof(store_t, parallel));
+
+	job_t jobs[count];
+	bool submitted[count];
+	int error = 0;
+
+	for (ssize_t i = 0; i < count; i++) {
+		void *const param = (char *)params + i * size;
+
+		// The last task is run from this thread while the others
+		// run, rather than waiting idle
+		submitted[i] = false;
+		if (i != count - 1) {
+			jobs[i] = csalt_executor_job_fn(task, param);
+			submitted[i] = !csalt_store_executor_submit(executor, &jobs[i]);
+		}
+
+		if (!submitted[i] && task(param))
+			error = -1;
+	}
+
+	for (ssize_t i = 0; i < count; i++)
+		if (submitted[i] && csalt_executor_job_wait(&jobs[i]))
+			error = -1;
+
+	return error;
+}
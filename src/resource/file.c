@@ -38,6 +38,7 @@ static const struct csalt_dynamic_store_interface store_impl = {
 		csalt_store_file_read,
 		csalt_store_file_write,
 		csalt_store_file_split,
+		csalt_store_file_fd,
 	},
 	csalt_store_file_size,
 	csalt_store_file_resize,
@@ -86,13 +87,23 @@ struct csalt_resource_file csalt_resource_file_open(const char *path, int flags)
 	return construct(path, 0, O_NONBLOCK | flags);
 }
 
+struct csalt_resource_file csalt_resource_file_descriptor(int fd)
+{
+	file_t file = construct(NULL, 0, 0);
+	file.store.fd = fd;
+	return file;
+}
+
 csalt_store *csalt_resource_file_init(csalt_resource *resource)
 {
 	file_t *file = (file_t *)resource;
-	file->store.fd = open(
-		file->path,
-		file->flags,
-		file->mode);
+
+	// Without a path, the file descriptor was handed over already
+	if (file->path)
+		file->store.fd = open(
+			file->path,
+			file->flags,
+			file->mode);
 
 	if (file->store.fd == -1)
 		return NULL;
@@ -168,6 +179,12 @@ int csalt_store_file_split(
 	return block((csalt_static_store *)&new_file, param);
 }
 
+int csalt_store_file_fd(csalt_static_store *store)
+{
+	file_store_t *file = (file_store_t *)store;
+	return file->fd;
+}
+
 ssize_t csalt_store_file_size(csalt_store *store)
 {
 	file_store_t *file = (file_store_t *)store;
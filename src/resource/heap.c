@@ -117,6 +117,7 @@ struct csalt_dynamic_store_interface heap_store_impl = {
 		csalt_store_heap_read,
 		csalt_store_heap_write,
 		csalt_store_heap_split,
+		NULL,
 	},
 	csalt_store_heap_size,
 	csalt_store_heap_resize,
@@ -8,6 +8,7 @@ static const struct csalt_dynamic_store_interface store_impl = {
 		csalt_store_lazy_read,
 		csalt_store_lazy_write,
 		csalt_store_lazy_split,
+		csalt_store_lazy_fd,
 	},
 	csalt_store_lazy_size,
 	csalt_store_lazy_resize,
@@ -103,6 +104,15 @@ int csalt_store_lazy_split(
 	return -1;
 }
 
+int csalt_store_lazy_fd(csalt_static_store *store)
+{
+	lazy_store_t *lazy = (lazy_store_t *)store;
+	csalt_static_store *initialized = (csalt_static_store *)init_if(lazy);
+	if (initialized)
+		return csalt_store_fd(initialized);
+	return -1;
+}
+
 ssize_t csalt_store_lazy_size(csalt_store *store)
 {
 	lazy_store_t *lazy = (lazy_store_t *)store;
@@ -1,6 +1,52 @@
 #include "csalt/resource/network.h"
 
-int csalt_resource_network_getaddrinfo(
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <csalt/platform/threads.h>
+
+typedef struct dns_entry entry_t;
+
+enum {
+	ENTRY_RESOLVING,
+	ENTRY_READY,
+};
+
+struct dns_entry {
+	char *node;
+	char *service;
+	bool has_hints;
+	struct addrinfo hints;
+
+	int state;
+	int error;
+	struct addrinfo *result;
+	long long expires;
+
+	// The entry is freed once it has been removed from the cache
+	// and nothing is using its result
+	size_t references;
+	bool removed;
+
+	entry_t *next;
+};
+
+static struct {
+	csalt_mutex lock;
+	csalt_cond resolved;
+	atomic_bool enabled;
+	struct csalt_network_dns_cache_options options;
+	entry_t *entries;
+	size_t count;
+	size_t background;
+} cache = {
+	.lock = CSALT_MUTEX_INITIALIZER,
+	.resolved = CSALT_COND_INITIALIZER,
+};
+
+static int resolve(
 	const char *node,
 	const char *service,
 	const struct addrinfo *hints,
@@ -23,3 +69,292 @@ int csalt_resource_network_getaddrinfo(
 	return callback_return;
 }
 
+static long long now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static bool string_equal(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a == b;
+	return !strcmp(a, b);
+}
+
+static bool entry_matches(
+	const entry_t *entry,
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+)
+{
+	if (!string_equal(entry->node, node) || !string_equal(entry->service, service))
+		return false;
+	if (!hints || !entry->has_hints)
+		return !hints && !entry->has_hints;
+	return entry->hints.ai_flags == hints->ai_flags
+		&& entry->hints.ai_family == hints->ai_family
+		&& entry->hints.ai_socktype == hints->ai_socktype
+		&& entry->hints.ai_protocol == hints->ai_protocol;
+}
+
+static void entry_free(entry_t *entry)
+{
+	if (entry->result)
+		freeaddrinfo(entry->result);
+	free(entry->node);
+	free(entry->service);
+	free(entry);
+}
+
+// All of the entry functions below must be called with the cache
+// locked
+
+static void entry_release(entry_t *entry)
+{
+	if (!--entry->references && entry->removed)
+		entry_free(entry);
+}
+
+static void entry_remove(entry_t *entry)
+{
+	for (entry_t **current = &cache.entries; *current; current = &(*current)->next) {
+		if (*current == entry) {
+			*current = entry->next;
+			cache.count--;
+			break;
+		}
+	}
+
+	entry->removed = true;
+	entry->references++;
+	entry_release(entry);
+}
+
+// Removes every expired result, and then the oldest entries until
+// there's room for one more, so names which are never looked up
+// again don't stay in the cache
+static void entry_make_room(void)
+{
+	const long long now = now_ms();
+	for (entry_t *current = cache.entries; current;) {
+		entry_t *const next = current->next;
+		if (current->state == ENTRY_READY && now >= current->expires)
+			entry_remove(current);
+		current = next;
+	}
+
+	if (!cache.options.max_entries)
+		return;
+
+	while (cache.count >= cache.options.max_entries) {
+		entry_t *oldest = cache.entries;
+		while (oldest->next)
+			oldest = oldest->next;
+		entry_remove(oldest);
+	}
+}
+
+static entry_t *entry_new(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+)
+{
+	entry_make_room();
+
+	entry_t *const entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return NULL;
+
+	entry->node = node? strdup(node): NULL;
+	entry->service = service? strdup(service): NULL;
+	if ((node && !entry->node) || (service && !entry->service)) {
+		entry_free(entry);
+		return NULL;
+	}
+
+	// Only the fields getaddrinfo reads from hints are kept
+	if (hints) {
+		entry->has_hints = true;
+		entry->hints = (struct addrinfo) {
+			.ai_flags = hints->ai_flags,
+			.ai_family = hints->ai_family,
+			.ai_socktype = hints->ai_socktype,
+			.ai_protocol = hints->ai_protocol,
+		};
+	}
+
+	entry->state = ENTRY_RESOLVING;
+	entry->next = cache.entries;
+	cache.entries = entry;
+	cache.count++;
+	return entry;
+}
+
+static bool cacheable(int error)
+{
+	return error != EAI_AGAIN && error != EAI_MEMORY && error != EAI_SYSTEM;
+}
+
+// Calls getaddrinfo without the lock held, then publishes the
+// result to any waiting threads
+static void entry_resolve(entry_t *entry)
+{
+	csalt_mutex_unlock(&cache.lock);
+	struct addrinfo *result = NULL;
+	const int error = getaddrinfo(
+		entry->node,
+		entry->service,
+		entry->has_hints? &entry->hints: NULL,
+		&result);
+	csalt_mutex_lock(&cache.lock);
+
+	entry->state = ENTRY_READY;
+	entry->error = error;
+	entry->result = error? NULL: result;
+	entry->expires = now_ms() + (error?
+		cache.options.negative_ttl:
+		cache.options.ttl);
+
+	// A temporary failure is passed to anyone already waiting, but
+	// the next lookup tries again
+	if (!entry->removed && error && !cacheable(error))
+		entry_remove(entry);
+
+	csalt_cond_broadcast(&cache.resolved);
+}
+
+static void *resolve_background(void *param)
+{
+	entry_t *const entry = param;
+	csalt_mutex_lock(&cache.lock);
+	entry_resolve(entry);
+	entry_release(entry);
+	cache.background--;
+	csalt_cond_broadcast(&cache.resolved);
+	csalt_mutex_unlock(&cache.lock);
+	return NULL;
+}
+
+static int start_background(entry_t *entry)
+{
+	csalt_thread thread;
+	entry->references++;
+	cache.background++;
+	if (csalt_thread_create(&thread, resolve_background, entry)) {
+		cache.background--;
+		entry_remove(entry);
+		entry_release(entry);
+		return EAI_SYSTEM;
+	}
+	csalt_thread_detach(thread);
+	return EAI_AGAIN;
+}
+
+static int resolve_cached(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	int (*callback)(const struct addrinfo *result, void *param),
+	void *param
+)
+{
+	entry_t *entry = NULL;
+	for (entry_t *current = cache.entries; current; current = current->next) {
+		if (entry_matches(current, node, service, hints)) {
+			entry = current;
+			break;
+		}
+	}
+
+	if (entry && entry->state == ENTRY_READY && now_ms() >= entry->expires) {
+		entry_remove(entry);
+		entry = NULL;
+	}
+
+	if (!entry) {
+		entry = entry_new(node, service, hints);
+		if (!entry)
+			return EAI_MEMORY;
+		if (cache.options.background)
+			return start_background(entry);
+
+		entry->references++;
+		entry_resolve(entry);
+	} else if (entry->state == ENTRY_RESOLVING) {
+		if (cache.options.background)
+			return EAI_AGAIN;
+
+		entry->references++;
+		while (entry->state == ENTRY_RESOLVING)
+			csalt_cond_wait(&cache.resolved, &cache.lock);
+	} else {
+		entry->references++;
+	}
+
+	const int error = entry->error;
+	const struct addrinfo *const result = entry->result;
+
+	// The reference keeps the result alive while the callback uses
+	// it, even if the entry expires or the cache is disabled
+	int callback_return = error;
+	if (!error) {
+		csalt_mutex_unlock(&cache.lock);
+		callback_return = callback(result, param);
+		csalt_mutex_lock(&cache.lock);
+	}
+
+	entry_release(entry);
+	return callback_return;
+}
+
+int csalt_resource_network_getaddrinfo(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	int (*callback)(const struct addrinfo *result, void *param),
+	void *param
+)
+{
+	// Lookups don't touch the lock at all while the cache is off
+	if (!atomic_load(&cache.enabled))
+		return resolve(node, service, hints, callback, param);
+
+	csalt_mutex_lock(&cache.lock);
+	if (!atomic_load(&cache.enabled)) {
+		csalt_mutex_unlock(&cache.lock);
+		return resolve(node, service, hints, callback, param);
+	}
+
+	const int result = resolve_cached(node, service, hints, callback, param);
+	csalt_mutex_unlock(&cache.lock);
+	return result;
+}
+
+int csalt_resource_network_dns_cache_enable(
+	const struct csalt_network_dns_cache_options *options
+)
+{
+	if (!options || options->ttl < 0 || options->negative_ttl < 0)
+		return -1;
+
+	csalt_mutex_lock(&cache.lock);
+	cache.options = *options;
+	atomic_store(&cache.enabled, true);
+	csalt_mutex_unlock(&cache.lock);
+	return 0;
+}
+
+void csalt_resource_network_dns_cache_disable(void)
+{
+	csalt_mutex_lock(&cache.lock);
+	atomic_store(&cache.enabled, false);
+	while (cache.background)
+		csalt_cond_wait(&cache.resolved, &cache.lock);
+	while (cache.entries)
+		entry_remove(cache.entries);
+	csalt_mutex_unlock(&cache.lock);
+}
@@ -0,0 +1,261 @@
+#include "csalt/resource/network/buffered.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+
+typedef struct csalt_resource_network_buffered buffered_t;
+typedef struct csalt_store_network_buffered store_t;
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_network_buffered_init,
+	csalt_resource_network_buffered_deinit,
+};
+
+static const struct csalt_static_store_interface store_impl = {
+	csalt_store_network_buffered_read,
+	csalt_store_network_buffered_write,
+	csalt_store_network_buffered_split,
+	csalt_store_network_client_fd,
+};
+
+struct csalt_resource_network_buffered csalt_resource_network_buffered(
+	csalt_static_resource *resource,
+	ssize_t read_size,
+	ssize_t write_size,
+	struct csalt_network_buffered_options options
+)
+{
+	return (buffered_t) {
+		&impl,
+		resource,
+		read_size,
+		write_size,
+		options,
+
+		{
+			.parent = {
+				.vtable = &store_impl,
+				.fd = -1,
+			},
+		},
+	};
+}
+
+static void set_option(int fd, int option, int value)
+{
+	// Fails harmlessly on sockets which aren't TCP
+	setsockopt(fd, IPPROTO_TCP, option, &value, sizeof(value));
+}
+
+csalt_static_store *csalt_resource_network_buffered_init(
+	csalt_static_resource *resource
+)
+{
+	buffered_t *const buffered = (buffered_t *)resource;
+	store_t *const store = &buffered->result;
+
+	if (buffered->read_size < 1 || buffered->write_size < 1)
+		return NULL;
+
+	// Both buffers share one allocation
+	char *const buffers = malloc(
+		(size_t)buffered->read_size + (size_t)buffered->write_size);
+	if (!buffers)
+		return NULL;
+
+	const struct csalt_store_network_client *const socket
+		= (void *)csalt_resource_init((csalt_resource *)buffered->resource);
+	if (!socket) {
+		free(buffers);
+		return NULL;
+	}
+
+	*store = (store_t) {
+		.parent = {
+			.vtable = &store_impl,
+			.fd = socket->fd,
+		},
+		.cork = buffered->options.cork,
+		.read_buffer = buffers,
+		.read_size = buffered->read_size,
+		.write_buffer = buffers + buffered->read_size,
+		.write_size = buffered->write_size,
+	};
+
+	if (buffered->options.nodelay)
+		set_option(store->parent.fd, TCP_NODELAY, 1);
+	if (store->cork)
+		set_option(store->parent.fd, TCP_CORK, 1);
+
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_network_buffered_deinit(csalt_resource *resource)
+{
+	buffered_t *const buffered = (buffered_t *)resource;
+	store_t *const store = &buffered->result;
+
+	for (;;) {
+		const ssize_t remaining = csalt_store_network_buffered_flush(store);
+		if (remaining <= 0)
+			break;
+
+		struct pollfd writable = {
+			.fd = store->parent.fd,
+			.events = POLLOUT,
+		};
+		if (poll(&writable, 1, -1) == -1 && errno != EINTR)
+			break;
+	}
+
+	if (store->cork)
+		set_option(store->parent.fd, TCP_CORK, 0);
+
+	free(store->read_buffer);
+	store->read_buffer = store->write_buffer = NULL;
+	csalt_resource_deinit((csalt_resource *)buffered->resource);
+	store->parent.fd = -1;
+}
+
+static bool would_block(void)
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+static void consume_written(store_t *store, ssize_t amount)
+{
+	store->write_length -= amount;
+	memmove(
+		store->write_buffer,
+		store->write_buffer + amount,
+		(size_t)store->write_length);
+}
+
+ssize_t csalt_store_network_buffered_flush(store_t *store)
+{
+	while (store->write_length) {
+		const ssize_t written = write(
+			store->parent.fd,
+			store->write_buffer,
+			(size_t)store->write_length);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			if (would_block())
+				break;
+			return -1;
+		}
+		consume_written(store, written);
+	}
+
+	// Toggling the cork pushes out a partial packet straight away
+	if (store->cork && !store->write_length) {
+		set_option(store->parent.fd, TCP_CORK, 0);
+		set_option(store->parent.fd, TCP_CORK, 1);
+	}
+
+	return store->write_length;
+}
+
+ssize_t csalt_store_network_buffered_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	store_t *const buffered = (store_t *)store;
+
+	if (buffered->read_begin == buffered->read_end) {
+		if (csalt_store_network_buffered_flush(buffered) < 0)
+			return -1;
+
+		if (size >= buffered->read_size)
+			return read(buffered->parent.fd, buffer, (size_t)size);
+
+		const ssize_t amount = read(
+			buffered->parent.fd,
+			buffered->read_buffer,
+			(size_t)buffered->read_size);
+		if (amount <= 0)
+			return amount;
+
+		buffered->read_begin = 0;
+		buffered->read_end = amount;
+	}
+
+	const ssize_t amount = csalt_min(
+		size,
+		buffered->read_end - buffered->read_begin);
+	memcpy(buffer, buffered->read_buffer + buffered->read_begin, (size_t)amount);
+	buffered->read_begin += amount;
+	return amount;
+}
+
+ssize_t csalt_store_network_buffered_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	store_t *const buffered = (store_t *)store;
+	const ssize_t space = buffered->write_size - buffered->write_length;
+
+	if (size < space) {
+		memcpy(buffered->write_buffer + buffered->write_length, buffer, (size_t)size);
+		buffered->write_length += size;
+		return size;
+	}
+
+	// Send what's buffered and the new data in one call, rather
+	// than copying the new data through the buffer
+	struct iovec vectors[] = {
+		{ buffered->write_buffer, (size_t)buffered->write_length },
+		{ (void *)buffer, (size_t)size },
+	};
+
+	ssize_t written;
+	do {
+		written = writev(buffered->parent.fd, vectors, 2);
+	} while (written < 0 && errno == EINTR);
+
+	if (written < 0 && !would_block())
+		return -1;
+	if (written < 0)
+		written = 0;
+
+	const ssize_t from_buffer = csalt_min(written, buffered->write_length);
+	consume_written(buffered, from_buffer);
+	const ssize_t from_data = written - from_buffer;
+
+	// Keep whatever didn't get sent, as far as it fits
+	const ssize_t buffered_amount = csalt_min(
+		size - from_data,
+		buffered->write_size - buffered->write_length);
+	memcpy(
+		buffered->write_buffer + buffered->write_length,
+		(const char *)buffer + from_data,
+		(size_t)buffered_amount);
+	buffered->write_length += buffered_amount;
+
+	return from_data + buffered_amount;
+}
+
+int csalt_store_network_buffered_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
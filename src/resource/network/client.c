@@ -1,6 +1,15 @@
+// SOCK_NONBLOCK and SOCK_CLOEXEC are GNU extensions
+#define _GNU_SOURCE
+
 #include "csalt/resource/network/client.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include "csalt/resource/network.h" // getaddrinfo interface
 
@@ -16,19 +25,36 @@ static const struct csalt_static_store_interface store_impl = {
 	csalt_store_network_client_read,
 	csalt_store_network_client_write,
 	csalt_store_network_client_split,
+	csalt_store_network_client_fd,
 };
 
-struct csalt_resource_network_client csalt_resource_network_client(
+static const struct addrinfo default_hints = {
+	.ai_family = AF_UNSPEC,
+	.ai_socktype = SOCK_STREAM,
+};
+
+struct csalt_network_client_options csalt_network_client_options(void)
+{
+	return (struct csalt_network_client_options) {
+		.attempt_delay = 250,
+		.timeout = -1,
+		.fast_open = false,
+	};
+}
+
+struct csalt_resource_network_client csalt_resource_network_client_options(
 	const char *node,
 	const char *service,
-	const struct addrinfo *hints
+	const struct addrinfo *hints,
+	struct csalt_network_client_options options
 )
 {
 	return (network_t) {
 		&impl,
 		node,
 		service,
-		hints,
+		hints? hints: &default_hints,
+		options,
 
 		{
 			.vtable = &store_impl,
@@ -36,28 +62,212 @@ struct csalt_resource_network_client csalt_resource_network_client(
 	};
 }
 
-static int init_store(const struct addrinfo *result, void *param)
+struct csalt_resource_network_client csalt_resource_network_client(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+)
+{
+	return csalt_resource_network_client_options(
+		node,
+		service,
+		hints,
+		csalt_network_client_options());
+}
+
+static long long now_ms(void)
 {
-	store_t *store = param;
-	int socket_fd = -1;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
-	for (; result; result = result->ai_next) {
-		socket_fd = socket(
-			result->ai_family,
-			result->ai_socktype,
-			result->ai_protocol);
-		if (socket_fd == -1)
+/*
+ * Orders the addresses so the families alternate, starting with
+ * the family getaddrinfo preferred, so that a broken family only
+ * delays every other attempt. Only addresses with the same socket
+ * type and protocol as the first are kept, since a datagram socket
+ * "connects" straight away and would always win the race. Returns
+ * the number of addresses kept.
+ */
+static size_t interleave(
+	const struct addrinfo *result,
+	const struct addrinfo **out,
+	size_t count
+)
+{
+	const struct addrinfo *preferred[count], *others[count];
+	size_t preferred_count = 0, others_count = 0;
+
+	for (const struct addrinfo *current = result; current; current = current->ai_next) {
+		if (
+			current->ai_socktype != result->ai_socktype ||
+			current->ai_protocol != result->ai_protocol
+		)
 			continue;
+		if (current->ai_family == result->ai_family)
+			preferred[preferred_count++] = current;
+		else
+			others[others_count++] = current;
+	}
 
-		if (connect(socket_fd, result->ai_addr, result->ai_addrlen) != -1)
+	count = preferred_count + others_count;
+	size_t p = 0, o = 0;
+	for (size_t i = 0; i < count; i++) {
+		const bool take_preferred = p < preferred_count
+			&& (o >= others_count || i % 2 == 0);
+		out[i] = take_preferred? preferred[p++]: others[o++];
+	}
+	return count;
+}
+
+static void fast_open(int socket_fd)
+{
+#ifdef TCP_FASTOPEN_CONNECT
+	const int enable = 1;
+	setsockopt(
+		socket_fd,
+		IPPROTO_TCP,
+		TCP_FASTOPEN_CONNECT,
+		&enable,
+		sizeof(enable));
+#else
+	(void)socket_fd;
+#endif
+}
+
+// Returns the connected socket, -1 if the attempt failed straight
+// away, or -2 with *pending set if the attempt is in progress
+static int attempt(
+	const struct addrinfo *address,
+	const struct csalt_network_client_options *options,
+	int *pending
+)
+{
+	const int socket_fd = socket(
+		address->ai_family,
+		address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		address->ai_protocol);
+	if (socket_fd == -1)
+		return -1;
+
+	if (options->fast_open && address->ai_protocol != IPPROTO_UDP)
+		fast_open(socket_fd);
+
+	if (connect(socket_fd, address->ai_addr, address->ai_addrlen) != -1)
+		return socket_fd;
+
+	if (errno == EINPROGRESS) {
+		*pending = socket_fd;
+		return -2;
+	}
+
+	close(socket_fd);
+	return -1;
+}
+
+static int connected(int socket_fd)
+{
+	int error = 0;
+	socklen_t length = sizeof(error);
+	if (getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &error, &length))
+		return 0;
+	return !error;
+}
+
+static int race(
+	const struct addrinfo **addresses,
+	size_t count,
+	const struct csalt_network_client_options *options
+)
+{
+	struct pollfd pending[count];
+	nfds_t pending_count = 0;
+	int winner = -1;
+
+	const long long deadline = options->timeout < 0?
+		-1:
+		now_ms() + options->timeout;
+	long long next_attempt = 0;
+	size_t next = 0;
+
+	while (winner == -1 && (next < count || pending_count)) {
+		const long long now = now_ms();
+		if (deadline >= 0 && now >= deadline)
 			break;
 
-		close(socket_fd);
+		if (next < count && (!pending_count || now >= next_attempt)) {
+			int socket_fd = -1;
+			winner = attempt(addresses[next++], options, &socket_fd);
+			if (winner == -2) {
+				winner = -1;
+				pending[pending_count++] = (struct pollfd) {
+					.fd = socket_fd,
+					.events = POLLOUT,
+				};
+				next_attempt = now + options->attempt_delay;
+			}
+			continue;
+		}
+
+		long long wait = -1;
+		if (next < count)
+			wait = next_attempt - now;
+		if (deadline >= 0 && (wait < 0 || deadline - now < wait))
+			wait = deadline - now;
+
+		if (poll(pending, pending_count, (int)wait) == -1 && errno != EINTR)
+			break;
+
+		for (nfds_t i = 0; i < pending_count && winner == -1;) {
+			if (!pending[i].revents) {
+				i++;
+				continue;
+			}
+
+			const int socket_fd = pending[i].fd;
+			pending[i] = pending[--pending_count];
+			if (connected(socket_fd)) {
+				winner = socket_fd;
+			} else {
+				close(socket_fd);
+				// Don't wait out the delay for a failed attempt
+				next_attempt = now;
+			}
+		}
 	}
 
-	if (result == NULL)
+	for (nfds_t i = 0; i < pending_count; i++)
+		close(pending[i].fd);
+
+	return winner;
+}
+
+static int init_store(const struct addrinfo *result, void *param)
+{
+	network_t *network = param;
+	store_t *store = &network->result;
+
+	size_t count = 0;
+	for (const struct addrinfo *current = result; current; current = current->ai_next)
+		count++;
+
+	if (!count)
 		return -1;
 
+	const struct addrinfo *addresses[count];
+	count = interleave(result, addresses, count);
+
+	const int socket_fd = race(addresses, count, &network->options);
+	if (socket_fd == -1)
+		return -1;
+
+	// Connecting is the only part done without blocking; the
+	// socket is handed over in the usual blocking mode
+	const int flags = fcntl(socket_fd, F_GETFL);
+	if (flags != -1)
+		fcntl(socket_fd, F_SETFL, flags & ~O_NONBLOCK);
+
 	store->fd = socket_fd;
 	return 0;
 }
@@ -73,7 +283,7 @@ csalt_static_store *csalt_resource_network_client_init(
 		network->service,
 		network->hints,
 		init_store,
-		&network->result);
+		network);
 
 	if (error)
 		return NULL;
@@ -122,3 +332,9 @@ int csalt_store_network_client_split(
 }
 
 
+
+int csalt_store_network_client_fd(csalt_static_store *store)
+{
+	store_t *network = (store_t *)store;
+	return network->fd;
+}
@@ -0,0 +1,395 @@
+#include "csalt/resource/network/client_pool.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct csalt_resource_network_client_pool pool_t;
+typedef struct csalt_store_network_client_pool pool_store_t;
+typedef struct csalt_resource_network_pooled_client pooled_t;
+typedef struct csalt_store_network_pooled_client pooled_store_t;
+typedef struct csalt_network_client_pool_key pool_key_t;
+
+struct idle_connection {
+	int fd;
+	long long since;
+};
+
+struct csalt_network_client_pool_key {
+	char *node;
+	char *service;
+	bool has_hints;
+	struct addrinfo hints;
+
+	// Connections in use count towards the limit, but only idle
+	// ones are kept here
+	ssize_t open;
+	ssize_t idle_count;
+	struct idle_connection *idle;
+
+	pool_key_t *next;
+};
+
+static const struct csalt_static_resource_interface pool_impl = {
+	csalt_resource_network_client_pool_init,
+	csalt_resource_network_client_pool_deinit,
+};
+
+static const struct csalt_static_store_interface pool_store_impl = {
+	csalt_store_network_client_pool_read,
+	csalt_store_network_client_pool_write,
+	csalt_store_network_client_pool_split,
+	NULL,
+};
+
+static const struct csalt_static_resource_interface pooled_impl = {
+	csalt_resource_network_pooled_client_init,
+	csalt_resource_network_pooled_client_deinit,
+};
+
+static const struct csalt_static_store_interface pooled_store_impl = {
+	csalt_store_network_client_read,
+	csalt_store_network_client_write,
+	csalt_store_network_client_split,
+	csalt_store_network_client_fd,
+};
+
+static long long now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+struct csalt_resource_network_client_pool csalt_resource_network_client_pool(
+	ssize_t max_per_key,
+	int idle_timeout
+)
+{
+	return (pool_t) {
+		&pool_impl,
+		max_per_key,
+		idle_timeout,
+
+		{
+			.vtable = &pool_store_impl,
+		},
+	};
+}
+
+csalt_static_store *csalt_resource_network_client_pool_init(
+	csalt_static_resource *resource
+)
+{
+	pool_t *const pool = (pool_t *)resource;
+	pool_store_t *const store = &pool->result;
+
+	if (pool->max_per_key < 1)
+		return NULL;
+
+	store->max_per_key = pool->max_per_key;
+	store->idle_timeout = pool->idle_timeout;
+	store->keys = NULL;
+	if (csalt_mutex_init(&store->lock, NULL))
+		return NULL;
+
+	return (csalt_static_store *)store;
+}
+
+static void key_free(pool_key_t *key)
+{
+	for (ssize_t i = 0; i < key->idle_count; i++)
+		close(key->idle[i].fd);
+	free(key->idle);
+	free(key->node);
+	free(key->service);
+	free(key);
+}
+
+void csalt_resource_network_client_pool_deinit(csalt_resource *resource)
+{
+	pool_t *const pool = (pool_t *)resource;
+	pool_store_t *const store = &pool->result;
+
+	while (store->keys) {
+		pool_key_t *const next = store->keys->next;
+		key_free(store->keys);
+		store->keys = next;
+	}
+	csalt_mutex_deinit(&store->lock);
+}
+
+static bool string_equal(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a == b;
+	return !strcmp(a, b);
+}
+
+static bool key_matches(
+	const pool_key_t *key,
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+)
+{
+	if (!string_equal(key->node, node) || !string_equal(key->service, service))
+		return false;
+	if (!hints || !key->has_hints)
+		return !hints && !key->has_hints;
+	return key->hints.ai_flags == hints->ai_flags
+		&& key->hints.ai_family == hints->ai_family
+		&& key->hints.ai_socktype == hints->ai_socktype
+		&& key->hints.ai_protocol == hints->ai_protocol;
+}
+
+static char *string_copy(const char *string, bool *failed)
+{
+	if (!string)
+		return NULL;
+	char *const result = strdup(string);
+	*failed = *failed || !result;
+	return result;
+}
+
+// Must be called with the pool locked
+static pool_key_t *key_find(
+	pool_store_t *pool,
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+)
+{
+	for (pool_key_t *key = pool->keys; key; key = key->next)
+		if (key_matches(key, node, service, hints))
+			return key;
+
+	pool_key_t *const key = calloc(1, sizeof(*key));
+	if (!key)
+		return NULL;
+
+	bool failed = false;
+	key->node = string_copy(node, &failed);
+	key->service = string_copy(service, &failed);
+	key->idle = calloc((size_t)pool->max_per_key, sizeof(*key->idle));
+	if (failed || !key->idle) {
+		key_free(key);
+		return NULL;
+	}
+
+	// Only the fields getaddrinfo reads from hints are kept
+	if (hints) {
+		key->has_hints = true;
+		key->hints = (struct addrinfo) {
+			.ai_flags = hints->ai_flags,
+			.ai_family = hints->ai_family,
+			.ai_socktype = hints->ai_socktype,
+			.ai_protocol = hints->ai_protocol,
+		};
+	}
+
+	key->next = pool->keys;
+	pool->keys = key;
+	return key;
+}
+
+// A healthy idle connection has nothing to read: end-of-file means
+// the peer closed it, and data means it has been left mid-response
+static bool alive(int fd)
+{
+	char byte;
+	const ssize_t result = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+	return result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static bool expired(const pool_store_t *pool, const struct idle_connection *idle, long long now)
+{
+	return now - idle->since > pool->idle_timeout;
+}
+
+// Must be called with the pool locked
+static ssize_t key_prune(pool_store_t *pool, pool_key_t *key, long long now)
+{
+	ssize_t closed = 0;
+	for (ssize_t i = 0; i < key->idle_count;) {
+		if (expired(pool, &key->idle[i], now)) {
+			close(key->idle[i].fd);
+			key->idle[i] = key->idle[--key->idle_count];
+			key->open--;
+			closed++;
+		} else {
+			i++;
+		}
+	}
+	return closed;
+}
+
+ssize_t csalt_store_network_client_pool_prune(pool_store_t *pool)
+{
+	const long long now = now_ms();
+	ssize_t closed = 0;
+
+	csalt_mutex_lock(&pool->lock);
+	for (pool_key_t *key = pool->keys; key; key = key->next)
+		closed += key_prune(pool, key, now);
+	csalt_mutex_unlock(&pool->lock);
+
+	return closed;
+}
+
+ssize_t csalt_store_network_client_pool_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+ssize_t csalt_store_network_client_pool_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+int csalt_store_network_client_pool_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
+
+struct csalt_resource_network_pooled_client csalt_resource_network_pooled_client(
+	pool_store_t *pool,
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+)
+{
+	return (pooled_t) {
+		&pooled_impl,
+		pool,
+		csalt_resource_network_client(node, service, hints),
+		NULL,
+
+		{
+			.parent = {
+				.vtable = &pooled_store_impl,
+				.fd = -1,
+			},
+		},
+	};
+}
+
+// Takes the most recently used healthy connection, since it's the
+// least likely to have been closed by the peer. Must be called with
+// the pool locked.
+static int checkout_idle(pool_store_t *pool, pool_key_t *key)
+{
+	key_prune(pool, key, now_ms());
+
+	while (key->idle_count) {
+		const int fd = key->idle[--key->idle_count].fd;
+		if (alive(fd))
+			return fd;
+		close(fd);
+		key->open--;
+	}
+	return -1;
+}
+
+csalt_static_store *csalt_resource_network_pooled_client_init(
+	csalt_static_resource *resource
+)
+{
+	pooled_t *const pooled = (pooled_t *)resource;
+	pool_store_t *const pool = pooled->pool;
+	struct csalt_resource_network_client *const client = &pooled->client;
+
+	csalt_mutex_lock(&pool->lock);
+	pool_key_t *const key = key_find(
+		pool,
+		client->node,
+		client->service,
+		client->hints);
+	if (!key) {
+		csalt_mutex_unlock(&pool->lock);
+		return NULL;
+	}
+
+	int fd = checkout_idle(pool, key);
+
+	// Reserve a place for the new connection before connecting
+	// without the lock, so the limit can't be overshot
+	const bool connect_new = fd == -1 && key->open < pool->max_per_key;
+	if (connect_new)
+		key->open++;
+	csalt_mutex_unlock(&pool->lock);
+
+	if (connect_new) {
+		csalt_static_store *const connected
+			= csalt_resource_network_client_init(
+				(csalt_static_resource *)client);
+
+		if (connected) {
+			fd = client->result.fd;
+		} else {
+			csalt_mutex_lock(&pool->lock);
+			key->open--;
+			csalt_mutex_unlock(&pool->lock);
+		}
+	}
+
+	if (fd == -1)
+		return NULL;
+
+	pooled->key = key;
+	pooled->result.parent.fd = fd;
+	pooled->result.discard = false;
+	return (csalt_static_store *)&pooled->result;
+}
+
+void csalt_resource_network_pooled_client_deinit(csalt_resource *resource)
+{
+	pooled_t *const pooled = (pooled_t *)resource;
+	pool_store_t *const pool = pooled->pool;
+	pool_key_t *const key = pooled->key;
+	const int fd = pooled->result.parent.fd;
+
+	csalt_mutex_lock(&pool->lock);
+	if (pooled->result.discard) {
+		close(fd);
+		key->open--;
+	} else {
+		key->idle[key->idle_count++] = (struct idle_connection) {
+			fd,
+			now_ms(),
+		};
+	}
+	csalt_mutex_unlock(&pool->lock);
+
+	pooled->key = NULL;
+	pooled->result.parent.fd = -1;
+}
+
+void csalt_store_network_pooled_client_discard(pooled_store_t *client)
+{
+	client->discard = true;
+}
@@ -0,0 +1,350 @@
+// accept4() is a GNU extension
+#define _GNU_SOURCE
+
+#include "csalt/resource/network/server.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "csalt/resource/network.h" // getaddrinfo interface
+
+typedef struct csalt_resource_network_server network_t;
+typedef struct csalt_store_network_server store_t;
+typedef struct csalt_store_network_server_client client_t;
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_network_server_init,
+	csalt_resource_network_server_deinit,
+};
+
+static const struct csalt_static_store_interface store_impl = {
+	csalt_store_network_server_read,
+	csalt_store_network_server_write,
+	csalt_store_network_server_split,
+	NULL,
+};
+
+static const struct csalt_static_store_interface client_impl = {
+	csalt_store_network_client_read,
+	csalt_store_network_client_write,
+	csalt_store_network_client_split,
+	csalt_store_network_client_fd,
+};
+
+static const struct addrinfo default_hints = {
+	.ai_flags = AI_PASSIVE,
+	.ai_family = AF_UNSPEC,
+	.ai_socktype = SOCK_STREAM,
+};
+
+struct csalt_resource_network_server csalt_resource_network_server(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints
+)
+{
+	return (network_t) {
+		&impl,
+		node,
+		service,
+		hints? hints: &default_hints,
+		SOMAXCONN,
+		false,
+
+		{
+			.vtable = &store_impl,
+			.fd = -1,
+			.epoll_fd = -1,
+		},
+	};
+}
+
+static int init_store(const struct addrinfo *result, void *param)
+{
+	network_t *network = param;
+	int socket_fd = -1;
+
+	for (; result; result = result->ai_next) {
+		socket_fd = socket(
+			result->ai_family,
+			result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			result->ai_protocol);
+		if (socket_fd == -1)
+			continue;
+
+		const int enable = 1;
+		setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+		if (
+			network->reuse_port &&
+			setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable))
+		) {
+			close(socket_fd);
+			continue;
+		}
+
+		if (
+			bind(socket_fd, result->ai_addr, result->ai_addrlen) != -1 &&
+			listen(socket_fd, network->backlog) != -1
+		)
+			break;
+
+		close(socket_fd);
+	}
+
+	if (result == NULL)
+		return -1;
+
+	network->result.fd = socket_fd;
+	return 0;
+}
+
+csalt_static_store *csalt_resource_network_server_init(
+	csalt_static_resource *resource
+)
+{
+	network_t *network = (network_t *)resource;
+
+	const int error = csalt_resource_network_getaddrinfo(
+		network->node,
+		network->service,
+		network->hints,
+		init_store,
+		network);
+
+	if (error)
+		return NULL;
+
+	return csalt_store_network_server_open(&network->result, network->result.fd);
+}
+
+csalt_static_store *csalt_store_network_server_open(store_t *store, int fd)
+{
+	store->vtable = &store_impl;
+	store->fd = fd;
+	store->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	// The listening socket is the only entry without a client
+	struct epoll_event event = {
+		.events = EPOLLIN,
+		.data.ptr = NULL,
+	};
+
+	if (
+		store->epoll_fd == -1 ||
+		epoll_ctl(store->epoll_fd, EPOLL_CTL_ADD, store->fd, &event)
+	) {
+		if (store->epoll_fd != -1)
+			close(store->epoll_fd);
+		close(store->fd);
+		store->epoll_fd = -1;
+		store->fd = -1;
+		return NULL;
+	}
+
+	store->client_count = 0;
+	store->clients = NULL;
+	store->accept_resume = 0;
+	return (csalt_static_store *)store;
+}
+
+static long long now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Stops or starts waking for new connections; the listening socket
+// stays in the epoll set either way, just without any events
+static void listen_events(store_t *server, uint32_t events)
+{
+	struct epoll_event event = {
+		.events = events,
+		.data.ptr = NULL,
+	};
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, server->fd, &event);
+}
+
+static void accept_pause(store_t *server)
+{
+	listen_events(server, 0);
+	server->accept_resume = now_ms() + CSALT_NETWORK_SERVER_ACCEPT_BACKOFF;
+}
+
+static void accept_resume(store_t *server)
+{
+	if (!server->accept_resume)
+		return;
+	listen_events(server, EPOLLIN);
+	server->accept_resume = 0;
+}
+
+static void client_close(store_t *server, client_t *client)
+{
+	if (client->previous)
+		client->previous->next = client->next;
+	else
+		server->clients = client->next;
+	if (client->next)
+		client->next->previous = client->previous;
+
+	// Closing the socket also removes it from the epoll set
+	close(client->parent.fd);
+	free(client);
+	server->client_count--;
+
+	// The descriptor just freed may be enough to accept another
+	accept_resume(server);
+}
+
+void csalt_resource_network_server_deinit(csalt_resource *resource)
+{
+	network_t *network = (network_t *)resource;
+	csalt_store_network_server_close(&network->result);
+}
+
+void csalt_store_network_server_close(store_t *store)
+{
+	while (store->clients)
+		client_close(store, store->clients);
+
+	close(store->epoll_fd);
+	close(store->fd);
+	store->epoll_fd = -1;
+	store->fd = -1;
+}
+
+static void accept_clients(store_t *server)
+{
+	for (;;) {
+		const int fd = accept4(
+			server->fd,
+			NULL,
+			NULL,
+			SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		// The connection stays queued, so the level-triggered
+		// listener would wake every poll until there's room for it
+		if (fd == -1 && (
+			errno == EMFILE ||
+			errno == ENFILE ||
+			errno == ENOBUFS ||
+			errno == ENOMEM
+		))
+			accept_pause(server);
+		if (fd == -1)
+			return;
+
+		client_t *client = malloc(sizeof(*client));
+		if (!client) {
+			close(fd);
+			continue;
+		}
+
+		*client = (client_t) {
+			.parent = {
+				.vtable = &client_impl,
+				.fd = fd,
+			},
+			.data = NULL,
+			.previous = NULL,
+			.next = server->clients,
+		};
+
+		struct epoll_event event = {
+			.events = EPOLLIN | EPOLLRDHUP,
+			.data.ptr = client,
+		};
+		if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+			close(fd);
+			free(client);
+			continue;
+		}
+
+		if (server->clients)
+			server->clients->previous = client;
+		server->clients = client;
+		server->client_count++;
+	}
+}
+
+int csalt_store_network_server_poll(
+	store_t *server,
+	int timeout,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	struct epoll_event events[CSALT_NETWORK_SERVER_EVENTS];
+
+	if (server->accept_resume) {
+		const long long remaining = server->accept_resume - now_ms();
+		if (remaining <= 0)
+			accept_resume(server);
+		else if (timeout < 0 || timeout > remaining)
+			timeout = (int)remaining;
+	}
+
+	const int count = epoll_wait(
+		server->epoll_fd,
+		events,
+		CSALT_NETWORK_SERVER_EVENTS,
+		timeout);
+
+	if (count == -1)
+		return errno == EINTR? 0: -1;
+
+	for (int i = 0; i < count; i++) {
+		client_t *const client = events[i].data.ptr;
+		if (!client) {
+			accept_clients(server);
+			continue;
+		}
+
+		if (block((csalt_static_store *)client, param) <= 0)
+			client_close(server, client);
+	}
+
+	return count;
+}
+
+ssize_t csalt_store_network_server_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+ssize_t csalt_store_network_server_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+int csalt_store_network_server_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
@@ -0,0 +1,269 @@
+// pthread_setaffinity_np() and the CPU_* macros are GNU extensions
+#define _GNU_SOURCE
+
+#include "csalt/resource/network/server_pool.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <csalt/platform/threads.h>
+
+typedef struct csalt_resource_network_server_pool pool_t;
+typedef struct csalt_store_network_server_pool store_t;
+typedef struct csalt_network_server_worker worker_t;
+
+struct csalt_network_server_worker {
+	struct csalt_resource_network_server server;
+	csalt_thread thread;
+	store_t *pool;
+	ssize_t index;
+	bool pin;
+	csalt_static_store_block_fn *block;
+	void *param;
+	int result;
+};
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_network_server_pool_init,
+	csalt_resource_network_server_pool_deinit,
+};
+
+static const struct csalt_static_store_interface store_impl = {
+	csalt_store_network_server_pool_read,
+	csalt_store_network_server_pool_write,
+	csalt_store_network_server_pool_split,
+	NULL,
+};
+
+static const struct addrinfo default_hints = {
+	.ai_flags = AI_PASSIVE,
+	.ai_family = AF_UNSPEC,
+	.ai_socktype = SOCK_STREAM,
+};
+
+struct csalt_resource_network_server_pool csalt_resource_network_server_pool(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	ssize_t threads,
+	bool pin
+)
+{
+	return (pool_t) {
+		&impl,
+		node,
+		service,
+		hints? hints: &default_hints,
+		threads,
+		pin,
+
+		{
+			.vtable = &store_impl,
+		},
+	};
+}
+
+static void deinit_servers(store_t *store, ssize_t count)
+{
+	for (ssize_t i = 0; i < count; i++)
+		csalt_resource_deinit(csalt_resource(&store->workers[i].server));
+	free(store->workers);
+	store->workers = NULL;
+}
+
+// Finds the address the first server was bound to, so the others
+// can be bound to exactly the same one
+static int bound_address(store_t *store, const struct addrinfo *hints)
+{
+	struct sockaddr_storage address;
+	socklen_t length = sizeof(address);
+	if (getsockname(
+		store->workers[0].server.result.fd,
+		(struct sockaddr *)&address,
+		&length
+	))
+		return -1;
+
+	if (getnameinfo(
+		(struct sockaddr *)&address,
+		length,
+		store->node,
+		sizeof(store->node),
+		store->service,
+		sizeof(store->service),
+		NI_NUMERICHOST | NI_NUMERICSERV
+	))
+		return -1;
+
+	store->hints = *hints;
+	store->hints.ai_flags |= AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+	store->hints.ai_family = address.ss_family;
+	return 0;
+}
+
+csalt_static_store *csalt_resource_network_server_pool_init(
+	csalt_static_resource *resource
+)
+{
+	pool_t *const pool = (pool_t *)resource;
+	store_t *const store = &pool->result;
+
+	ssize_t threads = pool->threads;
+	if (threads < 1)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+
+	store->workers = calloc((size_t)threads, sizeof(*store->workers));
+	if (!store->workers)
+		return NULL;
+
+	store->worker_count = threads;
+	atomic_init(&store->stopping, false);
+
+	for (ssize_t i = 0; i < threads; i++) {
+		worker_t *const worker = &store->workers[i];
+		worker->server = i?
+			csalt_resource_network_server(
+				store->node,
+				store->service,
+				&store->hints):
+			csalt_resource_network_server(
+				pool->node,
+				pool->service,
+				pool->hints);
+		worker->server.reuse_port = true;
+		worker->pool = store;
+		worker->index = i;
+		worker->pin = pool->pin;
+
+		if (!csalt_resource_init(csalt_resource(&worker->server))) {
+			deinit_servers(store, i);
+			return NULL;
+		}
+
+		if (!i && bound_address(store, pool->hints)) {
+			deinit_servers(store, 1);
+			return NULL;
+		}
+	}
+
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_network_server_pool_deinit(csalt_resource *resource)
+{
+	pool_t *const pool = (pool_t *)resource;
+	deinit_servers(&pool->result, pool->result.worker_count);
+}
+
+static void pin(const worker_t *worker)
+{
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET((size_t)(worker->index % cpus), &set);
+
+	// Pinning is an optimization, so failure isn't an error
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *worker_main(void *param)
+{
+	worker_t *const worker = param;
+	store_t *const pool = worker->pool;
+
+	if (worker->pin)
+		pin(worker);
+
+	while (!atomic_load(&pool->stopping)) {
+		const int result = csalt_store_network_server_poll(
+			&worker->server.result,
+			CSALT_NETWORK_SERVER_POOL_INTERVAL,
+			worker->block,
+			worker->param);
+
+		if (result < 0) {
+			worker->result = -1;
+			csalt_store_network_server_pool_stop(pool);
+		}
+	}
+	return NULL;
+}
+
+int csalt_store_network_server_pool_run(
+	store_t *pool,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	atomic_store(&pool->stopping, false);
+
+	ssize_t started = 0;
+	for (; started < pool->worker_count; started++) {
+		worker_t *const worker = &pool->workers[started];
+		worker->block = block;
+		worker->param = param;
+		worker->result = 0;
+		if (csalt_thread_create(&worker->thread, worker_main, worker))
+			break;
+	}
+
+	const bool failed = started < pool->worker_count;
+	if (failed)
+		csalt_store_network_server_pool_stop(pool);
+
+	int result = failed? -1: 0;
+	for (ssize_t i = 0; i < started; i++) {
+		csalt_thread_join(pool->workers[i].thread);
+		if (pool->workers[i].result)
+			result = -1;
+	}
+	return result;
+}
+
+void csalt_store_network_server_pool_stop(store_t *pool)
+{
+	atomic_store(&pool->stopping, true);
+}
+
+ssize_t csalt_store_network_server_pool_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+ssize_t csalt_store_network_server_pool_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	(void)store;
+	(void)buffer;
+	(void)size;
+	return -1;
+}
+
+int csalt_store_network_server_pool_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
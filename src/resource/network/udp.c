@@ -0,0 +1,467 @@
+// recvmmsg(), sendmmsg() and SOCK_CLOEXEC are GNU extensions
+#define _GNU_SOURCE
+
+#include "csalt/resource/network/udp.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#include "csalt/resource/network.h" // getaddrinfo interface
+
+typedef struct csalt_resource_network_udp network_t;
+typedef struct csalt_store_network_udp store_t;
+typedef struct csalt_network_datagram datagram_t;
+
+// The kernel refuses to segment more than this many datagrams at
+// once, or a combined payload which doesn't fit in one IP packet
+#define MAX_SEGMENTS 64
+#define MAX_SEGMENTED_PAYLOAD 65000
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_network_udp_init,
+	csalt_resource_network_udp_deinit,
+};
+
+static const struct csalt_static_store_interface store_impl = {
+	csalt_store_network_client_read,
+	csalt_store_network_client_write,
+	csalt_store_network_client_split,
+	csalt_store_network_client_fd,
+};
+
+static const struct addrinfo connected_hints = {
+	.ai_family = AF_UNSPEC,
+	.ai_socktype = SOCK_DGRAM,
+};
+
+static const struct addrinfo bound_hints = {
+	.ai_flags = AI_PASSIVE,
+	.ai_family = AF_UNSPEC,
+	.ai_socktype = SOCK_DGRAM,
+};
+
+static network_t udp(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	bool bind,
+	struct csalt_network_udp_options options
+)
+{
+	return (network_t) {
+		&impl,
+		node,
+		service,
+		hints,
+		bind,
+		options,
+
+		{
+			.parent = {
+				.vtable = &store_impl,
+				.fd = -1,
+			},
+		},
+	};
+}
+
+struct csalt_resource_network_udp csalt_resource_network_udp_connected(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	struct csalt_network_udp_options options
+)
+{
+	return udp(node, service, hints? hints: &connected_hints, false, options);
+}
+
+struct csalt_resource_network_udp csalt_resource_network_udp_bound(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	struct csalt_network_udp_options options
+)
+{
+	return udp(node, service, hints? hints: &bound_hints, true, options);
+}
+
+static void set_options(network_t *network)
+{
+	store_t *const store = &network->result;
+	const int socket_fd = store->parent.fd;
+	const struct csalt_network_udp_options *options = &network->options;
+
+	if (options->receive_buffer_size > 0)
+		setsockopt(
+			socket_fd,
+			SOL_SOCKET,
+			SO_RCVBUF,
+			&options->receive_buffer_size,
+			sizeof(options->receive_buffer_size));
+
+	store->segment_size = 0;
+#ifdef UDP_SEGMENT
+	if (
+		options->segment_size > 0 &&
+		!setsockopt(
+			socket_fd,
+			IPPROTO_UDP,
+			UDP_SEGMENT,
+			&options->segment_size,
+			sizeof(options->segment_size))
+	)
+		store->segment_size = options->segment_size;
+#endif
+
+	store->gro = false;
+#ifdef UDP_GRO
+	const int enable = 1;
+	if (options->gro)
+		store->gro = !setsockopt(
+			socket_fd,
+			IPPROTO_UDP,
+			UDP_GRO,
+			&enable,
+			sizeof(enable));
+#endif
+}
+
+static int init_store(const struct addrinfo *result, void *param)
+{
+	network_t *network = param;
+
+	for (; result; result = result->ai_next) {
+		const int socket_fd = socket(
+			result->ai_family,
+			result->ai_socktype | SOCK_CLOEXEC,
+			result->ai_protocol);
+		if (socket_fd == -1)
+			continue;
+
+		const int error = network->bind?
+			bind(socket_fd, result->ai_addr, result->ai_addrlen):
+			connect(socket_fd, result->ai_addr, result->ai_addrlen);
+
+		if (!error) {
+			network->result.parent.fd = socket_fd;
+			set_options(network);
+			return 0;
+		}
+
+		close(socket_fd);
+	}
+
+	return -1;
+}
+
+csalt_static_store *csalt_resource_network_udp_init(
+	csalt_static_resource *resource
+)
+{
+	network_t *network = (network_t *)resource;
+
+	const int error = csalt_resource_network_getaddrinfo(
+		network->node,
+		network->service,
+		network->hints,
+		init_store,
+		network);
+
+	if (error)
+		return NULL;
+
+	return (csalt_static_store *)&network->result;
+}
+
+void csalt_resource_network_udp_deinit(csalt_resource *resource)
+{
+	network_t *network = (network_t *)resource;
+	close(network->result.parent.fd);
+	network->result.parent.fd = -1;
+}
+
+static int segment_size(struct msghdr *message, ssize_t length)
+{
+#ifdef UDP_GRO
+	for (
+		struct cmsghdr *control = CMSG_FIRSTHDR(message);
+		control;
+		control = CMSG_NXTHDR(message, control)
+	) {
+		if (control->cmsg_level == IPPROTO_UDP && control->cmsg_type == UDP_GRO) {
+			int size;
+			memcpy(&size, CMSG_DATA(control), sizeof(size));
+			return size;
+		}
+	}
+#else
+	(void)message;
+#endif
+	return (int)length;
+}
+
+ssize_t csalt_store_network_udp_receive(
+	store_t *store,
+	datagram_t *datagrams,
+	ssize_t count,
+	int flags
+)
+{
+	if (count > CSALT_NETWORK_UDP_BATCH)
+		count = CSALT_NETWORK_UDP_BATCH;
+	if (count < 1)
+		return 0;
+
+	struct mmsghdr messages[count];
+	struct iovec vectors[count];
+	union {
+		char buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} controls[count];
+
+	for (ssize_t i = 0; i < count; i++) {
+		vectors[i] = (struct iovec) {
+			datagrams[i].buffer,
+			(size_t)datagrams[i].size,
+		};
+		messages[i] = (struct mmsghdr) {
+			.msg_hdr = {
+				.msg_name = &datagrams[i].address,
+				.msg_namelen = sizeof(datagrams[i].address),
+				.msg_iov = &vectors[i],
+				.msg_iovlen = 1,
+				.msg_control = store->gro? controls[i].buffer: NULL,
+				.msg_controllen = store->gro? sizeof(controls[i].buffer): 0,
+			},
+		};
+	}
+
+	const int received = recvmmsg(
+		store->parent.fd,
+		messages,
+		(unsigned)count,
+		flags,
+		NULL);
+
+	for (int i = 0; i < received; i++) {
+		datagram_t *const datagram = &datagrams[i];
+		datagram->length = messages[i].msg_len;
+		datagram->address_length = messages[i].msg_hdr.msg_namelen;
+		datagram->segment_size = segment_size(
+			&messages[i].msg_hdr,
+			datagram->length);
+	}
+
+	return received;
+}
+
+ssize_t csalt_store_network_udp_send(
+	store_t *store,
+	datagram_t *datagrams,
+	ssize_t count,
+	int flags
+)
+{
+	if (count > CSALT_NETWORK_UDP_BATCH)
+		count = CSALT_NETWORK_UDP_BATCH;
+	if (count < 1)
+		return 0;
+
+	struct mmsghdr messages[count];
+	struct iovec vectors[count];
+
+	for (ssize_t i = 0; i < count; i++) {
+		vectors[i] = (struct iovec) {
+			datagrams[i].buffer,
+			(size_t)datagrams[i].size,
+		};
+		messages[i] = (struct mmsghdr) {
+			.msg_hdr = {
+				.msg_name = datagrams[i].address_length?
+					&datagrams[i].address:
+					NULL,
+				.msg_namelen = datagrams[i].address_length,
+				.msg_iov = &vectors[i],
+				.msg_iovlen = 1,
+			},
+		};
+	}
+
+	const int sent = sendmmsg(
+		store->parent.fd,
+		messages,
+		(unsigned)count,
+		flags);
+
+	for (int i = 0; i < sent; i++)
+		datagrams[i].length = messages[i].msg_len;
+
+	return sent;
+}
+
+// Sends up to MAX_SEGMENTS datagrams in one call with UDP_SEGMENT
+static ssize_t send_segmented(
+	int socket_fd,
+	const char *buffer,
+	ssize_t size,
+	int segment_size,
+	const struct sockaddr *address,
+	socklen_t address_length
+)
+{
+#ifdef UDP_SEGMENT
+	struct iovec vector = {
+		(void *)buffer,
+		(size_t)size,
+	};
+	union {
+		char buffer[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} control = { 0 };
+
+	struct msghdr message = {
+		.msg_name = (void *)address,
+		.msg_namelen = address_length,
+		.msg_iov = &vector,
+		.msg_iovlen = 1,
+		.msg_control = control.buffer,
+		.msg_controllen = sizeof(control.buffer),
+	};
+
+	struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+	header->cmsg_level = IPPROTO_UDP;
+	header->cmsg_type = UDP_SEGMENT;
+	header->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	const uint16_t segment = (uint16_t)segment_size;
+	memcpy(CMSG_DATA(header), &segment, sizeof(segment));
+
+	return sendmsg(socket_fd, &message, 0);
+#else
+	(void)socket_fd;
+	(void)buffer;
+	(void)size;
+	(void)segment_size;
+	(void)address;
+	(void)address_length;
+	errno = ENOPROTOOPT;
+	return -1;
+#endif
+}
+
+// Sends a batch of datagrams with sendmmsg, returning the bytes sent
+static ssize_t send_batched(
+	int socket_fd,
+	const char *buffer,
+	ssize_t size,
+	int segment_size,
+	const struct sockaddr *address,
+	socklen_t address_length
+)
+{
+	ssize_t count = (size + segment_size - 1) / segment_size;
+	if (count > CSALT_NETWORK_UDP_BATCH)
+		count = CSALT_NETWORK_UDP_BATCH;
+
+	struct mmsghdr messages[count];
+	struct iovec vectors[count];
+
+	for (ssize_t i = 0; i < count; i++) {
+		const ssize_t offset = i * segment_size;
+		const ssize_t length = size - offset < segment_size?
+			size - offset:
+			segment_size;
+		vectors[i] = (struct iovec) {
+			(void *)(buffer + offset),
+			(size_t)length,
+		};
+		messages[i] = (struct mmsghdr) {
+			.msg_hdr = {
+				.msg_name = (void *)address,
+				.msg_namelen = address_length,
+				.msg_iov = &vectors[i],
+				.msg_iovlen = 1,
+			},
+		};
+	}
+
+	const int sent = sendmmsg(socket_fd, messages, (unsigned)count, 0);
+	if (sent < 1)
+		return -1;
+
+	ssize_t total = 0;
+	for (int i = 0; i < sent; i++)
+		total += messages[i].msg_len;
+	return total;
+}
+
+static bool unsupported(int error)
+{
+	// EIO is returned when the device can't checksum segments
+	return error == EIO
+		|| error == EINVAL
+		|| error == ENOPROTOOPT
+		|| error == EOPNOTSUPP;
+}
+
+ssize_t csalt_store_network_udp_send_segments(
+	store_t *store,
+	const void *buffer,
+	ssize_t size,
+	int segment_size,
+	const struct sockaddr *address,
+	socklen_t address_length
+)
+{
+	if (segment_size < 1)
+		return -1;
+
+	const int socket_fd = store->parent.fd;
+	const char *const data = buffer;
+	const socklen_t length = address? address_length: 0;
+
+	ssize_t per_call = MAX_SEGMENTED_PAYLOAD / segment_size;
+	if (per_call > MAX_SEGMENTS)
+		per_call = MAX_SEGMENTS;
+	bool segment = per_call > 1;
+
+	ssize_t total = 0;
+	while (total < size) {
+		const ssize_t remaining = size - total;
+		ssize_t sent;
+
+		if (segment) {
+			const ssize_t amount = remaining < per_call * segment_size?
+				remaining:
+				per_call * segment_size;
+			sent = send_segmented(
+				socket_fd,
+				data + total,
+				amount,
+				segment_size,
+				address,
+				length);
+			if (sent == -1 && unsupported(errno)) {
+				segment = false;
+				continue;
+			}
+		} else {
+			sent = send_batched(
+				socket_fd,
+				data + total,
+				remaining,
+				segment_size,
+				address,
+				length);
+		}
+
+		if (sent < 1)
+			break;
+		total += sent;
+	}
+
+	return total? total: -1;
+}
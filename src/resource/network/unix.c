@@ -0,0 +1,263 @@
+// SOCK_NONBLOCK, SOCK_CLOEXEC and MSG_CMSG_CLOEXEC are GNU extensions
+#define _GNU_SOURCE
+
+#include "csalt/resource/network/unix.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+typedef struct csalt_resource_network_unix_client client_t;
+typedef struct csalt_resource_network_unix_server server_t;
+typedef struct csalt_store_network_client store_t;
+
+static const struct csalt_static_resource_interface client_impl = {
+	csalt_resource_network_unix_client_init,
+	csalt_resource_network_unix_client_deinit,
+};
+
+static const struct csalt_static_resource_interface server_impl = {
+	csalt_resource_network_unix_server_init,
+	csalt_resource_network_unix_server_deinit,
+};
+
+static const struct csalt_static_store_interface store_impl = {
+	csalt_store_network_client_read,
+	csalt_store_network_client_write,
+	csalt_store_network_client_split,
+	csalt_store_network_client_fd,
+};
+
+struct csalt_resource_network_unix_client csalt_resource_network_unix_client(
+	const char *path,
+	int type
+)
+{
+	return (client_t) {
+		&client_impl,
+		path,
+		type,
+
+		{
+			.vtable = &store_impl,
+			.fd = -1,
+		},
+	};
+}
+
+struct csalt_resource_network_unix_server csalt_resource_network_unix_server(
+	const char *path,
+	int type
+)
+{
+	return (server_t) {
+		&server_impl,
+		path,
+		type,
+		SOMAXCONN,
+
+		{
+			.fd = -1,
+			.epoll_fd = -1,
+		},
+	};
+}
+
+// Fills in address from path, returning its length, or 0 if the
+// path doesn't fit
+static socklen_t unix_address(struct sockaddr_un *address, const char *path)
+{
+	*address = (struct sockaddr_un) {
+		.sun_family = AF_UNIX,
+	};
+
+	const size_t length = strlen(path);
+	if (!length || length >= sizeof(address->sun_path))
+		return 0;
+
+	memcpy(address->sun_path, path, length);
+
+	// Abstract names start with a null byte, and aren't terminated
+	if (path[0] == '@') {
+		address->sun_path[0] = '\0';
+		return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + length);
+	}
+
+	return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + length + 1);
+}
+
+csalt_static_store *csalt_resource_network_unix_client_init(
+	csalt_static_resource *resource
+)
+{
+	client_t *client = (client_t *)resource;
+	store_t *store = &client->result;
+
+	struct sockaddr_un address;
+	const socklen_t length = unix_address(&address, client->path);
+	if (!length)
+		return NULL;
+
+	const int socket_fd = socket(AF_UNIX, client->type | SOCK_CLOEXEC, 0);
+	if (socket_fd == -1)
+		return NULL;
+
+	if (connect(socket_fd, (struct sockaddr *)&address, length)) {
+		close(socket_fd);
+		return NULL;
+	}
+
+	store->fd = socket_fd;
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_network_unix_client_deinit(csalt_resource *resource)
+{
+	client_t *client = (client_t *)resource;
+	close(client->result.fd);
+	client->result.fd = -1;
+}
+
+csalt_static_store *csalt_resource_network_unix_server_init(
+	csalt_static_resource *resource
+)
+{
+	server_t *server = (server_t *)resource;
+
+	struct sockaddr_un address;
+	const socklen_t length = unix_address(&address, server->path);
+	if (!length)
+		return NULL;
+
+	const int socket_fd = socket(
+		AF_UNIX,
+		server->type | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		0);
+	if (socket_fd == -1)
+		return NULL;
+
+	if (
+		bind(socket_fd, (struct sockaddr *)&address, length) ||
+		listen(socket_fd, server->backlog)
+	) {
+		close(socket_fd);
+		return NULL;
+	}
+
+	csalt_static_store *const store = csalt_store_network_server_open(
+		&server->result,
+		socket_fd);
+	if (!store && server->path[0] != '@')
+		unlink(server->path);
+	return store;
+}
+
+void csalt_resource_network_unix_server_deinit(csalt_resource *resource)
+{
+	server_t *server = (server_t *)resource;
+	csalt_store_network_server_close(&server->result);
+	if (server->path[0] != '@')
+		unlink(server->path);
+}
+
+ssize_t csalt_store_network_unix_send_fd(
+	const store_t *network,
+	const void *buffer,
+	ssize_t size,
+	int fd
+)
+{
+	struct iovec vector = {
+		(void *)buffer,
+		(size_t)size,
+	};
+	union {
+		char buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control = { 0 };
+
+	struct msghdr message = {
+		.msg_iov = &vector,
+		.msg_iovlen = 1,
+		.msg_control = control.buffer,
+		.msg_controllen = sizeof(control.buffer),
+	};
+
+	struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+	header->cmsg_level = SOL_SOCKET;
+	header->cmsg_type = SCM_RIGHTS;
+	header->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(header), &fd, sizeof(fd));
+
+	return sendmsg(network->fd, &message, MSG_NOSIGNAL);
+}
+
+ssize_t csalt_store_network_unix_receive_fd(
+	const store_t *network,
+	void *buffer,
+	ssize_t size,
+	int *fd
+)
+{
+	*fd = -1;
+
+	struct iovec vector = {
+		buffer,
+		(size_t)size,
+	};
+	union {
+		char buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+
+	struct msghdr message = {
+		.msg_iov = &vector,
+		.msg_iovlen = 1,
+		.msg_control = control.buffer,
+		.msg_controllen = sizeof(control.buffer),
+	};
+
+	const ssize_t result = recvmsg(network->fd, &message, MSG_CMSG_CLOEXEC);
+	if (result == -1)
+		return -1;
+
+	// Padding can leave room for more than one descriptor, so any
+	// extras that did arrive are closed rather than leaked
+	int received = 0;
+	for (
+		struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+		header;
+		header = CMSG_NXTHDR(&message, header)
+	) {
+		if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		const size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (size_t i = 0; i < count; i++, received++) {
+			int descriptor;
+			memcpy(
+				&descriptor,
+				CMSG_DATA(header) + i * sizeof(int),
+				sizeof(descriptor));
+			if (received)
+				close(descriptor);
+			else
+				*fd = descriptor;
+		}
+	}
+
+	// The kernel drops whatever didn't fit, so the sender's
+	// descriptors can't all be passed on
+	if (received > 1 || (message.msg_flags & MSG_CTRUNC)) {
+		if (*fd != -1)
+			close(*fd);
+		*fd = -1;
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	return result;
+}
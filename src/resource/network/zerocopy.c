@@ -0,0 +1,305 @@
+#include "csalt/resource/network/zerocopy.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <asm/socket.h> // SO_ZEROCOPY isn't exported by every libc
+#include <linux/errqueue.h>
+
+typedef struct csalt_resource_network_zerocopy zerocopy_t;
+typedef struct csalt_store_network_zerocopy store_t;
+
+static const struct csalt_static_resource_interface impl = {
+	csalt_resource_network_zerocopy_init,
+	csalt_resource_network_zerocopy_deinit,
+};
+
+static const struct csalt_static_store_interface store_impl = {
+	csalt_store_network_client_read,
+	csalt_store_network_zerocopy_write,
+	csalt_store_network_client_split,
+	csalt_store_network_client_fd,
+};
+
+struct csalt_resource_network_zerocopy csalt_resource_network_zerocopy(
+	csalt_static_resource *resource,
+	ssize_t threshold
+)
+{
+	return (zerocopy_t) {
+		&impl,
+		resource,
+		threshold,
+
+		{
+			.parent = {
+				.vtable = &store_impl,
+				.fd = -1,
+			},
+		},
+	};
+}
+
+static long long now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+csalt_static_store *csalt_resource_network_zerocopy_init(
+	csalt_static_resource *resource
+)
+{
+	zerocopy_t *const zerocopy = (zerocopy_t *)resource;
+	store_t *const store = &zerocopy->result;
+
+	const struct csalt_store_network_client *const socket
+		= (void *)csalt_resource_init((csalt_resource *)zerocopy->resource);
+	if (!socket)
+		return NULL;
+
+	*store = (store_t) {
+		.parent = {
+			.vtable = &store_impl,
+			.fd = socket->fd,
+		},
+		.threshold = zerocopy->threshold,
+	};
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+	const int enable = 1;
+	store->enabled = !setsockopt(
+		store->parent.fd,
+		SOL_SOCKET,
+		SO_ZEROCOPY,
+		&enable,
+		sizeof(enable));
+#endif
+
+	return (csalt_static_store *)store;
+}
+
+void csalt_resource_network_zerocopy_deinit(csalt_resource *resource)
+{
+	zerocopy_t *const zerocopy = (zerocopy_t *)resource;
+	store_t *const store = &zerocopy->result;
+
+	// The kernel may still be sending from the caller's memory,
+	// which could be freed as soon as this returns
+	csalt_store_network_zerocopy_wait(
+		store,
+		csalt_store_network_zerocopy_last(store),
+		CSALT_NETWORK_ZEROCOPY_DEINIT_TIMEOUT);
+
+	csalt_resource_deinit((csalt_resource *)zerocopy->resource);
+	store->parent.fd = -1;
+}
+
+// Holds on to a range which completed before an earlier send,
+// merging it with any held range it touches
+static void hold(store_t *store, uint64_t first, uint64_t last)
+{
+	for (int i = 0; i < store->range_count;) {
+		if (
+			store->ranges[i].end + 1 < first ||
+			last + 1 < store->ranges[i].begin
+		) {
+			i++;
+			continue;
+		}
+		first = csalt_min(first, store->ranges[i].begin);
+		last = csalt_max(last, store->ranges[i].end);
+		store->ranges[i] = store->ranges[--store->range_count];
+	}
+
+	if (store->range_count == CSALT_NETWORK_ZEROCOPY_RANGES) {
+		store->lost = true;
+		return;
+	}
+
+	store->ranges[store->range_count].begin = first;
+	store->ranges[store->range_count].end = last;
+	store->range_count++;
+}
+
+// Marks sends begin to end (inclusive, counted from zero as the
+// kernel does) as completed
+static void complete(store_t *store, uint32_t begin, uint32_t end)
+{
+	// Widen the kernel's 32 bit IDs, relative to the oldest send
+	// which hasn't completed
+	const uint64_t first = store->completed
+		+ (uint32_t)(begin - (uint32_t)store->completed);
+	const uint64_t last = first + (uint32_t)(end - begin);
+
+	if (first != store->completed) {
+		hold(store, first, last);
+		return;
+	}
+
+	store->completed = last + 1;
+
+	// Pick up any later ranges which arrived early
+	for (int i = 0; i < store->range_count;) {
+		if (store->ranges[i].begin > store->completed) {
+			i++;
+			continue;
+		}
+		store->completed = csalt_max(
+			store->completed,
+			store->ranges[i].end + 1);
+		store->ranges[i] = store->ranges[--store->range_count];
+		i = 0;
+	}
+}
+
+// Reads every completion waiting on the error queue
+static int read_completions(store_t *store)
+{
+	for (;;) {
+		union {
+			char buffer[CMSG_SPACE(sizeof(struct sock_extended_err))];
+			struct cmsghdr align;
+		} control;
+
+		struct msghdr message = {
+			.msg_control = control.buffer,
+			.msg_controllen = sizeof(control.buffer),
+		};
+
+		if (recvmsg(store->parent.fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+			return errno == EAGAIN || errno == EWOULDBLOCK? 0: -1;
+
+		for (
+			struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+			header;
+			header = CMSG_NXTHDR(&message, header)
+		) {
+			const bool error_queue =
+				(header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+				(header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR);
+			if (!error_queue)
+				continue;
+
+			struct sock_extended_err error;
+			memcpy(&error, CMSG_DATA(header), sizeof(error));
+			if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				store->copied = true;
+			complete(store, error.ee_info, error.ee_data);
+		}
+	}
+}
+
+ssize_t csalt_store_network_zerocopy_send(
+	store_t *store,
+	const void *buffer,
+	ssize_t size,
+	uint64_t *id
+)
+{
+	if (id)
+		*id = 0;
+
+#ifdef MSG_ZEROCOPY
+	if (store->enabled && size >= store->threshold) {
+		const ssize_t result = send(
+			store->parent.fd,
+			buffer,
+			(size_t)size,
+			MSG_ZEROCOPY);
+
+		if (result != -1) {
+			store->sent++;
+			if (id)
+				*id = store->sent;
+			return result;
+		}
+
+		// ENOBUFS means too much memory is pinned already, so
+		// copy this one instead
+		if (errno != ENOBUFS)
+			return -1;
+	}
+#endif
+
+	return write(store->parent.fd, buffer, (size_t)size);
+}
+
+uint64_t csalt_store_network_zerocopy_last(const store_t *store)
+{
+	return store->sent;
+}
+
+bool csalt_store_network_zerocopy_done(store_t *store, uint64_t id)
+{
+	if (store->completed < id)
+		read_completions(store);
+	return store->completed >= id;
+}
+
+int csalt_store_network_zerocopy_wait(store_t *store, uint64_t id, int timeout)
+{
+	const long long deadline = timeout < 0? -1: now_ms() + timeout;
+
+	while (store->completed < id) {
+		if (read_completions(store))
+			return -1;
+		if (store->completed >= id)
+			break;
+		if (store->lost)
+			return -1;
+
+		long long wait = -1;
+		if (deadline >= 0) {
+			wait = deadline - now_ms();
+			if (wait <= 0)
+				return -1;
+		}
+
+		// Completions on the error queue are reported as POLLERR
+		struct pollfd error = {
+			.fd = store->parent.fd,
+		};
+		if (poll(&error, 1, (int)wait) == -1 && errno != EINTR)
+			return -1;
+		if (error.revents & POLLNVAL)
+			return -1;
+	}
+	return 0;
+}
+
+ssize_t csalt_store_network_zerocopy_pending(const store_t *store)
+{
+	return (ssize_t)(store->sent - store->completed);
+}
+
+ssize_t csalt_store_network_zerocopy_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	store_t *const zerocopy = (store_t *)store;
+
+	// Generic callers reuse the buffer as soon as this returns, so
+	// the kernel has to be finished with it first
+	uint64_t id;
+	const ssize_t result = csalt_store_network_zerocopy_send(
+		zerocopy,
+		buffer,
+		size,
+		&id);
+
+	if (result < 0 || csalt_store_network_zerocopy_done(zerocopy, id))
+		return result;
+	if (csalt_store_network_zerocopy_wait(zerocopy, id, -1))
+		return -1;
+	return result;
+}
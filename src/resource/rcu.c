@@ -0,0 +1,362 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/resource/rcu.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef struct csalt_resource_rcu rcu_t;
+typedef struct csalt_store_rcu rcu_store_t;
+typedef struct csalt_store_rcu_version version_t;
+
+struct csalt_store_rcu_version {
+	struct csalt_resource_heap heap;
+	size_t retired_epoch;
+	version_t *next;
+};
+
+static const struct csalt_dynamic_resource_interface impl = {
+	csalt_resource_rcu_init,
+	csalt_resource_rcu_deinit,
+};
+
+static const struct csalt_dynamic_store_interface store_impl = {
+	{
+		csalt_store_rcu_read,
+		csalt_store_rcu_write,
+		csalt_store_rcu_split,
+		NULL,
+	},
+	csalt_store_rcu_size,
+	csalt_store_rcu_resize,
+};
+
+struct csalt_resource_rcu csalt_resource_rcu(ssize_t initial_size)
+{
+	return (rcu_t) {
+		.vtable = &impl,
+		.size = initial_size,
+		.store = {
+			.vtable = &store_impl,
+		},
+	};
+}
+
+static version_t *version_new(ssize_t size)
+{
+	version_t *const version = malloc(sizeof(*version));
+	if (!version)
+		return NULL;
+
+	version->heap = csalt_resource_heap(size);
+	version->retired_epoch = 0;
+	version->next = NULL;
+
+	if (!csalt_resource_init(csalt_resource(&version->heap))) {
+		free(version);
+		return NULL;
+	}
+	return version;
+}
+
+static void version_free(version_t *version)
+{
+	csalt_resource_deinit(csalt_resource(&version->heap));
+	free(version);
+}
+
+static csalt_store *version_store(version_t *version)
+{
+	return (csalt_store *)&version->heap.store;
+}
+
+// Readers announce the epoch they started in; zero means the slot
+// is free. The hint keeps each thread on its own cache line in the
+// common case.
+static _Thread_local size_t reader_hint = 0;
+
+static atomic_size_t *pin(rcu_store_t *rcu)
+{
+	const size_t epoch = atomic_load(&rcu->epoch);
+	for (size_t i = 0; i < CSALT_STORE_RCU_READERS; i++) {
+		const size_t index = (reader_hint + i) % CSALT_STORE_RCU_READERS;
+		atomic_size_t *const slot = &rcu->readers[index].epoch;
+		size_t expected = 0;
+		if (atomic_compare_exchange_strong(slot, &expected, epoch)) {
+			reader_hint = index;
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+static void unpin(atomic_size_t *slot)
+{
+	atomic_store(slot, 0);
+}
+
+static void retire_push(rcu_store_t *rcu, version_t *version)
+{
+	version->next = atomic_load(&rcu->retired);
+	while (!atomic_compare_exchange_weak(
+		&rcu->retired,
+		&version->next,
+		version));
+}
+
+static void retire(rcu_store_t *rcu, version_t *version)
+{
+	// Any reader which could still see this version announced an
+	// epoch no later than this one
+	version->retired_epoch = atomic_fetch_add(&rcu->epoch, 1);
+	retire_push(rcu, version);
+}
+
+ssize_t csalt_store_rcu_reclaim(rcu_store_t *rcu)
+{
+	version_t *list = atomic_exchange(&rcu->retired, NULL);
+
+	size_t oldest = SIZE_MAX;
+	for (size_t i = 0; i < CSALT_STORE_RCU_READERS; i++) {
+		const size_t epoch = atomic_load(&rcu->readers[i].epoch);
+		if (epoch && epoch < oldest)
+			oldest = epoch;
+	}
+
+	ssize_t remaining = 0;
+	while (list) {
+		version_t *const next = list->next;
+		if (list->retired_epoch < oldest) {
+			version_free(list);
+		} else {
+			retire_push(rcu, list);
+			remaining++;
+		}
+		list = next;
+	}
+	return remaining;
+}
+
+csalt_store *csalt_resource_rcu_init(csalt_resource *resource)
+{
+	rcu_t *const rcu = (rcu_t *)resource;
+	rcu_store_t *const store = &rcu->store;
+
+	version_t *const first = version_new(rcu->size);
+	if (!first)
+		return NULL;
+
+	atomic_init(&store->current, first);
+	atomic_init(&store->retired, NULL);
+	atomic_init(&store->epoch, 1);
+	for (size_t i = 0; i < CSALT_STORE_RCU_READERS; i++)
+		atomic_init(&store->readers[i].epoch, 0);
+
+	return (csalt_store *)store;
+}
+
+void csalt_resource_rcu_deinit(csalt_resource *resource)
+{
+	rcu_t *const rcu = (rcu_t *)resource;
+	rcu_store_t *const store = &rcu->store;
+
+	version_free(atomic_exchange(&store->current, NULL));
+
+	version_t *list = atomic_exchange(&store->retired, NULL);
+	while (list) {
+		version_t *const next = list->next;
+		version_free(list);
+		list = next;
+	}
+}
+
+int csalt_store_rcu_update(
+	rcu_store_t *rcu,
+	csalt_store_block_fn *block,
+	void *param
+)
+{
+	// Stay pinned until the new version is published, so the
+	// version we copied can't be freed and its address re-used
+	// underneath the compare-exchange
+	atomic_size_t *const slot = pin(rcu);
+	if (!slot)
+		return -1;
+
+	version_t *const current = atomic_load(&rcu->current);
+	csalt_store *const current_store = version_store(current);
+	const ssize_t size = csalt_store_size(current_store);
+
+	version_t *const copy = version_new(size);
+	if (!copy) {
+		unpin(slot);
+		return -1;
+	}
+
+	csalt_store_read(
+		(csalt_static_store *)current_store,
+		copy->heap.store.begin,
+		size);
+
+	const int result = block(version_store(copy), param);
+	if (result < 0) {
+		unpin(slot);
+		version_free(copy);
+		return result;
+	}
+
+	version_t *expected = current;
+	if (!atomic_compare_exchange_strong(&rcu->current, &expected, copy)) {
+		unpin(slot);
+		version_free(copy);
+		return -1;
+	}
+
+	retire(rcu, current);
+	unpin(slot);
+	csalt_store_rcu_reclaim(rcu);
+	return result;
+}
+
+int csalt_store_rcu_publish(
+	rcu_store_t *rcu,
+	ssize_t size,
+	csalt_store_block_fn *block,
+	void *param
+)
+{
+	version_t *const version = version_new(size);
+	if (!version)
+		return -1;
+
+	const int result = block(version_store(version), param);
+	if (result < 0) {
+		version_free(version);
+		return result;
+	}
+
+	retire(rcu, atomic_exchange(&rcu->current, version));
+	csalt_store_rcu_reclaim(rcu);
+	return result;
+}
+
+ssize_t csalt_store_rcu_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t amount
+)
+{
+	rcu_store_t *const rcu = (rcu_store_t *)store;
+	atomic_size_t *const slot = pin(rcu);
+	if (!slot)
+		return -1;
+
+	const ssize_t result = csalt_store_read(
+		(csalt_static_store *)version_store(atomic_load(&rcu->current)),
+		buffer,
+		amount);
+
+	unpin(slot);
+	return result;
+}
+
+struct write_params {
+	const void *buffer;
+	ssize_t amount;
+	ssize_t result;
+};
+
+static int receive_write(csalt_store *store, void *param)
+{
+	struct write_params *const params = param;
+	params->result = csalt_store_write(
+		(csalt_static_store *)store,
+		params->buffer,
+		params->amount);
+	return params->result < 0 ? -1 : 0;
+}
+
+ssize_t csalt_store_rcu_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t amount
+)
+{
+	struct write_params params = {
+		buffer,
+		amount,
+		-1,
+	};
+
+	if (csalt_store_rcu_update((rcu_store_t *)store, receive_write, &params) < 0)
+		return -1;
+	return params.result;
+}
+
+int csalt_store_rcu_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	rcu_store_t *const rcu = (rcu_store_t *)store;
+	atomic_size_t *const slot = pin(rcu);
+	if (!slot)
+		return -1;
+
+	const int result = csalt_store_split(
+		(csalt_static_store *)version_store(atomic_load(&rcu->current)),
+		begin,
+		end,
+		block,
+		param);
+
+	unpin(slot);
+	return result;
+}
+
+ssize_t csalt_store_rcu_size(csalt_store *store)
+{
+	rcu_store_t *const rcu = (rcu_store_t *)store;
+	atomic_size_t *const slot = pin(rcu);
+	if (!slot)
+		return -1;
+
+	const ssize_t result = csalt_store_size(
+		version_store(atomic_load(&rcu->current)));
+
+	unpin(slot);
+	return result;
+}
+
+static int receive_resize(csalt_store *store, void *param)
+{
+	ssize_t *const new_size = param;
+	*new_size = csalt_store_resize(store, *new_size);
+	return 0;
+}
+
+ssize_t csalt_store_rcu_resize(csalt_store *store, ssize_t new_size)
+{
+	if (csalt_store_rcu_update((rcu_store_t *)store, receive_resize, &new_size) < 0)
+		return csalt_store_rcu_size(store);
+	return new_size;
+}
@@ -0,0 +1,646 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/resource/tiered.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct csalt_resource_tiered resource_t;
+typedef struct csalt_store_tiered tiered_t;
+typedef struct csalt_store_tiered_view view_t;
+typedef struct csalt_tier tier_t;
+
+static ssize_t view_read(csalt_static_store *store, void *buffer, ssize_t amount);
+static ssize_t view_write(csalt_static_store *store, const void *buffer, ssize_t amount);
+static int view_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+);
+
+static const struct csalt_dynamic_resource_interface impl = {
+	csalt_resource_tiered_init,
+	csalt_resource_tiered_deinit,
+};
+
+static const struct csalt_dynamic_store_interface store_impl = {
+	{
+		csalt_store_tiered_read,
+		csalt_store_tiered_write,
+		csalt_store_tiered_split,
+		NULL,
+	},
+	csalt_store_tiered_size,
+	csalt_store_tiered_resize,
+};
+
+static const struct csalt_static_store_interface view_impl = {
+	view_read,
+	view_write,
+	view_split,
+	NULL,
+};
+
+struct csalt_tier csalt_tier(csalt_resource *resource, ssize_t capacity)
+{
+	return (tier_t) {
+		.resource = resource,
+		.capacity = capacity,
+	};
+}
+
+struct csalt_resource_tiered csalt_resource_tiered_bounds(
+	struct csalt_tier *begin,
+	struct csalt_tier *end,
+	ssize_t block_size,
+	ssize_t promote_after
+)
+{
+	return (resource_t) {
+		.vtable = &impl,
+		.tiers = begin,
+		.tier_count = end - begin,
+		.block_size = block_size,
+		.promote_after = promote_after,
+		.store = {
+			.vtable = &store_impl,
+		},
+	};
+}
+
+static view_t whole(tiered_t *tiered)
+{
+	return (view_t) {
+		&view_impl,
+		tiered,
+		0,
+		SSIZE_MAX,
+	};
+}
+
+static tier_t *last_tier(tiered_t *tiered)
+{
+	return &tiered->tiers[tiered->tier_count - 1];
+}
+
+// Reading and writing part of a tier's store
+
+struct io_params {
+	void *buffer;
+	ssize_t size;
+	bool write;
+	ssize_t result;
+};
+
+static int receive_io(csalt_static_store *store, void *param)
+{
+	struct io_params *const params = param;
+	params->result = params->write?
+		csalt_store_write(store, params->buffer, params->size):
+		csalt_store_read(store, params->buffer, params->size);
+	return params->result < 0? -1: 0;
+}
+
+static ssize_t store_io(
+	csalt_store *store,
+	ssize_t offset,
+	void *buffer,
+	ssize_t size,
+	bool write
+)
+{
+	ssize_t done = 0;
+	while (done < size) {
+		struct io_params params = {
+			(char *)buffer + done,
+			size - done,
+			write,
+			-1,
+		};
+		if (csalt_store_split(
+			(csalt_static_store *)store,
+			offset + done,
+			offset + size,
+			receive_io,
+			&params
+		))
+			return -1;
+		if (!params.result)
+			break;
+		done += params.result;
+	}
+	return done;
+}
+
+// Slot bookkeeping for the cached tiers. Occupied slots are found
+// through a chained hash table, and free slots are kept on a list,
+// both threaded through next.
+
+static size_t hash(ssize_t block)
+{
+	return (size_t)(((uint64_t)block * 0x9e3779b97f4a7c15u) >> 32);
+}
+
+static ssize_t slot_of(const tier_t *tier, ssize_t block)
+{
+	if (!tier->capacity)
+		return -1;
+
+	ssize_t slot = tier->buckets[hash(block) & tier->bucket_mask];
+	while (slot >= 0 && tier->blocks[slot] != block)
+		slot = tier->next[slot];
+	return slot;
+}
+
+static void map(tier_t *tier, ssize_t slot, ssize_t block)
+{
+	ssize_t *const bucket = &tier->buckets[hash(block) & tier->bucket_mask];
+	tier->blocks[slot] = block;
+	tier->counts[slot] = 0;
+	tier->referenced[slot] = true;
+	tier->next[slot] = *bucket;
+	*bucket = slot;
+}
+
+static void unmap(tier_t *tier, ssize_t slot)
+{
+	ssize_t *link = &tier->buckets[hash(tier->blocks[slot]) & tier->bucket_mask];
+	while (*link != slot)
+		link = &tier->next[*link];
+	*link = tier->next[slot];
+
+	tier->blocks[slot] = -1;
+	tier->next[slot] = tier->free_slot;
+	tier->free_slot = slot;
+}
+
+static void clear(tier_t *tier)
+{
+	for (ssize_t i = 0; i < tier->capacity; i++) {
+		tier->blocks[i] = -1;
+		tier->counts[i] = 0;
+		tier->referenced[i] = false;
+		tier->next[i] = i + 1 < tier->capacity? i + 1: -1;
+	}
+	for (size_t i = 0; tier->capacity && i <= tier->bucket_mask; i++)
+		tier->buckets[i] = -1;
+	tier->free_slot = tier->capacity? 0: -1;
+	tier->hand = 0;
+}
+
+// Chooses a slot for a new block: a free slot if there is one,
+// otherwise the first slot the CLOCK hand finds unreferenced
+static ssize_t choose(tier_t *tier)
+{
+	const ssize_t free_slot = tier->free_slot;
+	if (free_slot >= 0) {
+		tier->free_slot = tier->next[free_slot];
+		return free_slot;
+	}
+
+	for (;;) {
+		const ssize_t slot = tier->hand;
+		tier->hand = (slot + 1) % tier->capacity;
+		if (!tier->referenced[slot])
+			return slot;
+		tier->referenced[slot] = false;
+	}
+}
+
+// Finds the cached tier holding block, or the last tier
+static ssize_t locate(tiered_t *tiered, ssize_t block, ssize_t *slot)
+{
+	for (ssize_t t = 0; t < tiered->tier_count - 1; t++) {
+		*slot = slot_of(&tiered->tiers[t], block);
+		if (*slot >= 0)
+			return t;
+	}
+	*slot = -1;
+	return tiered->tier_count - 1;
+}
+
+static struct csalt_tier_ghost *ghost(tiered_t *tiered, ssize_t block)
+{
+	return &tiered->ghosts[hash(block) % (size_t)tiered->ghost_count];
+}
+
+// Moving blocks between tiers. The scratch buffer has one block for
+// each tier, and a block moving into tier t is staged in scratch
+// block t, so a chain of demotions never overwrites a block still
+// on its way somewhere.
+
+static char *scratch(tiered_t *tiered, ssize_t t)
+{
+	return tiered->scratch + t * tiered->block_size;
+}
+
+static int place(tiered_t *tiered, ssize_t t, ssize_t block, const char *data);
+
+static int demote(tiered_t *tiered, ssize_t t, ssize_t slot)
+{
+	tier_t *const tier = &tiered->tiers[t];
+	const ssize_t block = tier->blocks[slot];
+	const ssize_t below = t + 1;
+	const bool keep = below < tiered->tier_count - 1
+		&& tiered->tiers[below].capacity;
+	const ssize_t size = tiered->block_size;
+
+	if (keep && store_io(tier->store, slot * size, scratch(tiered, below), size, false) != size)
+		return -1;
+
+	unmap(tier, slot);
+	tier->demotions++;
+	return keep? place(tiered, below, block, scratch(tiered, below)): 0;
+}
+
+static int place(tiered_t *tiered, ssize_t t, ssize_t block, const char *data)
+{
+	tier_t *const tier = &tiered->tiers[t];
+	const ssize_t size = tiered->block_size;
+	const ssize_t slot = choose(tier);
+
+	if (tier->blocks[slot] >= 0) {
+		// The victim's slot goes back on the free list when it's
+		// demoted, so it has to be taken off again afterwards
+		if (demote(tiered, t, slot))
+			return -1;
+		tier->free_slot = tier->next[slot];
+	}
+
+	if (store_io(tier->store, slot * size, (void *)data, size, true) != size) {
+		tier->next[slot] = tier->free_slot;
+		tier->free_slot = slot;
+		return -1;
+	}
+
+	map(tier, slot, block);
+	return 0;
+}
+
+static int promote(tiered_t *tiered, ssize_t t, ssize_t slot, ssize_t block)
+{
+	tier_t *const tier = &tiered->tiers[t];
+	const ssize_t size = tiered->block_size;
+	char *const data = scratch(tiered, t - 1);
+	if (!tiered->tiers[t - 1].capacity)
+		return -1;
+
+	// Blocks are only cached whole, so the short block at the end
+	// of the store never goes stale in a cached tier as it grows
+	const ssize_t offset = slot >= 0? slot * size: block * size;
+	if (store_io(tier->store, offset, data, size, false) != size)
+		return -1;
+
+	if (slot >= 0)
+		unmap(tier, slot);
+	else
+		ghost(tiered, block)->block = -1;
+
+	if (place(tiered, t - 1, block, data))
+		return -1;
+	tiered->tiers[t - 1].promotions++;
+	return 0;
+}
+
+// Reads part of one block, from the fastest tier holding it
+static ssize_t read_block(tiered_t *tiered, ssize_t offset, char *buffer, ssize_t size)
+{
+	const ssize_t block = offset / tiered->block_size;
+	ssize_t slot;
+	const ssize_t t = locate(tiered, block, &slot);
+	tier_t *const tier = &tiered->tiers[t];
+
+	const ssize_t result = slot >= 0?
+		store_io(tier->store, slot * tiered->block_size + offset % tiered->block_size, buffer, size, false):
+		store_io(tier->store, offset, buffer, size, false);
+	if (result <= 0)
+		return result;
+	tier->hits++;
+
+	ssize_t count;
+	if (slot >= 0) {
+		tier->referenced[slot] = true;
+		count = ++tier->counts[slot];
+	} else {
+		struct csalt_tier_ghost *const entry = ghost(tiered, block);
+		if (entry->block != block)
+			*entry = (struct csalt_tier_ghost) { block, 0 };
+		count = ++entry->count;
+	}
+
+	// A failed promotion leaves the block where it was, or in the
+	// last tier, so the read still succeeds
+	if (t > 0 && count >= tiered->promote_after)
+		promote(tiered, t, slot, block);
+	return result;
+}
+
+// Views
+
+static ssize_t view_read(csalt_static_store *store, void *buffer, ssize_t amount)
+{
+	view_t *const view = (view_t *)store;
+	tiered_t *const tiered = view->tiered;
+	if (amount > view->end - view->begin)
+		amount = view->end - view->begin;
+
+	csalt_mutex_lock(&tiered->lock);
+	ssize_t done = 0;
+	while (done < amount) {
+		const ssize_t offset = view->begin + done;
+		const ssize_t size = csalt_min(
+			tiered->block_size - offset % tiered->block_size,
+			amount - done);
+
+		const ssize_t result = read_block(tiered, offset, (char *)buffer + done, size);
+		if (result < 0) {
+			csalt_mutex_unlock(&tiered->lock);
+			return done? done: -1;
+		}
+		done += result;
+		if (result < size)
+			break;
+	}
+	csalt_mutex_unlock(&tiered->lock);
+	return done;
+}
+
+static ssize_t view_write(csalt_static_store *store, const void *buffer, ssize_t amount)
+{
+	view_t *const view = (view_t *)store;
+	tiered_t *const tiered = view->tiered;
+	const ssize_t size = tiered->block_size;
+	if (amount > view->end - view->begin)
+		amount = view->end - view->begin;
+
+	csalt_mutex_lock(&tiered->lock);
+	const ssize_t written = store_io(last_tier(tiered)->store, view->begin, (void *)buffer, amount, true);
+
+	// Cached copies are updated in place, or dropped if that fails
+	const ssize_t end = view->begin + written;
+	for (ssize_t offset = view->begin; offset < end;) {
+		const ssize_t block = offset / size;
+		const ssize_t part = csalt_min(size - offset % size, end - offset);
+
+		ssize_t slot;
+		const ssize_t t = locate(tiered, block, &slot);
+		if (slot >= 0) {
+			tier_t *const tier = &tiered->tiers[t];
+			const char *const data = (const char *)buffer + (offset - view->begin);
+			if (store_io(tier->store, slot * size + offset % size, (void *)data, part, true) != part)
+				unmap(tier, slot);
+		}
+		offset += part;
+	}
+	csalt_mutex_unlock(&tiered->lock);
+	return written;
+}
+
+static int view_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	view_t *const view = (view_t *)store;
+	if (begin < 0 || end < begin)
+		return -1;
+
+	view_t split = *view;
+	split.begin = begin < view->end - view->begin?
+		view->begin + begin:
+		view->end;
+	split.end = end < view->end - view->begin?
+		view->begin + end:
+		view->end;
+	return block((csalt_static_store *)&split, param);
+}
+
+// The tiered store itself behaves as a view of the whole last tier
+
+ssize_t csalt_store_tiered_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t amount
+)
+{
+	view_t view = whole((tiered_t *)store);
+	return view_read((csalt_static_store *)&view, buffer, amount);
+}
+
+ssize_t csalt_store_tiered_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t amount
+)
+{
+	view_t view = whole((tiered_t *)store);
+	return view_write((csalt_static_store *)&view, buffer, amount);
+}
+
+int csalt_store_tiered_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	view_t view = whole((tiered_t *)store);
+	return view_split((csalt_static_store *)&view, begin, end, block, param);
+}
+
+ssize_t csalt_store_tiered_size(csalt_store *store)
+{
+	tiered_t *const tiered = (tiered_t *)store;
+	csalt_mutex_lock(&tiered->lock);
+	const ssize_t result = csalt_store_size(last_tier(tiered)->store);
+	csalt_mutex_unlock(&tiered->lock);
+	return result;
+}
+
+ssize_t csalt_store_tiered_resize(csalt_store *store, ssize_t new_size)
+{
+	tiered_t *const tiered = (tiered_t *)store;
+	csalt_mutex_lock(&tiered->lock);
+	const ssize_t result = csalt_store_resize(last_tier(tiered)->store, new_size);
+	for (ssize_t t = 0; t < tiered->tier_count - 1; t++)
+		clear(&tiered->tiers[t]);
+	for (ssize_t i = 0; i < tiered->ghost_count; i++)
+		tiered->ghosts[i].block = -1;
+	csalt_mutex_unlock(&tiered->lock);
+	return result;
+}
+
+ssize_t csalt_store_tiered_demote(tiered_t *tiered)
+{
+	ssize_t demoted = 0;
+	bool failed = false;
+
+	csalt_mutex_lock(&tiered->lock);
+	for (ssize_t t = 0; t < tiered->tier_count - 1; t++) {
+		tier_t *const tier = &tiered->tiers[t];
+		for (ssize_t slot = 0; slot < tier->capacity; slot++) {
+			if (tier->blocks[slot] < 0)
+				continue;
+
+			if (tier->referenced[slot]) {
+				tier->referenced[slot] = false;
+				tier->counts[slot] /= 2;
+				continue;
+			}
+
+			if (demote(tiered, t, slot))
+				failed = true;
+			else
+				demoted++;
+		}
+	}
+	csalt_mutex_unlock(&tiered->lock);
+	return failed? -1: demoted;
+}
+
+int csalt_store_tiered_demote_job(void *param)
+{
+	return csalt_store_tiered_demote(param) < 0? -1: 0;
+}
+
+// Resource functions
+
+static void destroy(tiered_t *tiered, ssize_t initialized)
+{
+	for (ssize_t t = 0; t < tiered->tier_count; t++) {
+		tier_t *const tier = &tiered->tiers[t];
+		free(tier->blocks);
+		free(tier->counts);
+		free(tier->referenced);
+		free(tier->next);
+		free(tier->buckets);
+		tier->blocks = NULL;
+		tier->counts = NULL;
+		tier->referenced = NULL;
+		tier->next = NULL;
+		tier->buckets = NULL;
+	}
+	for (ssize_t t = 0; t < initialized; t++)
+		csalt_resource_deinit(tiered->tiers[t].resource);
+
+	free(tiered->scratch);
+	free(tiered->ghosts);
+	tiered->scratch = NULL;
+	tiered->ghosts = NULL;
+	csalt_mutex_deinit(&tiered->lock);
+}
+
+static bool allocate_tier(tier_t *tier, ssize_t block_size)
+{
+	const ssize_t size = csalt_store_size(tier->store);
+	if (size < 0)
+		return false;
+	if (tier->capacity > size / block_size)
+		tier->capacity = size / block_size;
+	if (tier->capacity <= 0) {
+		tier->capacity = 0;
+		clear(tier);
+		return true;
+	}
+
+	// Two buckets per slot keeps the chains short
+	size_t buckets = 1;
+	while (buckets < (size_t)tier->capacity * 2)
+		buckets *= 2;
+
+	const size_t capacity = (size_t)tier->capacity;
+	tier->blocks = malloc(capacity * sizeof(*tier->blocks));
+	tier->counts = malloc(capacity * sizeof(*tier->counts));
+	tier->referenced = malloc(capacity * sizeof(*tier->referenced));
+	tier->next = malloc(capacity * sizeof(*tier->next));
+	tier->buckets = malloc(buckets * sizeof(*tier->buckets));
+	tier->bucket_mask = buckets - 1;
+	if (!tier->blocks || !tier->counts || !tier->referenced || !tier->next || !tier->buckets)
+		return false;
+
+	clear(tier);
+	return true;
+}
+
+csalt_store *csalt_resource_tiered_init(csalt_resource *resource)
+{
+	resource_t *const resource_tiered = (resource_t *)resource;
+	tiered_t *const tiered = &resource_tiered->store;
+	const ssize_t count = resource_tiered->tier_count;
+	const ssize_t block_size = resource_tiered->block_size;
+
+	if (count < 1 || block_size < 1 || resource_tiered->promote_after < 1)
+		return NULL;
+	if (csalt_mutex_init(&tiered->lock, NULL))
+		return NULL;
+
+	tiered->tiers = resource_tiered->tiers;
+	tiered->tier_count = count;
+	tiered->block_size = block_size;
+	tiered->promote_after = resource_tiered->promote_after;
+	tiered->scratch = NULL;
+	tiered->ghosts = NULL;
+
+	for (ssize_t t = 0; t < count; t++) {
+		tier_t *const tier = &tiered->tiers[t];
+		*tier = csalt_tier(tier->resource, t < count - 1? tier->capacity: 0);
+	}
+
+	ssize_t initialized = 0;
+	for (; initialized < count; initialized++) {
+		tier_t *const tier = &tiered->tiers[initialized];
+		tier->store = csalt_resource_init(tier->resource);
+		if (!tier->store) {
+			destroy(tiered, initialized);
+			return NULL;
+		}
+	}
+
+	ssize_t cached = 0;
+	bool allocated = true;
+	for (ssize_t t = 0; t < count - 1; t++) {
+		allocated = allocated && allocate_tier(&tiered->tiers[t], block_size);
+		cached += tiered->tiers[t].capacity;
+	}
+
+	tiered->ghost_count = cached? cached * 2: 1;
+	tiered->scratch = malloc((size_t)count * (size_t)block_size);
+	tiered->ghosts = malloc((size_t)tiered->ghost_count * sizeof(*tiered->ghosts));
+	if (!allocated || !tiered->scratch || !tiered->ghosts) {
+		destroy(tiered, count);
+		return NULL;
+	}
+
+	for (ssize_t i = 0; i < tiered->ghost_count; i++)
+		tiered->ghosts[i] = (struct csalt_tier_ghost) { -1, 0 };
+	return (csalt_store *)tiered;
+}
+
+void csalt_resource_tiered_deinit(csalt_resource *resource)
+{
+	resource_t *const resource_tiered = (resource_t *)resource;
+	tiered_t *const tiered = &resource_tiered->store;
+	destroy(tiered, tiered->tier_count);
+}
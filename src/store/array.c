@@ -9,6 +9,7 @@ static const struct csalt_dynamic_store_interface impl = {
 		csalt_store_array_read,
 		csalt_store_array_write,
 		csalt_store_array_split,
+		NULL,
 	},
 	csalt_store_array_size,
 	csalt_store_array_resize,
@@ -0,0 +1,207 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/store/atomic.h"
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct csalt_store_atomic atomic_t;
+typedef unsigned __int128 uint128_t;
+
+static const struct csalt_static_store_interface impl = {
+	csalt_store_atomic_read,
+	csalt_store_atomic_write,
+	csalt_store_atomic_split,
+	NULL,
+};
+
+struct csalt_store_atomic csalt_store_atomic_bounds(void *begin, ssize_t size)
+{
+	return (atomic_t) {
+		.vtable = &impl,
+		.begin = begin,
+		.size = size,
+	};
+}
+
+static bool valid(const atomic_t *store)
+{
+	switch (store->size) {
+	case 1:
+	case 2:
+	case 4:
+	case 8:
+	case 16:
+		return !((uintptr_t)store->begin % (uintptr_t)store->size);
+	default:
+		return false;
+	}
+}
+
+/*
+ * Each operation is expanded once per supported size, using the
+ * integer type of that size. The values are copied through
+ * temporaries since the caller's buffers may not be aligned.
+ */
+#define ATOMIC_DISPATCH(store, OPERATION) \
+	switch ((store)->size) { \
+	case 1: OPERATION(uint8_t); break; \
+	case 2: OPERATION(uint16_t); break; \
+	case 4: OPERATION(uint32_t); break; \
+	case 8: OPERATION(uint64_t); break; \
+	case 16: OPERATION(uint128_t); break; \
+	}
+
+ssize_t csalt_store_atomic_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	atomic_t *const atomic = (atomic_t *)store;
+	if (!valid(atomic) || size < atomic->size)
+		return -1;
+
+#define LOAD(type) { \
+		const type value = __atomic_load_n( \
+			(type *)atomic->begin, \
+			__ATOMIC_SEQ_CST); \
+		memcpy(buffer, &value, sizeof(value)); \
+	}
+
+	ATOMIC_DISPATCH(atomic, LOAD)
+#undef LOAD
+	return atomic->size;
+}
+
+ssize_t csalt_store_atomic_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	atomic_t *const atomic = (atomic_t *)store;
+	if (!valid(atomic) || size < atomic->size)
+		return -1;
+
+#define STORE(type) { \
+		type value; \
+		memcpy(&value, buffer, sizeof(value)); \
+		__atomic_store_n((type *)atomic->begin, value, __ATOMIC_SEQ_CST); \
+	}
+
+	ATOMIC_DISPATCH(atomic, STORE)
+#undef STORE
+	return atomic->size;
+}
+
+int csalt_store_atomic_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	atomic_t *const atomic = (atomic_t *)store;
+	if (begin != 0 || end < atomic->size)
+		return -1;
+	return block(store, param);
+}
+
+int csalt_store_atomic_fetch_add(
+	atomic_t *store,
+	const void *operand,
+	void *previous
+)
+{
+	if (!valid(store))
+		return -1;
+
+#define FETCH_ADD(type) { \
+		type value; \
+		memcpy(&value, operand, sizeof(value)); \
+		value = __atomic_fetch_add( \
+			(type *)store->begin, \
+			value, \
+			__ATOMIC_SEQ_CST); \
+		if (previous) \
+			memcpy(previous, &value, sizeof(value)); \
+	}
+
+	ATOMIC_DISPATCH(store, FETCH_ADD)
+#undef FETCH_ADD
+	return 0;
+}
+
+int csalt_store_atomic_exchange(
+	atomic_t *store,
+	const void *desired,
+	void *previous
+)
+{
+	if (!valid(store))
+		return -1;
+
+#define EXCHANGE(type) { \
+		type value; \
+		memcpy(&value, desired, sizeof(value)); \
+		value = __atomic_exchange_n( \
+			(type *)store->begin, \
+			value, \
+			__ATOMIC_SEQ_CST); \
+		if (previous) \
+			memcpy(previous, &value, sizeof(value)); \
+	}
+
+	ATOMIC_DISPATCH(store, EXCHANGE)
+#undef EXCHANGE
+	return 0;
+}
+
+int csalt_store_atomic_compare_exchange(
+	atomic_t *store,
+	void *expected,
+	const void *desired
+)
+{
+	if (!valid(store))
+		return -1;
+
+	bool result = false;
+
+#define COMPARE_EXCHANGE(type) { \
+		type expected_value, desired_value; \
+		memcpy(&expected_value, expected, sizeof(expected_value)); \
+		memcpy(&desired_value, desired, sizeof(desired_value)); \
+		result = __atomic_compare_exchange_n( \
+			(type *)store->begin, \
+			&expected_value, \
+			desired_value, \
+			false, \
+			__ATOMIC_SEQ_CST, \
+			__ATOMIC_SEQ_CST); \
+		if (!result) \
+			memcpy(expected, &expected_value, sizeof(expected_value)); \
+	}
+
+	ATOMIC_DISPATCH(store, COMPARE_EXCHANGE)
+#undef COMPARE_EXCHANGE
+	return result;
+}
@@ -22,6 +22,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
 
 #include "csalt/store/base.h"
 #include "csalt/util.h"
@@ -57,6 +60,13 @@ int csalt_store_split(
 	return (*store)->split(store, start, end, block, data);
 }
 
+int csalt_store_fd(csalt_static_store *store)
+{
+	if (!(*store)->fd)
+		return -1;
+	return (*store)->fd(store);
+}
+
 ssize_t csalt_store_size(csalt_store *store)
 {
 	return (*store)->size(store);
@@ -156,3 +166,167 @@ ssize_t csalt_store_transfer(
 	return progress->amount_completed;
 }
 
+
+// Blocking transfer algorithm
+
+struct transfer_wait_params {
+	struct csalt_progress *progress;
+	long long deadline;
+	int timed_out;
+	int finished;
+
+	// Data read from the source but not yet accepted by the
+	// destination; it can't be put back, so it's written before
+	// anything else is read
+	char buffer[DEFAULT_PAGESIZE];
+	ssize_t length;
+	ssize_t written;
+};
+
+static long long now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int would_block(ssize_t result)
+{
+	return result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// Returns 0 once the store might be ready, or -1 on timeout or
+// error
+static int wait_for(
+	csalt_static_store *store,
+	short events,
+	long long deadline,
+	struct transfer_wait_params *params
+)
+{
+	int wait = -1;
+	if (deadline >= 0) {
+		const long long remaining = deadline - now_ms();
+		if (remaining <= 0) {
+			params->timed_out = 1;
+			return -1;
+		}
+		wait = (int)remaining;
+	}
+
+	struct pollfd ready = {
+		.fd = csalt_store_fd(store),
+		.events = events,
+	};
+
+	if (ready.fd == -1) {
+		sched_yield();
+		return 0;
+	}
+
+	const int result = poll(&ready, 1, wait);
+	if (result == -1)
+		return errno == EINTR? 0: -1;
+	if (!result && deadline >= 0)
+		params->timed_out = 1;
+	return result? 0: -1;
+}
+
+static int write_pending(csalt_static_store *store, void *param)
+{
+	struct transfer_wait_params *params = param;
+
+	const ssize_t amount = csalt_store_write(
+		store,
+		params->buffer + params->written,
+		params->length - params->written);
+
+	// Pending data has already left the source, so the deadline
+	// doesn't apply to writing it
+	if (would_block(amount))
+		return wait_for(store, POLLOUT, -1, params);
+	if (amount < 0)
+		return -1;
+	if (!amount) {
+		params->finished = 1;
+		return 0;
+	}
+
+	params->written += amount;
+	params->progress->amount_completed += amount;
+	return 0;
+}
+
+static int transfer_wait_split(csalt_static_store *store, void *param)
+{
+	struct transfer_wait_params *params = param;
+	struct csalt_static_store_pair *pair = (void *)store;
+
+	if (params->written == params->length) {
+		// Only read once the destination can take some of it, so
+		// a timeout doesn't leave data stranded in the buffer
+		if (
+			csalt_store_fd(pair->second) != -1 &&
+			wait_for(pair->second, POLLOUT, params->deadline, params)
+		)
+			return -1;
+
+		const ssize_t amount_read = csalt_store_read(
+			pair->first,
+			params->buffer,
+			csalt_min(
+				(ssize_t)sizeof(params->buffer),
+				csalt_progress_remaining(params->progress)));
+
+		if (would_block(amount_read))
+			return wait_for(pair->first, POLLIN, params->deadline, params);
+		if (amount_read < 0)
+			return -1;
+		if (!amount_read) {
+			params->finished = 1;
+			return 0;
+		}
+
+		params->length = amount_read;
+		params->written = 0;
+	}
+
+	return csalt_store_split(
+		pair->second,
+		0,
+		params->length - params->written,
+		write_pending,
+		params);
+}
+
+ssize_t csalt_store_transfer_wait(
+	struct csalt_progress *progress,
+	csalt_static_store *from,
+	csalt_static_store *to,
+	int timeout
+)
+{
+	struct transfer_wait_params params = {
+		.progress = progress,
+		.deadline = timeout < 0? -1: now_ms() + timeout,
+	};
+
+	const struct csalt_static_store_pair pair = csalt_static_store_pair(
+		from,
+		to
+	);
+
+	while (!csalt_progress_complete(progress) && !params.finished) {
+		const int result = csalt_store_split(
+			(csalt_static_store *)&pair,
+			progress->amount_completed,
+			progress->total,
+			transfer_wait_split,
+			&params);
+
+		if (result < 0)
+			return params.timed_out? progress->amount_completed: -1;
+	}
+
+	return progress->amount_completed;
+}
@@ -26,6 +26,12 @@ int csalt_store_decorator_split(
 	return csalt_store_split(decorator->decorated_static, begin, end, block, param);
 }
 
+int csalt_store_decorator_fd(csalt_static_store *store)
+{
+	decorator_t *decorator = (void*)store;
+	return csalt_store_fd(decorator->decorated_static);
+}
+
 ssize_t csalt_store_decorator_size(csalt_store *store)
 {
 	decorator_t *decorator = (void*)store;
@@ -1,5 +1,9 @@
 #include "csalt/store/fallback.h"
 
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
 typedef struct csalt_store_fallback fallback;
 typedef struct csalt_static_store_fallback static_fallback;
 
@@ -8,6 +12,7 @@ const struct csalt_dynamic_store_interface csalt_fallback_implementation = {
 		csalt_store_fallback_read,
 		csalt_store_fallback_write,
 		csalt_store_fallback_split,
+		NULL,
 	},
 	csalt_store_fallback_size,
 	csalt_store_fallback_resize,
@@ -21,6 +26,8 @@ fallback csalt_store_fallback(
 	return (fallback) {
 		&csalt_fallback_implementation,
 		csalt_store_pair(primary, secondary),
+		NULL,
+		0,
 	};
 }
 
@@ -32,6 +39,8 @@ static_fallback csalt_static_store_fallback(
 	return (static_fallback) {
 		&csalt_fallback_implementation.parent,
 		csalt_static_store_pair(primary, secondary),
+		NULL,
+		0,
 	};
 }
 
@@ -102,6 +111,8 @@ ssize_t csalt_store_fallback_read(
 	return amount - params.remaining;
 }
 
+static int mark_dirty(static_fallback *fb, ssize_t begin, ssize_t end);
+
 ssize_t csalt_store_fallback_write(
 	csalt_static_store *store,
 	const void *buffer,
@@ -109,10 +120,18 @@ ssize_t csalt_store_fallback_write(
 )
 {
 	static_fallback *const fb = (static_fallback*)store;
-	return csalt_store_write((csalt_static_store*)fb->pair.first, buffer, amount);
+	const ssize_t written = csalt_store_write((csalt_static_store*)fb->pair.first, buffer, amount);
+	if (written <= 0 || !fb->dirty)
+		return written;
+
+	if (mark_dirty(fb, fb->offset, fb->offset + written))
+		return -1;
+	return written;
 }
 
 struct split_params {
+	static_fallback *fallback;
+	ssize_t begin;
 	csalt_static_store_block_fn *block;
 	void *param;
 };
@@ -124,6 +143,8 @@ static int receive_pair(csalt_static_store *store, void *param)
 	struct split_params *params = param;
 
 	static_fallback fb = csalt_static_store_fallback(pair->first, pair->second);
+	fb.dirty = params->fallback->dirty;
+	fb.offset = params->fallback->offset + params->begin;
 
 	return params->block((csalt_static_store*)&fb, params->param);
 }
@@ -137,7 +158,7 @@ int csalt_store_fallback_split(
 )
 {
 	static_fallback *const fb = (static_fallback*)store;
-	struct split_params params = {block, param};
+	struct split_params params = {fb, begin, block, param};
 	return csalt_store_split(
 		(csalt_static_store*)&fb->pair,
 		begin,
@@ -200,3 +221,207 @@ int csalt_store_fallback_array_bounds(
 	return 0;
 }
 
+
+// Write-back
+
+int csalt_fallback_dirty_init(
+	struct csalt_fallback_dirty *dirty,
+	ssize_t watermark
+)
+{
+	if (csalt_mutex_init(&dirty->lock, NULL))
+		return -1;
+
+	dirty->ranges = NULL;
+	dirty->count = 0;
+	dirty->capacity = 0;
+	dirty->dirty_bytes = 0;
+	dirty->watermark = watermark;
+	dirty->fallback = NULL;
+	return 0;
+}
+
+void csalt_fallback_dirty_deinit(struct csalt_fallback_dirty *dirty)
+{
+	free(dirty->ranges);
+	dirty->ranges = NULL;
+	csalt_mutex_deinit(&dirty->lock);
+}
+
+void csalt_store_fallback_writeback(
+	static_fallback *store,
+	struct csalt_fallback_dirty *dirty
+)
+{
+	store->dirty = dirty;
+	store->offset = 0;
+	dirty->fallback = store;
+}
+
+// The index of the first range ending at or after offset
+static ssize_t first_touching(
+	const struct csalt_fallback_dirty *dirty,
+	ssize_t offset
+)
+{
+	ssize_t low = 0, high = dirty->count;
+	while (low < high) {
+		const ssize_t middle = low + (high - low) / 2;
+		if (dirty->ranges[middle].end < offset)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+// Adds [begin, end) to the set, merging it with any ranges it
+// overlaps or touches. Must be called with the lock held.
+static int insert_range(
+	struct csalt_fallback_dirty *dirty,
+	ssize_t begin,
+	ssize_t end
+)
+{
+	const ssize_t first = first_touching(dirty, begin);
+	ssize_t last = first;
+	while (last < dirty->count && dirty->ranges[last].begin <= end)
+		last++;
+
+	if (first == last) {
+		if (dirty->count == dirty->capacity) {
+			const ssize_t capacity = dirty->capacity? dirty->capacity * 2: 16;
+			struct csalt_fallback_range *const ranges = realloc(
+				dirty->ranges,
+				(size_t)capacity * sizeof(*ranges));
+			if (!ranges)
+				return -1;
+			dirty->ranges = ranges;
+			dirty->capacity = capacity;
+		}
+
+		memmove(
+			dirty->ranges + first + 1,
+			dirty->ranges + first,
+			(size_t)(dirty->count - first) * sizeof(*dirty->ranges));
+		dirty->ranges[first] = (struct csalt_fallback_range) { begin, end };
+		dirty->count++;
+		dirty->dirty_bytes += end - begin;
+		return 0;
+	}
+
+	for (ssize_t i = first; i < last; i++)
+		dirty->dirty_bytes -= dirty->ranges[i].end - dirty->ranges[i].begin;
+
+	struct csalt_fallback_range *const merged = &dirty->ranges[first];
+	merged->begin = csalt_min(merged->begin, begin);
+	merged->end = csalt_max(dirty->ranges[last - 1].end, end);
+	dirty->dirty_bytes += merged->end - merged->begin;
+
+	memmove(
+		dirty->ranges + first + 1,
+		dirty->ranges + last,
+		(size_t)(dirty->count - last) * sizeof(*dirty->ranges));
+	dirty->count -= last - first - 1;
+	return 0;
+}
+
+static int receive_flush_range(csalt_static_store *store, void *param)
+{
+	struct csalt_static_store_pair *const pair
+		= (struct csalt_static_store_pair *)store;
+	const ssize_t size = *(ssize_t *)param;
+
+	// A secondary which stops accepting data fails the range,
+	// rather than being retried forever
+	struct csalt_progress progress = csalt_progress(size);
+	while (!csalt_progress_complete(&progress)) {
+		const ssize_t before = progress.amount_completed;
+		if (csalt_store_transfer(&progress, pair->first, pair->second) <= before)
+			return -1;
+	}
+	return 0;
+}
+
+static int flush_range(static_fallback *root, ssize_t begin, ssize_t end)
+{
+	ssize_t size = end - begin;
+	return csalt_store_split(
+		(csalt_static_store *)&root->pair,
+		begin,
+		end,
+		receive_flush_range,
+		&size);
+}
+
+static int mark_dirty(static_fallback *fb, ssize_t begin, ssize_t end)
+{
+	struct csalt_fallback_dirty *const dirty = fb->dirty;
+	csalt_mutex_lock(&dirty->lock);
+	const int inserted = insert_range(dirty, begin, end);
+	const bool full = dirty->watermark > 0
+		&& dirty->dirty_bytes > dirty->watermark;
+	csalt_mutex_unlock(&dirty->lock);
+
+	// With nowhere to record the range, it's written back
+	// straight away instead
+	if (inserted)
+		return flush_range(dirty->fallback, begin, end);
+	if (full)
+		return csalt_store_fallback_flush_dirty(fb) < 0? -1: 0;
+	return 0;
+}
+
+ssize_t csalt_store_fallback_flush_dirty(static_fallback *store)
+{
+	struct csalt_fallback_dirty *const dirty = store->dirty;
+	if (!dirty)
+		return 0;
+
+	// The ranges are taken out of the set before copying, so any
+	// range written while copying is marked dirty again
+	csalt_mutex_lock(&dirty->lock);
+	struct csalt_fallback_range *const ranges = dirty->ranges;
+	const ssize_t count = dirty->count;
+	dirty->ranges = NULL;
+	dirty->count = 0;
+	dirty->capacity = 0;
+	dirty->dirty_bytes = 0;
+	csalt_mutex_unlock(&dirty->lock);
+
+	ssize_t flushed = 0;
+	ssize_t i = 0;
+	for (; i < count; i++) {
+		if (flush_range(dirty->fallback, ranges[i].begin, ranges[i].end))
+			break;
+		flushed += ranges[i].end - ranges[i].begin;
+	}
+
+	if (i < count) {
+		csalt_mutex_lock(&dirty->lock);
+		for (; i < count; i++)
+			insert_range(dirty, ranges[i].begin, ranges[i].end);
+		csalt_mutex_unlock(&dirty->lock);
+		flushed = -1;
+	}
+
+	free(ranges);
+	return flushed;
+}
+
+int csalt_store_fallback_flush_job(void *param)
+{
+	return csalt_store_fallback_flush_dirty(param) < 0? -1: 0;
+}
+
+ssize_t csalt_store_fallback_dirty(static_fallback *store)
+{
+	struct csalt_fallback_dirty *const dirty = store->dirty;
+	if (!dirty)
+		return 0;
+
+	csalt_mutex_lock(&dirty->lock);
+	const ssize_t result = dirty->dirty_bytes;
+	csalt_mutex_unlock(&dirty->lock);
+	return result;
+}
@@ -0,0 +1,253 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/store/list.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct csalt_store_list list_t;
+typedef struct csalt_static_store_list static_list_t;
+typedef struct csalt_store_multisplit_split split_t;
+
+static const struct csalt_dynamic_store_interface impl = {
+	{
+		csalt_store_list_read,
+		csalt_store_list_write,
+		csalt_store_list_split,
+		NULL,
+	},
+	csalt_store_list_size,
+	csalt_store_list_resize,
+};
+
+struct csalt_store_list csalt_store_list_bounds(
+	csalt_store **begin,
+	csalt_store **end
+)
+{
+	return (list_t) {
+		.vtable = &impl,
+		.begin = begin,
+		.end = end,
+	};
+}
+
+struct csalt_static_store_list csalt_static_store_list_bounds(
+	csalt_static_store **begin,
+	csalt_static_store **end
+)
+{
+	return (static_list_t) {
+		.vtable = &impl.parent,
+		.begin = begin,
+		.end = end,
+	};
+}
+
+struct csalt_store_list csalt_store_list_from_pairs_bounds(
+	const struct csalt_store_pair *pairs,
+	csalt_store **out_begin,
+	csalt_store **out_end
+)
+{
+	if (csalt_store_pair_list_length(pairs) > out_end - out_begin)
+		return csalt_store_list_bounds(out_begin, out_begin);
+
+	csalt_store **out = out_begin;
+	for (; pairs; pairs = (const struct csalt_store_pair *)pairs->second)
+		*out++ = pairs->first;
+	return csalt_store_list_bounds(out_begin, out);
+}
+
+ssize_t csalt_store_list_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	static_list_t *const list = (static_list_t *)store;
+	for (csalt_static_store **i = list->begin; i < list->end; i++) {
+		if (!*i)
+			continue;
+		const ssize_t result = csalt_store_read(*i, buffer, size);
+		if (result)
+			return result;
+	}
+	return 0;
+}
+
+ssize_t csalt_store_list_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	static_list_t *const list = (static_list_t *)store;
+	ssize_t result = SSIZE_MAX;
+	for (csalt_static_store **i = list->begin; i < list->end; i++) {
+		if (!*i)
+			continue;
+		const ssize_t written = csalt_store_write(*i, buffer, size);
+		if (written < 0)
+			return written;
+		result = csalt_min(result, written);
+	}
+	return result == SSIZE_MAX ? 0 : result;
+}
+
+ssize_t csalt_store_list_size(csalt_store *store)
+{
+	list_t *const list = (list_t *)store;
+	ssize_t result = SSIZE_MAX;
+	for (csalt_store **i = list->begin; i < list->end; i++)
+		if (*i)
+			result = csalt_min(result, csalt_store_size(*i));
+	return result == SSIZE_MAX ? 0 : result;
+}
+
+ssize_t csalt_store_list_resize(csalt_store *store, ssize_t new_size)
+{
+	list_t *const list = (list_t *)store;
+	ssize_t result = SSIZE_MAX;
+	for (csalt_store **i = list->begin; i < list->end; i++)
+		if (*i)
+			result = csalt_min(result, csalt_store_resize(*i, new_size));
+	return result == SSIZE_MAX ? -1 : result;
+}
+
+ssize_t csalt_store_list_length(const list_t *list)
+{
+	return list->end - list->begin;
+}
+
+csalt_store *csalt_store_list_get(const list_t *list, ssize_t index)
+{
+	if (index < 0 || index >= csalt_store_list_length(list))
+		return NULL;
+	return list->begin[index];
+}
+
+struct split_params {
+	const static_list_t *list;
+	csalt_static_store **stores;
+	ssize_t index;
+	const split_t *begin;
+	const split_t *end;
+	bool repeat;
+	csalt_static_store_block_fn *block;
+	void *param;
+};
+
+static const split_t *split_at(const struct split_params *params, ssize_t index)
+{
+	if (params->repeat)
+		return params->begin;
+	if (index < params->end - params->begin)
+		return params->begin + index;
+	return NULL;
+}
+
+static int receive_split(csalt_static_store *store, void *param);
+
+// Only stores which are actually split nest another call; empty
+// entries and stores past the end of the splits are copied in place
+static int split_next(struct split_params *params)
+{
+	const static_list_t *const list = params->list;
+	const ssize_t count = list->end - list->begin;
+
+	for (; params->index < count; params->index++) {
+		csalt_static_store *const store = list->begin[params->index];
+		const split_t *const split = split_at(params, params->index);
+		if (store && split)
+			return csalt_store_split(
+				store,
+				split->begin,
+				split->end,
+				receive_split,
+				params);
+		params->stores[params->index] = store;
+	}
+
+	static_list_t split = *list;
+	split.begin = params->stores;
+	split.end = params->stores + count;
+	return params->block((csalt_static_store *)&split, params->param);
+}
+
+static int receive_split(csalt_static_store *store, void *param)
+{
+	struct split_params *const params = param;
+	params->stores[params->index++] = store;
+	return split_next(params);
+}
+
+static int split_list(
+	const static_list_t *list,
+	const split_t *begin,
+	const split_t *end,
+	bool repeat,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	csalt_static_store *stores[csalt_max(list->end - list->begin, 1)];
+
+	struct split_params params = {
+		list,
+		stores,
+		0,
+		begin,
+		end,
+		repeat,
+		block,
+		param,
+	};
+
+	return split_next(&params);
+}
+
+int csalt_store_list_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	const split_t split = { begin, end };
+	return split_list(
+		(static_list_t *)store,
+		&split,
+		&split + 1,
+		true,
+		block,
+		param);
+}
+
+int csalt_store_list_multisplit_bounds(
+	const static_list_t *list,
+	const split_t *begin,
+	const split_t *end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	return split_list(list, begin, end, false, block, param);
+}
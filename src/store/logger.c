@@ -47,9 +47,8 @@ static int use_format(csalt_store *store, void *param)
 {
 	csalt_static_store **output = param;
 	struct csalt_progress progress = csalt_progress(csalt_store_size(store));
-	while (!csalt_progress_complete(&progress))
-		if (csalt_store_transfer(&progress, (void*)store, *output) == -1)
-			return -1;
+	if (csalt_store_transfer_wait(&progress, (void*)store, *output, -1) == -1)
+		return -1;
 	return 0;
 }
 
@@ -205,6 +204,7 @@ const struct csalt_dynamic_store_interface impl = {
 		csalt_store_logger_read,
 		csalt_store_logger_write,
 		csalt_store_logger_split,
+		csalt_store_decorator_fd,
 	},
 	csalt_store_decorator_size,
 	csalt_store_logger_resize,
@@ -6,6 +6,7 @@ const struct csalt_static_store_interface mem_impl = {
 	csalt_store_memory_read,
 	csalt_store_memory_write,
 	csalt_store_memory_split,
+	NULL,
 };
 
 struct csalt_store_memory csalt_store_memory_bounds(void *begin, void *end)
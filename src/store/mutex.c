@@ -7,6 +7,7 @@ static const struct csalt_dynamic_store_interface impl = {
 		csalt_store_mutex_read,
 		csalt_store_mutex_write,
 		csalt_store_mutex_split,
+		csalt_store_decorator_fd,
 	},
 	csalt_store_decorator_size,
 	csalt_store_decorator_resize,
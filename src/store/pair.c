@@ -30,6 +30,7 @@ static const struct csalt_dynamic_store_interface csalt_store_pair_implementatio
 		csalt_store_pair_read,
 		csalt_store_pair_write,
 		csalt_store_pair_split,
+		NULL,
 	},
 	csalt_store_pair_size,
 	csalt_store_pair_resize,
@@ -246,11 +247,13 @@ csalt_store *csalt_store_pair_list_get(
 	ssize_t index
 )
 {
+	if (index < 0)
+		return 0;
+	for (; pairs && index > 0; index--)
+		pairs = (struct csalt_store_pair *)pairs->second;
 	if (!pairs)
 		return 0;
-	if (index == 0)
-		return pairs->first;
-	return csalt_store_pair_list_get((void *)pairs->second, index - 1);
+	return pairs->first;
 }
 
 struct csalt_store_multisplit_params {
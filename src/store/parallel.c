@@ -0,0 +1,39 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/store/parallel.h"
+
+int csalt_store_parallel_run(
+	struct csalt_store_parallel *parallel,
+	csalt_store_task_fn *task,
+	void *params,
+	ssize_t size,
+	ssize_t count
+)
+{
+	if (count <= 0)
+		return 0;
+	if (parallel)
+		return parallel->run(parallel, task, params, size, count);
+
+	int error = 0;
+	for (ssize_t i = 0; i < count; i++)
+		if (task((char *)params + i * size))
+			error = -1;
+	return error;
+}
@@ -0,0 +1,345 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/store/striped.h"
+
+#include <stdint.h>
+
+typedef struct csalt_store_striped striped_t;
+typedef struct csalt_static_store_striped static_striped_t;
+
+static const struct csalt_dynamic_store_interface impl = {
+	{
+		csalt_store_striped_read,
+		csalt_store_striped_write,
+		csalt_store_striped_split,
+		NULL,
+	},
+	csalt_store_striped_size,
+	csalt_store_striped_resize,
+};
+
+struct csalt_store_striped csalt_store_striped_bounds(
+	csalt_store **begin,
+	csalt_store **end,
+	ssize_t stripe_unit,
+	struct csalt_store_parallel *parallel
+)
+{
+	return (striped_t) {
+		.vtable = &impl,
+		.begin = begin,
+		.end = end,
+		.stripe_unit = stripe_unit,
+		.parallel = parallel,
+		.origin = 0,
+	};
+}
+
+static ssize_t device_count(const static_striped_t *striped)
+{
+	return striped->end - striped->begin;
+}
+
+// Returns where on the device the first of its bytes at or after
+// the given position in the stripe pattern is
+static ssize_t device_offset(
+	const static_striped_t *striped,
+	ssize_t device,
+	ssize_t position
+)
+{
+	const ssize_t unit = striped->stripe_unit;
+	const ssize_t stripe = position / unit;
+	const ssize_t row = stripe / device_count(striped);
+	const ssize_t owner = stripe % device_count(striped);
+
+	if (device == owner)
+		return row * unit + position % unit;
+	if (device > owner)
+		return row * unit;
+	return (row + 1) * unit;
+}
+
+// Returns where in this store a byte on the device is
+static ssize_t logical_offset(
+	const static_striped_t *striped,
+	ssize_t device,
+	ssize_t offset
+)
+{
+	const ssize_t unit = striped->stripe_unit;
+	const ssize_t position = offset
+		+ device_offset(striped, device, striped->origin);
+	const ssize_t stripe = position / unit * device_count(striped) + device;
+	return stripe * unit + position % unit - striped->origin;
+}
+
+struct device_transfer {
+	const static_striped_t *striped;
+	ssize_t device;
+	char *read_buffer;
+	const char *write_buffer;
+	ssize_t size;
+
+	// Where in the buffer the device stopped short, or size
+	ssize_t end;
+};
+
+struct stripe_transfer {
+	struct device_transfer *transfer;
+	ssize_t position;
+	ssize_t amount;
+	ssize_t result;
+};
+
+static int receive_stripe(csalt_static_store *store, void *param)
+{
+	struct stripe_transfer *const stripe = param;
+	struct device_transfer *const transfer = stripe->transfer;
+
+	if (transfer->read_buffer)
+		stripe->result = csalt_store_read(
+			store,
+			transfer->read_buffer + stripe->position,
+			stripe->amount);
+	else
+		stripe->result = csalt_store_write(
+			store,
+			transfer->write_buffer + stripe->position,
+			stripe->amount);
+
+	return stripe->result < 0 ? -1 : 0;
+}
+
+static int transfer_device(void *param)
+{
+	struct device_transfer *const transfer = param;
+	const static_striped_t *const striped = transfer->striped;
+	const ssize_t count = device_count(striped);
+	const ssize_t unit = striped->stripe_unit;
+	const ssize_t origin = striped->origin;
+	const ssize_t base = device_offset(striped, transfer->device, origin);
+
+	const ssize_t first = origin / unit;
+	const ssize_t last = (origin + transfer->size - 1) / unit;
+	ssize_t stripe = first
+		+ (transfer->device - first % count + count) % count;
+
+	transfer->end = transfer->size;
+	for (; stripe <= last; stripe += count) {
+		const ssize_t begin = csalt_max(stripe * unit, origin);
+		const ssize_t end = csalt_min((stripe + 1) * unit, origin + transfer->size);
+		const ssize_t offset = stripe / count * unit
+			+ begin - stripe * unit
+			- base;
+
+		struct stripe_transfer params = {
+			transfer,
+			begin - origin,
+			end - begin,
+			-1,
+		};
+
+		if (csalt_store_split(
+			striped->begin[transfer->device],
+			offset,
+			offset + params.amount,
+			receive_stripe,
+			&params
+		) || params.result < 0)
+			return -1;
+
+		if (params.result < params.amount) {
+			transfer->end = params.position + params.result;
+			break;
+		}
+	}
+	return 0;
+}
+
+static ssize_t transfer(
+	const static_striped_t *striped,
+	void *read_buffer,
+	const void *write_buffer,
+	ssize_t size
+)
+{
+	if (striped->stripe_unit < 1)
+		return -1;
+
+	const ssize_t count = device_count(striped);
+	if (!count || size <= 0)
+		return 0;
+
+	const ssize_t unit = striped->stripe_unit;
+	const ssize_t first = striped->origin / unit;
+	const ssize_t last = (striped->origin + size - 1) / unit;
+	const ssize_t devices = csalt_min(count, last - first + 1);
+
+	struct device_transfer transfers[devices];
+	for (ssize_t i = 0; i < devices; i++)
+		transfers[i] = (struct device_transfer) {
+			striped,
+			(first + i) % count,
+			read_buffer,
+			write_buffer,
+			size,
+			size,
+		};
+
+	if (csalt_store_parallel_run(
+		striped->parallel,
+		transfer_device,
+		transfers,
+		sizeof(*transfers),
+		devices
+	))
+		return -1;
+
+	ssize_t result = size;
+	for (ssize_t i = 0; i < devices; i++)
+		result = csalt_min(result, transfers[i].end);
+	return result;
+}
+
+ssize_t csalt_store_striped_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	return transfer((static_striped_t *)store, buffer, NULL, size);
+}
+
+ssize_t csalt_store_striped_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	return transfer((static_striped_t *)store, NULL, buffer, size);
+}
+
+struct split_params {
+	const static_striped_t *striped;
+	csalt_static_store **devices;
+	ssize_t index;
+	ssize_t begin;
+	ssize_t end;
+	csalt_static_store_block_fn *block;
+	void *param;
+};
+
+static int receive_split(csalt_static_store *store, void *param)
+{
+	struct split_params *const params = param;
+	const static_striped_t *const striped = params->striped;
+	const ssize_t count = device_count(striped);
+
+	if (store)
+		params->devices[params->index++] = store;
+
+	if (params->index < count) {
+		const ssize_t base = device_offset(
+			striped,
+			params->index,
+			striped->origin);
+		return csalt_store_split(
+			striped->begin[params->index],
+			device_offset(striped, params->index, params->begin) - base,
+			device_offset(striped, params->index, params->end) - base,
+			receive_split,
+			params);
+	}
+
+	static_striped_t split = *striped;
+	split.begin = params->devices;
+	split.end = params->devices + count;
+	split.origin = params->begin % (striped->stripe_unit * count);
+	return params->block((csalt_static_store *)&split, params->param);
+}
+
+int csalt_store_striped_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	static_striped_t *const striped = (static_striped_t *)store;
+	if (striped->stripe_unit < 1)
+		return -1;
+
+	const ssize_t count = device_count(striped);
+	if (!count)
+		return block(store, param);
+
+	begin = csalt_max(begin, 0);
+	end = csalt_max(end, begin);
+	csalt_static_store *devices[count];
+
+	struct split_params params = {
+		striped,
+		devices,
+		0,
+		striped->origin + begin,
+		striped->origin + end,
+		block,
+		param,
+	};
+
+	return receive_split(NULL, &params);
+}
+
+ssize_t csalt_store_striped_size(csalt_store *store)
+{
+	const static_striped_t *const striped = (static_striped_t *)store;
+	const ssize_t count = device_count(striped);
+	if (striped->stripe_unit < 1)
+		return -1;
+	if (!count)
+		return 0;
+
+	ssize_t result = SSIZE_MAX;
+	for (ssize_t i = 0; i < count; i++) {
+		const ssize_t size = csalt_store_size((csalt_store *)striped->begin[i]);
+		if (size < 0)
+			return -1;
+		result = csalt_min(result, logical_offset(striped, i, size));
+	}
+	return result;
+}
+
+ssize_t csalt_store_striped_resize(csalt_store *store, ssize_t new_size)
+{
+	const static_striped_t *const striped = (static_striped_t *)store;
+	const ssize_t count = device_count(striped);
+	if (striped->stripe_unit < 1 || !count)
+		return -1;
+
+	const ssize_t end = striped->origin + csalt_max(new_size, 0);
+	for (ssize_t i = 0; i < count; i++)
+		csalt_store_resize(
+			(csalt_store *)striped->begin[i],
+			device_offset(striped, i, end)
+				- device_offset(striped, i, striped->origin));
+
+	return csalt_store_striped_size(store);
+}
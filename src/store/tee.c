@@ -0,0 +1,213 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "csalt/store/tee.h"
+
+#include <stdint.h>
+
+typedef struct csalt_store_tee tee_t;
+
+static const struct csalt_static_store_interface impl = {
+	csalt_store_tee_read,
+	csalt_store_tee_write,
+	csalt_store_tee_split,
+	NULL,
+};
+
+struct csalt_store_tee csalt_store_tee_bounds(
+	csalt_static_store **begin,
+	csalt_static_store **end,
+	struct csalt_progress *progress,
+	struct csalt_store_parallel *parallel
+)
+{
+	for (ssize_t i = 0; i < end - begin; i++)
+		progress[i] = csalt_progress(0);
+
+	return (tee_t) {
+		.vtable = &impl,
+		.begin = begin,
+		.end = end,
+		.progress = progress,
+		.parallel = parallel,
+	};
+}
+
+ssize_t csalt_store_tee_position(const tee_t *tee)
+{
+	ssize_t result = SSIZE_MAX;
+	for (ssize_t i = 0; i < tee->end - tee->begin; i++)
+		result = csalt_min(result, tee->progress[i].amount_completed);
+	return tee->begin < tee->end ? result : 0;
+}
+
+ssize_t csalt_store_tee_read(
+	csalt_static_store *store,
+	void *buffer,
+	ssize_t size
+)
+{
+	tee_t *const tee = (tee_t *)store;
+	if (tee->begin >= tee->end)
+		return 0;
+	return csalt_store_read(*tee->begin, buffer, size);
+}
+
+struct sink_write {
+	csalt_static_store *sink;
+	struct csalt_progress *progress;
+	const char *buffer;
+	ssize_t size;
+
+	// Where in the stream the buffer starts
+	ssize_t offset;
+};
+
+static int receive_sink(csalt_static_store *sink, void *param)
+{
+	struct sink_write *const write = param;
+	struct csalt_progress *const progress = write->progress;
+	const ssize_t skip = progress->amount_completed - write->offset;
+
+	const ssize_t result = csalt_store_write(
+		sink,
+		write->buffer + skip,
+		write->size - skip);
+
+	if (result < 0)
+		return -1;
+	progress->amount_completed += result;
+	return 0;
+}
+
+// A sink ahead of the slowest one has already accepted the start
+// of the buffer, so it's split to where it got to before writing
+// the rest
+static int write_sink(void *param)
+{
+	struct sink_write *const write = param;
+	const ssize_t skip = write->progress->amount_completed - write->offset;
+	if (!skip)
+		return receive_sink(write->sink, write);
+
+	return csalt_store_split(
+		write->sink,
+		skip,
+		write->size,
+		receive_sink,
+		write);
+}
+
+ssize_t csalt_store_tee_write(
+	csalt_static_store *store,
+	const void *buffer,
+	ssize_t size
+)
+{
+	tee_t *const tee = (tee_t *)store;
+	const ssize_t count = tee->end - tee->begin;
+	if (!count)
+		return 0;
+
+	// The caller passes again whatever the slowest sink didn't
+	// accept, so the buffer starts at its position
+	const ssize_t offset = csalt_store_tee_position(tee);
+
+	// Sinks which have already accepted the whole buffer are left
+	// out of the batch
+	struct sink_write writes[count];
+	ssize_t pending = 0;
+	for (ssize_t i = 0; i < count; i++) {
+		if (tee->progress[i].amount_completed - offset >= size)
+			continue;
+		writes[pending++] = (struct sink_write) {
+			tee->begin[i],
+			&tee->progress[i],
+			buffer,
+			size,
+			offset,
+		};
+	}
+
+	if (csalt_store_parallel_run(
+		tee->parallel,
+		write_sink,
+		writes,
+		sizeof(*writes),
+		pending
+	))
+		return -1;
+	return csalt_store_tee_position(tee) - offset;
+}
+
+struct split_params {
+	tee_t *tee;
+	csalt_static_store **sinks;
+	ssize_t index;
+	ssize_t begin;
+	ssize_t end;
+	csalt_static_store_block_fn *block;
+	void *param;
+};
+
+static int receive_split(csalt_static_store *store, void *param)
+{
+	struct split_params *const params = param;
+	tee_t *const tee = params->tee;
+	const ssize_t count = tee->end - tee->begin;
+
+	if (store)
+		params->sinks[params->index++] = store;
+
+	if (params->index < count)
+		return csalt_store_split(
+			tee->begin[params->index],
+			params->begin,
+			params->end,
+			receive_split,
+			params);
+
+	tee_t split = *tee;
+	split.begin = params->sinks;
+	split.end = params->sinks + count;
+	return params->block((csalt_static_store *)&split, params->param);
+}
+
+int csalt_store_tee_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	tee_t *const tee = (tee_t *)store;
+	csalt_static_store *sinks[csalt_max(tee->end - tee->begin, 1)];
+
+	struct split_params params = {
+		tee,
+		sinks,
+		0,
+		begin,
+		end,
+		block,
+		param,
+	};
+
+	return receive_split(NULL, &params);
+}
@@ -1,5 +1,7 @@
 #include "csalt/util.h"
 
+#include <string.h>
+
 void *csalt_lfind(
 	const void *key,
 	const struct csalt_array array,
@@ -17,3 +19,39 @@ void *csalt_lfind(
 	return NULL;
 }
 
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15ull
+
+static uint64_t hash_mix(uint64_t hash, uint64_t word)
+{
+	hash ^= word * HASH_MULTIPLIER;
+	hash = (hash << 31) | (hash >> 33);
+	return hash * 0xbf58476d1ce4e5b9ull;
+}
+
+uint64_t csalt_hash(const void *data, size_t size, uint64_t seed)
+{
+	const unsigned char *bytes = data;
+	uint64_t hash = seed ^ (size * HASH_MULTIPLIER);
+
+	for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		hash = hash_mix(hash, word);
+		bytes += sizeof(word);
+	}
+
+	if (size) {
+		uint64_t word = 0;
+		memcpy(&word, bytes, size);
+		hash = hash_mix(hash, word);
+	}
+
+	// Finalizer from MurmurHash3, so every input bit affects
+	// every output bit
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
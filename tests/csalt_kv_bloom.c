@@ -0,0 +1,184 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/kvs.h>
+#include <csalt/resources.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define KEYS 2000
+#define BITS_PER_KEY 10
+#define PROBES 20000
+
+static ssize_t key(char *buffer, const char *prefix, int i)
+{
+	return snprintf(buffer, 32, "%s%d", prefix, i);
+}
+
+static void expect_members(const struct csalt_bloom *bloom)
+{
+	char buffer[32];
+	for (int i = 0; i < KEYS; i++) {
+		const ssize_t size = key(buffer, "member", i);
+		if (!csalt_bloom_contains(bloom, buffer, size))
+			print_error_and_exit("Filter lost key %d", i);
+	}
+}
+
+static int false_positives(const struct csalt_bloom *bloom)
+{
+	char buffer[32];
+	int result = 0;
+	for (int i = 0; i < PROBES; i++) {
+		const ssize_t size = key(buffer, "absent", i);
+		result += csalt_bloom_contains(bloom, buffer, size);
+	}
+	return result;
+}
+
+static int read_int(csalt_static_store *store, void *param)
+{
+	return csalt_store_read(store, param, sizeof(int)) == sizeof(int)? 0: -1;
+}
+
+static int use_kv(csalt_static_store *store, void *param)
+{
+	struct csalt_bloom *const bloom = param;
+	csalt_kv *table = (csalt_kv *)store;
+	char buffer[32];
+
+	// Keys already in the decorated store are added by filling
+	for (int i = 0; i < KEYS / 2; i++) {
+		struct csalt_store_memory value = csalt_store_memory(i);
+		csalt_kv_put(table, buffer, key(buffer, "member", i), (csalt_static_store *)&value, sizeof(i));
+	}
+
+	struct csalt_kv_bloom filtered = csalt_kv_bloom(table, bloom);
+	csalt_kv *kv = (csalt_kv *)&filtered;
+	if (csalt_kv_bloom_fill(&filtered))
+		print_error_and_exit("Filling the filter failed");
+
+	for (int i = KEYS / 2; i < KEYS; i++) {
+		struct csalt_store_memory value = csalt_store_memory(i);
+		if (csalt_kv_put(kv, buffer, key(buffer, "member", i), (csalt_static_store *)&value, sizeof(i)))
+			print_error_and_exit("Put through the filter failed");
+	}
+
+	for (int i = 0; i < KEYS; i++) {
+		int value = -1;
+		if (csalt_kv_get(kv, buffer, key(buffer, "member", i), read_int, &value) || value != i)
+			print_error_and_exit("Get of key %d through the filter failed", i);
+	}
+	if (filtered.skipped)
+		print_error_and_exit("Filter skipped a present key");
+
+	for (int i = 0; i < PROBES; i++) {
+		int value;
+		if (!csalt_kv_get(kv, buffer, key(buffer, "absent", i), read_int, &value))
+			print_error_and_exit("Found a missing key");
+	}
+	if (filtered.skipped < PROBES * 95 / 100)
+		print_error_and_exit("Filter only skipped %zu of %d missing keys", filtered.skipped, PROBES);
+
+	if (csalt_kv_remove(kv, buffer, key(buffer, "member", 0)))
+		print_error_and_exit("Remove through the filter failed");
+	int value;
+	if (!csalt_kv_get(kv, buffer, key(buffer, "member", 0), read_int, &value))
+		print_error_and_exit("Removed key still found");
+	return 0;
+}
+
+int main()
+{
+	struct csalt_bloom bloom;
+	if (csalt_bloom_init(&bloom, KEYS, BITS_PER_KEY))
+		print_error_and_exit("Unable to initialize filter");
+
+	if (false_positives(&bloom))
+		print_error_and_exit("Empty filter contains keys");
+
+	char buffer[32];
+	for (int i = 0; i < KEYS; i++)
+		csalt_bloom_add(&bloom, buffer, key(buffer, "member", i));
+	expect_members(&bloom);
+
+	// About 1% at 10 bits per key
+	const int positives = false_positives(&bloom);
+	if (positives > PROBES * 3 / 100)
+		print_error_and_exit("False positive rate too high: %d in %d", positives, PROBES);
+
+	// Saving, then using the saved filter without copying it
+	{
+		struct csalt_resource_heap heap = csalt_resource_heap(csalt_bloom_size(&bloom));
+		struct csalt_store_heap *const store
+			= (struct csalt_store_heap *)csalt_resource_init(csalt_resource(&heap));
+		if (!store)
+			print_error_and_exit("Unable to allocate heap");
+		if (csalt_bloom_save(&bloom, (csalt_static_store *)store))
+			print_error_and_exit("Saving the filter failed");
+
+		struct csalt_bloom view;
+		if (csalt_bloom_view(&view, store->begin, csalt_bloom_size(&bloom)))
+			print_error_and_exit("Viewing the saved filter failed");
+		if ((char *)view.blocks != (char *)store->begin + CSALT_BLOOM_HEADER_SIZE)
+			print_error_and_exit("Viewing the filter copied it");
+		expect_members(&view);
+		if (false_positives(&view) != positives)
+			print_error_and_exit("Viewed filter answers differently");
+		csalt_bloom_deinit(&view);
+
+		struct csalt_bloom loaded;
+		if (csalt_bloom_load(&loaded, (csalt_static_store *)store))
+			print_error_and_exit("Loading the saved filter failed");
+		expect_members(&loaded);
+		csalt_bloom_deinit(&loaded);
+
+		char too_small[CSALT_BLOOM_HEADER_SIZE];
+		struct csalt_store_memory short_store = csalt_store_memory_array(too_small);
+		if (!csalt_bloom_save(&bloom, (csalt_static_store *)&short_store))
+			print_error_and_exit("Saved the filter into a store too small for it");
+
+		struct csalt_bloom invalid;
+		if (!csalt_bloom_view(&invalid, store->begin, csalt_bloom_size(&bloom) - 1))
+			print_error_and_exit("Viewed a truncated filter");
+		memset(store->begin, 0, CSALT_BLOOM_HEADER_SIZE);
+		if (!csalt_bloom_view(&invalid, store->begin, csalt_bloom_size(&bloom)))
+			print_error_and_exit("Viewed a filter without a header");
+		if (!csalt_bloom_load(&invalid, (csalt_static_store *)store))
+			print_error_and_exit("Loaded a filter without a header");
+
+		csalt_resource_deinit(csalt_resource(&heap));
+	}
+
+	csalt_bloom_deinit(&bloom);
+
+	// Filtering a key/value store
+	{
+		if (csalt_bloom_init(&bloom, KEYS, BITS_PER_KEY))
+			print_error_and_exit("Unable to initialize filter");
+		struct csalt_resource_kv_hash table = csalt_resource_kv_hash(0);
+		if (csalt_static_resource_use((csalt_static_resource *)&table, use_kv, &bloom))
+			print_error_and_exit("Filtered key/value tests failed");
+		csalt_bloom_deinit(&bloom);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,353 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/kvs.h>
+#include <csalt/resources.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define KEYS 5000
+#define LOADED 20000
+#define LONG_PREFIX 900
+
+char path[] = "/tmp/csalt_kv_btree_XXXXXX";
+int present[KEYS];
+
+struct csalt_store_kv_btree *tree;
+
+static void make_key(char *key, int i)
+{
+	snprintf(key, 16, "key-%06d", i);
+}
+
+static void put_int(const void *key, ssize_t key_size, int value)
+{
+	struct csalt_store_memory store = csalt_store_memory(value);
+	if (csalt_kv_put(
+		(csalt_kv *)tree,
+		key,
+		key_size,
+		(csalt_static_store *)&store,
+		sizeof(value)
+	))
+		print_error_and_exit("Put of value %d failed", value);
+}
+
+static int read_int(csalt_static_store *store, void *param)
+{
+	return csalt_store_read(store, param, sizeof(int)) == sizeof(int)? 0: -1;
+}
+
+static int get_int(const void *key, ssize_t key_size, int *value)
+{
+	return csalt_kv_get((csalt_kv *)tree, key, key_size, read_int, value);
+}
+
+static void check_all(const char *when)
+{
+	for (int i = 0; i < KEYS; i++) {
+		char key[16];
+		make_key(key, i);
+		int value = -1;
+		const int result = get_int(key, (ssize_t)strlen(key), &value);
+		if (present[i] && (result || value != present[i]))
+			print_error_and_exit("Key %d was %d %s", i, value, when);
+		if (!present[i] && result != -1)
+			print_error_and_exit("Removed key %d found %s", i, when);
+	}
+}
+
+struct order {
+	char last[LONG_PREFIX + 16];
+	ssize_t last_size;
+	int count;
+};
+
+static int check_order(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	(void)value;
+	struct order *const order = param;
+	if (order->count) {
+		const int compared = memcmp(
+			order->last,
+			key,
+			(size_t)csalt_min(order->last_size, key_size));
+		if (compared > 0 || (!compared && order->last_size >= key_size))
+			print_error_and_exit("Keys out of order at %d", order->count);
+	}
+
+	memcpy(order->last, key, (size_t)key_size);
+	order->last_size = key_size;
+	order->count++;
+	return 0;
+}
+
+static int use_tree(csalt_static_store *store, void *param)
+{
+	(void)param;
+	tree = (struct csalt_store_kv_btree *)store;
+
+	// Insert in a scattered order
+	for (int i = 0; i < KEYS; i++) {
+		const int n = (int)(((long)i * 7919) % KEYS);
+		char key[16];
+		make_key(key, n);
+		present[n] = n + 1;
+		put_int(key, (ssize_t)strlen(key), present[n]);
+	}
+	check_all("after inserting");
+
+	if (tree->root == 1 || csalt_store_kv_btree_count(tree) != KEYS)
+		print_error_and_exit("Tree didn't grow");
+
+	for (int i = 0; i < KEYS; i += 3) {
+		char key[16];
+		make_key(key, i);
+		present[i] = -i;
+		put_int(key, (ssize_t)strlen(key), present[i]);
+	}
+	for (int i = 0; i < KEYS; i += 7) {
+		char key[16];
+		make_key(key, i);
+		present[i] = 0;
+		if (csalt_kv_remove((csalt_kv *)tree, key, (ssize_t)strlen(key)))
+			print_error_and_exit("Remove %d failed", i);
+	}
+	check_all("after updating");
+
+	if (csalt_kv_remove((csalt_kv *)tree, "key-000000", 10) != -1)
+		print_error_and_exit("Removing a missing key succeeded");
+
+	{
+		struct order order = { .count = 0 };
+		if (csalt_store_kv_btree_range(tree, "key-001000", 10, "key-002000", 10, check_order, &order))
+			print_error_and_exit("Range failed");
+
+		int expected = 0;
+		for (int i = 1000; i < 2000; i++)
+			expected += present[i] != 0;
+		if (order.count != expected)
+			print_error_and_exit("Range visited %d keys, expected %d", order.count, expected);
+	}
+
+	{
+		struct order order = { .count = 0 };
+		csalt_kv_iterate((csalt_kv *)tree, check_order, &order);
+		if (order.count != csalt_store_kv_btree_count(tree))
+			print_error_and_exit("Iterated %d keys", order.count);
+	}
+
+	{
+		char large[CSALT_KV_BTREE_MAX_ENTRY + 1] = { 0 };
+		struct csalt_store_memory value = csalt_store_memory_array(large);
+		if (!csalt_kv_put((csalt_kv *)tree, "large", 5, (csalt_static_store *)&value, sizeof(large)))
+			print_error_and_exit("Oversized entry accepted");
+	}
+
+	return 0;
+}
+
+static int use_reopened(csalt_static_store *store, void *param)
+{
+	(void)param;
+	tree = (struct csalt_store_kv_btree *)store;
+	check_all("after reopening");
+	return 0;
+}
+
+// Keys sharing a long prefix pack many to a page, until a key
+// without the prefix leaves a page which needs splitting many ways
+static int use_long_keys(csalt_static_store *store, void *param)
+{
+	(void)param;
+	tree = (struct csalt_store_kv_btree *)store;
+
+	char key[LONG_PREFIX + 16];
+	memset(key, 'a', LONG_PREFIX);
+	for (int i = 0; i < 1000; i++) {
+		const int length = snprintf(key + LONG_PREFIX, 16, "%04d", i);
+		put_int(key, LONG_PREFIX + length, i);
+	}
+	put_int("b", 1, -1);
+	put_int("0", 1, -2);
+
+	for (int i = 0; i < 1000; i++) {
+		const int length = snprintf(key + LONG_PREFIX, 16, "%04d", i);
+		int value = -1;
+		if (get_int(key, LONG_PREFIX + length, &value) || value != i)
+			print_error_and_exit("Long key %d lost", i);
+	}
+
+	int value = 0;
+	if (get_int("b", 1, &value) || value != -1 || get_int("0", 1, &value) || value != -2)
+		print_error_and_exit("Short keys lost");
+
+	struct order order = { .count = 0 };
+	csalt_kv_iterate((csalt_kv *)tree, check_order, &order);
+	if (order.count != 1002)
+		print_error_and_exit("Iterated %d long keys", order.count);
+	return 0;
+}
+
+struct source {
+	int next;
+	int limit;
+	char key[16];
+	int value;
+};
+
+static int next_sorted(
+	const void **key,
+	ssize_t *key_size,
+	const void **value,
+	ssize_t *value_size,
+	void *param
+)
+{
+	struct source *const source = param;
+	if (source->next == source->limit)
+		return 0;
+
+	make_key(source->key, source->next);
+	source->value = source->next++;
+	*key = source->key;
+	*key_size = (ssize_t)strlen(source->key);
+	*value = &source->value;
+	*value_size = sizeof(source->value);
+	return 1;
+}
+
+static int next_unsorted(
+	const void **key,
+	ssize_t *key_size,
+	const void **value,
+	ssize_t *value_size,
+	void *param
+)
+{
+	struct source *const source = param;
+	const int result = next_sorted(key, key_size, value, value_size, param);
+	source->next -= 2;
+	return result;
+}
+
+static int use_loaded(csalt_static_store *store, void *param)
+{
+	(void)param;
+	tree = (struct csalt_store_kv_btree *)store;
+
+	struct source unsorted = { .next = 10, .limit = -1 };
+	if (!csalt_store_kv_btree_load(tree, next_unsorted, &unsorted))
+		print_error_and_exit("Loading unsorted keys succeeded");
+	if (csalt_store_kv_btree_count(tree))
+		print_error_and_exit("Failed load left keys behind");
+
+	struct source source = { .next = 0, .limit = LOADED };
+	if (csalt_store_kv_btree_load(tree, next_sorted, &source))
+		print_error_and_exit("Bulk load failed");
+
+	if (csalt_store_kv_btree_count(tree) != LOADED)
+		print_error_and_exit("Loaded %zd keys", csalt_store_kv_btree_count(tree));
+
+	for (int i = 0; i < LOADED; i += 17) {
+		char key[16];
+		make_key(key, i);
+		int value = -1;
+		if (get_int(key, (ssize_t)strlen(key), &value) || value != i)
+			print_error_and_exit("Loaded key %d was %d", i, value);
+	}
+
+	struct order order = { .count = 0 };
+	csalt_store_kv_btree_range(tree, "key-015000", 10, NULL, 0, check_order, &order);
+	if (order.count != LOADED - 15000)
+		print_error_and_exit("Range over loaded keys visited %d", order.count);
+
+	if (!csalt_store_kv_btree_load(tree, next_sorted, &source))
+		print_error_and_exit("Loading into a full tree succeeded");
+	return 0;
+}
+
+// Every write fails on a read-only file, so nothing should change
+static int use_read_only(csalt_static_store *store, void *param)
+{
+	(void)param;
+	tree = (struct csalt_store_kv_btree *)store;
+
+	const ssize_t count = csalt_store_kv_btree_count(tree);
+	int value = 0;
+	struct csalt_store_memory memory = csalt_store_memory(value);
+	if (!csalt_kv_put((csalt_kv *)tree, "new", 3, (csalt_static_store *)&memory, sizeof(value)))
+		print_error_and_exit("Put to a read-only file succeeded");
+	if (csalt_store_kv_btree_count(tree) != count)
+		print_error_and_exit("Failed put changed the count to %zd", csalt_store_kv_btree_count(tree));
+	return 0;
+}
+
+static void with_tree_flags(
+	csalt_static_store_block_fn *block,
+	const char *what,
+	int flags
+)
+{
+	struct csalt_resource_file file = csalt_resource_file(path, flags, 0600);
+	struct csalt_resource_kv_btree resource = csalt_resource_kv_btree(
+		csalt_resource(&file));
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&resource,
+		block,
+		NULL
+	))
+		print_error_and_exit("%s failed", what);
+}
+
+static void with_tree(csalt_static_store_block_fn *block, const char *what)
+{
+	with_tree_flags(block, what, O_RDWR);
+}
+
+int main()
+{
+	const int fd = mkstemp(path);
+	if (fd < 0)
+		print_error_and_exit("Failed to create a temporary file");
+	close(fd);
+
+	with_tree(use_tree, "B+tree tests");
+	with_tree(use_reopened, "Reopening");
+	with_tree_flags(use_read_only, "Read-only tests", O_RDONLY);
+
+	truncate(path, 0);
+	with_tree(use_long_keys, "Long key tests");
+
+	truncate(path, 0);
+	with_tree(use_loaded, "Bulk load tests");
+
+	unlink(path);
+	return EXIT_SUCCESS;
+}
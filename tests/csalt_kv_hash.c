@@ -0,0 +1,215 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/kvs.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define KEYS 10000
+
+struct csalt_store_kv_hash *table;
+
+static int put_int(const char *key, int value)
+{
+	struct csalt_store_memory store = csalt_store_memory(value);
+	return csalt_kv_put(
+		(csalt_kv *)table,
+		key,
+		(ssize_t)strlen(key),
+		(csalt_static_store *)&store,
+		sizeof(value));
+}
+
+static int read_int(csalt_static_store *store, void *param)
+{
+	int value = -1;
+	if (csalt_store_read(store, &value, sizeof(value)) != sizeof(value))
+		print_error_and_exit("Short read from value store");
+	*(int *)param = value;
+	return 0;
+}
+
+static int get_int(const char *key, int *value)
+{
+	return csalt_kv_get(
+		(csalt_kv *)table,
+		key,
+		(ssize_t)strlen(key),
+		read_int,
+		value);
+}
+
+static int sum_values(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	(void)key;
+	(void)key_size;
+	int result = 0;
+	read_int(value, &result);
+	*(long *)param += result;
+	return 0;
+}
+
+static int stop_early(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	(void)key;
+	(void)key_size;
+	(void)value;
+	return ++*(int *)param == 3? 42: 0;
+}
+
+static int transfer_out(csalt_static_store *store, void *param)
+{
+	struct csalt_store_memory *const destination = param;
+	struct csalt_progress progress = csalt_progress(5);
+	return csalt_store_transfer(
+		&progress,
+		store,
+		(csalt_static_store *)destination) == 5? 0: -1;
+}
+
+static int use_table(csalt_static_store *store, void *param)
+{
+	(void)param;
+	table = (struct csalt_store_kv_hash *)store;
+	char key[32];
+
+	{
+		if (put_int("answer", 42))
+			print_error_and_exit("Put failed");
+
+		int value = 0;
+		if (get_int("answer", &value) || value != 42)
+			print_error_and_exit("Unexpected value: %d", value);
+
+		if (put_int("answer", 43) || get_int("answer", &value) || value != 43)
+			print_error_and_exit("Value not replaced: %d", value);
+
+		if (csalt_store_kv_hash_count(table) != 1)
+			print_error_and_exit("Replacing a value added a key");
+
+		if (get_int("question", &value) != -1)
+			print_error_and_exit("Missing key was found");
+
+		if (csalt_kv_remove((csalt_kv *)table, "answer", 6))
+			print_error_and_exit("Remove failed");
+
+		if (get_int("answer", &value) != -1)
+			print_error_and_exit("Removed key was found");
+
+		if (csalt_kv_remove((csalt_kv *)table, "answer", 6) != -1)
+			print_error_and_exit("Removing a missing key succeeded");
+	}
+
+	{
+		bool rehashed = false;
+		for (int i = 0; i < KEYS; i++) {
+			snprintf(key, sizeof(key), "key-%d", i);
+			if (put_int(key, i))
+				print_error_and_exit("Put %d failed", i);
+			rehashed = rehashed || csalt_store_kv_hash_rehashing(table);
+
+			// Check keys in both tables while migration is underway
+			int value = -1;
+			snprintf(key, sizeof(key), "key-%d", i / 2);
+			if (get_int(key, &value) || value != i / 2)
+				print_error_and_exit("Key %d lost during insert %d", i / 2, i);
+		}
+
+		if (!rehashed)
+			print_error_and_exit("Table never grew");
+
+		if (csalt_store_kv_hash_count(table) != KEYS)
+			print_error_and_exit(
+				"Unexpected count: %zd",
+				csalt_store_kv_hash_count(table));
+
+		long sum = 0;
+		csalt_kv_iterate((csalt_kv *)table, sum_values, &sum);
+		if (sum != (long)KEYS * (KEYS - 1) / 2)
+			print_error_and_exit("Iteration missed values: %ld", sum);
+
+		int calls = 0;
+		if (csalt_kv_iterate((csalt_kv *)table, stop_early, &calls) != 42 || calls != 3)
+			print_error_and_exit("Iteration did not stop early");
+
+		for (int i = 0; i < KEYS; i += 2) {
+			snprintf(key, sizeof(key), "key-%d", i);
+			if (csalt_kv_remove((csalt_kv *)table, key, (ssize_t)strlen(key)))
+				print_error_and_exit("Remove %d failed", i);
+		}
+
+		for (int i = 0; i < KEYS; i++) {
+			int value = -1;
+			snprintf(key, sizeof(key), "key-%d", i);
+			const int result = get_int(key, &value);
+			if (i % 2 && (result || value != i))
+				print_error_and_exit("Key %d lost after removals", i);
+			if (!(i % 2) && result != -1)
+				print_error_and_exit("Removed key %d found", i);
+		}
+	}
+
+	{
+		char text[] = "hello";
+		struct csalt_store_memory source = csalt_store_memory_array(text);
+		if (csalt_kv_put((csalt_kv *)table, "text", 4, (csalt_static_store *)&source, 5))
+			print_error_and_exit("Put from array failed");
+
+		char out[5] = { 0 };
+		struct csalt_store_memory destination = csalt_store_memory_array(out);
+		if (csalt_kv_get((csalt_kv *)table, "text", 4, transfer_out, &destination))
+			print_error_and_exit("Transfer from value failed");
+		if (memcmp(out, "hello", 5))
+			print_error_and_exit("Unexpected value: %.5s", out);
+
+		struct csalt_store_memory short_source = csalt_store_memory_array(text);
+		if (!csalt_kv_put((csalt_kv *)table, "long", 4, (csalt_static_store *)&short_source, 100))
+			print_error_and_exit("Put with a short value succeeded");
+		if (csalt_kv_get((csalt_kv *)table, "long", 4, transfer_out, &destination) != -1)
+			print_error_and_exit("Failed put added a key");
+	}
+
+	return 0;
+}
+
+int main()
+{
+	struct csalt_resource_kv_hash resource = csalt_resource_kv_hash(0);
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&resource,
+		use_table,
+		NULL
+	))
+		print_error_and_exit("Hash table tests failed");
+
+	return EXIT_SUCCESS;
+}
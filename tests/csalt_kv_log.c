@@ -0,0 +1,285 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/kvs.h>
+#include <csalt/resources.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define KEYS 500
+#define SEGMENT_SIZE 4096
+
+char directory[] = "/tmp/csalt_kv_log_XXXXXX";
+char expected[KEYS][32];
+
+struct csalt_store_kv_log *log_store;
+
+static void set(int i, const char *format)
+{
+	char key[16];
+	snprintf(key, sizeof(key), "key-%d", i);
+	snprintf(expected[i], sizeof(expected[i]), format, i);
+
+	struct csalt_store_memory value = csalt_store_memory_bounds(
+		expected[i],
+		expected[i] + strlen(expected[i]));
+	if (csalt_kv_put(
+		(csalt_kv *)log_store,
+		key,
+		(ssize_t)strlen(key),
+		(csalt_static_store *)&value,
+		(ssize_t)strlen(expected[i])
+	))
+		print_error_and_exit("Put %d failed", i);
+}
+
+static void unset(int i)
+{
+	char key[16];
+	snprintf(key, sizeof(key), "key-%d", i);
+	expected[i][0] = '\0';
+	if (csalt_kv_remove((csalt_kv *)log_store, key, (ssize_t)strlen(key)))
+		print_error_and_exit("Remove %d failed", i);
+}
+
+static int read_value(csalt_static_store *store, void *param)
+{
+	char *const buffer = param;
+	const ssize_t amount = csalt_store_read(store, buffer, 31);
+	if (amount < 0)
+		return -1;
+	buffer[amount] = '\0';
+	return 0;
+}
+
+static void check_all(const char *when)
+{
+	for (int i = 0; i < KEYS; i++) {
+		char key[16];
+		snprintf(key, sizeof(key), "key-%d", i);
+
+		char value[32] = { 0 };
+		const int result = csalt_kv_get(
+			(csalt_kv *)log_store,
+			key,
+			(ssize_t)strlen(key),
+			read_value,
+			value);
+
+		if (!expected[i][0] && result != -1)
+			print_error_and_exit("Removed key %d found %s", i, when);
+		if (expected[i][0] && (result || strcmp(value, expected[i])))
+			print_error_and_exit(
+				"Key %d was \"%s\", expected \"%s\" %s",
+				i,
+				value,
+				expected[i],
+				when);
+	}
+}
+
+static int count_entry(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	(void)key;
+	(void)key_size;
+	char buffer[32];
+	if (read_value(value, buffer))
+		return -1;
+	++*(int *)param;
+	return 0;
+}
+
+static int compact(void *param)
+{
+	(void)param;
+	return csalt_store_kv_log_compact(log_store) < 0? -1: 0;
+}
+
+static int use_executor(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_executor *const executor = (struct csalt_store_executor *)store;
+
+	struct csalt_executor_job job = csalt_executor_job_fn(compact, NULL);
+	if (csalt_store_executor_submit(executor, &job))
+		print_error_and_exit("Failed to submit compaction");
+
+	for (int i = 0; i < 100; i++)
+		set(i, "late-%d");
+
+	if (csalt_executor_job_wait(&job))
+		print_error_and_exit("Background compaction failed");
+	return 0;
+}
+
+static int use_log(csalt_static_store *store, void *param)
+{
+	(void)param;
+	log_store = (struct csalt_store_kv_log *)store;
+
+	for (int i = 0; i < KEYS; i++)
+		set(i, "value-%d");
+	for (int i = 0; i < KEYS; i += 2)
+		set(i, "new-%d");
+	for (int i = 0; i < KEYS; i += 5)
+		unset(i);
+	check_all("after writing");
+
+	char missing[] = "key-0";
+	if (csalt_kv_remove((csalt_kv *)log_store, missing, 5) != -1)
+		print_error_and_exit("Removing a missing key succeeded");
+
+	if (log_store->segment_count < 2)
+		print_error_and_exit("Log never started a new segment");
+
+	const ssize_t dead = csalt_store_kv_log_dead(log_store);
+	if (dead <= 0)
+		print_error_and_exit("No dead records after overwrites");
+
+	struct csalt_resource_executor executor = csalt_resource_executor(1, 1);
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&executor,
+		use_executor,
+		NULL
+	))
+		print_error_and_exit("Executor failed");
+	check_all("after background compaction");
+
+	if (csalt_store_kv_log_compact(log_store) < 0)
+		print_error_and_exit("Compaction failed");
+	check_all("after compaction");
+
+	if (csalt_store_kv_log_dead(log_store) >= dead)
+		print_error_and_exit("Compaction reclaimed nothing");
+
+	int count = 0;
+	if (csalt_kv_iterate((csalt_kv *)log_store, count_entry, &count))
+		print_error_and_exit("Iteration failed");
+	int live = 0;
+	for (int i = 0; i < KEYS; i++)
+		live += expected[i][0] != '\0';
+	if (count != live)
+		print_error_and_exit("Iterated %d keys, expected %d", count, live);
+
+	if (csalt_store_kv_log_sync(log_store))
+		print_error_and_exit("Sync failed");
+	return 0;
+}
+
+static int use_reopened(csalt_static_store *store, void *param)
+{
+	log_store = (struct csalt_store_kv_log *)store;
+	check_all(param);
+
+	static int reopens = 0;
+	reopens++;
+	set(reopens, "reopened-%d");
+	unset(reopens * 2 + 1);
+	return 0;
+}
+
+// Removes hint files, and leaves a torn record at the end of the
+// newest segment
+static void damage(void)
+{
+	DIR *const dir = opendir(directory);
+	struct dirent *entry;
+	char newest[NAME_MAX + 1] = "";
+
+	while ((entry = readdir(dir))) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+		if (strstr(entry->d_name, ".hint"))
+			unlink(path);
+		else if (strstr(entry->d_name, ".log") && strcmp(entry->d_name, newest) > 0)
+			snprintf(newest, sizeof(newest), "%s", entry->d_name);
+	}
+	closedir(dir);
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", directory, newest);
+	const int fd = open(path, O_WRONLY | O_APPEND);
+	// The header claims the largest sizes it can, as a torn write
+	// might, so the scan has to stop before allocating for them
+	char garbage[40] = { 1, 2, 3 };
+	memset(garbage + 8, 0xff, 8);
+	if (fd < 0 || write(fd, garbage, sizeof(garbage)) != sizeof(garbage))
+		print_error_and_exit("Failed to damage %s", path);
+	close(fd);
+}
+
+static void remove_directory(void)
+{
+	DIR *const dir = opendir(directory);
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+		unlink(path);
+	}
+	closedir(dir);
+	rmdir(directory);
+}
+
+int main()
+{
+	if (!mkdtemp(directory))
+		print_error_and_exit("Failed to create a temporary directory");
+
+	struct csalt_resource_kv_log resource = csalt_resource_kv_log(
+		directory,
+		SEGMENT_SIZE);
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&resource,
+		use_log,
+		NULL
+	))
+		print_error_and_exit("Log tests failed");
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&resource,
+		use_reopened,
+		"after restarting from hints"
+	))
+		print_error_and_exit("Reopening from hints failed");
+
+	damage();
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&resource,
+		use_reopened,
+		"after restarting from a scan"
+	))
+		print_error_and_exit("Reopening from a scan failed");
+
+	remove_directory();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,669 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/kvs.h>
+#include <csalt/resources.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS 250
+#define PIPELINE 100
+#define LARGE_SIZE (256 * 1024)
+#define SCAN_BATCH 16
+
+// A small stand-in for a RESP server, which keeps its keys in an
+// array and answers one connection at a time
+
+struct entry {
+	char *key;
+	ssize_t key_size;
+	char *value;
+	ssize_t value_size;
+};
+
+struct entry entries[KEYS * 2];
+int entry_count = 0;
+int server_fd = -1;
+bool resp3 = false;
+
+atomic_int connections = 0;
+atomic_int largest_batch = 0;
+
+struct output {
+	char *data;
+	size_t length;
+	size_t size;
+};
+
+static void output_append(struct output *output, const void *data, size_t size)
+{
+	if (output->length + size > output->size) {
+		output->size = (output->length + size) * 2;
+		output->data = realloc(output->data, output->size);
+	}
+	memcpy(output->data + output->length, data, size);
+	output->length += size;
+}
+
+static void output_format(struct output *output, const char *format, ...)
+{
+	char buffer[128];
+	va_list args;
+	va_start(args, format);
+	const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	output_append(output, buffer, (size_t)length);
+}
+
+static void output_bulk(struct output *output, const char *data, ssize_t size)
+{
+	output_format(output, "$%zd\r\n", size);
+	output_append(output, data, (size_t)size);
+	output_append(output, "\r\n", 2);
+}
+
+static void output_null(struct output *output)
+{
+	output_format(output, resp3? "_\r\n": "$-1\r\n");
+}
+
+static struct entry *find(const char *key, ssize_t key_size)
+{
+	for (int i = 0; i < entry_count; i++)
+		if (entries[i].key_size == key_size && !memcmp(entries[i].key, key, (size_t)key_size))
+			return &entries[i];
+	return NULL;
+}
+
+static char *copy(const char *data, ssize_t size)
+{
+	char *const result = malloc((size_t)size + 1);
+	memcpy(result, data, (size_t)size);
+	return result;
+}
+
+static bool is(const char *argument, ssize_t size, const char *text)
+{
+	return size == (ssize_t)strlen(text) && !memcmp(argument, text, (size_t)size);
+}
+
+static void execute(
+	struct output *output,
+	int count,
+	char **arguments,
+	ssize_t *sizes
+)
+{
+	if (is(arguments[0], sizes[0], "PING")) {
+		output_format(output, "+PONG\r\n");
+	} else if (is(arguments[0], sizes[0], "HELLO") && count == 2) {
+		resp3 = true;
+		output_format(output, "%%2\r\n+server\r\n+stand-in\r\n+proto\r\n:3\r\n");
+	} else if (is(arguments[0], sizes[0], "NESTED")) {
+		// An attribute, then an array of most reply types
+		output_format(
+			output,
+			"|1\r\n+ttl\r\n:3600\r\n"
+			"*6\r\n:-42\r\n_\r\n%%1\r\n+k\r\n#t\r\n"
+			"~2\r\n,1.5\r\n(12345678901234567890\r\n"
+			"!5\r\nOOPS!\r\n=7\r\ntxt:abc\r\n");
+	} else if (is(arguments[0], sizes[0], "HUGE")) {
+		// Longer than any string a server may send
+		output_format(output, "$600000000\r\n");
+	} else if (is(arguments[0], sizes[0], "OVERFLOW")) {
+		output_format(output, "$99999999999999999999\r\n");
+	} else if (is(arguments[0], sizes[0], "PUSH")) {
+		// A push message before the reply, as for client tracking
+		output_format(output, ">2\r\n+invalidate\r\n*1\r\n$3\r\nkey\r\n+PUSHED\r\n");
+	} else if (is(arguments[0], sizes[0], "GET") && count == 2) {
+		struct entry *const entry = find(arguments[1], sizes[1]);
+		if (entry)
+			output_bulk(output, entry->value, entry->value_size);
+		else
+			output_null(output);
+	} else if (is(arguments[0], sizes[0], "SET") && count == 3) {
+		struct entry *entry = find(arguments[1], sizes[1]);
+		if (!entry) {
+			entry = &entries[entry_count++];
+			entry->key = copy(arguments[1], sizes[1]);
+			entry->key_size = sizes[1];
+		} else {
+			free(entry->value);
+		}
+		entry->value = copy(arguments[2], sizes[2]);
+		entry->value_size = sizes[2];
+		output_format(output, "+OK\r\n");
+	} else if (is(arguments[0], sizes[0], "DEL") && count == 2) {
+		struct entry *const entry = find(arguments[1], sizes[1]);
+		if (entry) {
+			free(entry->key);
+			free(entry->value);
+			*entry = entries[--entry_count];
+		}
+		output_format(output, ":%d\r\n", entry? 1: 0);
+	} else if (is(arguments[0], sizes[0], "SCAN") && count >= 2) {
+		const int cursor = atoi(arguments[1]);
+		const int end = cursor + SCAN_BATCH < entry_count?
+			cursor + SCAN_BATCH:
+			entry_count;
+		char next[16];
+		const int next_size = snprintf(next, sizeof(next), "%d", end < entry_count? end: 0);
+		output_format(output, "*2\r\n");
+		output_bulk(output, next, next_size);
+		output_format(output, "*%d\r\n", end > cursor? end - cursor: 0);
+		for (int i = cursor; i < end; i++)
+			output_bulk(output, entries[i].key, entries[i].key_size);
+	} else {
+		output_format(output, "-ERR unknown command\r\n");
+	}
+}
+
+// Parses one command from data, returning its length, or 0 if it
+// hasn't all arrived yet
+static ssize_t parse(
+	char *data,
+	ssize_t size,
+	int *count,
+	char **arguments,
+	ssize_t *sizes
+)
+{
+	char *const end = data + size;
+	char *line = memchr(data, '\n', (size_t)size);
+	if (!line)
+		return 0;
+	if (data[0] != '*')
+		print_error_and_exit("Client sent an inline command");
+
+	*count = atoi(data + 1);
+	char *position = line + 1;
+	for (int i = 0; i < *count; i++) {
+		if (position >= end)
+			return 0;
+		line = memchr(position, '\n', (size_t)(end - position));
+		if (!line)
+			return 0;
+		if (position[0] != '$')
+			print_error_and_exit("Client sent an argument which isn't a bulk string");
+
+		sizes[i] = atol(position + 1);
+		arguments[i] = line + 1;
+		if (end - arguments[i] < sizes[i] + 2)
+			return 0;
+		arguments[i][sizes[i]] = '\0';
+		position = arguments[i] + sizes[i] + 2;
+	}
+	return position - data;
+}
+
+static void serve(int fd)
+{
+	size_t size = 4096, length = 0;
+	char *buffer = malloc(size);
+	struct output output = { NULL, 0, 0 };
+
+	for (;;) {
+		if (length == size)
+			buffer = realloc(buffer, size *= 2);
+
+		const ssize_t amount = read(fd, buffer + length, size - length);
+		if (amount <= 0)
+			break;
+		length += (size_t)amount;
+
+		// Every command which has arrived is answered before
+		// writing, so pipelined commands come in one batch
+		int batch = 0;
+		ssize_t offset = 0;
+		for (;;) {
+			int count = 0;
+			char *arguments[4];
+			ssize_t sizes[4];
+			const ssize_t consumed = parse(
+				buffer + offset,
+				(ssize_t)length - offset,
+				&count,
+				arguments,
+				sizes);
+			if (!consumed)
+				break;
+			execute(&output, count, arguments, sizes);
+			offset += consumed;
+			batch++;
+		}
+
+		if (batch > atomic_load(&largest_batch))
+			atomic_store(&largest_batch, batch);
+
+		memmove(buffer, buffer + offset, length - (size_t)offset);
+		length -= (size_t)offset;
+
+		for (size_t written = 0; written < output.length;) {
+			const ssize_t amount = write(fd, output.data + written, output.length - written);
+			if (amount <= 0)
+				print_error_and_exit("Server unable to write reply");
+			written += (size_t)amount;
+		}
+		output.length = 0;
+	}
+
+	free(buffer);
+	free(output.data);
+	close(fd);
+}
+
+static void *run_server(void *param)
+{
+	(void)param;
+	for (;;) {
+		const int fd = accept(server_fd, NULL, NULL);
+		if (fd < 0)
+			break;
+		resp3 = false;
+		atomic_fetch_add(&connections, 1);
+		serve(fd);
+	}
+	return NULL;
+}
+
+// Client tests
+
+static int expect_value(csalt_static_store *store, void *param)
+{
+	const char *const expected = param;
+	char buffer[64] = { 0 };
+	const ssize_t amount = csalt_store_read(store, buffer, sizeof(buffer) - 1);
+	if (amount != (ssize_t)strlen(expected) || strcmp(buffer, expected))
+		print_error_and_exit("Expected %s, got %s", expected, buffer);
+	return 0;
+}
+
+static int expect_large(csalt_static_store *store, void *param)
+{
+	const char *const expected = param;
+	char *const buffer = malloc(LARGE_SIZE);
+	if (csalt_store_read(store, buffer, LARGE_SIZE) != LARGE_SIZE)
+		print_error_and_exit("Short large value");
+	if (memcmp(buffer, expected, LARGE_SIZE))
+		print_error_and_exit("Large value corrupted");
+	free(buffer);
+	return 0;
+}
+
+static int expect_ok(const struct csalt_resp_reply *reply, void *param)
+{
+	(void)param;
+	if (reply->type != CSALT_RESP_SIMPLE || reply->size != 2 || memcmp(reply->data, "OK", 2))
+		print_error_and_exit("Expected OK, got type %d", reply->type);
+	return 0;
+}
+
+static int expect_bulk(const struct csalt_resp_reply *reply, void *param)
+{
+	const char *const expected = param;
+	if (reply->type != CSALT_RESP_BULK)
+		print_error_and_exit("Expected a bulk string, got type %d", reply->type);
+	if (reply->size != (ssize_t)strlen(expected) || memcmp(reply->data, expected, (size_t)reply->size))
+		print_error_and_exit("Expected %s, got %.*s", expected, (int)reply->size, reply->data);
+	return 0;
+}
+
+static int expect_type(const struct csalt_resp_reply *reply, void *param)
+{
+	const enum csalt_resp_type *const type = param;
+	if (reply->type != *type)
+		print_error_and_exit("Expected type %d, got type %d", *type, reply->type);
+	return 0;
+}
+
+static int expect_nested(const struct csalt_resp_reply *reply, void *param)
+{
+	(void)param;
+	if (reply->type != CSALT_RESP_ARRAY || reply->count != 6)
+		print_error_and_exit("Attribute not skipped, type %d", reply->type);
+
+	const struct csalt_resp_reply *const elements = reply->elements;
+	if (elements[0].type != CSALT_RESP_INTEGER || elements[0].integer != -42)
+		print_error_and_exit("Integer not parsed");
+	if (elements[1].type != CSALT_RESP_NULL)
+		print_error_and_exit("Null not parsed");
+	if (
+		elements[2].type != CSALT_RESP_MAP
+		|| elements[2].count != 2
+		|| elements[2].elements[1].type != CSALT_RESP_BOOLEAN
+		|| !elements[2].elements[1].integer
+	)
+		print_error_and_exit("Map not parsed");
+	if (
+		elements[3].type != CSALT_RESP_SET
+		|| elements[3].count != 2
+		|| elements[3].elements[0].type != CSALT_RESP_DOUBLE
+		|| elements[3].elements[1].type != CSALT_RESP_BIG_NUMBER
+		|| elements[3].elements[1].size != 20
+	)
+		print_error_and_exit("Set not parsed");
+	if (elements[4].type != CSALT_RESP_BULK_ERROR || elements[4].size != 5)
+		print_error_and_exit("Bulk error not parsed");
+	if (elements[5].type != CSALT_RESP_VERBATIM || memcmp(elements[5].data, "txt:abc", 7))
+		print_error_and_exit("Verbatim string not parsed");
+	return 0;
+}
+
+static int count_keys(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	(void)key;
+	int *const seen = param;
+
+	// Keys are "key<n>" and values are "value<n>"
+	char buffer[32] = { 0 };
+	csalt_store_read(value, buffer, sizeof(buffer) - 1);
+	if (strncmp(buffer, "value", 5) || strncmp(buffer + 5, (const char *)key + 3, (size_t)key_size - 3))
+		print_error_and_exit("Iterated value %s doesn't match its key", buffer);
+
+	const int index = atoi(buffer + 5);
+	if (index < 0 || index >= KEYS)
+		print_error_and_exit("Unexpected key in iteration");
+	seen[index]++;
+	return 0;
+}
+
+static int stop_early(
+	const void *key,
+	ssize_t key_size,
+	csalt_static_store *value,
+	void *param
+)
+{
+	(void)key;
+	(void)key_size;
+	(void)value;
+	return ++*(int *)param == 3? 7: 0;
+}
+
+static int expect_pushed(const struct csalt_resp_reply *reply, void *param)
+{
+	(void)param;
+	if (reply->type != CSALT_RESP_SIMPLE || reply->size != 6 || memcmp(reply->data, "PUSHED", 6))
+		print_error_and_exit("Expected PUSHED after the push message");
+	return 1;
+}
+
+static int use_resp(csalt_static_store *store, void *param)
+{
+	(void)param;
+	csalt_kv *kv = (csalt_kv *)store;
+	struct csalt_store_kv_resp *resp = (struct csalt_store_kv_resp *)store;
+	char key[32], value[32];
+
+	// Set and get, one at a time
+	{
+		struct csalt_store_memory memory = csalt_store_memory_bounds("hello", "hello" + 5);
+		if (csalt_kv_put(kv, "greeting", 8, (csalt_static_store *)&memory, 5))
+			print_error_and_exit("Put failed");
+		if (csalt_kv_get(kv, "greeting", 8, expect_value, "hello"))
+			print_error_and_exit("Get failed");
+		if (!csalt_kv_get(kv, "missing", 7, expect_value, ""))
+			print_error_and_exit("Get of a missing key succeeded");
+		if (csalt_kv_remove(kv, "greeting", 8))
+			print_error_and_exit("Remove failed");
+		if (!csalt_kv_remove(kv, "greeting", 8))
+			print_error_and_exit("Removing a missing key succeeded");
+	}
+
+	// Pipelined sets and gets on the one connection
+	{
+		for (int i = 0; i < PIPELINE; i++) {
+			const int key_size = snprintf(key, sizeof(key), "key%d", i);
+			const int value_size = snprintf(value, sizeof(value), "value%d", i);
+			if (csalt_store_kv_resp_queue_set(resp, key, key_size, value, value_size))
+				print_error_and_exit("Queueing set %d failed", i);
+		}
+		for (int i = 0; i < PIPELINE; i++) {
+			const int key_size = snprintf(key, sizeof(key), "key%d", i);
+			if (csalt_store_kv_resp_queue_get(resp, key, key_size))
+				print_error_and_exit("Queueing get %d failed", i);
+		}
+
+		if (csalt_store_kv_resp_pending(resp) != PIPELINE * 2)
+			print_error_and_exit("Pipeline has %zd pending replies", csalt_store_kv_resp_pending(resp));
+		if (csalt_store_kv_resp_flush(resp))
+			print_error_and_exit("Flush failed");
+
+		for (int i = 0; i < PIPELINE; i++)
+			if (csalt_store_kv_resp_reply(resp, expect_ok, NULL))
+				print_error_and_exit("Set %d failed", i);
+		for (int i = 0; i < PIPELINE; i++) {
+			snprintf(value, sizeof(value), "value%d", i);
+			if (csalt_store_kv_resp_reply(resp, expect_bulk, value))
+				print_error_and_exit("Get %d failed", i);
+		}
+
+		if (csalt_store_kv_resp_pending(resp))
+			print_error_and_exit("Replies left over after the pipeline");
+		if (atomic_load(&largest_batch) < 2)
+			print_error_and_exit("Pipelined commands weren't sent together");
+		if (csalt_store_kv_resp_reply(resp, expect_ok, NULL) != -1)
+			print_error_and_exit("Read a reply with nothing pending");
+	}
+
+	// Key/value calls don't take the reply of a queued command
+	{
+		csalt_store_kv_resp_queue_get(resp, "key1", 4);
+		struct csalt_store_memory memory = csalt_store_memory_bounds("x", "x" + 1);
+		if (
+			csalt_kv_get(kv, "key2", 4, expect_value, "value2") != -1
+			|| csalt_kv_put(kv, "key2", 4, (csalt_static_store *)&memory, 1) != -1
+			|| csalt_kv_remove(kv, "key2", 4) != -1
+			|| csalt_kv_iterate(kv, count_keys, NULL) != -1
+		)
+			print_error_and_exit("Key/value call made with a reply outstanding");
+		if (csalt_store_kv_resp_pending(resp) != 1)
+			print_error_and_exit("Key/value call queued a command");
+		if (csalt_store_kv_resp_reply(resp, expect_bulk, "value1"))
+			print_error_and_exit("Queued command lost its reply");
+	}
+
+	// A value much larger than the buffers
+	{
+		char *const large = malloc(LARGE_SIZE);
+		for (int i = 0; i < LARGE_SIZE; i++)
+			large[i] = (char)(i * 7 + i / 251);
+		struct csalt_store_memory memory = csalt_store_memory_bounds(large, large + LARGE_SIZE);
+		if (csalt_kv_put(kv, "large", 5, (csalt_static_store *)&memory, LARGE_SIZE))
+			print_error_and_exit("Large put failed");
+		if (csalt_kv_get(kv, "large", 5, expect_large, large))
+			print_error_and_exit("Large get failed");
+		if (csalt_kv_remove(kv, "large", 5))
+			print_error_and_exit("Large remove failed");
+		free(large);
+	}
+
+	// Iteration over several scan batches, stopping early
+	{
+		for (int i = PIPELINE; i < KEYS; i++) {
+			const int key_size = snprintf(key, sizeof(key), "key%d", i);
+			const int value_size = snprintf(value, sizeof(value), "value%d", i);
+			csalt_store_kv_resp_queue_set(resp, key, key_size, value, value_size);
+		}
+		for (int i = PIPELINE; i < KEYS; i++)
+			csalt_store_kv_resp_reply(resp, expect_ok, NULL);
+
+		int seen[KEYS] = { 0 };
+		if (csalt_kv_iterate(kv, count_keys, seen))
+			print_error_and_exit("Iteration failed");
+		for (int i = 0; i < KEYS; i++)
+			if (seen[i] != 1)
+				print_error_and_exit("Key %d seen %d times", i, seen[i]);
+
+		int calls = 0;
+		if (csalt_kv_iterate(kv, stop_early, &calls) != 7 || calls != 3)
+			print_error_and_exit("Iteration didn't stop early");
+		if (csalt_kv_get(kv, "key1", 4, expect_value, "value1"))
+			print_error_and_exit("Replies out of step after stopping early");
+	}
+
+	// Errors and RESP3 replies
+	{
+		const void *const unknown[] = { "FROB" };
+		const ssize_t unknown_size[] = { 4 };
+		enum csalt_resp_type error = CSALT_RESP_ERROR;
+		csalt_store_kv_resp_queue(resp, 1, unknown, unknown_size);
+		if (csalt_store_kv_resp_reply(resp, expect_type, &error))
+			print_error_and_exit("Error reply not passed to the block");
+
+		const void *const hello[] = { "HELLO", "3" };
+		const ssize_t hello_size[] = { 5, 1 };
+		enum csalt_resp_type map = CSALT_RESP_MAP;
+		csalt_store_kv_resp_queue(resp, 2, hello, hello_size);
+		if (csalt_store_kv_resp_reply(resp, expect_type, &map))
+			print_error_and_exit("HELLO reply not parsed");
+
+		enum csalt_resp_type null = CSALT_RESP_NULL;
+		csalt_store_kv_resp_queue_get(resp, "missing", 7);
+		if (csalt_store_kv_resp_reply(resp, expect_type, &null))
+			print_error_and_exit("RESP3 null not parsed");
+
+		const void *const push[] = { "PUSH" };
+		const ssize_t push_size[] = { 4 };
+		const void *const nested[] = { "NESTED" };
+		const ssize_t nested_size[] = { 6 };
+		csalt_store_kv_resp_queue(resp, 1, push, push_size);
+		csalt_store_kv_resp_queue(resp, 1, nested, nested_size);
+		csalt_store_kv_resp_queue_del(resp, "key0", 4);
+		if (csalt_store_kv_resp_reply(resp, expect_pushed, NULL) != 1)
+			print_error_and_exit("Push message not skipped");
+		if (csalt_store_kv_resp_reply(resp, expect_nested, NULL))
+			print_error_and_exit("Nested reply not parsed");
+		enum csalt_resp_type integer = CSALT_RESP_INTEGER;
+		if (csalt_store_kv_resp_reply(resp, expect_type, &integer))
+			print_error_and_exit("Reply after a nested reply not parsed");
+	}
+
+	return 0;
+}
+
+static int use_unflushed(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_kv_resp *resp = (struct csalt_store_kv_resp *)store;
+
+	// Replies still outstanding at deinit are discarded
+	const void *const push[] = { "PUSH" };
+	const ssize_t push_size[] = { 4 };
+	const void *const ping[] = { "PING" };
+	const ssize_t ping_size[] = { 4 };
+	csalt_store_kv_resp_queue(resp, 1, push, push_size);
+	for (int i = 0; i < 10; i++)
+		csalt_store_kv_resp_queue(resp, 1, ping, ping_size);
+
+	return csalt_store_kv_resp_reply(resp, expect_pushed, NULL);
+}
+
+static int use_hostile(csalt_static_store *store, void *param)
+{
+	struct csalt_store_kv_resp *resp = (struct csalt_store_kv_resp *)store;
+	const void *const command[] = { param };
+	const ssize_t command_size[] = { (ssize_t)strlen(param) };
+	csalt_store_kv_resp_queue(resp, 1, command, command_size);
+	return csalt_store_kv_resp_reply(resp, expect_ok, NULL);
+}
+
+int main()
+{
+	server_fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t address_size = sizeof(address);
+	if (
+		bind(server_fd, (struct sockaddr *)&address, sizeof(address))
+		|| listen(server_fd, 4)
+		|| getsockname(server_fd, (struct sockaddr *)&address, &address_size)
+	)
+		print_error_and_exit("Unable to start the stand-in server");
+
+	pthread_t server;
+	pthread_create(&server, NULL, run_server, NULL);
+
+	char port[8];
+	snprintf(port, sizeof(port), "%d", ntohs(address.sin_port));
+	struct addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+
+	{
+		struct csalt_resource_network_client
+			client = csalt_resource_network_client("127.0.0.1", port, &hints);
+		struct csalt_resource_kv_resp
+			resource = csalt_resource_kv_resp((csalt_static_resource *)&client, 64);
+		if (csalt_static_resource_use((csalt_static_resource *)&resource, use_resp, NULL))
+			print_error_and_exit("RESP tests failed");
+	}
+
+	{
+		struct csalt_resource_network_client
+			client = csalt_resource_network_client("127.0.0.1", port, &hints);
+		struct csalt_resource_kv_resp
+			resource = csalt_resource_kv_resp((csalt_static_resource *)&client, 0);
+		if (csalt_static_resource_use((csalt_static_resource *)&resource, use_unflushed, NULL) != 1)
+			print_error_and_exit("Pushed reply not returned");
+	}
+
+	{
+		const char *const hostile[] = { "HUGE", "OVERFLOW" };
+		for (size_t i = 0; i < csalt_arrlength(hostile); i++) {
+			struct csalt_resource_network_client
+				client = csalt_resource_network_client("127.0.0.1", port, &hints);
+			struct csalt_resource_kv_resp
+				resource = csalt_resource_kv_resp((csalt_static_resource *)&client, 0);
+			if (csalt_static_resource_use(
+				(csalt_static_resource *)&resource,
+				use_hostile,
+				(void *)hostile[i]
+			) != -1)
+				print_error_and_exit("%s length accepted", hostile[i]);
+		}
+	}
+
+	if (atomic_load(&connections) != 4)
+		print_error_and_exit("Expected 4 connections, got %d", atomic_load(&connections));
+
+	shutdown(server_fd, SHUT_RDWR);
+	close(server_fd);
+	pthread_join(server, NULL);
+
+	for (int i = 0; i < entry_count; i++) {
+		free(entries[i].key);
+		free(entries[i].value);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/platform/threads.h>
+
+#define THREADS 4
+#define ITERATIONS 100000
+
+csalt_mutex mutex;
+csalt_rwlock rwlock;
+csalt_cond cond;
+
+long counter = 0;
+long shared[2] = { 0 };
+int turn = 0;
+
+static void *increment(void *param)
+{
+	(void)param;
+	for (int i = 0; i < ITERATIONS; i++) {
+		csalt_mutex_lock(&mutex);
+		counter++;
+		csalt_mutex_unlock(&mutex);
+	}
+	return NULL;
+}
+
+static void *read_write(void *param)
+{
+	const int writer = (int)(ssize_t)param;
+	for (int i = 0; i < ITERATIONS / 10; i++) {
+		if (writer) {
+			csalt_rwlock_wrlock(&rwlock);
+			shared[0]++;
+			shared[1]++;
+			csalt_rwlock_unlock(&rwlock);
+		} else {
+			csalt_rwlock_rdlock(&rwlock);
+			if (shared[0] != shared[1])
+				print_error_and_exit("Read lock held during write");
+			csalt_rwlock_unlock(&rwlock);
+		}
+	}
+	return NULL;
+}
+
+static void *ping_pong(void *param)
+{
+	const int self = (int)(ssize_t)param;
+	for (int i = 0; i < ITERATIONS / 100; i++) {
+		csalt_mutex_lock(&mutex);
+		while (turn != self)
+			csalt_cond_wait(&cond, &mutex);
+		turn = !self;
+		csalt_cond_broadcast(&cond);
+		csalt_mutex_unlock(&mutex);
+	}
+	return NULL;
+}
+
+int main()
+{
+#ifdef CSALT_FUTEX
+	if (sizeof(csalt_mutex) != 4 || sizeof(csalt_rwlock) != 4)
+		print_error_and_exit("Futex locks are larger than expected");
+#endif
+
+	csalt_mutex_init(&mutex, NULL);
+	csalt_rwlock_init(&rwlock, NULL);
+	csalt_cond_init(&cond);
+
+	{
+		if (csalt_mutex_trylock(&mutex))
+			print_error_and_exit("Unable to lock free mutex");
+		if (!csalt_mutex_trylock(&mutex))
+			print_error_and_exit("Locked mutex twice");
+		csalt_mutex_unlock(&mutex);
+	}
+
+	{
+		if (csalt_rwlock_tryrdlock(&rwlock) || csalt_rwlock_tryrdlock(&rwlock))
+			print_error_and_exit("Unable to share read lock");
+		if (!csalt_rwlock_trywrlock(&rwlock))
+			print_error_and_exit("Write lock taken while read-locked");
+		csalt_rwlock_unlock(&rwlock);
+		csalt_rwlock_unlock(&rwlock);
+
+		if (csalt_rwlock_trywrlock(&rwlock))
+			print_error_and_exit("Unable to write lock free rwlock");
+		if (!csalt_rwlock_tryrdlock(&rwlock))
+			print_error_and_exit("Read lock taken while write-locked");
+		csalt_rwlock_unlock(&rwlock);
+	}
+
+	{
+		csalt_thread threads[THREADS];
+		for (int i = 0; i < THREADS; i++)
+			csalt_thread_create(&threads[i], increment, NULL);
+		for (int i = 0; i < THREADS; i++)
+			csalt_thread_join(threads[i]);
+
+		if (counter != THREADS * ITERATIONS)
+			print_error_and_exit("Lost updates under mutex: %ld", counter);
+	}
+
+	{
+		csalt_thread threads[THREADS];
+		for (int i = 0; i < THREADS; i++)
+			csalt_thread_create(&threads[i], read_write, (void *)(ssize_t)(i % 2));
+		for (int i = 0; i < THREADS; i++)
+			csalt_thread_join(threads[i]);
+
+		if (shared[0] != THREADS / 2 * (ITERATIONS / 10))
+			print_error_and_exit("Lost updates under rwlock: %ld", shared[0]);
+	}
+
+	{
+		csalt_thread threads[2];
+		for (int i = 0; i < 2; i++)
+			csalt_thread_create(&threads[i], ping_pong, (void *)(ssize_t)i);
+		for (int i = 0; i < 2; i++)
+			csalt_thread_join(threads[i]);
+	}
+
+	csalt_cond_deinit(&cond);
+	csalt_rwlock_deinit(&rwlock);
+	csalt_mutex_deinit(&mutex);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <string.h>
+
+#define BLOCK_SIZE 16
+#define BLOCK_COUNT 4
+#define STORE_SIZE 200
+
+static void expect_contents(
+	csalt_static_store *store,
+	ssize_t offset,
+	ssize_t amount,
+	const char *expected
+)
+{
+	char buffer[STORE_SIZE] = { 0 };
+	const ssize_t result = csalt_store_read(store, buffer, amount);
+	if (result != amount)
+		print_error_and_exit("Read %zd bytes at %zd, expected %zd", result, offset, amount);
+	if (memcmp(buffer, expected + offset, (size_t)amount))
+		print_error_and_exit("Unexpected contents at %zd", offset);
+}
+
+struct range {
+	ssize_t offset;
+	ssize_t amount;
+	const char *expected;
+};
+
+static int read_range(csalt_static_store *store, void *param)
+{
+	struct range *const range = param;
+	expect_contents(store, range->offset, range->amount, range->expected);
+	return 0;
+}
+
+static void expect_counters(
+	struct csalt_store_cache *cache,
+	size_t hits,
+	size_t misses,
+	size_t evictions
+)
+{
+	if (cache->hits != hits || cache->misses != misses || cache->evictions != evictions)
+		print_error_and_exit(
+			"Expected %zu/%zu/%zu hits/misses/evictions, got %zu/%zu/%zu",
+			hits,
+			misses,
+			evictions,
+			cache->hits,
+			cache->misses,
+			cache->evictions);
+}
+
+static void read_at(
+	csalt_store *store,
+	ssize_t offset,
+	ssize_t amount,
+	const char *expected
+)
+{
+	struct range range = { offset, amount, expected };
+	csalt_store_split(
+		(csalt_static_store *)store,
+		offset,
+		offset + amount,
+		read_range,
+		&range);
+}
+
+static int read_short(csalt_static_store *store, void *param)
+{
+	const char *const expected = param;
+	char buffer[32];
+	if (csalt_store_read(store, buffer, sizeof(buffer)) != 10)
+		print_error_and_exit("Read past the end wasn't short");
+	if (memcmp(buffer, expected + 190, 10))
+		print_error_and_exit("Unexpected contents at the end");
+	return 0;
+}
+
+struct write {
+	const char *data;
+	ssize_t amount;
+};
+
+static int write_range(csalt_static_store *store, void *param)
+{
+	struct write *const write = param;
+	return csalt_store_write(store, write->data, write->amount) == write->amount? 0: -1;
+}
+
+int main()
+{
+	char contents[STORE_SIZE];
+	for (int i = 0; i < STORE_SIZE; i++)
+		contents[i] = (char)(i * 3 + 1);
+
+	struct csalt_resource_heap heap = csalt_resource_heap(STORE_SIZE);
+	struct csalt_resource_cache resource = csalt_resource_cache(
+		csalt_resource(&heap),
+		BLOCK_SIZE,
+		BLOCK_COUNT);
+
+	csalt_store *const store = csalt_resource_init(csalt_resource(&resource));
+	if (!store)
+		print_error_and_exit("Unable to initialize the cache");
+	struct csalt_store_cache *const cache = (struct csalt_store_cache *)store;
+	csalt_store *const decorated = (csalt_store *)&heap.store;
+	csalt_store_write((csalt_static_store *)decorated, contents, STORE_SIZE);
+
+	// Misses, then hits on the same block
+	{
+		expect_contents((csalt_static_store *)store, 0, 10, contents);
+		expect_counters(cache, 0, 1, 0);
+		expect_contents((csalt_static_store *)store, 0, 16, contents);
+		expect_counters(cache, 1, 1, 0);
+	}
+
+	// A read spanning blocks, starting part-way into one
+	{
+		read_at(store, 20, 30, contents);
+		expect_counters(cache, 1, 4, 0);
+		read_at(store, 30, 20, contents);
+		expect_counters(cache, 4, 4, 0);
+	}
+
+	// Reading past the end of the store is short
+	{
+		char buffer[32];
+		if (csalt_store_read((csalt_static_store *)store, buffer, 0) != 0)
+			print_error_and_exit("Empty read returned data");
+		csalt_store_split((csalt_static_store *)store, 190, 300, read_short, contents);
+		expect_counters(cache, 4, 6, 2);
+	}
+
+	// The blocks which keep being read survive eviction
+	{
+		csalt_store_cache_invalidate(cache);
+		cache->hits = cache->misses = cache->evictions = 0;
+
+		read_at(store, 0, 1, contents);
+		read_at(store, 16, 1, contents);
+		read_at(store, 32, 1, contents);
+		read_at(store, 48, 1, contents);
+		expect_counters(cache, 0, 4, 0);
+
+		// The hand clears every reference bit and evicts block 0
+		read_at(store, 64, 1, contents);
+		expect_counters(cache, 0, 5, 1);
+
+		// Block 1 is referenced again, so block 2 goes next
+		read_at(store, 16, 1, contents);
+		read_at(store, 80, 1, contents);
+		expect_counters(cache, 1, 6, 2);
+		read_at(store, 16, 1, contents);
+		expect_counters(cache, 2, 6, 2);
+		read_at(store, 32, 1, contents);
+		expect_counters(cache, 2, 7, 3);
+	}
+
+	// A read larger than the whole cache
+	{
+		expect_contents((csalt_static_store *)store, 0, STORE_SIZE, contents);
+		if (cache->evictions <= 3)
+			print_error_and_exit("Large read didn't evict anything");
+	}
+
+	// Writes go through to the decorated store and refresh the cache
+	{
+		expect_contents((csalt_static_store *)store, 0, 40, contents);
+		const char update[] = "written through";
+		struct write write = { update, sizeof(update) - 1 };
+		if (csalt_store_split((csalt_static_store *)store, 10, 40, write_range, &write))
+			print_error_and_exit("Write through the cache failed");
+		memcpy(contents + 10, update, sizeof(update) - 1);
+
+		char buffer[STORE_SIZE];
+		csalt_store_read((csalt_static_store *)decorated, buffer, STORE_SIZE);
+		if (memcmp(buffer, contents, STORE_SIZE))
+			print_error_and_exit("Write didn't reach the decorated store");
+		expect_contents((csalt_static_store *)store, 0, 40, contents);
+	}
+
+	// Growing the store refreshes the short block at its end
+	{
+		read_at(store, 192, 8, contents);
+		if (csalt_store_resize(store, STORE_SIZE + 8) != STORE_SIZE + 8)
+			print_error_and_exit("Resize failed");
+
+		char grown[STORE_SIZE + 8];
+		memcpy(grown, contents, STORE_SIZE);
+		memcpy(grown + STORE_SIZE, "12345678", 8);
+		struct write write = { "12345678", 8 };
+		csalt_store_split((csalt_static_store *)store, STORE_SIZE, STORE_SIZE + 8, write_range, &write);
+		read_at(store, 192, 16, grown);
+		if (csalt_store_size(store) != STORE_SIZE + 8)
+			print_error_and_exit("Size not passed to the decorated store");
+	}
+
+	csalt_resource_deinit(csalt_resource(&resource));
+
+	{
+		struct csalt_resource_stub failing = csalt_resource_stub(1);
+		struct csalt_resource_cache invalid = csalt_resource_cache(
+			csalt_resource(&failing),
+			BLOCK_SIZE,
+			BLOCK_COUNT);
+		if (csalt_resource_init(csalt_resource(&invalid)))
+			print_error_and_exit("Cache initialized over a failed resource");
+
+		struct csalt_resource_stub stub = csalt_resource_stub(0);
+		struct csalt_resource_cache empty = csalt_resource_cache(
+			csalt_resource(&stub),
+			BLOCK_SIZE,
+			0);
+		if (csalt_resource_init(csalt_resource(&empty)))
+			print_error_and_exit("Cache with no blocks initialized");
+		if (stub.init_called)
+			print_error_and_exit("Cache with no blocks initialized its resource");
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#define JOBS 64
+
+struct csalt_store_executor *executor;
+
+static int use_heap(csalt_store *store, void *param)
+{
+	const int value = *(int *)param;
+	csalt_store_write((csalt_static_store *)store, &value, sizeof(value));
+
+	int result = 0;
+	csalt_store_read((csalt_static_store *)store, &result, sizeof(result));
+	return result * 2;
+}
+
+static int fibonacci(void *param)
+{
+	const int n = (int)(ssize_t)param;
+	if (n < 2)
+		return n;
+
+	struct csalt_executor_job
+		left = csalt_executor_job_fn(fibonacci, (void *)(ssize_t)(n - 1));
+
+	if (csalt_store_executor_submit(executor, &left))
+		return fibonacci((void *)(ssize_t)(n - 1)) + fibonacci((void *)(ssize_t)(n - 2));
+
+	const int right = fibonacci((void *)(ssize_t)(n - 2));
+	return csalt_executor_job_wait(&left) + right;
+}
+
+atomic_int release = 0;
+
+static int hold(void *param)
+{
+	(void)param;
+	while (!atomic_load(&release));
+	return 0;
+}
+
+static int use_executor(csalt_static_store *store, void *param)
+{
+	(void)param;
+	executor = (struct csalt_store_executor *)store;
+
+	{
+		struct csalt_resource_heap heaps[JOBS];
+		struct csalt_executor_job jobs[JOBS];
+		int values[JOBS];
+
+		for (int i = 0; i < JOBS; i++) {
+			values[i] = i;
+			heaps[i] = csalt_resource_heap(sizeof(int));
+			jobs[i] = csalt_executor_job(
+				csalt_resource(&heaps[i]),
+				use_heap,
+				&values[i]);
+			if (csalt_store_executor_submit(executor, &jobs[i]))
+				print_error_and_exit("Failed to submit job %d", i);
+		}
+
+		for (int i = 0; i < JOBS; i++) {
+			const int result = csalt_executor_job_wait(&jobs[i]);
+			if (result != i * 2)
+				print_error_and_exit("Job %d returned %d", i, result);
+		}
+	}
+
+	{
+		struct csalt_resource_heap failure = csalt_resource_heap(-1);
+		struct csalt_executor_job job = csalt_executor_job(
+			csalt_resource(&failure),
+			use_heap,
+			NULL);
+		csalt_store_executor_submit(executor, &job);
+		if (csalt_executor_job_wait(&job) != -1)
+			print_error_and_exit("Failed resource did not return -1");
+	}
+
+	{
+		struct csalt_executor_job job = csalt_executor_job_fn(
+			fibonacci,
+			(void *)(ssize_t)15);
+		csalt_store_executor_submit(executor, &job);
+		const int result = csalt_executor_job_wait(&job);
+		if (result != 610)
+			print_error_and_exit("Nested jobs returned %d", result);
+	}
+
+	{
+		struct csalt_executor_job unsubmitted = csalt_executor_job_fn(hold, NULL);
+		if (csalt_executor_job_wait(&unsubmitted) != -1)
+			print_error_and_exit("Waiting on an unsubmitted job succeeded");
+	}
+
+	return 0;
+}
+
+static int use_small_executor(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_executor *small = (struct csalt_store_executor *)store;
+
+	struct csalt_executor_job
+		running = csalt_executor_job_fn(hold, NULL),
+		queued = csalt_executor_job_fn(hold, NULL),
+		rejected = csalt_executor_job_fn(hold, NULL);
+
+	csalt_store_executor_submit(small, &running);
+	while (atomic_load(&small->pending));
+
+	if (csalt_store_executor_submit(small, &queued))
+		print_error_and_exit("Queue rejected a job with space available");
+
+	if (!csalt_store_executor_submit(small, &rejected))
+		print_error_and_exit("Full queue accepted a job");
+
+	if (csalt_executor_job_done(&running))
+		print_error_and_exit("Job finished early");
+
+	atomic_store(&release, 1);
+	csalt_store_executor_wait(small);
+
+	if (!csalt_executor_job_done(&running) || !csalt_executor_job_done(&queued))
+		print_error_and_exit("Wait returned before jobs finished");
+
+	return 0;
+}
+
+int main()
+{
+	struct csalt_resource_executor
+		resource = csalt_resource_executor(4, JOBS);
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&resource,
+		use_executor,
+		NULL
+	))
+		print_error_and_exit("Executor tests failed");
+
+	struct csalt_resource_executor
+		small = csalt_resource_executor(1, 1);
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&small,
+		use_small_executor,
+		NULL
+	))
+		print_error_and_exit("Small executor tests failed");
+
+	struct csalt_resource_executor
+		invalid = csalt_resource_executor(1, 0);
+
+	if (csalt_static_resource_init((csalt_static_resource *)&invalid))
+		print_error_and_exit("Executor with no queue initialized");
+
+	return EXIT_SUCCESS;
+}
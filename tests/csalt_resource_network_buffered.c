@@ -0,0 +1,165 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+
+int peer = -1;
+
+static void expect_nothing_sent(void)
+{
+	char byte;
+	if (recv(peer, &byte, 1, MSG_DONTWAIT) != -1)
+		print_error_and_exit("Data sent before flush");
+}
+
+static void expect_received(const char *expected, ssize_t size)
+{
+	char buffer[256] = { 0 };
+	ssize_t total = 0;
+	while (total < size) {
+		const ssize_t amount = read(peer, buffer + total, (size_t)(size - total));
+		if (amount <= 0)
+			print_error_and_exit("Peer didn't receive data");
+		total += amount;
+	}
+	if (memcmp(buffer, expected, (size_t)size))
+		print_error_and_exit("Peer received unexpected data");
+}
+
+static int use_buffered(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_network_buffered *buffered = (void *)store;
+
+	{
+		int nodelay = 0;
+		socklen_t length = sizeof(nodelay);
+		getsockopt(buffered->parent.fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, &length);
+		if (!nodelay)
+			print_error_and_exit("TCP_NODELAY wasn't set");
+	}
+
+	{
+		csalt_store_write(store, "abc", 3);
+		csalt_store_write(store, "def", 3);
+		csalt_store_write(store, "ghi", 3);
+		expect_nothing_sent();
+
+		if (csalt_store_network_buffered_flush(buffered) != 0)
+			print_error_and_exit("Flush didn't send everything");
+		expect_received("abcdefghi", 9);
+	}
+
+	{
+		char large[100];
+		memset(large, 'x', sizeof(large));
+		csalt_store_write(store, "ab", 2);
+		if (csalt_store_write(store, large, sizeof(large)) != sizeof(large))
+			print_error_and_exit("Large write was not accepted");
+		if (buffered->write_length)
+			print_error_and_exit("Large write was buffered");
+
+		char expected[102] = "ab";
+		memset(expected + 2, 'x', sizeof(large));
+		expect_received(expected, sizeof(expected));
+	}
+
+	{
+		if (write(peer, "0123456789", 10) != 10)
+			print_error_and_exit("Peer unable to send");
+
+		csalt_store_write(store, "ping", 4);
+
+		char buffer[4] = { 0 };
+		if (csalt_store_read(store, buffer, 4) != 4 || memcmp(buffer, "0123", 4))
+			print_error_and_exit("Unexpected buffered read");
+		if (buffered->read_end - buffered->read_begin != 6)
+			print_error_and_exit("Read wasn't buffered");
+
+		expect_received("ping", 4);
+
+		if (csalt_store_read(store, buffer, 4) != 4 || memcmp(buffer, "4567", 4))
+			print_error_and_exit("Unexpected read from buffer");
+	}
+
+	csalt_store_write(store, "end", 3);
+	return 0;
+}
+
+int main()
+{
+	struct sockaddr_in address = {
+		.sin_family = AF_INET,
+	};
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+	socklen_t length = sizeof(address);
+
+	const int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (
+		bind(listener, (struct sockaddr *)&address, length) ||
+		getsockname(listener, (struct sockaddr *)&address, &length) ||
+		listen(listener, 1)
+	)
+		print_error_and_exit("Unable to listen");
+
+	char port[sizeof("65535")];
+	snprintf(port, sizeof(port), "%d", ntohs(address.sin_port));
+
+	struct addrinfo hints = {
+		.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV,
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+
+	struct csalt_resource_network_client
+		client = csalt_resource_network_client("127.0.0.1", port, &hints);
+
+	struct csalt_resource_network_buffered
+		buffered = csalt_resource_network_buffered(
+			(csalt_static_resource *)&client,
+			64,
+			16,
+			(struct csalt_network_buffered_options) {
+				.nodelay = true,
+				.cork = false,
+			});
+
+	csalt_static_store *store = csalt_static_resource_init(
+		(csalt_static_resource *)&buffered);
+	if (!store)
+		print_error_and_exit("Unable to initialize buffered client");
+
+	peer = accept(listener, NULL, NULL);
+
+	use_buffered(store, NULL);
+
+	csalt_resource_deinit((csalt_resource *)&buffered);
+	expect_received("end", 3);
+
+	close(peer);
+	close(listener);
+	return EXIT_SUCCESS;
+}
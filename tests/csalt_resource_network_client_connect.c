@@ -0,0 +1,187 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <time.h>
+
+INIT_IMPL(
+	int,
+	getaddrinfo,
+	ARGS(
+		const char *node,
+		const char *service,
+		const struct addrinfo *hints,
+		struct addrinfo **res
+	),
+	ARGS(
+		node,
+		service,
+		hints,
+		res
+	))
+
+INIT_IMPL(
+	void,
+	freeaddrinfo,
+	ARGS(struct addrinfo *res),
+	ARGS(res))
+
+void freeaddrinfo_stub(struct addrinfo *res)
+{
+	(void)res;
+}
+
+struct sockaddr_in
+	// TEST-NET-1, which should never answer
+	unreachable = { .sin_family = AF_INET },
+	refused = { .sin_family = AF_INET },
+	listening = { .sin_family = AF_INET };
+
+struct addrinfo addresses[2];
+const struct addrinfo *requested = NULL;
+
+int getaddrinfo_stub(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	struct addrinfo **res
+)
+{
+	(void)node;
+	(void)service;
+	requested = hints;
+	*res = addresses;
+	return 0;
+}
+
+static void set_addresses(struct sockaddr_in *first, struct sockaddr_in *second)
+{
+	struct sockaddr_in *list[] = { first, second };
+	for (int i = 0; i < 2; i++) {
+		addresses[i] = (struct addrinfo) {
+			.ai_family = AF_INET,
+			.ai_socktype = SOCK_STREAM,
+			.ai_addr = (struct sockaddr *)list[i],
+			.ai_addrlen = sizeof(*list[i]),
+			.ai_next = i || !second? NULL: &addresses[1],
+		};
+	}
+}
+
+static long long now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int expect_blocking(csalt_static_store *store, void *param)
+{
+	(void)param;
+	const int fd = ((struct csalt_store_network_client *)store)->fd;
+	if (fcntl(fd, F_GETFL) & O_NONBLOCK)
+		print_error_and_exit("Connected socket left non-blocking");
+	return 0;
+}
+
+static int bound_socket(struct sockaddr_in *address)
+{
+	const int fd = socket(AF_INET, SOCK_STREAM, 0);
+	inet_pton(AF_INET, "127.0.0.1", &address->sin_addr);
+	socklen_t length = sizeof(*address);
+	if (
+		bind(fd, (struct sockaddr *)address, length) ||
+		getsockname(fd, (struct sockaddr *)address, &length)
+	)
+		print_error_and_exit("Unable to bind test socket");
+	return fd;
+}
+
+int main()
+{
+	SET_IMPL(getaddrinfo, getaddrinfo_stub);
+	SET_IMPL(freeaddrinfo, freeaddrinfo_stub);
+
+	inet_pton(AF_INET, "192.0.2.1", &unreachable.sin_addr);
+	unreachable.sin_port = htons(9);
+
+	close(bound_socket(&refused));
+
+	const int listener = bound_socket(&listening);
+	if (listen(listener, 4))
+		print_error_and_exit("Unable to listen");
+
+	struct csalt_network_client_options options = csalt_network_client_options();
+	options.attempt_delay = 50;
+	options.timeout = 5000;
+
+	struct csalt_resource_network_client client
+		= csalt_resource_network_client_options(NULL, NULL, NULL, options);
+	csalt_static_resource *resource = (csalt_static_resource *)&client;
+
+	{
+		set_addresses(&unreachable, &listening);
+		const long long start = now_ms();
+		if (csalt_static_resource_use(resource, expect_blocking, NULL))
+			print_error_and_exit("Unable to connect past an unresponsive address");
+		if (now_ms() - start > 2000)
+			print_error_and_exit("Unresponsive address wasn't raced");
+		if (!requested || requested->ai_socktype != SOCK_STREAM)
+			print_error_and_exit("TCP wasn't requested without hints");
+	}
+
+	{
+		set_addresses(&refused, &listening);
+		if (csalt_static_resource_use(resource, expect_blocking, NULL))
+			print_error_and_exit("Unable to connect past a refused address");
+	}
+
+	{
+		set_addresses(&refused, NULL);
+		if (!csalt_static_resource_use(resource, expect_blocking, NULL))
+			print_error_and_exit("Connected to a refused address");
+	}
+
+	{
+		client.options.timeout = 100;
+		set_addresses(&unreachable, NULL);
+		const long long start = now_ms();
+		if (!csalt_static_resource_use(resource, expect_blocking, NULL))
+			print_error_and_exit("Connected to an unresponsive address");
+		if (now_ms() - start > 2000)
+			print_error_and_exit("Timeout not respected");
+	}
+
+	{
+		// A datagram socket "connects" straight away, so it
+		// mustn't be raced against the stream socket
+		set_addresses(&unreachable, &unreachable);
+		addresses[1].ai_socktype = SOCK_DGRAM;
+		addresses[1].ai_protocol = IPPROTO_UDP;
+		if (!csalt_static_resource_use(resource, expect_blocking, NULL))
+			print_error_and_exit("Datagram socket returned as a connection");
+	}
+
+	close(listener);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+
+struct csalt_store_network_client_pool *pool;
+int listener = -1;
+char port[sizeof("65535")];
+
+struct addrinfo hints = {
+	.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV,
+	.ai_family = AF_INET,
+	.ai_socktype = SOCK_STREAM,
+};
+
+static int local_port(csalt_static_store *store)
+{
+	struct sockaddr_in address;
+	socklen_t length = sizeof(address);
+	getsockname(
+		((struct csalt_store_network_client *)store)->fd,
+		(struct sockaddr *)&address,
+		&length);
+	return ntohs(address.sin_port);
+}
+
+static int get_port(csalt_static_store *store, void *param)
+{
+	*(int *)param = local_port(store);
+	return 0;
+}
+
+static int use_client(csalt_static_store_block_fn *block, void *param)
+{
+	struct csalt_resource_network_pooled_client client
+		= csalt_resource_network_pooled_client(pool, "127.0.0.1", port, &hints);
+	return csalt_static_resource_use(
+		(csalt_static_resource *)&client,
+		block,
+		param);
+}
+
+static int get_port_and_discard(csalt_static_store *store, void *param)
+{
+	csalt_store_network_pooled_client_discard(
+		(struct csalt_store_network_pooled_client *)store);
+	return get_port(store, param);
+}
+
+static int nested_third(csalt_static_store *store, void *param)
+{
+	(void)store;
+	(void)param;
+	print_error_and_exit("Limit per key was exceeded");
+}
+
+static int nested_second(csalt_static_store *store, void *param)
+{
+	if (local_port(store) == *(int *)param)
+		print_error_and_exit("Connection in use was handed out twice");
+	if (use_client(nested_third, NULL) != -1)
+		print_error_and_exit("Pool at its limit didn't fail");
+	return 0;
+}
+
+static int nested_first(csalt_static_store *store, void *param)
+{
+	(void)param;
+	int first = local_port(store);
+	return use_client(nested_second, &first);
+}
+
+static int use_pool(csalt_static_store *store, void *param)
+{
+	(void)param;
+	pool = (struct csalt_store_network_client_pool *)store;
+
+	int first = 0, second = 0;
+
+	{
+		use_client(get_port, &first);
+		use_client(get_port, &second);
+		if (!first || first != second)
+			print_error_and_exit("Idle connection wasn't reused");
+	}
+
+	{
+		if (use_client(nested_first, NULL))
+			print_error_and_exit("Nested pooled clients failed");
+	}
+
+	{
+		// The peer closing the connection should be noticed before
+		// it's handed out again
+		int accepted;
+		while ((accepted = accept(listener, NULL, NULL)) != -1)
+			close(accepted);
+
+		use_client(get_port, &second);
+		if (first == second)
+			print_error_and_exit("Connection closed by the peer was reused");
+	}
+
+	{
+		use_client(get_port_and_discard, &first);
+		use_client(get_port, &second);
+		if (first == second)
+			print_error_and_exit("Discarded connection was reused");
+	}
+
+	{
+		use_client(get_port, &first);
+		usleep(150 * 1000);
+		if (csalt_store_network_client_pool_prune(pool) < 1)
+			print_error_and_exit("Expired connections weren't pruned");
+		use_client(get_port, &second);
+		if (first == second)
+			print_error_and_exit("Expired connection was reused");
+	}
+
+	return 0;
+}
+
+int main()
+{
+	struct sockaddr_in address = {
+		.sin_family = AF_INET,
+	};
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+	socklen_t length = sizeof(address);
+
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (
+		bind(listener, (struct sockaddr *)&address, length) ||
+		getsockname(listener, (struct sockaddr *)&address, &length) ||
+		listen(listener, 16)
+	)
+		print_error_and_exit("Unable to listen");
+	fcntl(listener, F_SETFL, O_NONBLOCK);
+	snprintf(port, sizeof(port), "%d", ntohs(address.sin_port));
+
+	struct csalt_resource_network_client_pool
+		resource = csalt_resource_network_client_pool(2, 100);
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&resource,
+		use_pool,
+		NULL
+	))
+		print_error_and_exit("Pool tests failed");
+
+	struct csalt_resource_network_client_pool
+		invalid = csalt_resource_network_client_pool(0, 100);
+	if (csalt_static_resource_init((csalt_static_resource *)&invalid))
+		print_error_and_exit("Pool with no connections initialized");
+
+	close(listener);
+	return EXIT_SUCCESS;
+}
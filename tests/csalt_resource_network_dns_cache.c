@@ -0,0 +1,244 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define THREADS 4
+
+INIT_IMPL(
+	int,
+	getaddrinfo,
+	ARGS(
+		const char *node,
+		const char *service,
+		const struct addrinfo *hints,
+		struct addrinfo **res
+	),
+	ARGS(
+		node,
+		service,
+		hints,
+		res
+	)
+);
+
+INIT_IMPL(
+	void,
+	freeaddrinfo,
+	struct addrinfo *res,
+	res
+);
+
+/*
+ * Stands in for the hosts file: known.test resolves, flaky.test
+ * fails temporarily, and anything else doesn't exist.
+ */
+struct addrinfo known = {
+	.ai_next = NULL,
+};
+
+atomic_int lookups = 0;
+atomic_int frees = 0;
+useconds_t delay = 0;
+
+int getaddrinfo_hosts(
+	const char *node,
+	const char *service,
+	const struct addrinfo *hints,
+	struct addrinfo **res
+)
+{
+	(void)service;
+	(void)hints;
+	atomic_fetch_add(&lookups, 1);
+	if (delay)
+		usleep(delay);
+
+	if (!strcmp(node, "known.test")) {
+		*res = &known;
+		return 0;
+	}
+	if (!strcmp(node, "flaky.test"))
+		return EAI_AGAIN;
+	return EAI_NONAME;
+}
+
+void freeaddrinfo_count(struct addrinfo *res)
+{
+	if (res != &known)
+		print_error_and_exit("Freed an unexpected result");
+	atomic_fetch_add(&frees, 1);
+}
+
+static int expect_known(const struct addrinfo *result, void *param)
+{
+	(void)param;
+	if (result != &known)
+		print_error_and_exit("Unexpected result: %p", (void *)result);
+	return 0;
+}
+
+static int lookup(const char *node)
+{
+	return csalt_resource_network_getaddrinfo(
+		node,
+		"80",
+		NULL,
+		expect_known,
+		NULL);
+}
+
+static void *lookup_thread(void *param)
+{
+	(void)param;
+	if (lookup("known.test"))
+		print_error_and_exit("Concurrent lookup failed");
+	return NULL;
+}
+
+int main()
+{
+	SET_IMPL(getaddrinfo, getaddrinfo_hosts);
+	SET_IMPL(freeaddrinfo, freeaddrinfo_count);
+
+	{
+		lookup("known.test");
+		lookup("known.test");
+		if (atomic_load(&lookups) != 2)
+			print_error_and_exit("Results were cached while disabled");
+	}
+
+	struct csalt_network_dns_cache_options options = {
+		.ttl = 100,
+		.negative_ttl = 100,
+		.background = false,
+	};
+
+	{
+		if (csalt_resource_network_dns_cache_enable(&options))
+			print_error_and_exit("Unable to enable the cache");
+
+		atomic_store(&lookups, 0);
+		atomic_store(&frees, 0);
+		if (lookup("known.test") || lookup("known.test"))
+			print_error_and_exit("Cached lookup failed");
+		if (atomic_load(&lookups) != 1)
+			print_error_and_exit("Result wasn't cached: %d lookups", atomic_load(&lookups));
+
+		usleep(150 * 1000);
+		lookup("known.test");
+		if (atomic_load(&lookups) != 2)
+			print_error_and_exit("Expired result was used");
+		if (atomic_load(&frees) != 1)
+			print_error_and_exit("Expired result wasn't freed");
+	}
+
+	{
+		atomic_store(&lookups, 0);
+		if (lookup("unknown.test") != EAI_NONAME || lookup("unknown.test") != EAI_NONAME)
+			print_error_and_exit("Unknown host didn't fail");
+		if (atomic_load(&lookups) != 1)
+			print_error_and_exit("Failure wasn't cached");
+
+		if (lookup("flaky.test") != EAI_AGAIN || lookup("flaky.test") != EAI_AGAIN)
+			print_error_and_exit("Temporary failure not reported");
+		if (atomic_load(&lookups) != 3)
+			print_error_and_exit("Temporary failure was cached");
+	}
+
+	{
+		csalt_resource_network_dns_cache_disable();
+		csalt_resource_network_dns_cache_enable(&options);
+		atomic_store(&frees, 0);
+
+		lookup("known.test");
+		usleep(150 * 1000);
+		lookup("unknown.test");
+		if (atomic_load(&frees) != 1)
+			print_error_and_exit("Expired result wasn't swept by a new name");
+	}
+
+	{
+		csalt_resource_network_dns_cache_disable();
+		options.max_entries = 1;
+		csalt_resource_network_dns_cache_enable(&options);
+		atomic_store(&lookups, 0);
+		atomic_store(&frees, 0);
+
+		lookup("known.test");
+		lookup("unknown.test");
+		if (atomic_load(&frees) != 1)
+			print_error_and_exit("Oldest name wasn't evicted");
+		lookup("known.test");
+		if (atomic_load(&lookups) != 3)
+			print_error_and_exit("Evicted name was still cached");
+		options.max_entries = 0;
+	}
+
+	{
+		csalt_resource_network_dns_cache_disable();
+		csalt_resource_network_dns_cache_enable(&options);
+		atomic_store(&lookups, 0);
+		delay = 50 * 1000;
+
+		pthread_t threads[THREADS];
+		for (int i = 0; i < THREADS; i++)
+			pthread_create(&threads[i], NULL, lookup_thread, NULL);
+		for (int i = 0; i < THREADS; i++)
+			pthread_join(threads[i], NULL);
+
+		if (atomic_load(&lookups) != 1)
+			print_error_and_exit("Concurrent lookups weren't shared: %d", atomic_load(&lookups));
+	}
+
+	{
+		csalt_resource_network_dns_cache_disable();
+		options.background = true;
+		csalt_resource_network_dns_cache_enable(&options);
+		atomic_store(&lookups, 0);
+
+		if (lookup("known.test") != EAI_AGAIN)
+			print_error_and_exit("Background lookup blocked");
+
+		int result;
+		while ((result = lookup("known.test")) == EAI_AGAIN)
+			usleep(1000);
+
+		if (result != 0)
+			print_error_and_exit("Background lookup failed: %d", result);
+		if (atomic_load(&lookups) != 1)
+			print_error_and_exit("Background lookup repeated");
+
+		// Disabling while a lookup is running waits for it
+		if (lookup("other.test") != EAI_AGAIN)
+			print_error_and_exit("Background lookup blocked");
+	}
+
+	atomic_store(&frees, 0);
+	csalt_resource_network_dns_cache_disable();
+	if (atomic_load(&frees) != 1)
+		print_error_and_exit("Cached results weren't freed on disable");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define CLIENTS 32
+
+struct sockaddr_in address;
+int closed = 0;
+
+static void *run_clients(void *param)
+{
+	(void)param;
+	int fds[CLIENTS];
+
+	for (int i = 0; i < CLIENTS; i++) {
+		fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(fds[i], (struct sockaddr *)&address, sizeof(address)))
+			print_error_and_exit("Unable to connect client %d", i);
+	}
+
+	for (int i = 0; i < CLIENTS; i++)
+		if (write(fds[i], &i, sizeof(i)) != sizeof(i))
+			print_error_and_exit("Unable to send from client %d", i);
+
+	for (int i = 0; i < CLIENTS; i++) {
+		int reply = -1;
+		if (read(fds[i], &reply, sizeof(reply)) != sizeof(reply))
+			print_error_and_exit("No reply for client %d", i);
+		if (reply != i * 2)
+			print_error_and_exit("Unexpected reply for client %d: %d", i, reply);
+		close(fds[i]);
+	}
+
+	return NULL;
+}
+
+static int double_value(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_network_server_client *client = (void *)store;
+
+	int value = 0;
+	const ssize_t amount = csalt_store_read(store, &value, sizeof(value));
+	if (amount == 0) {
+		if (client->data != client)
+			print_error_and_exit("Client data was not kept");
+		closed++;
+		return 0;
+	}
+	if (amount != sizeof(value))
+		print_error_and_exit("Short read from client: %ld", amount);
+
+	client->data = client;
+	value *= 2;
+	if (csalt_store_write(store, &value, sizeof(value)) != sizeof(value))
+		print_error_and_exit("Unable to reply to client");
+	return 1;
+}
+
+static int use_server(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_network_server *server = (void *)store;
+
+	socklen_t length = sizeof(address);
+	if (getsockname(server->fd, (struct sockaddr *)&address, &length))
+		print_error_and_exit("Unable to get server address");
+
+	if (csalt_store_network_server_poll(server, 0, double_value, NULL) != 0)
+		print_error_and_exit("Idle server reported events");
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, run_clients, NULL);
+
+	while (closed < CLIENTS)
+		if (csalt_store_network_server_poll(server, 1000, double_value, NULL) <= 0)
+			print_error_and_exit("Server stopped receiving events");
+
+	pthread_join(thread, NULL);
+
+	if (server->client_count != 0)
+		print_error_and_exit("Clients left open: %ld", server->client_count);
+
+	return 0;
+}
+
+static long long elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000
+		+ (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int use_exhausted_server(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_network_server *server = (void *)store;
+
+	socklen_t length = sizeof(address);
+	if (getsockname(server->fd, (struct sockaddr *)&address, &length))
+		print_error_and_exit("Unable to get server address");
+
+	const int client = socket(AF_INET, SOCK_STREAM, 0);
+	if (connect(client, (struct sockaddr *)&address, sizeof(address)))
+		print_error_and_exit("Unable to connect client");
+
+	// Leave no room for the accepted connection's descriptor
+	struct rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	const rlim_t previous = limit.rlim_cur;
+	limit.rlim_cur = client + 1;
+	if (setrlimit(RLIMIT_NOFILE, &limit))
+		print_error_and_exit("Unable to lower the descriptor limit");
+
+	if (csalt_store_network_server_poll(server, 1000, double_value, NULL) != 1)
+		print_error_and_exit("Pending connection not reported");
+	if (server->client_count != 0)
+		print_error_and_exit("Connection accepted past the limit");
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (csalt_store_network_server_poll(server, 50, double_value, NULL) != 0)
+		print_error_and_exit("Unacceptable connection reported again");
+	if (elapsed_ms(&start) < 40)
+		print_error_and_exit("Poll returned without waiting");
+
+	limit.rlim_cur = previous;
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	while (server->client_count == 0)
+		if (csalt_store_network_server_poll(server, 1000, double_value, NULL) < 0)
+			print_error_and_exit("Server failed while resuming");
+
+	close(client);
+	return 0;
+}
+
+int main()
+{
+	struct addrinfo hints = {
+		.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV,
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+
+	struct csalt_resource_network_server
+		server = csalt_resource_network_server("127.0.0.1", "0", &hints);
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&server,
+		use_server,
+		NULL
+	))
+		print_error_and_exit("Server tests failed");
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&server,
+		use_exhausted_server,
+		NULL
+	))
+		print_error_and_exit("Descriptor exhaustion tests failed");
+
+	struct csalt_resource_network_server
+		invalid = csalt_resource_network_server("not an address", "0", &hints);
+
+	if (csalt_static_resource_init((csalt_static_resource *)&invalid))
+		print_error_and_exit("Server with invalid address initialized");
+
+	return EXIT_SUCCESS;
+}
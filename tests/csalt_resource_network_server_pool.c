@@ -0,0 +1,129 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define CLIENTS 16
+
+struct sockaddr_in address = {
+	.sin_family = AF_INET,
+};
+
+struct csalt_store_network_server_pool *pool;
+atomic_int closed = 0;
+
+static void *run_clients(void *param)
+{
+	(void)param;
+	int fds[CLIENTS];
+
+	for (int i = 0; i < CLIENTS; i++) {
+		fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(fds[i], (struct sockaddr *)&address, sizeof(address)))
+			print_error_and_exit("Unable to connect client %d", i);
+		if (write(fds[i], &i, sizeof(i)) != sizeof(i))
+			print_error_and_exit("Unable to send from client %d", i);
+	}
+
+	for (int i = 0; i < CLIENTS; i++) {
+		int reply = -1;
+		if (read(fds[i], &reply, sizeof(reply)) != sizeof(reply))
+			print_error_and_exit("No reply for client %d", i);
+		if (reply != i * 2)
+			print_error_and_exit("Unexpected reply for client %d: %d", i, reply);
+		close(fds[i]);
+	}
+
+	return NULL;
+}
+
+static int double_value(csalt_static_store *store, void *param)
+{
+	(void)param;
+	int value = 0;
+	const ssize_t amount = csalt_store_read(store, &value, sizeof(value));
+	if (amount == 0) {
+		if (atomic_fetch_add(&closed, 1) + 1 == CLIENTS)
+			csalt_store_network_server_pool_stop(pool);
+		return 0;
+	}
+	if (amount != sizeof(value))
+		print_error_and_exit("Short read from client: %ld", amount);
+
+	value *= 2;
+	if (csalt_store_write(store, &value, sizeof(value)) != sizeof(value))
+		print_error_and_exit("Unable to reply to client");
+	return 1;
+}
+
+static int use_pool(csalt_static_store *store, void *param)
+{
+	(void)param;
+	pool = (struct csalt_store_network_server_pool *)store;
+
+	if (pool->worker_count != 2)
+		print_error_and_exit("Unexpected worker count: %ld", pool->worker_count);
+
+	address.sin_port = htons((uint16_t)atoi(pool->service));
+	inet_pton(AF_INET, pool->node, &address.sin_addr);
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, run_clients, NULL);
+
+	if (csalt_store_network_server_pool_run(pool, double_value, NULL))
+		print_error_and_exit("Pool returned an error");
+
+	pthread_join(thread, NULL);
+
+	if (atomic_load(&closed) != CLIENTS)
+		print_error_and_exit("Pool stopped early");
+	return 0;
+}
+
+int main()
+{
+	struct addrinfo hints = {
+		.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV,
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+
+	struct csalt_resource_network_server_pool
+		server = csalt_resource_network_server_pool(
+			"127.0.0.1",
+			"0",
+			&hints,
+			2,
+			true);
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&server,
+		use_pool,
+		NULL
+	))
+		print_error_and_exit("Server pool tests failed");
+
+	return EXIT_SUCCESS;
+}
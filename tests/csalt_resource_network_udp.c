@@ -0,0 +1,232 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DATAGRAMS 16
+#define SEGMENT 100
+#define SEGMENTS 40
+
+struct csalt_store_network_udp *server;
+
+static ssize_t receive_all(
+	struct csalt_network_datagram *datagrams,
+	ssize_t count
+)
+{
+	ssize_t received = 0;
+	while (received < count) {
+		const ssize_t amount = csalt_store_network_udp_receive(
+			server,
+			datagrams + received,
+			count - received,
+			MSG_WAITFORONE);
+		if (amount < 1)
+			print_error_and_exit("Receive failed");
+		received += amount;
+	}
+	return received;
+}
+
+static int use_client(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_network_udp *client = (void *)store;
+
+	{
+		if (csalt_store_write(store, "hello", 5) != 5)
+			print_error_and_exit("Unable to write to connected socket");
+
+		char buffer[16] = { 0 };
+		if (csalt_store_read((csalt_static_store *)server, buffer, sizeof(buffer)) != 5)
+			print_error_and_exit("Unable to read from bound socket");
+		if (strcmp(buffer, "hello"))
+			print_error_and_exit("Unexpected datagram: %s", buffer);
+	}
+
+	char sent[DATAGRAMS][8];
+	char received[DATAGRAMS][8];
+	struct csalt_network_datagram datagrams[DATAGRAMS];
+
+	{
+		for (int i = 0; i < DATAGRAMS; i++) {
+			snprintf(sent[i], sizeof(sent[i]), "dg%d", i);
+			datagrams[i] = (struct csalt_network_datagram) {
+				.buffer = sent[i],
+				.size = (ssize_t)strlen(sent[i]) + 1,
+			};
+		}
+
+		ssize_t count = 0;
+		while (count < DATAGRAMS) {
+			const ssize_t amount = csalt_store_network_udp_send(
+				client,
+				datagrams + count,
+				DATAGRAMS - count,
+				0);
+			if (amount < 1)
+				print_error_and_exit("Batch send failed");
+			count += amount;
+		}
+
+		for (int i = 0; i < DATAGRAMS; i++)
+			datagrams[i] = (struct csalt_network_datagram) {
+				.buffer = received[i],
+				.size = sizeof(received[i]),
+			};
+
+		receive_all(datagrams, DATAGRAMS);
+		for (int i = 0; i < DATAGRAMS; i++) {
+			if (strcmp(received[i], sent[i]))
+				print_error_and_exit("Datagram %d out of order: %s", i, received[i]);
+			if (datagrams[i].length != (ssize_t)strlen(sent[i]) + 1)
+				print_error_and_exit("Datagram %d has length %zd", i, datagrams[i].length);
+			if (!datagrams[i].address_length)
+				print_error_and_exit("Datagram %d has no sender", i);
+		}
+	}
+
+	{
+		// Reply to each sender, using the address it was received from
+		for (int i = 0; i < DATAGRAMS; i++)
+			datagrams[i].size = datagrams[i].length;
+		if (csalt_store_network_udp_send(server, datagrams, DATAGRAMS, 0) != DATAGRAMS)
+			print_error_and_exit("Batch reply failed");
+
+		for (int i = 0; i < DATAGRAMS; i++) {
+			char buffer[8] = { 0 };
+			csalt_store_read(store, buffer, sizeof(buffer));
+			if (strcmp(buffer, sent[i]))
+				print_error_and_exit("Unexpected reply %d: %s", i, buffer);
+		}
+	}
+
+	{
+		char payload[SEGMENT * SEGMENTS - SEGMENT / 2];
+		for (size_t i = 0; i < sizeof(payload); i++)
+			payload[i] = (char)(i / SEGMENT);
+
+		if (csalt_store_network_udp_send_segments(
+			client,
+			payload,
+			sizeof(payload),
+			SEGMENT,
+			NULL,
+			0
+		) != sizeof(payload))
+			print_error_and_exit("Segmented send failed");
+
+		// With UDP_GRO, the kernel may combine segments back
+		// together, so count what arrives by segment size
+		char buffers[DATAGRAMS][SEGMENT * SEGMENTS];
+		ssize_t segments = 0, bytes = 0;
+		while (bytes < (ssize_t)sizeof(payload)) {
+			for (int i = 0; i < DATAGRAMS; i++)
+				datagrams[i] = (struct csalt_network_datagram) {
+					.buffer = buffers[i],
+					.size = sizeof(buffers[i]),
+				};
+
+			const ssize_t count = csalt_store_network_udp_receive(
+				server,
+				datagrams,
+				DATAGRAMS,
+				MSG_WAITFORONE);
+			if (count < 1)
+				print_error_and_exit("Segmented receive failed");
+
+			for (ssize_t i = 0; i < count; i++) {
+				const struct csalt_network_datagram *datagram = &datagrams[i];
+				if (datagram->segment_size != SEGMENT && datagram->length > SEGMENT)
+					print_error_and_exit("Unexpected segment size %d", datagram->segment_size);
+				const char *contents = datagram->buffer;
+				for (ssize_t j = 0; j < datagram->length; j++)
+					if (contents[j] != (char)(segments + j / SEGMENT))
+						print_error_and_exit("Segment %zd corrupted", segments + j / SEGMENT);
+				segments += (datagram->length + SEGMENT - 1) / SEGMENT;
+				bytes += datagram->length;
+			}
+		}
+
+		if (segments != SEGMENTS || bytes != sizeof(payload))
+			print_error_and_exit("Received %zd segments, %zd bytes", segments, bytes);
+	}
+
+	return 0;
+}
+
+int main()
+{
+	struct addrinfo hints = {
+		.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV,
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_DGRAM,
+	};
+
+	struct csalt_resource_network_udp bound = csalt_resource_network_udp_bound(
+		"127.0.0.1",
+		"0",
+		&hints,
+		(struct csalt_network_udp_options) {
+			.gro = true,
+			.receive_buffer_size = 1 << 20,
+		});
+
+	server = (struct csalt_store_network_udp *)csalt_static_resource_init(
+		(csalt_static_resource *)&bound);
+	if (!server)
+		print_error_and_exit("Unable to bind UDP socket");
+
+	struct sockaddr_in address;
+	socklen_t length = sizeof(address);
+	getsockname(server->parent.fd, (struct sockaddr *)&address, &length);
+	char port[sizeof("65535")];
+	snprintf(port, sizeof(port), "%d", ntohs(address.sin_port));
+
+	struct csalt_resource_network_udp connected = csalt_resource_network_udp_connected(
+		"127.0.0.1",
+		port,
+		&hints,
+		(struct csalt_network_udp_options) { 0 });
+
+	if (csalt_static_resource_use(
+		(csalt_static_resource *)&connected,
+		use_client,
+		NULL
+	))
+		print_error_and_exit("Connected socket tests failed");
+
+	csalt_resource_deinit((csalt_resource *)&bound);
+
+	struct csalt_resource_network_udp
+		unresolvable = csalt_resource_network_udp_connected(
+			"not an address",
+			"0",
+			&hints,
+			(struct csalt_network_udp_options) { 0 });
+	if (csalt_static_resource_init((csalt_static_resource *)&unresolvable))
+		print_error_and_exit("Unresolvable address initialized");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CONTENTS "file contents"
+
+struct csalt_store_network_server *server;
+int handled = 0;
+
+static void poll_until_handled(csalt_static_store_block_fn *block)
+{
+	const int expected = handled + 1;
+	while (handled < expected)
+		if (csalt_store_network_server_poll(server, 1000, block, NULL) <= 0)
+			print_error_and_exit("Server stopped receiving events");
+}
+
+static int reply(csalt_static_store *store, void *param)
+{
+	(void)param;
+	char buffer[4];
+	if (csalt_store_read(store, buffer, sizeof(buffer)) != 4 || memcmp(buffer, "ping", 4))
+		print_error_and_exit("Unexpected message from client");
+	if (csalt_store_write(store, "pong", 4) != 4)
+		print_error_and_exit("Unable to reply");
+	handled++;
+	return 1;
+}
+
+static int receive_file(csalt_static_store *store, void *param)
+{
+	(void)param;
+	char byte = 0;
+	int fd = -1;
+	if (csalt_store_network_unix_receive_fd((void *)store, &byte, 1, &fd) != 1)
+		print_error_and_exit("Unable to receive file descriptor");
+	if (byte != 'f' || fd == -1)
+		print_error_and_exit("File descriptor not received");
+
+	struct csalt_resource_file file = csalt_resource_file_descriptor(fd);
+	csalt_store *file_store = csalt_resource_init(csalt_resource(&file));
+	if (!file_store)
+		print_error_and_exit("Unable to use received file descriptor");
+
+	char contents[sizeof(CONTENTS)] = { 0 };
+	if (csalt_store_size(file_store) != sizeof(CONTENTS) - 1)
+		print_error_and_exit("Received file has the wrong size");
+	csalt_store_read((csalt_static_store *)file_store, contents, sizeof(CONTENTS) - 1);
+	if (strcmp(contents, CONTENTS))
+		print_error_and_exit("Unexpected file contents: %s", contents);
+
+	csalt_resource_deinit(csalt_resource(&file));
+	if (csalt_resource_init(csalt_resource(&file)))
+		print_error_and_exit("Closed file descriptor initialized again");
+
+	handled++;
+	return 1;
+}
+
+static int refuse_files(csalt_static_store *store, void *param)
+{
+	(void)param;
+	char byte = 0;
+	int fd = 0;
+	if (csalt_store_network_unix_receive_fd((void *)store, &byte, 1, &fd) != -1)
+		print_error_and_exit("Extra file descriptors were dropped silently");
+	if (errno != EMSGSIZE || fd != -1)
+		print_error_and_exit("Unexpected result for extra file descriptors");
+	handled++;
+	return 1;
+}
+
+static int receive_packets(csalt_static_store *store, void *param)
+{
+	(void)param;
+	char buffer[16] = { 0 };
+	if (csalt_store_read(store, buffer, sizeof(buffer)) != 3 || strcmp(buffer, "one"))
+		print_error_and_exit("Packet boundary not kept: %s", buffer);
+	if (csalt_store_read(store, buffer, sizeof(buffer)) != 5 || memcmp(buffer, "three", 5))
+		print_error_and_exit("Second packet not received: %s", buffer);
+	handled++;
+	return 1;
+}
+
+static int use_client(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_network_client *client = (void *)store;
+
+	{
+		if (csalt_store_write(store, "ping", 4) != 4)
+			print_error_and_exit("Unable to send from client");
+		poll_until_handled(reply);
+
+		char buffer[4];
+		if (csalt_store_read(store, buffer, 4) != 4 || memcmp(buffer, "pong", 4))
+			print_error_and_exit("Unexpected reply");
+	}
+
+	{
+		char path[] = "/tmp/csalt_unix_file_XXXXXX";
+		const int fd = mkstemp(path);
+		if (fd == -1 || write(fd, CONTENTS, sizeof(CONTENTS) - 1) != sizeof(CONTENTS) - 1)
+			print_error_and_exit("Unable to create file to send");
+		close(fd);
+
+		struct csalt_resource_file file = csalt_resource_file_open(path, O_RDONLY);
+		csalt_store *file_store = csalt_resource_init(csalt_resource(&file));
+		unlink(path);
+		if (!file_store)
+			print_error_and_exit("Unable to open file to send");
+
+		if (csalt_store_network_unix_send_fd(
+			client,
+			"f",
+			1,
+			csalt_store_fd((csalt_static_store *)file_store)
+		) != 1)
+			print_error_and_exit("Unable to send file descriptor");
+		csalt_resource_deinit(csalt_resource(&file));
+
+		poll_until_handled(receive_file);
+	}
+
+	{
+		int fds[2];
+		if (pipe(fds))
+			print_error_and_exit("Unable to create descriptors to send");
+
+		union {
+			char buffer[CMSG_SPACE(sizeof(fds))];
+			struct cmsghdr align;
+		} control;
+		struct iovec vector = { "f", 1 };
+		struct msghdr message = {
+			.msg_iov = &vector,
+			.msg_iovlen = 1,
+			.msg_control = control.buffer,
+			.msg_controllen = sizeof(control.buffer),
+		};
+		struct cmsghdr *const header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(fds));
+		memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+		if (sendmsg(client->fd, &message, 0) != 1)
+			print_error_and_exit("Unable to send two file descriptors");
+		close(fds[0]);
+		close(fds[1]);
+
+		poll_until_handled(refuse_files);
+	}
+
+	return 0;
+}
+
+static int use_packet_client(csalt_static_store *store, void *param)
+{
+	(void)param;
+	if (csalt_store_write(store, "one", 3) != 3 || csalt_store_write(store, "three", 5) != 5)
+		print_error_and_exit("Unable to send packets");
+	poll_until_handled(receive_packets);
+	return 0;
+}
+
+int main()
+{
+	char name[64];
+
+	{
+		snprintf(name, sizeof(name), "@csalt_unix_test_%d", (int)getpid());
+		struct csalt_resource_network_unix_server
+			listener = csalt_resource_network_unix_server(name, SOCK_STREAM);
+		server = (void *)csalt_static_resource_init((csalt_static_resource *)&listener);
+		if (!server)
+			print_error_and_exit("Unable to listen on abstract name");
+
+		struct csalt_resource_network_unix_client
+			client = csalt_resource_network_unix_client(name, SOCK_STREAM);
+		if (csalt_static_resource_use((csalt_static_resource *)&client, use_client, NULL))
+			print_error_and_exit("Stream client tests failed");
+
+		csalt_resource_deinit((csalt_resource *)&listener);
+	}
+
+	{
+		snprintf(name, sizeof(name), "/tmp/csalt_unix_test_%d.sock", (int)getpid());
+		struct csalt_resource_network_unix_server
+			listener = csalt_resource_network_unix_server(name, SOCK_SEQPACKET);
+		server = (void *)csalt_static_resource_init((csalt_static_resource *)&listener);
+		if (!server)
+			print_error_and_exit("Unable to listen on path");
+
+		struct csalt_resource_network_unix_server
+			duplicate = csalt_resource_network_unix_server(name, SOCK_SEQPACKET);
+		if (csalt_static_resource_init((csalt_static_resource *)&duplicate))
+			print_error_and_exit("Second server took over the same path");
+
+		struct csalt_resource_network_unix_client
+			client = csalt_resource_network_unix_client(name, SOCK_SEQPACKET);
+		if (csalt_static_resource_use((csalt_static_resource *)&client, use_packet_client, NULL))
+			print_error_and_exit("Packet client tests failed");
+
+		csalt_resource_deinit((csalt_resource *)&listener);
+		if (access(name, F_OK) == 0)
+			print_error_and_exit("Socket file left behind");
+	}
+
+	{
+		char long_name[256];
+		memset(long_name, 'a', sizeof(long_name) - 1);
+		long_name[sizeof(long_name) - 1] = '\0';
+
+		struct csalt_resource_network_unix_client
+			client = csalt_resource_network_unix_client(long_name, SOCK_STREAM);
+		if (csalt_static_resource_init((csalt_static_resource *)&client))
+			print_error_and_exit("Client with overlong name initialized");
+	}
+
+	return EXIT_SUCCESS;
+}
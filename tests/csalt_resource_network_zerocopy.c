@@ -0,0 +1,160 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LARGE (256 * 1024)
+#define SENDS 8
+
+int peer = -1;
+char large[LARGE];
+
+static void receive(ssize_t size)
+{
+	char buffer[LARGE];
+	for (ssize_t total = 0; total < size;) {
+		const ssize_t amount = read(peer, buffer, sizeof(buffer));
+		if (amount <= 0)
+			print_error_and_exit("Peer didn't receive data");
+		for (ssize_t i = 0; i < amount; i++)
+			if (buffer[i] != large[(total + i) % LARGE])
+				print_error_and_exit("Corrupted data at %zd", total + i);
+		total += amount;
+	}
+}
+
+static int use_zerocopy(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_network_zerocopy *zerocopy = (void *)store;
+
+	{
+		uint64_t id = 1;
+		if (csalt_store_network_zerocopy_send(zerocopy, "small", 5, &id) != 5)
+			print_error_and_exit("Small send failed");
+		if (id != 0 || !csalt_store_network_zerocopy_done(zerocopy, id))
+			print_error_and_exit("Copied send wasn't done straight away");
+
+		char buffer[5];
+		if (read(peer, buffer, sizeof(buffer)) != 5 || memcmp(buffer, "small", 5))
+			print_error_and_exit("Peer didn't receive small send");
+	}
+
+	{
+		uint64_t id = 0;
+		ssize_t sent = csalt_store_network_zerocopy_send(zerocopy, large, LARGE, &id);
+		if (sent < 1)
+			print_error_and_exit("Large send failed");
+		if (zerocopy->enabled && id != 1)
+			print_error_and_exit("Zero-copy send given ID %llu", (unsigned long long)id);
+
+		receive(sent);
+
+		if (csalt_store_network_zerocopy_wait(zerocopy, id, 5000))
+			print_error_and_exit("Zero-copy send didn't complete");
+		if (csalt_store_network_zerocopy_pending(zerocopy))
+			print_error_and_exit("Sends still pending");
+	}
+
+	{
+		ssize_t total = 0;
+		for (int i = 0; i < SENDS; i++) {
+			const ssize_t sent = csalt_store_write(store, large, LARGE);
+			if (sent < 1)
+				print_error_and_exit("Write %d failed", i);
+			receive(sent);
+			total += sent;
+
+			if (csalt_store_network_zerocopy_pending(zerocopy))
+				print_error_and_exit("Write %d returned before its buffer was free", i);
+		}
+
+		if (zerocopy->enabled && csalt_store_network_zerocopy_last(zerocopy) != SENDS + 1)
+			print_error_and_exit("Writes weren't sent with MSG_ZEROCOPY");
+
+		const uint64_t last = csalt_store_network_zerocopy_last(zerocopy);
+		if (csalt_store_network_zerocopy_wait(zerocopy, last, 5000))
+			print_error_and_exit("Writes didn't complete");
+		if (last && !csalt_store_network_zerocopy_done(zerocopy, last - 1))
+			print_error_and_exit("Earlier send not done after later one");
+	}
+
+	// Left pending for deinit to wait for
+	const ssize_t sent = csalt_store_network_zerocopy_send(zerocopy, large, LARGE, NULL);
+	receive(sent);
+	return 0;
+}
+
+int main()
+{
+	for (int i = 0; i < LARGE; i++)
+		large[i] = (char)(i * 31);
+
+	struct sockaddr_in address = {
+		.sin_family = AF_INET,
+	};
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+	socklen_t length = sizeof(address);
+
+	const int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (
+		bind(listener, (struct sockaddr *)&address, length) ||
+		getsockname(listener, (struct sockaddr *)&address, &length) ||
+		listen(listener, 1)
+	)
+		print_error_and_exit("Unable to listen");
+
+	char port[sizeof("65535")];
+	snprintf(port, sizeof(port), "%d", ntohs(address.sin_port));
+
+	struct addrinfo hints = {
+		.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV,
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+
+	struct csalt_resource_network_client
+		client = csalt_resource_network_client("127.0.0.1", port, &hints);
+
+	struct csalt_resource_network_zerocopy zerocopy
+		= csalt_resource_network_zerocopy((csalt_static_resource *)&client, 4096);
+
+	csalt_static_store *store = csalt_static_resource_init(
+		(csalt_static_resource *)&zerocopy);
+	if (!store)
+		print_error_and_exit("Unable to initialize zero-copy client");
+
+	peer = accept(listener, NULL, NULL);
+
+	use_zerocopy(store, NULL);
+
+	csalt_resource_deinit((csalt_resource *)&zerocopy);
+	if (csalt_store_network_zerocopy_pending(&zerocopy.result))
+		print_error_and_exit("Deinit didn't wait for pending sends");
+
+	close(peer);
+	close(listener);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <pthread.h>
+#include <string.h>
+
+#define TABLE_SIZE 64
+#define READERS 4
+#define VERSIONS 200
+
+struct csalt_store_rcu *rcu;
+atomic_int finished = 0;
+
+static int fill(csalt_store *store, void *param)
+{
+	char buffer[TABLE_SIZE];
+	memset(buffer, *(char *)param, sizeof(buffer));
+	if (csalt_store_write((csalt_static_store *)store, buffer, sizeof(buffer)) != TABLE_SIZE)
+		return -1;
+	return 0;
+}
+
+static int expect_consistent(csalt_static_store *store, void *param)
+{
+	(void)param;
+	char buffer[TABLE_SIZE] = { 0 };
+	if (csalt_store_read(store, buffer, TABLE_SIZE) != TABLE_SIZE)
+		print_error_and_exit("Short read from snapshot");
+	for (int i = 1; i < TABLE_SIZE; i++)
+		if (buffer[i] != buffer[0])
+			print_error_and_exit("Snapshot torn at %d: %d != %d", i, buffer[i], buffer[0]);
+	return 0;
+}
+
+static void *reader(void *param)
+{
+	(void)param;
+	while (!atomic_load(&finished))
+		csalt_store_split(
+			(csalt_static_store *)rcu,
+			0,
+			TABLE_SIZE,
+			expect_consistent,
+			NULL);
+	return NULL;
+}
+
+static int publish_during_split(csalt_static_store *store, void *param)
+{
+	char value = 7;
+	if (csalt_store_rcu_publish(rcu, TABLE_SIZE, fill, &value) != 0)
+		print_error_and_exit("Publish failed");
+
+	if (csalt_store_rcu_reclaim(rcu) != 1)
+		print_error_and_exit("Version reclaimed while still being read");
+
+	char c = 0;
+	csalt_store_read(store, &c, 1);
+	if (c != *(char *)param)
+		print_error_and_exit("Pinned version changed: %d", c);
+	return 0;
+}
+
+static int add_one(csalt_store *store, void *param)
+{
+	(void)param;
+	char c = 0;
+	csalt_store_read((csalt_static_store *)store, &c, 1);
+	c++;
+	csalt_store_write((csalt_static_store *)store, &c, 1);
+	return c;
+}
+
+int main()
+{
+	struct csalt_resource_rcu resource = csalt_resource_rcu(TABLE_SIZE);
+	rcu = (struct csalt_store_rcu *)csalt_resource_init(csalt_resource(&resource));
+	if (!rcu)
+		print_error_and_exit("Failed to initialize rcu resource");
+
+	csalt_static_store *store = (csalt_static_store *)rcu;
+
+	{
+		char value = 3;
+		if (csalt_store_write(store, &value, 1) != 1)
+			print_error_and_exit("Copy-on-write failed");
+
+		value = 0;
+		if (csalt_store_read(store, &value, 1) != 1 || value != 3)
+			print_error_and_exit("Unexpected value after write: %d", value);
+	}
+
+	{
+		if (csalt_store_rcu_update(rcu, add_one, NULL) != 4)
+			print_error_and_exit("Update did not see the previous version");
+	}
+
+	{
+		if (csalt_store_resize((csalt_store *)rcu, TABLE_SIZE * 2) != TABLE_SIZE * 2)
+			print_error_and_exit("Resize failed");
+		if (csalt_store_size((csalt_store *)rcu) != TABLE_SIZE * 2)
+			print_error_and_exit("Resized version not published");
+		csalt_store_resize((csalt_store *)rcu, TABLE_SIZE);
+	}
+
+	{
+		char value = 5;
+		csalt_store_rcu_publish(rcu, TABLE_SIZE, fill, &value);
+		csalt_store_split(store, 0, TABLE_SIZE, publish_during_split, &value);
+
+		if (csalt_store_rcu_reclaim(rcu) != 0)
+			print_error_and_exit("Version not reclaimed after reader finished");
+	}
+
+	{
+		pthread_t threads[READERS];
+		for (int i = 0; i < READERS; i++)
+			pthread_create(&threads[i], NULL, reader, NULL);
+
+		for (int i = 0; i < VERSIONS; i++) {
+			char value = (char)i;
+			csalt_store_rcu_publish(rcu, TABLE_SIZE, fill, &value);
+		}
+
+		atomic_store(&finished, 1);
+		for (int i = 0; i < READERS; i++)
+			pthread_join(threads[i], NULL);
+
+		if (csalt_store_rcu_reclaim(rcu) != 0)
+			print_error_and_exit("Versions left unreclaimed");
+	}
+
+	csalt_resource_deinit(csalt_resource(&resource));
+	return EXIT_SUCCESS;
+}
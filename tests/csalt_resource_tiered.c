@@ -0,0 +1,253 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <string.h>
+
+#define BLOCK_SIZE 16
+#define STORE_SIZE 1000
+#define PROMOTE_AFTER 2
+
+char contents[STORE_SIZE];
+
+struct csalt_store_tiered *tiered;
+
+struct range {
+	ssize_t offset;
+	ssize_t amount;
+};
+
+static int receive_read(csalt_static_store *store, void *param)
+{
+	struct range *const range = param;
+	char buffer[STORE_SIZE];
+	const ssize_t expected = csalt_min(range->amount, STORE_SIZE - range->offset);
+	const ssize_t result = csalt_store_read(store, buffer, range->amount);
+	if (result != expected)
+		print_error_and_exit("Read %zd bytes at %zd, expected %zd", result, range->offset, expected);
+	if (memcmp(buffer, contents + range->offset, (size_t)expected))
+		print_error_and_exit("Unexpected contents at %zd", range->offset);
+	return 0;
+}
+
+static void read_at(ssize_t offset, ssize_t amount)
+{
+	struct range range = { offset, amount };
+	csalt_store_split((csalt_static_store *)tiered, offset, offset + amount, receive_read, &range);
+}
+
+static int receive_write(csalt_static_store *store, void *param)
+{
+	const char *const data = param;
+	return csalt_store_write(store, data, (ssize_t)strlen(data)) == (ssize_t)strlen(data)? 0: -1;
+}
+
+static void write_at(ssize_t offset, const char *data)
+{
+	memcpy(contents + offset, data, strlen(data));
+	if (csalt_store_split(
+		(csalt_static_store *)tiered,
+		offset,
+		offset + (ssize_t)strlen(data),
+		receive_write,
+		(void *)data
+	))
+		print_error_and_exit("Write at %zd failed", offset);
+}
+
+// The tier holding block, or the last tier
+static ssize_t tier_of(ssize_t block)
+{
+	for (ssize_t t = 0; t < tiered->tier_count - 1; t++) {
+		const struct csalt_tier *const tier = &tiered->tiers[t];
+		for (ssize_t slot = 0; slot < tier->capacity; slot++)
+			if (tier->blocks[slot] == block)
+				return t;
+	}
+	return tiered->tier_count - 1;
+}
+
+static void expect_tier(ssize_t block, ssize_t expected)
+{
+	const ssize_t actual = tier_of(block);
+	if (actual != expected)
+		print_error_and_exit("Block %zd in tier %zd, expected %zd", block, actual, expected);
+}
+
+int main()
+{
+	for (int i = 0; i < STORE_SIZE; i++)
+		contents[i] = (char)(i * 7 + 3);
+
+	struct csalt_resource_heap
+		fast = csalt_resource_heap(2 * BLOCK_SIZE),
+		medium = csalt_resource_heap(4 * BLOCK_SIZE),
+		slow = csalt_resource_heap(STORE_SIZE);
+
+	struct csalt_tier tiers[] = {
+		csalt_tier(csalt_resource(&fast), 2),
+		csalt_tier(csalt_resource(&medium), 100),
+		csalt_tier(csalt_resource(&slow), 0),
+	};
+
+	struct csalt_resource_tiered resource = csalt_resource_tiered(
+		tiers,
+		BLOCK_SIZE,
+		PROMOTE_AFTER);
+
+	tiered = (struct csalt_store_tiered *)csalt_resource_init(csalt_resource(&resource));
+	if (!tiered)
+		print_error_and_exit("Unable to initialize tiered store");
+	csalt_store_write((csalt_static_store *)&slow.store, contents, STORE_SIZE);
+
+	if (tiers[1].capacity != 4)
+		print_error_and_exit("Capacity not limited to the tier's size: %zd", tiers[1].capacity);
+
+	// Blocks are promoted one tier for every few reads
+	{
+		read_at(0, 4);
+		expect_tier(0, 2);
+		read_at(4, 4);
+		expect_tier(0, 1);
+		if (tiers[2].hits != 2 || tiers[1].promotions != 1)
+			print_error_and_exit("Unexpected statistics after promotion");
+
+		read_at(8, 4);
+		read_at(12, 4);
+		expect_tier(0, 0);
+		if (tiers[1].hits != 2 || tiers[0].promotions != 1)
+			print_error_and_exit("Unexpected statistics after second promotion");
+
+		read_at(0, 16);
+		if (tiers[0].hits != 1)
+			print_error_and_exit("Fastest tier didn't serve its block");
+	}
+
+	// Reads spanning blocks are served from each block's own tier
+	{
+		read_at(10, 40);
+		read_at(10, 40);
+		expect_tier(0, 0);
+		expect_tier(1, 1);
+		expect_tier(2, 1);
+		read_at(48, 2);
+		expect_tier(3, 1);
+	}
+
+	// A full tier demotes a block to make room, swapping it with
+	// the block being promoted
+	{
+		read_at(16, 1);
+		read_at(16, 1);
+		expect_tier(1, 0);
+		read_at(32, 1);
+		read_at(32, 1);
+		expect_tier(2, 0);
+
+		ssize_t in_fast = 0;
+		for (ssize_t block = 0; block < 3; block++)
+			in_fast += tier_of(block) == 0;
+		if (in_fast != 2 || tiers[0].demotions != 1)
+			print_error_and_exit("Full tier didn't demote a block");
+		for (ssize_t block = 0; block < 3; block++)
+			if (tier_of(block) == 2)
+				print_error_and_exit("Demoted block %zd dropped out of the cache", block);
+	}
+
+	// Writes reach the last tier and every cached copy
+	{
+		write_at(20, "written through the tiers");
+		read_at(0, STORE_SIZE);
+		char buffer[STORE_SIZE];
+		csalt_store_read((csalt_static_store *)&slow.store, buffer, STORE_SIZE);
+		if (memcmp(buffer, contents, STORE_SIZE))
+			print_error_and_exit("Write didn't reach the last tier");
+	}
+
+	// Reading past the end is short, and never caches a short block
+	{
+		const ssize_t last = STORE_SIZE / BLOCK_SIZE;
+		for (int i = 0; i < PROMOTE_AFTER * 2; i++)
+			read_at(last * BLOCK_SIZE, 100);
+		expect_tier(last, 2);
+	}
+
+	// Sweeps demote blocks which haven't been read since the last
+	{
+		if (csalt_store_tiered_demote(tiered) < 0)
+			print_error_and_exit("First sweep failed");
+		const ssize_t hot = 5;
+		for (int i = 0; i < PROMOTE_AFTER * 2; i++)
+			read_at(hot * BLOCK_SIZE, 1);
+		expect_tier(hot, 0);
+		const ssize_t demoted = csalt_store_tiered_demote(tiered);
+		if (demoted < 1)
+			print_error_and_exit("Sweep demoted %zd blocks", demoted);
+		expect_tier(hot, 0);
+
+		struct csalt_resource_executor executor = csalt_resource_executor(1, 4);
+		struct csalt_store_executor *const store
+			= (struct csalt_store_executor *)csalt_resource_init(csalt_resource(&executor));
+		if (!store)
+			print_error_and_exit("Unable to start executor");
+
+		for (int i = 0; i < 3; i++) {
+			struct csalt_executor_job job = csalt_executor_job_fn(
+				csalt_store_tiered_demote_job,
+				tiered);
+			csalt_store_executor_submit(store, &job);
+			read_at(0, STORE_SIZE);
+			if (csalt_executor_job_wait(&job))
+				print_error_and_exit("Background sweep failed");
+		}
+		csalt_resource_deinit(csalt_resource(&executor));
+		read_at(0, STORE_SIZE);
+	}
+
+	// Resizing drops every cached block
+	{
+		if (csalt_store_resize((csalt_store *)tiered, STORE_SIZE) != STORE_SIZE)
+			print_error_and_exit("Resize failed");
+		for (ssize_t block = 0; block < STORE_SIZE / BLOCK_SIZE; block++)
+			expect_tier(block, 2);
+		if (csalt_store_size((csalt_store *)tiered) != STORE_SIZE)
+			print_error_and_exit("Size not passed to the last tier");
+		read_at(0, STORE_SIZE);
+	}
+
+	csalt_resource_deinit(csalt_resource(&resource));
+
+	{
+		struct csalt_resource_stub stub = csalt_resource_stub(0);
+		struct csalt_resource_stub failing = csalt_resource_stub(1);
+		struct csalt_tier failing_tiers[] = {
+			csalt_tier(csalt_resource(&stub), 0),
+			csalt_tier(csalt_resource(&failing), 0),
+		};
+		struct csalt_resource_tiered invalid = csalt_resource_tiered(failing_tiers, BLOCK_SIZE, 1);
+		if (csalt_resource_init(csalt_resource(&invalid)))
+			print_error_and_exit("Tiered store initialized over a failed resource");
+		if (!stub.deinit_called)
+			print_error_and_exit("Initialized tier not cleaned up");
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -73,6 +73,7 @@ const struct csalt_dynamic_store_interface parent = {
 		test_read,
 		test_write,
 		NULL,
+		NULL,
 	},
 	NULL,
 	NULL
@@ -0,0 +1,133 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <csalt/stores.h>
+#include <csalt/platform/threads.h>
+
+#include "test_macros.h"
+
+#include <stdint.h>
+
+#define THREADS 4
+#define ITERATIONS 10000
+
+uint64_t counter = 0;
+_Alignas(16) uint64_t pair[2] = { 0 };
+
+static void *increment(void *param)
+{
+	(void)param;
+	struct csalt_store_atomic store = csalt_store_atomic(counter);
+	const uint64_t one = 1;
+	for (int i = 0; i < ITERATIONS; i++)
+		if (csalt_store_atomic_fetch_add(&store, &one, NULL))
+			print_error_and_exit("fetch_add failed");
+	return NULL;
+}
+
+static void *increment_pair(void *param)
+{
+	(void)param;
+	struct csalt_store_atomic store = csalt_store_atomic(pair);
+	for (int i = 0; i < ITERATIONS; i++) {
+		uint64_t expected[2], desired[2];
+		csalt_store_read((csalt_static_store *)&store, expected, sizeof(expected));
+		do {
+			desired[0] = expected[0] + 1;
+			desired[1] = expected[1] + 2;
+		} while (csalt_store_atomic_compare_exchange(&store, expected, desired) == 0);
+	}
+	return NULL;
+}
+
+static int receive_split(csalt_static_store *store, void *param)
+{
+	uint32_t value = 0;
+	if (csalt_store_read(store, &value, sizeof(value)) != sizeof(value))
+		return -1;
+	*(uint32_t *)param = value;
+	return 0;
+}
+
+int main()
+{
+	{
+		uint32_t value = 5;
+		struct csalt_store_atomic store = csalt_store_atomic(value);
+		csalt_static_store *static_store = (csalt_static_store *)&store;
+
+		const uint32_t written = 7;
+		if (csalt_store_write(static_store, &written, sizeof(written)) != sizeof(written))
+			print_error_and_exit("Write failed");
+		if (value != 7)
+			print_error_and_exit("Write not stored: %u", value);
+
+		uint32_t read = 0;
+		if (csalt_store_read(static_store, &read, 2) != -1)
+			print_error_and_exit("Partial read succeeded");
+
+		const uint32_t replacement = 9;
+		uint32_t previous = 0;
+		csalt_store_atomic_exchange(&store, &replacement, &previous);
+		if (previous != 7 || value != 9)
+			print_error_and_exit("Unexpected exchange: %u, %u", previous, value);
+
+		uint32_t expected = 1;
+		if (csalt_store_atomic_compare_exchange(&store, &expected, &replacement) != 0)
+			print_error_and_exit("Compare-exchange with wrong value succeeded");
+		if (expected != 9)
+			print_error_and_exit("Failed compare-exchange didn't return current value");
+
+		if (csalt_store_split(static_store, 0, sizeof(value), receive_split, &read) || read != 9)
+			print_error_and_exit("Split of whole value failed");
+		if (csalt_store_split(static_store, 1, sizeof(value), receive_split, &read) != -1)
+			print_error_and_exit("Split of partial value succeeded");
+	}
+
+	{
+		char buffer[8] = { 0 };
+		struct csalt_store_atomic
+			misaligned = csalt_store_atomic_bounds(buffer + 1, 4),
+			odd = csalt_store_atomic_bounds(buffer, 3);
+		const uint32_t value = 0;
+		if (csalt_store_atomic_exchange(&misaligned, &value, NULL) != -1)
+			print_error_and_exit("Misaligned store accepted");
+		if (csalt_store_write((csalt_static_store *)&odd, &value, 3) != -1)
+			print_error_and_exit("Unsupported size accepted");
+	}
+
+	{
+		csalt_thread threads[THREADS];
+		for (int i = 0; i < THREADS; i++)
+			csalt_thread_create(
+				&threads[i],
+				i % 2 ? increment : increment_pair,
+				NULL);
+		for (int i = 0; i < THREADS; i++)
+			csalt_thread_join(threads[i]);
+
+		if (counter != THREADS / 2 * ITERATIONS)
+			print_error_and_exit("Lost counter updates: %lu", (unsigned long)counter);
+		if (pair[0] != THREADS / 2 * ITERATIONS || pair[1] != pair[0] * 2)
+			print_error_and_exit("Lost pair updates: %lu, %lu",
+				(unsigned long)pair[0],
+				(unsigned long)pair[1]);
+	}
+
+	return EXIT_SUCCESS;
+}
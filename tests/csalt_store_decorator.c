@@ -25,6 +25,7 @@ const struct csalt_dynamic_store_interface impl = {
 		csalt_store_decorator_read,
 		csalt_store_decorator_write,
 		csalt_store_decorator_split,
+		NULL,
 	},
 	csalt_store_decorator_size,
 	csalt_store_decorator_resize,
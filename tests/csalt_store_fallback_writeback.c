@@ -0,0 +1,225 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/resources.h>
+
+#include <string.h>
+
+#define STORE_SIZE 1024
+#define WATERMARK 64
+
+char primary_buffer[STORE_SIZE];
+char secondary_buffer[STORE_SIZE];
+char pattern[STORE_SIZE];
+
+struct write {
+	const char *data;
+	ssize_t size;
+};
+
+static int receive_write(csalt_static_store *store, void *param)
+{
+	struct write *const write = param;
+	if (csalt_store_write(store, write->data, write->size) != write->size)
+		print_error_and_exit("Write through the fallback failed");
+	return 0;
+}
+
+static void write_at(csalt_static_store *store, ssize_t offset, const char *data, ssize_t size)
+{
+	struct write write = { data, size };
+	csalt_store_split(store, offset, offset + size, receive_write, &write);
+}
+
+static void expect_dirty(struct csalt_static_store_fallback *fallback, ssize_t bytes, ssize_t ranges)
+{
+	if (csalt_store_fallback_dirty(fallback) != bytes)
+		print_error_and_exit(
+			"Expected %zd dirty bytes, got %zd",
+			bytes,
+			csalt_store_fallback_dirty(fallback));
+	if (fallback->dirty->count != ranges)
+		print_error_and_exit(
+			"Expected %zd dirty ranges, got %zd",
+			ranges,
+			fallback->dirty->count);
+}
+
+static void expect_written_back(ssize_t begin, ssize_t end)
+{
+	for (ssize_t i = 0; i < STORE_SIZE; i++) {
+		const char expected = i >= begin && i < end? primary_buffer[i]: 0;
+		if (secondary_buffer[i] != expected)
+			print_error_and_exit("Unexpected byte written back at %zd", i);
+	}
+}
+
+static int nested_write(csalt_static_store *store, void *param)
+{
+	(void)param;
+	write_at(store, 10, "nested", 6);
+	return 0;
+}
+
+int main()
+{
+	for (int i = 0; i < STORE_SIZE; i++)
+		pattern[i] = (char)(i % 251 + 1);
+
+	struct csalt_store_memory
+		primary = csalt_store_memory_array(primary_buffer),
+		secondary = csalt_store_memory_array(secondary_buffer);
+	struct csalt_static_store_fallback fallback = csalt_static_store_fallback(
+		(csalt_static_store *)&primary,
+		(csalt_static_store *)&secondary);
+	csalt_static_store *store = (csalt_static_store *)&fallback;
+
+	struct csalt_fallback_dirty dirty;
+	if (csalt_fallback_dirty_init(&dirty, 0))
+		print_error_and_exit("Unable to initialize dirty ranges");
+
+	// Without write-back, nothing is tracked
+	{
+		write_at(store, 0, "untracked", 9);
+		if (csalt_store_fallback_dirty(&fallback) || csalt_store_fallback_flush_dirty(&fallback))
+			print_error_and_exit("Dirty ranges tracked without write-back");
+		memset(primary_buffer, 0, sizeof(primary_buffer));
+	}
+
+	csalt_store_fallback_writeback(&fallback, &dirty);
+
+	// Overlapping and adjacent ranges are coalesced
+	{
+		write_at(store, 10, "0123456789", 10);
+		expect_dirty(&fallback, 10, 1);
+		write_at(store, 15, "abcdefghij", 10);
+		expect_dirty(&fallback, 15, 1);
+		write_at(store, 25, "ABCDE", 5);
+		expect_dirty(&fallback, 20, 1);
+		write_at(store, 100, "far away", 8);
+		expect_dirty(&fallback, 28, 2);
+		write_at(store, 50, "between", 7);
+		expect_dirty(&fallback, 35, 3);
+		write_at(store, 5, "before and into", 15);
+		expect_dirty(&fallback, 40, 3);
+
+		// One write covering every range merges them all
+		write_at(store, 0, pattern, 120);
+		expect_dirty(&fallback, 120, 1);
+		write_at(store, 300, "x", 1);
+		expect_dirty(&fallback, 121, 2);
+	}
+
+	// Only the dirty ranges are written back
+	{
+		memset(secondary_buffer, 0, sizeof(secondary_buffer));
+		if (csalt_store_fallback_flush_dirty(&fallback) != 121)
+			print_error_and_exit("Unexpected amount written back");
+		expect_dirty(&fallback, 0, 0);
+		for (ssize_t i = 0; i < 120; i++)
+			if (secondary_buffer[i] != primary_buffer[i])
+				print_error_and_exit("Dirty range not written back at %zd", i);
+		if (secondary_buffer[300] != 'x' || secondary_buffer[299] || secondary_buffer[301])
+			print_error_and_exit("Single byte range not written back");
+		if (csalt_store_fallback_flush_dirty(&fallback) != 0)
+			print_error_and_exit("Clean fallback wrote something back");
+	}
+
+	// Writes through nested splits are marked at their real offset
+	{
+		memset(secondary_buffer, 0, sizeof(secondary_buffer));
+		csalt_store_split(store, 500, 600, nested_write, NULL);
+		expect_dirty(&fallback, 6, 1);
+		if (dirty.ranges[0].begin != 510)
+			print_error_and_exit("Split write marked at %zd", dirty.ranges[0].begin);
+		csalt_store_fallback_flush_dirty(&fallback);
+		expect_written_back(510, 516);
+	}
+
+	// Writing back on an executor
+	{
+		memset(secondary_buffer, 0, sizeof(secondary_buffer));
+		write_at(store, 700, "in the background", 17);
+
+		struct csalt_resource_executor
+			resource = csalt_resource_executor(1, 4);
+		struct csalt_store_executor *const executor
+			= (struct csalt_store_executor *)csalt_resource_init(csalt_resource(&resource));
+		if (!executor)
+			print_error_and_exit("Unable to start executor");
+
+		struct csalt_executor_job job = csalt_executor_job_fn(
+			csalt_store_fallback_flush_job,
+			&fallback);
+		if (csalt_store_executor_submit(executor, &job) || csalt_executor_job_wait(&job))
+			print_error_and_exit("Background write-back failed");
+		csalt_resource_deinit(csalt_resource(&resource));
+
+		expect_written_back(700, 717);
+		expect_dirty(&fallback, 0, 0);
+	}
+
+	csalt_fallback_dirty_deinit(&dirty);
+
+	// Passing the watermark writes back straight away
+	{
+		memset(secondary_buffer, 0, sizeof(secondary_buffer));
+		if (csalt_fallback_dirty_init(&dirty, WATERMARK))
+			print_error_and_exit("Unable to initialize dirty ranges");
+		csalt_store_fallback_writeback(&fallback, &dirty);
+
+		write_at(store, 0, pattern, WATERMARK);
+		expect_dirty(&fallback, WATERMARK, 1);
+		expect_written_back(0, 0);
+
+		write_at(store, 200, "over", 4);
+		expect_dirty(&fallback, 0, 0);
+		for (ssize_t i = 0; i < WATERMARK; i++)
+			if (secondary_buffer[i] != primary_buffer[i])
+				print_error_and_exit("Watermark didn't write back at %zd", i);
+		if (memcmp(secondary_buffer + 200, "over", 4))
+			print_error_and_exit("Watermark didn't write back the last write");
+
+		csalt_fallback_dirty_deinit(&dirty);
+	}
+
+	// A secondary too short for a range fails the write-back
+	{
+		char short_buffer[16] = { 0 };
+		struct csalt_store_memory short_secondary
+			= csalt_store_memory_array(short_buffer);
+		struct csalt_static_store_fallback short_fallback = csalt_static_store_fallback(
+			(csalt_static_store *)&primary,
+			(csalt_static_store *)&short_secondary);
+
+		if (csalt_fallback_dirty_init(&dirty, 0))
+			print_error_and_exit("Unable to initialize dirty ranges");
+		csalt_store_fallback_writeback(&short_fallback, &dirty);
+
+		write_at((csalt_static_store *)&short_fallback, 8, pattern, 32);
+		if (csalt_store_fallback_flush_dirty(&short_fallback) != -1)
+			print_error_and_exit("Short secondary wrote back successfully");
+		expect_dirty(&short_fallback, 32, 1);
+
+		csalt_fallback_dirty_deinit(&dirty);
+	}
+
+	return EXIT_SUCCESS;
+}
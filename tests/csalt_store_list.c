@@ -0,0 +1,240 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <csalt/stores.h>
+
+#include <csalt/util.h>
+#include "test_macros.h"
+
+#define LONG_LIST 1000
+
+static int receive_split(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_list *list = (struct csalt_store_list *)store;
+
+	if (csalt_store_list_length(list) != 3)
+		print_error_and_exit("Split list has %ld stores", csalt_store_list_length(list));
+
+	if (csalt_store_list_get(list, 1))
+		print_error_and_exit("Empty entry was not kept empty");
+
+	for (ssize_t i = 0; i < 3; i += 2) {
+		struct csalt_dynamic_store_stub *stub
+			= (void *)csalt_store_list_get(list, i);
+		if (stub->parent.split_begin != 5 || stub->parent.split_end != 10)
+			print_error_and_exit(
+				"Store %ld split unexpectedly: %ld -> %ld",
+				i,
+				stub->parent.split_begin,
+				stub->parent.split_end);
+	}
+	return 0;
+}
+
+static int receive_multisplit(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct csalt_store_list *list = (struct csalt_store_list *)store;
+
+	const struct csalt_store_multisplit_split expected[] = {
+		{ 0, 1 },
+		{ 2, 3 },
+		{ 0, 0 },
+		{ 0, 0 },
+	};
+
+	for (ssize_t i = 0; i < csalt_store_list_length(list); i++) {
+		struct csalt_dynamic_store_stub *stub
+			= (void *)csalt_store_list_get(list, i);
+		if (
+			stub->parent.split_begin != expected[i].begin ||
+			stub->parent.split_end != expected[i].end
+		)
+			print_error_and_exit(
+				"Multisplit resulted in unexpected store %ld: %ld -> %ld",
+				i,
+				stub->parent.split_begin,
+				stub->parent.split_end);
+	}
+	return 0;
+}
+
+static int receive_long_split(csalt_static_store *store, void *param)
+{
+	struct csalt_store_list *list = (struct csalt_store_list *)store;
+	struct csalt_dynamic_store_stub *stubs = param;
+
+	if (csalt_store_list_length(list) != LONG_LIST)
+		print_error_and_exit("Long split list has %ld stores", csalt_store_list_length(list));
+
+	for (ssize_t i = 0; i < LONG_LIST; i++) {
+		if (csalt_store_list_get(list, i) != (csalt_store *)&stubs[i])
+			print_error_and_exit("Long split list out of order at %ld", i);
+		if (stubs[i].parent.split_end != 2)
+			print_error_and_exit("Store %ld not split", i);
+	}
+	return 0;
+}
+
+int main()
+{
+	{
+		struct csalt_store_list list = csalt_store_list_bounds(NULL, NULL);
+		char data[8] = { 0 };
+
+		if (csalt_store_write((csalt_static_store *)&list, data, sizeof(data)))
+			print_error_and_exit("Empty list wrote data");
+		if (csalt_store_read((csalt_static_store *)&list, data, sizeof(data)))
+			print_error_and_exit("Empty list read data");
+		if (csalt_store_size((csalt_store *)&list))
+			print_error_and_exit("Empty list has a size");
+		if (csalt_store_resize((csalt_store *)&list, 8) != -1)
+			print_error_and_exit("Empty list resized");
+		if (csalt_store_list_get(&list, 0))
+			print_error_and_exit("Empty list returned a store");
+	}
+
+	{
+		struct csalt_dynamic_store_stub zero = csalt_dynamic_store_stub_zero();
+		struct csalt_dynamic_store_stub first = csalt_dynamic_store_stub(4);
+		struct csalt_dynamic_store_stub second = csalt_dynamic_store_stub(8);
+
+		csalt_store *stores[] = {
+			(csalt_store *)&zero,
+			NULL,
+			(csalt_store *)&first,
+			(csalt_store *)&second,
+		};
+		struct csalt_store_list list = csalt_store_list(stores);
+		char data[8] = { 0 };
+
+		if (csalt_store_read((csalt_static_store *)&list, data, sizeof(data)) != 4)
+			print_error_and_exit("Read did not come from the first non-empty store");
+		if (second.parent.last_read)
+			print_error_and_exit("Read continued past a successful store");
+
+		if (csalt_store_write((csalt_static_store *)&list, data, sizeof(data)) != 0)
+			print_error_and_exit("Write did not return the lowest amount");
+		if (first.parent.last_write != 4 || second.parent.last_write != 8)
+			print_error_and_exit("Write did not reach every store");
+
+		zero.parent.size = 16;
+		if (csalt_store_size((csalt_store *)&list) != 4)
+			print_error_and_exit("Size was not the smallest store's size");
+		if (csalt_store_resize((csalt_store *)&list, 32) != 32 || first.parent.size != 32)
+			print_error_and_exit("Resize did not reach every store");
+
+		if (csalt_store_list_get(&list, 3) != (csalt_store *)&second)
+			print_error_and_exit("Indexed access returned the wrong store");
+		if (csalt_store_list_get(&list, 4) || csalt_store_list_get(&list, -1))
+			print_error_and_exit("Out of range index returned a store");
+	}
+
+	{
+		struct csalt_dynamic_store_stub error = csalt_dynamic_store_stub_error();
+		struct csalt_dynamic_store_stub success = csalt_dynamic_store_stub(512);
+
+		csalt_store *stores[] = {
+			(csalt_store *)&error,
+			(csalt_store *)&success,
+		};
+		struct csalt_store_list list = csalt_store_list(stores);
+
+		if (csalt_store_read((csalt_static_store *)&list, NULL, 10) != -1)
+			print_error_and_exit("Read error was not returned");
+		if (csalt_store_write((csalt_static_store *)&list, NULL, 10) != -1)
+			print_error_and_exit("Write error was not returned");
+		if (success.parent.last_write)
+			print_error_and_exit("Write continued after an error");
+	}
+
+	{
+		struct csalt_dynamic_store_stub first = csalt_dynamic_store_stub(256);
+		struct csalt_dynamic_store_stub second = csalt_dynamic_store_stub(256);
+
+		csalt_store *stores[] = {
+			(csalt_store *)&first,
+			NULL,
+			(csalt_store *)&second,
+		};
+		struct csalt_store_list list = csalt_store_list(stores);
+
+		if (csalt_store_split((csalt_static_store *)&list, 5, 10, receive_split, NULL))
+			print_error_and_exit("Split failed");
+	}
+
+	{
+		struct csalt_dynamic_store_stub stubs[4];
+		csalt_store *stores[csalt_arrlength(stubs)];
+		for (size_t i = 0; i < csalt_arrlength(stubs); i++) {
+			stubs[i] = csalt_dynamic_store_stub(256);
+			stores[i] = (csalt_store *)&stubs[i];
+		}
+
+		struct csalt_store_pair pairs[csalt_arrlength(stores)] = { 0 };
+		csalt_store_pair_list(stores, pairs);
+
+		csalt_store *copy[csalt_arrlength(pairs)];
+		struct csalt_store_list list = csalt_store_list_from_pairs(pairs, copy);
+
+		if (csalt_store_list_length(&list) != csalt_store_pair_list_length(pairs))
+			print_error_and_exit("List from pairs has %ld stores", csalt_store_list_length(&list));
+		for (ssize_t i = 0; i < csalt_store_list_length(&list); i++)
+			if (csalt_store_list_get(&list, i) != csalt_store_pair_list_get(pairs, i))
+				print_error_and_exit("List from pairs differs at %ld", i);
+		if (csalt_store_pair_list_get(pairs, -1))
+			print_error_and_exit("Negative pair list index returned a store");
+
+		csalt_store *small[2];
+		struct csalt_store_list truncated = csalt_store_list_from_pairs(pairs, small);
+		if (csalt_store_list_length(&truncated))
+			print_error_and_exit("List from pairs overflowed its array");
+
+		struct csalt_store_multisplit_split splits[] = {
+			{ 0, 1 },
+			{ 2, 3 },
+		};
+
+		if (csalt_store_list_multisplit(
+			(struct csalt_static_store_list *)&list,
+			splits,
+			receive_multisplit,
+			NULL
+		))
+			print_error_and_exit("Multisplit failed");
+	}
+
+	{
+		static struct csalt_dynamic_store_stub stubs[LONG_LIST];
+		static csalt_store *stores[LONG_LIST];
+		for (ssize_t i = 0; i < LONG_LIST; i++) {
+			stubs[i] = csalt_dynamic_store_stub(8);
+			stores[i] = (csalt_store *)&stubs[i];
+		}
+		struct csalt_store_list list = csalt_store_list(stores);
+
+		if (csalt_store_list_get(&list, LONG_LIST - 1) != stores[LONG_LIST - 1])
+			print_error_and_exit("Last store of a long list was wrong");
+
+		if (csalt_store_split((csalt_static_store *)&list, 1, 2, receive_long_split, stubs))
+			print_error_and_exit("Long split failed");
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -63,6 +63,7 @@ struct csalt_static_store_interface impl = {
 	&stub_read,
 	&stub_write,
 	&stub_split,
+	NULL,
 };
 csalt_static_store stub = &impl;
 
@@ -87,6 +87,7 @@ struct csalt_dynamic_store_interface impl = {
 		stub_read,
 		stub_write,
 		stub_split,
+		NULL,
 	},
 	stub_size,
 	stub_resize,
@@ -80,6 +80,7 @@ struct csalt_static_store_interface test_implementation = {
 	test_read,
 	test_write,
 	test_split,
+	NULL,
 };
 
 int split_block(csalt_static_store *store, void *_)
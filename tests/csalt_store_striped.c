@@ -0,0 +1,210 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/stores.h>
+#include <csalt/resources.h>
+
+#include <string.h>
+
+#define UNIT 4
+#define DEVICES 3
+#define DEVICE_SIZE 8
+#define TOTAL (UNIT * DEVICES * DEVICE_SIZE / UNIT)
+
+#define LARGE_UNIT 64
+#define LARGE_DEVICES 4
+#define LARGE_SIZE 4096
+
+static void expect_range(const char *buffer, ssize_t size, char first)
+{
+	for (ssize_t i = 0; i < size; i++)
+		if (buffer[i] != (char)(first + i))
+			print_error_and_exit(
+				"Unexpected byte at %ld: %d != %d",
+				i,
+				buffer[i],
+				(char)(first + i));
+}
+
+static int receive_inner_split(csalt_static_store *store, void *param)
+{
+	(void)param;
+	char buffer[TOTAL] = { 0 };
+	if (csalt_store_read(store, buffer, sizeof(buffer)) != 6)
+		print_error_and_exit("Nested split read the wrong amount");
+	expect_range(buffer, 6, 8);
+	return 0;
+}
+
+static int receive_split(csalt_static_store *store, void *param)
+{
+	(void)param;
+	char buffer[TOTAL] = { 0 };
+	if (csalt_store_read(store, buffer, sizeof(buffer)) != 14)
+		print_error_and_exit("Split read the wrong amount");
+	expect_range(buffer, 14, 5);
+
+	if (csalt_store_size((csalt_store *)store) != 14)
+		print_error_and_exit("Split has size %ld", csalt_store_size((csalt_store *)store));
+
+	return csalt_store_split(store, 3, 9, receive_inner_split, NULL);
+}
+
+static int write_split(csalt_static_store *store, void *param)
+{
+	const char *const data = param;
+	return csalt_store_write(store, data, 3) == 3 ? 0 : -1;
+}
+
+int main()
+{
+	struct csalt_resource_heap heaps[DEVICES];
+	csalt_store *devices[DEVICES];
+	for (int i = 0; i < DEVICES; i++) {
+		heaps[i] = csalt_resource_heap(DEVICE_SIZE);
+		devices[i] = csalt_resource_init(csalt_resource(&heaps[i]));
+		if (!devices[i])
+			print_error_and_exit("Failed to initialize heap %d", i);
+	}
+
+	struct csalt_store_striped striped = csalt_store_striped(devices, UNIT, NULL);
+	csalt_static_store *const store = (csalt_static_store *)&striped;
+
+	{
+		char data[TOTAL];
+		for (int i = 0; i < TOTAL; i++)
+			data[i] = (char)i;
+
+		if (csalt_store_size((csalt_store *)&striped) != TOTAL)
+			print_error_and_exit("Unexpected size %ld", csalt_store_size((csalt_store *)&striped));
+
+		if (csalt_store_write(store, data, TOTAL) != TOTAL)
+			print_error_and_exit("Write failed");
+
+		const char *second = heaps[1].store.begin;
+		const char expected[] = { 4, 5, 6, 7, 16, 17, 18, 19 };
+		if (memcmp(second, expected, sizeof(expected)))
+			print_error_and_exit("Stripes not placed round-robin");
+
+		char buffer[TOTAL + 6] = { 0 };
+		if (csalt_store_read(store, buffer, sizeof(buffer)) != TOTAL)
+			print_error_and_exit("Read past the end of the devices");
+		expect_range(buffer, TOTAL, 0);
+	}
+
+	{
+		if (csalt_store_split(store, 5, 19, receive_split, NULL))
+			print_error_and_exit("Split failed");
+
+		const char data[] = { 50, 51, 52 };
+		csalt_store_split(store, 6, TOTAL, write_split, (void *)data);
+
+		char buffer[TOTAL] = { 0 };
+		csalt_store_read(store, buffer, TOTAL);
+		if (memcmp(buffer + 6, data, sizeof(data)) || buffer[5] != 5 || buffer[9] != 9)
+			print_error_and_exit("Split write landed in the wrong place");
+	}
+
+	{
+		if (csalt_store_resize((csalt_store *)&striped, 36) != 36)
+			print_error_and_exit("Resize did not grow every device");
+		if (csalt_store_size(devices[0]) != 12)
+			print_error_and_exit("Device resized to %ld", csalt_store_size(devices[0]));
+
+		if (csalt_store_resize((csalt_store *)&striped, 10) != 10)
+			print_error_and_exit("Resize did not shrink every device");
+		if (csalt_store_size(devices[2]) != 2)
+			print_error_and_exit("Device resized to %ld", csalt_store_size(devices[2]));
+
+		csalt_store_resize((csalt_store *)&striped, 36);
+		csalt_store_resize(devices[1], 4);
+		if (csalt_store_size((csalt_store *)&striped) != 16)
+			print_error_and_exit("Size did not stop at the short device");
+
+		char buffer[36] = { 0 };
+		if (csalt_store_write(store, buffer, sizeof(buffer)) != 16)
+			print_error_and_exit("Write did not stop at the short device");
+		if (csalt_store_read(store, buffer, sizeof(buffer)) != 16)
+			print_error_and_exit("Read did not stop at the short device");
+	}
+
+	{
+		struct csalt_dynamic_store_stub error = csalt_dynamic_store_stub_error();
+		csalt_store *failing[] = {
+			devices[0],
+			(csalt_store *)&error,
+		};
+		struct csalt_store_striped with_error = csalt_store_striped(failing, UNIT, NULL);
+
+		char buffer[UNIT * 2] = { 0 };
+		if (csalt_store_read((csalt_static_store *)&with_error, buffer, sizeof(buffer)) != -1)
+			print_error_and_exit("Device error not returned");
+		if (csalt_store_read((csalt_static_store *)&with_error, buffer, UNIT) != UNIT)
+			print_error_and_exit("Read touched a device outside the range");
+
+		struct csalt_store_striped invalid = csalt_store_striped(devices, 0, NULL);
+		if (csalt_store_read((csalt_static_store *)&invalid, buffer, sizeof(buffer)) != -1)
+			print_error_and_exit("Zero stripe unit accepted");
+	}
+
+	for (int i = 0; i < DEVICES; i++)
+		csalt_resource_deinit(csalt_resource(&heaps[i]));
+
+	{
+		struct csalt_resource_executor resource
+			= csalt_resource_executor(LARGE_DEVICES, LARGE_DEVICES);
+		struct csalt_store_executor *executor = (struct csalt_store_executor *)
+			csalt_static_resource_init((csalt_static_resource *)&resource);
+		if (!executor)
+			print_error_and_exit("Failed to initialize executor");
+
+		struct csalt_resource_heap large[LARGE_DEVICES];
+		csalt_store *large_devices[LARGE_DEVICES];
+		for (int i = 0; i < LARGE_DEVICES; i++) {
+			large[i] = csalt_resource_heap(LARGE_SIZE / LARGE_DEVICES);
+			large_devices[i] = csalt_resource_init(csalt_resource(&large[i]));
+		}
+
+		struct csalt_store_striped concurrent
+			= csalt_store_striped(large_devices, LARGE_UNIT, &executor->parallel);
+
+		static char data[LARGE_SIZE];
+		static char buffer[LARGE_SIZE];
+		for (int i = 0; i < LARGE_SIZE; i++)
+			data[i] = (char)(i * 7 + i / 251);
+
+		if (csalt_store_write((csalt_static_store *)&concurrent, data, LARGE_SIZE) != LARGE_SIZE)
+			print_error_and_exit("Concurrent write failed");
+		if (csalt_store_read((csalt_static_store *)&concurrent, buffer, LARGE_SIZE) != LARGE_SIZE)
+			print_error_and_exit("Concurrent read failed");
+		if (memcmp(data, buffer, LARGE_SIZE))
+			print_error_and_exit("Concurrent read returned different data");
+
+		const char *third = large[2].store.begin;
+		if (memcmp(third + LARGE_UNIT, data + LARGE_UNIT * (LARGE_DEVICES + 2), LARGE_UNIT))
+			print_error_and_exit("Concurrent stripes not placed round-robin");
+
+		for (int i = 0; i < LARGE_DEVICES; i++)
+			csalt_resource_deinit(csalt_resource(&large[i]));
+		csalt_resource_deinit(csalt_resource(&resource));
+	}
+
+	return EXIT_SUCCESS;
+}
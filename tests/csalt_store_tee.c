@@ -0,0 +1,288 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <csalt/stores.h>
+#include <csalt/resources.h>
+
+#include "test_macros.h"
+
+#include <string.h>
+
+#define MESSAGE_SIZE 1000
+
+/*
+ * A sink which accepts at most `chunk` bytes per write, like a
+ * non-blocking socket, and appends them to a buffer.
+ */
+struct chunked_sink {
+	const struct csalt_static_store_interface *vtable;
+	char buffer[MESSAGE_SIZE * 2];
+	ssize_t length;
+	ssize_t chunk;
+	int fail_next;
+	int writes;
+};
+
+static ssize_t chunked_read(csalt_static_store *store, void *buffer, ssize_t size)
+{
+	struct chunked_sink *const sink = (struct chunked_sink *)store;
+	const ssize_t amount = csalt_min(size, sink->length);
+	memcpy(buffer, sink->buffer, (size_t)amount);
+	return amount;
+}
+
+static ssize_t chunked_write(csalt_static_store *store, const void *buffer, ssize_t size)
+{
+	struct chunked_sink *const sink = (struct chunked_sink *)store;
+	sink->writes++;
+	if (sink->fail_next) {
+		sink->fail_next = 0;
+		return -1;
+	}
+
+	const ssize_t amount = csalt_min(
+		csalt_min(size, sink->chunk),
+		(ssize_t)sizeof(sink->buffer) - sink->length);
+	memcpy(sink->buffer + sink->length, buffer, (size_t)amount);
+	sink->length += amount;
+	return amount;
+}
+
+static int chunked_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
+
+static const struct csalt_static_store_interface chunked_impl = {
+	chunked_read,
+	chunked_write,
+	chunked_split,
+	NULL,
+};
+
+static struct chunked_sink chunked_sink(ssize_t chunk)
+{
+	return (struct chunked_sink) {
+		.vtable = &chunked_impl,
+		.chunk = chunk,
+	};
+}
+
+char message[MESSAGE_SIZE];
+
+// Writes the rest of the message, from where the tee got to
+static void write_until_complete(
+	struct csalt_store_tee *tee,
+	ssize_t done,
+	int allow_errors
+)
+{
+	int attempts = 0;
+	while (done != MESSAGE_SIZE) {
+		const ssize_t result = csalt_store_write(
+			(csalt_static_store *)tee,
+			message + done,
+			MESSAGE_SIZE - done);
+		if (result < 0 && !allow_errors)
+			print_error_and_exit("Tee write failed");
+		if (result > 0)
+			done += result;
+		if (++attempts > MESSAGE_SIZE)
+			print_error_and_exit("Tee write made no progress");
+	}
+}
+
+static void expect_message(const struct chunked_sink *sink, ssize_t copies)
+{
+	if (sink->length != MESSAGE_SIZE * copies)
+		print_error_and_exit("Sink received %ld bytes", sink->length);
+	for (ssize_t i = 0; i < copies; i++)
+		if (memcmp(sink->buffer + i * MESSAGE_SIZE, message, MESSAGE_SIZE))
+			print_error_and_exit("Sink received corrupted data");
+}
+
+static int use_executor(csalt_static_store *store, void *param)
+{
+	(void)param;
+	struct chunked_sink
+		fast = chunked_sink(MESSAGE_SIZE),
+		medium = chunked_sink(300),
+		slow = chunked_sink(64);
+
+	csalt_static_store *sinks[] = {
+		(csalt_static_store *)&fast,
+		(csalt_static_store *)&medium,
+		(csalt_static_store *)&slow,
+	};
+	struct csalt_progress progress[csalt_arrlength(sinks)];
+
+	struct csalt_store_tee tee = csalt_store_tee(
+		sinks,
+		progress,
+		&((struct csalt_store_executor *)store)->parallel);
+
+	write_until_complete(&tee, 0, 0);
+	write_until_complete(&tee, 0, 0);
+
+	expect_message(&fast, 2);
+	expect_message(&medium, 2);
+	expect_message(&slow, 2);
+	return 0;
+}
+
+int main()
+{
+	for (int i = 0; i < MESSAGE_SIZE; i++)
+		message[i] = (char)(i % 128);
+
+	{
+		struct chunked_sink
+			fast = chunked_sink(MESSAGE_SIZE),
+			slow = chunked_sink(100);
+
+		csalt_static_store *sinks[] = {
+			(csalt_static_store *)&fast,
+			(csalt_static_store *)&slow,
+		};
+		struct csalt_progress progress[csalt_arrlength(sinks)];
+
+		struct csalt_store_tee tee = csalt_store_tee(sinks, progress, NULL);
+
+		const ssize_t first = csalt_store_write(
+			(csalt_static_store *)&tee,
+			message,
+			MESSAGE_SIZE);
+
+		if (first != 100)
+			print_error_and_exit("Tee didn't report the slowest sink: %ld", first);
+		if (csalt_store_tee_position(&tee) != 100)
+			print_error_and_exit("Unexpected tee position");
+
+		write_until_complete(&tee, first, 0);
+
+		if (fast.writes != 1)
+			print_error_and_exit("Completed sink was written again: %d", fast.writes);
+		expect_message(&fast, 1);
+		expect_message(&slow, 1);
+
+		char buffer[MESSAGE_SIZE] = { 0 };
+		if (csalt_store_read((csalt_static_store *)&tee, buffer, MESSAGE_SIZE) != MESSAGE_SIZE)
+			print_error_and_exit("Read from first sink failed");
+	}
+
+	{
+		struct chunked_sink
+			failing = chunked_sink(200),
+			healthy = chunked_sink(MESSAGE_SIZE);
+		failing.fail_next = 1;
+
+		csalt_static_store *sinks[] = {
+			(csalt_static_store *)&failing,
+			(csalt_static_store *)&healthy,
+		};
+		struct csalt_progress progress[csalt_arrlength(sinks)];
+
+		struct csalt_store_tee tee = csalt_store_tee(sinks, progress, NULL);
+
+		if (csalt_store_write((csalt_static_store *)&tee, message, MESSAGE_SIZE) != -1)
+			print_error_and_exit("Sink error not reported");
+
+		write_until_complete(&tee, 0, 1);
+
+		expect_message(&failing, 1);
+		expect_message(&healthy, 1);
+	}
+
+	{
+		char a[MESSAGE_SIZE] = { 0 }, b[MESSAGE_SIZE] = { 0 };
+		struct csalt_store_memory
+			memory_a = csalt_store_memory_array(a),
+			memory_b = csalt_store_memory_array(b);
+
+		csalt_static_store *sinks[] = {
+			(csalt_static_store *)&memory_a,
+			(csalt_static_store *)&memory_b,
+		};
+		struct csalt_progress progress[csalt_arrlength(sinks)];
+
+		struct csalt_store_tee tee = csalt_store_tee(sinks, progress, NULL);
+
+		struct csalt_store_memory source = csalt_store_memory_array(message);
+		struct csalt_progress transfer = csalt_progress(MESSAGE_SIZE);
+		while (csalt_store_transfer(
+			&transfer,
+			(csalt_static_store *)&source,
+			(csalt_static_store *)&tee
+		) < MESSAGE_SIZE);
+
+		if (memcmp(a, message, MESSAGE_SIZE) || memcmp(b, message, MESSAGE_SIZE))
+			print_error_and_exit("Transfer through split tee failed");
+	}
+
+	{
+		struct chunked_sink
+			fast = chunked_sink(MESSAGE_SIZE),
+			slow = chunked_sink(45);
+
+		csalt_static_store *sinks[] = {
+			(csalt_static_store *)&fast,
+			(csalt_static_store *)&slow,
+		};
+		struct csalt_progress progress[csalt_arrlength(sinks)];
+
+		struct csalt_store_tee tee = csalt_store_tee(sinks, progress, NULL);
+
+		struct csalt_store_memory source = csalt_store_memory_array(message);
+		struct csalt_progress transfer = csalt_progress(MESSAGE_SIZE);
+		for (int attempts = 0; !csalt_progress_complete(&transfer); attempts++) {
+			if (csalt_store_transfer(
+				&transfer,
+				(csalt_static_store *)&source,
+				(csalt_static_store *)&tee
+			) < 0)
+				print_error_and_exit("Transfer through tee failed");
+			if (attempts > MESSAGE_SIZE)
+				print_error_and_exit("Transfer through tee made no progress");
+		}
+
+		expect_message(&fast, 1);
+		expect_message(&slow, 1);
+	}
+
+	{
+		struct csalt_resource_executor
+			executor = csalt_resource_executor(3, 4);
+
+		if (csalt_static_resource_use(
+			(csalt_static_resource *)&executor,
+			use_executor,
+			NULL
+		))
+			print_error_and_exit("Concurrent tee tests failed");
+	}
+
+	return EXIT_SUCCESS;
+}
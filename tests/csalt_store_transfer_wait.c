@@ -0,0 +1,267 @@
+/*
+ * Ceasoning - Syntactic Sugar for Common C Tasks
+ * Copyright (C) 2024   Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_macros.h"
+
+#include <csalt/stores.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#define CHUNK 1000
+#define CHUNKS 4
+#define LARGE (256 * 1024)
+
+struct pipe_store {
+	const struct csalt_static_store_interface *vtable;
+	int fd;
+};
+
+static ssize_t pipe_read(csalt_static_store *store, void *buffer, ssize_t size)
+{
+	return read(((struct pipe_store *)store)->fd, buffer, (size_t)size);
+}
+
+static ssize_t pipe_write(csalt_static_store *store, const void *buffer, ssize_t size)
+{
+	return write(((struct pipe_store *)store)->fd, buffer, (size_t)size);
+}
+
+static int pipe_split(
+	csalt_static_store *store,
+	ssize_t begin,
+	ssize_t end,
+	csalt_static_store_block_fn *block,
+	void *param
+)
+{
+	(void)begin;
+	(void)end;
+	return block(store, param);
+}
+
+static int pipe_fd(csalt_static_store *store)
+{
+	return ((struct pipe_store *)store)->fd;
+}
+
+static const struct csalt_static_store_interface pipe_impl = {
+	pipe_read,
+	pipe_write,
+	pipe_split,
+	pipe_fd,
+};
+
+char source[LARGE], destination[LARGE];
+int fds[2];
+
+static long long elapsed_ms(clockid_t clock, const struct timespec *since)
+{
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return (now.tv_sec - since->tv_sec) * 1000LL
+		+ (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static void *slow_writer(void *param)
+{
+	(void)param;
+	for (int i = 0; i < CHUNKS; i++) {
+		usleep(50 * 1000);
+		if (write(fds[1], source + i * CHUNK, CHUNK) != CHUNK)
+			print_error_and_exit("Writer failed");
+	}
+	return NULL;
+}
+
+static void *slow_reader(void *param)
+{
+	(void)param;
+	for (ssize_t total = 0; total < LARGE;) {
+		usleep(10 * 1000);
+		const ssize_t amount = read(fds[0], destination + total, LARGE - total);
+		if (amount <= 0)
+			print_error_and_exit("Reader failed");
+		total += amount;
+	}
+	return NULL;
+}
+
+int main()
+{
+	for (int i = 0; i < LARGE; i++)
+		source[i] = (char)(i * 7);
+
+	{
+		struct csalt_store_memory
+			from = csalt_store_memory_array(source),
+			to = csalt_store_memory_array(destination);
+
+		if (csalt_store_fd((csalt_static_store *)&from) != -1)
+			print_error_and_exit("Memory store returned a file descriptor");
+
+		struct csalt_progress progress = csalt_progress(LARGE);
+		if (csalt_store_transfer_wait(
+			&progress,
+			(csalt_static_store *)&from,
+			(csalt_static_store *)&to,
+			-1
+		) != LARGE)
+			print_error_and_exit("Memory transfer incomplete");
+		if (memcmp(source, destination, LARGE))
+			print_error_and_exit("Memory transfer corrupted");
+	}
+
+	{
+		char small[16] = { 0 };
+		struct csalt_store_memory
+			from = csalt_store_memory_array(source),
+			empty = csalt_store_memory_bounds(destination, destination),
+			short_source = csalt_store_memory_array(small),
+			to = csalt_store_memory_array(destination);
+
+		struct csalt_progress progress = csalt_progress(sizeof(small));
+		if (csalt_store_transfer_wait(
+			&progress,
+			(csalt_static_store *)&from,
+			(csalt_static_store *)&empty,
+			-1
+		) != 0)
+			print_error_and_exit("Transfer into an empty store didn't stop");
+
+		progress = csalt_progress(sizeof(small) * 2);
+		if (csalt_store_transfer_wait(
+			&progress,
+			(csalt_static_store *)&short_source,
+			(csalt_static_store *)&to,
+			-1
+		) != sizeof(small))
+			print_error_and_exit("Transfer didn't stop at the end of the source");
+	}
+
+	{
+		if (pipe2(fds, O_NONBLOCK))
+			print_error_and_exit("Unable to create pipe");
+
+		struct pipe_store input = { &pipe_impl, fds[0] };
+		struct csalt_store_memory output = csalt_store_memory_array(destination);
+		memset(destination, 0, sizeof(destination));
+
+		if (csalt_store_fd((csalt_static_store *)&input) != fds[0])
+			print_error_and_exit("Store's file descriptor not returned");
+
+		pthread_t writer;
+		pthread_create(&writer, NULL, slow_writer, NULL);
+
+		struct timespec wall, cpu;
+		clock_gettime(CLOCK_MONOTONIC, &wall);
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+
+		struct csalt_progress progress = csalt_progress(CHUNK * CHUNKS);
+		if (csalt_store_transfer_wait(
+			&progress,
+			(csalt_static_store *)&input,
+			(csalt_static_store *)&output,
+			-1
+		) != CHUNK * CHUNKS)
+			print_error_and_exit("Pipe transfer incomplete");
+
+		const long long waited = elapsed_ms(CLOCK_MONOTONIC, &wall);
+		const long long busy = elapsed_ms(CLOCK_THREAD_CPUTIME_ID, &cpu);
+		pthread_join(writer, NULL);
+
+		if (memcmp(source, destination, CHUNK * CHUNKS))
+			print_error_and_exit("Pipe transfer corrupted");
+		if (busy * 2 > waited)
+			print_error_and_exit("Spent %lldms of %lldms on the CPU", busy, waited);
+
+		progress = csalt_progress(CHUNK);
+		clock_gettime(CLOCK_MONOTONIC, &wall);
+		if (csalt_store_transfer_wait(
+			&progress,
+			(csalt_static_store *)&input,
+			(csalt_static_store *)&output,
+			50
+		) != 0)
+			print_error_and_exit("Transfer with no data didn't time out");
+		if (elapsed_ms(CLOCK_MONOTONIC, &wall) < 45)
+			print_error_and_exit("Transfer returned before timeout");
+
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	{
+		if (pipe2(fds, O_NONBLOCK))
+			print_error_and_exit("Unable to create pipe");
+
+		struct csalt_store_memory input = csalt_store_memory_array(source);
+		struct pipe_store output = { &pipe_impl, fds[1] };
+		memset(destination, 0, sizeof(destination));
+
+		pthread_t reader;
+		pthread_create(&reader, NULL, slow_reader, NULL);
+
+		struct csalt_progress progress = csalt_progress(LARGE);
+		if (csalt_store_transfer_wait(
+			&progress,
+			(csalt_static_store *)&input,
+			(csalt_static_store *)&output,
+			-1
+		) != LARGE)
+			print_error_and_exit("Transfer into full pipe incomplete");
+
+		pthread_join(reader, NULL);
+		if (memcmp(source, destination, LARGE))
+			print_error_and_exit("Transfer into full pipe corrupted");
+
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	{
+		if (pipe2(fds, O_NONBLOCK))
+			print_error_and_exit("Unable to create pipe");
+
+		struct csalt_store_memory input = csalt_store_memory_array(source);
+		struct pipe_store output = { &pipe_impl, fds[1] };
+
+		struct csalt_progress progress = csalt_progress(LARGE);
+		const ssize_t sent = csalt_store_transfer_wait(
+			&progress,
+			(csalt_static_store *)&input,
+			(csalt_static_store *)&output,
+			50);
+
+		int queued = 0;
+		ioctl(fds[0], FIONREAD, &queued);
+		if (sent <= 0 || sent == LARGE)
+			print_error_and_exit("Transfer into unread pipe didn't time out: %ld", sent);
+		if (sent != queued)
+			print_error_and_exit("Reported %ld bytes but %d reached the pipe", sent, queued);
+
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	return EXIT_SUCCESS;
+}
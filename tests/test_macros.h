@@ -117,6 +117,7 @@ struct csalt_dynamic_store_interface csalt_dynamic_store_stub_interface = {
 		csalt_static_store_stub_read,
 		csalt_static_store_stub_write,
 		csalt_static_store_stub_split,
+		NULL,
 	},
 	csalt_dynamic_store_stub_size,
 	csalt_dynamic_store_stub_resize,
@@ -174,6 +175,7 @@ struct csalt_dynamic_store_interface csalt_dynamic_store_stub_error_implementati
 		csalt_static_store_stub_error_read,
 		csalt_static_store_stub_error_write,
 		csalt_static_store_stub_split,
+		NULL,
 	},
 	csalt_dynamic_store_stub_error_size,
 	csalt_dynamic_store_stub_error_resize,
@@ -215,6 +217,7 @@ struct csalt_dynamic_store_interface csalt_dynamic_store_stub_zero_implementatio
 		csalt_static_store_stub_zero_read,
 		csalt_static_store_stub_zero_write,
 		csalt_static_store_stub_split,
+		NULL,
 	},
 	csalt_dynamic_store_stub_size,
 	csalt_dynamic_store_stub_resize,